@@ -0,0 +1,35 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: benchcase.hpp
+ *        Created: 12/04/2017 10:40:03
+ *  Last Modified: 12/17/2017 21:10:32
+ *
+ *    Description: all benchmark cases, one function for each component
+ *
+ *                 case name is "component/operation/parameter", keep it unchanged
+ *                 once added, it's the key to compare results between releases
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include "benchrunner.hpp"
+
+void AddMemoryPoolCase (BenchRunner &);
+void AddCacheQueueCase (BenchRunner &);
+void AddInnDBCase      (BenchRunner &);
+void AddCompressCase   (BenchRunner &);
+void AddPathFinderCase (BenchRunner &);
+void AddMessagePackCase(BenchRunner &);
+void AddMapDataCase    (BenchRunner &);
+void AddSchedulerCase  (BenchRunner &);
+void AddUIDSlotCase    (BenchRunner &);
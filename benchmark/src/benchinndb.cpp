@@ -0,0 +1,151 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: benchinndb.cpp
+ *        Created: 12/04/2017 11:30:56
+ *  Last Modified: 12/04/2017 21:36:15
+ *
+ *    Description: CacheQueue and InnDB with a trivial resource
+ *
+ *                 only the cache overhead is measured, LoadResource() is cheap, the key
+ *                 set size decides where most lookups end:
+ *
+ *                      hot  : linear cache
+ *                      warm : main cache
+ *                      miss : LoadResource() and eviction
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <random>
+#include <string>
+#include <vector>
+#include "inndb.hpp"
+#include "benchcase.hpp"
+#include "cachequeue.hpp"
+
+namespace
+{
+    constexpr size_t BENCH_LCDEEP = 4;
+    constexpr size_t BENCH_LCLEN  = 256;
+    constexpr size_t BENCH_RESMAX = 4096;
+
+    class BenchDB: public InnDB<uint32_t, uint32_t, BENCH_LCDEEP, BENCH_LCLEN, BENCH_RESMAX>
+    {
+        public:
+            BenchDB()
+                : InnDB<uint32_t, uint32_t, BENCH_LCDEEP, BENCH_LCLEN, BENCH_RESMAX>()
+            {}
+
+            // ~InnDB() calls FreeResource() when cache not empty
+            // it's pure virtual there, clear while BenchDB is alive
+            virtual ~BenchDB()
+            {
+                ClearCache();
+            }
+
+        public:
+            uint32_t Retrieve(uint32_t nKey)
+            {
+                uint32_t nResource = 0;
+                InnRetrieve(nKey, &nResource, [](uint32_t nLCKey) -> size_t
+                {
+                    return nLCKey % BENCH_LCLEN;
+                }, nullptr);
+                return nResource;
+            }
+
+        public:
+            virtual uint32_t LoadResource(uint32_t nKey)
+            {
+                return nKey * 2 + 1;
+            }
+
+            virtual void FreeResource(uint32_t &)
+            {
+            }
+    };
+
+    std::vector<uint32_t> MakeKeyV(size_t nKeySetSize)
+    {
+        // fixed seed
+        // same key sequence for every build
+        std::mt19937 stRandGen(12345);
+        std::uniform_int_distribution<uint32_t> stKeyDist(0, (uint32_t)(nKeySetSize - 1));
+
+        std::vector<uint32_t> stKeyV(1 << 16);
+        for(auto &nKey: stKeyV){
+            nKey = stKeyDist(stRandGen);
+        }
+        return stKeyV;
+    }
+}
+
+void AddCacheQueueCase(BenchRunner &rstRunner)
+{
+    rstRunner.Add("CacheQueue/PushHead/16", 0, [](uint64_t nIteration)
+    {
+        CacheQueue<uint64_t, 16> stQueue;
+        for(uint64_t nIndex = 0; nIndex < nIteration; ++nIndex){
+            stQueue.PushHead(nIndex);
+        }
+
+        Bench::DoNotOptimize(stQueue.Head());
+        return stQueue.Head() == nIteration - 1;
+    });
+
+    // the way InnDB searches the linear cache
+    // full traversal of a full queue
+    rstRunner.Add("CacheQueue/Traverse/16", 0, [](uint64_t nIteration)
+    {
+        CacheQueue<uint64_t, 16> stQueue;
+        for(uint64_t nIndex = 0; nIndex < 16; ++nIndex){
+            stQueue.PushHead(nIndex);
+        }
+
+        uint64_t nSum = 0;
+        for(uint64_t nIndex = 0; nIndex < nIteration; ++nIndex){
+            for(stQueue.Reset(); !stQueue.Done(); stQueue.Forward()){
+                nSum += stQueue.Current();
+            }
+            Bench::ClobberMemory();
+        }
+
+        Bench::DoNotOptimize(nSum);
+        return nSum == nIteration * 120;
+    });
+}
+
+void AddInnDBCase(BenchRunner &rstRunner)
+{
+    struct KeySet
+    {
+        const char *Name;
+        size_t      Size;
+    };
+
+    for(auto &rstKeySet: std::vector<KeySet>{{"hot", 64}, {"warm", 2048}, {"miss", 65536}}){
+        auto stKeyV = MakeKeyV(rstKeySet.Size);
+        rstRunner.Add((std::string("InnDB/Retrieve/") + rstKeySet.Name + "/" + std::to_string(rstKeySet.Size)).c_str(), 0, [stKeyV](uint64_t nIteration)
+        {
+            // time stamp queue only shrinks when evicting
+            // use a new db for each run to keep memory bounded
+            BenchDB stDB;
+            for(uint64_t nIndex = 0; nIndex < nIteration; ++nIndex){
+                auto nKey = stKeyV[nIndex % stKeyV.size()];
+                if(stDB.Retrieve(nKey) != nKey * 2 + 1){
+                    return false;
+                }
+            }
+            return true;
+        });
+    }
+}
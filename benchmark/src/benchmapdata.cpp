@@ -0,0 +1,158 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: benchmapdata.cpp
+ *        Created: 12/04/2017 16:25:10
+ *  Last Modified: 12/06/2017 23:07:51
+ *
+ *    Description: Mir2xMapData::Load() of a synthetic map
+ *
+ *                 map is made by Allocate() and Save() to a temporary file, then read
+ *                 from the page cache in each iteration, it's the load cost rather than
+ *                 the disk speed
+ *
+ *                 LoadPack mmaps the same map in a MapBinPack and views it, compare it to
+ *                 LoadFile for the server startup
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include "benchcase.hpp"
+#include "mapbinpack.hpp"
+#include "mir2xmapdata.hpp"
+
+namespace
+{
+    std::string MakeTempFile()
+    {
+        char szFileName[] = "/tmp/mir2xbench_XXXXXX";
+        auto nFD = mkstemp(szFileName);
+        if(nFD < 0){
+            return "";
+        }
+
+        close(nFD);
+        return szFileName;
+    }
+
+    std::string MakeMapFile(int nW, int nH, bool bPack)
+    {
+        Mir2xMapData stMapData;
+        if(!stMapData.Allocate((uint16_t)(nW), (uint16_t)(nH))){
+            return "";
+        }
+
+        // walkable with some land types
+        // content doesn't matter for loading
+        for(int nX = 0; nX < nW; ++nX){
+            for(int nY = 0; nY < nH; ++nY){
+                stMapData.Cell(nX, nY).Param = 0X00800000 | ((uint32_t)((nX * 7 + nY * 13) % 64) << 16);
+            }
+        }
+
+        auto szFileName = MakeTempFile();
+        if(szFileName.empty()){
+            return "";
+        }
+
+        auto bSaveOK = bPack ? MapBinPack::Save(szFileName.c_str(), {{1, &stMapData}}) : stMapData.Save(szFileName.c_str());
+        if(!bSaveOK){
+            std::remove(szFileName.c_str());
+            return "";
+        }
+        return szFileName;
+    }
+}
+
+void AddMapDataCase(BenchRunner &rstRunner)
+{
+    for(int nSize: {256, 1024}){
+        auto szFileName = MakeMapFile(nSize, nSize, false);
+        auto szPackName = MakeMapFile(nSize, nSize, true);
+        if(szFileName.empty() || szPackName.empty()){
+            std::fprintf(stderr, "Failed to create map file for %dx%d\n", nSize, nSize);
+            continue;
+        }
+
+        // removed at exit
+        // file is needed until all cases done
+        static std::vector<std::string> s_FileNameV;
+        if(s_FileNameV.empty()){
+            std::atexit([]()
+            {
+                for(auto &szFile: s_FileNameV){
+                    std::remove(szFile.c_str());
+                }
+            });
+        }
+        s_FileNameV.push_back(szFileName);
+        s_FileNameV.push_back(szPackName);
+
+        std::vector<uint8_t> stFileV;
+        if(auto fp = std::fopen(szFileName.c_str(), "rb")){
+            std::fseek(fp, 0, SEEK_END);
+            stFileV.resize(std::ftell(fp));
+            std::fseek(fp, 0, SEEK_SET);
+
+            if(std::fread(&(stFileV[0]), stFileV.size(), 1, fp) != 1){
+                stFileV.clear();
+            }
+            std::fclose(fp);
+        }
+
+        auto szSuffix = "/" + std::to_string(nSize) + "x" + std::to_string(nSize);
+        rstRunner.Add(("Mir2xMapData/LoadFile" + szSuffix).c_str(), stFileV.size(), [szFileName, nSize](uint64_t nIteration)
+        {
+            for(uint64_t nIndex = 0; nIndex < nIteration; ++nIndex){
+                Mir2xMapData stMapData;
+                if(!stMapData.Load(szFileName.c_str()) || stMapData.W() != nSize){
+                    return false;
+                }
+                Bench::DoNotOptimize(stMapData);
+            }
+            return true;
+        });
+
+        rstRunner.Add(("Mir2xMapData/LoadBuffer" + szSuffix).c_str(), stFileV.size(), [stFileV, nSize](uint64_t nIteration)
+        {
+            for(uint64_t nIndex = 0; nIndex < nIteration; ++nIndex){
+                Mir2xMapData stMapData;
+                if(stFileV.empty() || !stMapData.Load(&(stFileV[0]), stFileV.size()) || stMapData.H() != nSize){
+                    return false;
+                }
+                Bench::DoNotOptimize(stMapData);
+            }
+            return true;
+        });
+
+        rstRunner.Add(("Mir2xMapData/LoadPack" + szSuffix).c_str(), stFileV.size(), [szPackName, nSize](uint64_t nIteration)
+        {
+            for(uint64_t nIndex = 0; nIndex < nIteration; ++nIndex){
+                MapBinPack stPack;
+                if(!stPack.Load(szPackName.c_str())){
+                    return false;
+                }
+
+                const Mir2xMapData stMapData = *(stPack.Retrieve(1));
+                if(stMapData.W() != nSize || !stMapData.Cell(nSize - 1, nSize - 1).CanWalk()){
+                    return false;
+                }
+                Bench::DoNotOptimize(stMapData);
+            }
+            return true;
+        });
+    }
+}
@@ -0,0 +1,124 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: benchmemorypool.cpp
+ *        Created: 12/04/2017 10:52:17
+ *  Last Modified: 12/04/2017 21:36:15
+ *
+ *    Description: MemoryChunkPN / MemoryBlockPN, with operator new as reference
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <string>
+#include <vector>
+#include <memory>
+#include "benchcase.hpp"
+#include "memoryblockpn.hpp"
+#include "memorychunkpn.hpp"
+
+void AddMemoryPoolCase(BenchRunner &rstRunner)
+{
+    // pools are shared by all iterations of a case
+    // same as in the server they live as long as the program
+    static MemoryChunkPN<64, 256, 1> s_ChunkPN1;
+    static MemoryChunkPN<64, 256, 4> s_ChunkPN4;
+    static MemoryBlockPN<64, 1024, 1> s_BlockPN1;
+    static MemoryBlockPN<64, 1024, 4> s_BlockPN4;
+
+    for(size_t nSize: {16, 256, 4096}){
+        rstRunner.Add(("MemoryChunkPN/GetFree/B1/" + std::to_string(nSize)).c_str(), 0, [nSize](uint64_t nIteration)
+        {
+            for(uint64_t nIndex = 0; nIndex < nIteration; ++nIndex){
+                auto pBuf = s_ChunkPN1.Get(nSize);
+                Bench::DoNotOptimize(pBuf);
+                s_ChunkPN1.Free(pBuf);
+            }
+            return true;
+        });
+
+        rstRunner.Add(("MemoryChunkPN/GetFree/B4/" + std::to_string(nSize)).c_str(), 0, [nSize](uint64_t nIteration)
+        {
+            for(uint64_t nIndex = 0; nIndex < nIteration; ++nIndex){
+                auto pBuf = s_ChunkPN4.Get(nSize);
+                Bench::DoNotOptimize(pBuf);
+                s_ChunkPN4.Free(pBuf);
+            }
+            return true;
+        });
+
+        rstRunner.Add(("OperatorNew/GetFree/" + std::to_string(nSize)).c_str(), 0, [nSize](uint64_t nIteration)
+        {
+            for(uint64_t nIndex = 0; nIndex < nIteration; ++nIndex){
+                auto pBuf = new uint8_t[nSize];
+                Bench::DoNotOptimize(pBuf);
+                delete [] pBuf;
+            }
+            return true;
+        });
+    }
+
+    // 128 live buffers of mixed size
+    // exercises split and merge of the buddy tree
+    rstRunner.Add("MemoryChunkPN/Burst128/B1/mixed", 0, [](uint64_t nIteration)
+    {
+        static const size_t s_SizeV[] = {24, 100, 64, 700, 32, 250, 1500, 64};
+        std::vector<void *> stBufV(128, nullptr);
+
+        for(uint64_t nIndex = 0; nIndex < nIteration; nIndex += stBufV.size()){
+            for(size_t nBuf = 0; nBuf < stBufV.size(); ++nBuf){
+                stBufV[nBuf] = s_ChunkPN1.Get(s_SizeV[nBuf % 8]);
+            }
+
+            Bench::ClobberMemory();
+            for(auto pBuf: stBufV){
+                s_ChunkPN1.Free(pBuf);
+            }
+        }
+        return true;
+    });
+
+    rstRunner.Add("MemoryBlockPN/GetFree/B1/64", 0, [](uint64_t nIteration)
+    {
+        for(uint64_t nIndex = 0; nIndex < nIteration; ++nIndex){
+            auto pBuf = s_BlockPN1.Get();
+            Bench::DoNotOptimize(pBuf);
+            s_BlockPN1.Free(pBuf);
+        }
+        return true;
+    });
+
+    rstRunner.Add("MemoryBlockPN/GetFree/B4/64", 0, [](uint64_t nIteration)
+    {
+        for(uint64_t nIndex = 0; nIndex < nIteration; ++nIndex){
+            auto pBuf = s_BlockPN4.Get();
+            Bench::DoNotOptimize(pBuf);
+            s_BlockPN4.Free(pBuf);
+        }
+        return true;
+    });
+
+    rstRunner.Add("MemoryBlockPN/Burst128/B1/64", 0, [](uint64_t nIteration)
+    {
+        std::vector<void *> stBufV(128, nullptr);
+        for(uint64_t nIndex = 0; nIndex < nIteration; nIndex += stBufV.size()){
+            for(auto &pBuf: stBufV){
+                pBuf = s_BlockPN1.Get();
+            }
+
+            Bench::ClobberMemory();
+            for(auto pBuf: stBufV){
+                s_BlockPN1.Free(pBuf);
+            }
+        }
+        return true;
+    });
+}
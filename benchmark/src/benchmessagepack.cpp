@@ -0,0 +1,79 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: benchmessagepack.cpp
+ *        Created: 12/04/2017 15:02:48
+ *  Last Modified: 12/04/2017 21:36:15
+ *
+ *    Description: MessagePack of the monoserver
+ *
+ *                 small message lives in the static buffer, large one goes to the
+ *                 payload from g_MemoryPN and copies share it by ref-count
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <string>
+#include <vector>
+#include <utility>
+#include "memorypn.hpp"
+#include "benchcase.hpp"
+#include "messagepack.hpp"
+
+// memorypn.cpp reports a second instance by g_MonoServer
+// benchmark has no server, define the plain one here
+MemoryPN::MemoryPN()
+    : MemoryChunkPN<64, 256, 4>()
+{}
+
+MemoryPN *g_MemoryPN = nullptr;
+
+void AddMessagePackCase(BenchRunner &rstRunner)
+{
+    if(!g_MemoryPN){
+        g_MemoryPN = new MemoryPN();
+    }
+
+    for(size_t nDataLen: {16, 256}){
+        auto szSuffix = "/" + std::to_string(nDataLen);
+        std::vector<uint8_t> stDataV(nDataLen, 0X5A);
+
+        rstRunner.Add(("MessagePack/Construct" + szSuffix).c_str(), 0, [stDataV](uint64_t nIteration)
+        {
+            for(uint64_t nIndex = 0; nIndex < nIteration; ++nIndex){
+                MessagePack stMPK(MPK_ACTION, &(stDataV[0]), stDataV.size(), 1, 0);
+                Bench::DoNotOptimize(stMPK);
+            }
+            return true;
+        });
+
+        rstRunner.Add(("MessagePack/Copy" + szSuffix).c_str(), 0, [stDataV](uint64_t nIteration)
+        {
+            MessagePack stMPK(MPK_ACTION, &(stDataV[0]), stDataV.size(), 1, 0);
+            for(uint64_t nIndex = 0; nIndex < nIteration; ++nIndex){
+                MessagePack stCopyMPK(stMPK);
+                Bench::DoNotOptimize(stCopyMPK);
+            }
+            return stMPK.DataLen() == stDataV.size() && (stDataV.size() <= 64 || stMPK.Payload().RefCount() == 1);
+        });
+
+        rstRunner.Add(("MessagePack/Move" + szSuffix).c_str(), 0, [stDataV](uint64_t nIteration)
+        {
+            MessagePack stMPK(MPK_ACTION, &(stDataV[0]), stDataV.size(), 1, 0);
+            for(uint64_t nIndex = 0; nIndex < nIteration; ++nIndex){
+                MessagePack stMovedMPK(std::move(stMPK));
+                Bench::DoNotOptimize(stMovedMPK);
+                stMPK = std::move(stMovedMPK);
+            }
+            return stMPK.DataLen() == stDataV.size();
+        });
+    }
+}
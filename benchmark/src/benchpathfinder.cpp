@@ -0,0 +1,198 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: benchpathfinder.cpp
+ *        Created: 12/04/2017 13:47:25
+ *  Last Modified: 12/09/2017 23:35:42
+ *
+ *    Description: AStarPathFinder, JPSPathFinder and NavGraph on synthetic maps
+ *
+ *                      open   : no obstacle
+ *                      random : 20% random blocked cells
+ *                      wall   : vertical walls with one gap each, long detour
+ *
+ *                 search from top-left to bottom-right, same map for every build
+ *                 AStarSearch() allocates 1000 nodes by default, searches exceed it fail
+ *                 and that's the cost we pay in server as well, so only small open map
+ *                 is required to find the path, others check the result is stable
+ *
+ *                 JPSPathFinder has no node limit, it must find the path on all maps
+ *                 NavGraph gives waypoints only, graph is built once out of the timing,
+ *                 it can miss diagonal-only crossings of random map, checked as stable
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "mathfunc.hpp"
+#include "bitgrid.hpp"
+#include "benchcase.hpp"
+#include "pathfinder.hpp"
+#include "jpspathfinder.hpp"
+#include "navgraph.hpp"
+
+namespace
+{
+    struct BenchMap
+    {
+        int W;
+        int H;
+        std::vector<uint8_t> Block;
+
+        BenchMap(int nW, int nH)
+            : W(nW)
+            , H(nH)
+            , Block(nW * nH, 0)
+        {}
+
+        BitGrid Ground() const
+        {
+            BitGrid stGround(W, H);
+            for(int nY = 0; nY < H; ++nY){
+                for(int nX = 0; nX < W; ++nX){
+                    stGround.Set(nX, nY, CanWalk(nX, nY));
+                }
+            }
+            return stGround;
+        }
+
+        bool CanWalk(int nX, int nY) const
+        {
+            return nX >= 0 && nX < W && nY >= 0 && nY < H && !Block[nX + nY * W];
+        }
+
+        // check all grids on the segment
+        // segment is straight since max step is 3
+        bool CanMove(int nX0, int nY0, int nX1, int nY1) const
+        {
+            int nDX = (nX1 > nX0) - (nX1 < nX0);
+            int nDY = (nY1 > nY0) - (nY1 < nY0);
+
+            for(int nX = nX0, nY = nY0; nX != nX1 || nY != nY1;){
+                nX += nDX;
+                nY += nDY;
+                if(!CanWalk(nX, nY)){
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    std::shared_ptr<BenchMap> MakeMap(const std::string &szType, int nW, int nH)
+    {
+        auto pMap = std::make_shared<BenchMap>(nW, nH);
+        if(szType == "random"){
+            std::mt19937 stRandGen(2017);
+            std::uniform_int_distribution<int> stPercentDist(0, 99);
+            for(auto &nBlock: pMap->Block){
+                nBlock = (stPercentDist(stRandGen) < 20) ? 1 : 0;
+            }
+        }else if(szType == "wall"){
+            // walls at every 16 columns
+            // gap alternates between top and bottom
+            for(int nX = 8, nWall = 0; nX < nW - 8; nX += 16, ++nWall){
+                for(int nY = 0; nY < nH; ++nY){
+                    pMap->Block[nX + nY * nW] = 1;
+                }
+
+                auto nGapY = (nWall % 2) ? 1 : (nH - 2);
+                pMap->Block[nX + nGapY * nW] = 0;
+            }
+        }
+
+        // start and goal are always free
+        for(int nDX = 0; nDX < 3; ++nDX){
+            for(int nDY = 0; nDY < 3; ++nDY){
+                pMap->Block[(0      + nDX) + (0      + nDY) * nW] = 0;
+                pMap->Block[(nW - 3 + nDX) + (nH - 3 + nDY) * nW] = 0;
+            }
+        }
+        return pMap;
+    }
+}
+
+void AddPathFinderCase(BenchRunner &rstRunner)
+{
+    for(auto szType: {"open", "random", "wall"}){
+        for(int nSize: {64, 256}){
+            auto pMap = MakeMap(szType, nSize, nSize);
+            auto bMustFind = (std::string(szType) == "open") && (nSize <= 64);
+
+            for(int nMaxStep: {1, 3}){
+                auto szName = std::string("AStarPathFinder/Search/") + szType + "/" + std::to_string(nSize) + "/step" + std::to_string(nMaxStep);
+                rstRunner.Add(szName.c_str(), 0, [pMap, nMaxStep, bMustFind](uint64_t nIteration)
+                {
+                    auto fnMoveChecker = [pMap](int nX0, int nY0, int nX1, int nY1) -> bool
+                    {
+                        return pMap->CanMove(nX0, nY0, nX1, nY1);
+                    };
+
+                    auto fnMoveCost = [](int nX0, int nY0, int nX1, int nY1) -> double
+                    {
+                        return (LDistance2(nX0, nY0, nX1, nY1) > 2) ? 1.10 : 1.00;
+                    };
+
+                    // small open map must have a path
+                    // others are checked by keeping the same result
+                    int nResult = -1;
+                    for(uint64_t nIndex = 0; nIndex < nIteration; ++nIndex){
+                        AStarPathFinder stFinder(fnMoveChecker, fnMoveCost, nMaxStep);
+                        auto bFound = stFinder.Search(1, 1, pMap->W - 2, pMap->H - 2);
+
+                        if(nResult >= 0 && nResult != (bFound ? 1 : 0)){
+                            return false;
+                        }
+                        nResult = bFound ? 1 : 0;
+                    }
+                    return bMustFind ? (nResult == 1) : (nResult >= 0);
+                });
+            }
+
+            auto pGround = std::make_shared<BitGrid>(pMap->Ground());
+            for(int nMaxStep: {1, 3}){
+                auto szName = std::string("JPSPathFinder/Search/") + szType + "/" + std::to_string(nSize) + "/step" + std::to_string(nMaxStep);
+                rstRunner.Add(szName.c_str(), 0, [pMap, pGround, nMaxStep](uint64_t nIteration)
+                {
+                    for(uint64_t nIndex = 0; nIndex < nIteration; ++nIndex){
+                        JPSPathFinder stFinder(*pGround, nullptr, 0, 0, nMaxStep);
+                        if(!stFinder.Search(1, 1, pMap->W - 2, pMap->H - 2)){
+                            return false;
+                        }
+                    }
+                    return true;
+                });
+            }
+
+            auto pNavGraph = std::make_shared<NavGraph>();
+            pNavGraph->Build(*pGround);
+
+            auto bMustRoute = (std::string(szType) != "random");
+            auto szName = std::string("NavGraph/Search/") + szType + "/" + std::to_string(nSize);
+            rstRunner.Add(szName.c_str(), 0, [pMap, pGround, pNavGraph, bMustRoute](uint64_t nIteration)
+            {
+                int nResult = -1;
+                std::vector<PathFind::PathNode> stWaypointV;
+                for(uint64_t nIndex = 0; nIndex < nIteration; ++nIndex){
+                    auto bFound = pNavGraph->Search(*pGround, 1, 1, pMap->W - 2, pMap->H - 2, &stWaypointV);
+                    if(nResult >= 0 && nResult != (bFound ? 1 : 0)){
+                        return false;
+                    }
+                    nResult = bFound ? 1 : 0;
+                }
+                return bMustRoute ? (nResult == 1) : (nResult >= 0);
+            });
+        }
+    }
+}
@@ -0,0 +1,157 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: benchrunner.cpp
+ *        Created: 12/04/2017 10:12:40
+ *  Last Modified: 12/04/2017 21:36:15
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <ctime>
+#include <chrono>
+#include <thread>
+#include <cinttypes>
+#include <algorithm>
+#include "benchrunner.hpp"
+
+uint64_t BenchRunner::CurrTime()
+{
+    return (uint64_t)(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void BenchRunner::Add(const char *szName, uint64_t nBytes, const CaseFunc &fnCase)
+{
+    if(szName && fnCase){
+        m_CaseV.push_back({szName, fnCase, nBytes});
+    }
+}
+
+void BenchRunner::List() const
+{
+    for(auto &rstCase: m_CaseV){
+        std::printf("%s\n", rstCase.Name.c_str());
+    }
+}
+
+bool BenchRunner::Run()
+{
+    bool bAllOK = true;
+    for(auto &rstCase: m_CaseV){
+        if(m_Filter.empty() || rstCase.Name.find(m_Filter) != std::string::npos){
+            bAllOK = RunCase(rstCase) && bAllOK;
+        }
+    }
+    return bAllOK;
+}
+
+bool BenchRunner::RunCase(const BenchCase &rstCase)
+{
+    auto nMinTime = std::max<uint64_t>(m_MinTime, 1) * 1000000;
+
+    // calibrate the iteration count
+    // also warms up caches and memory pools
+    uint64_t nIteration = 1;
+    while(true){
+        auto nStartTime = CurrTime();
+        if(!rstCase.Func(nIteration)){
+            std::fprintf(stderr, "%-48s FAILED\n", rstCase.Name.c_str());
+            m_ResultV.push_back({rstCase.Name, nIteration, rstCase.Bytes, 0.0, 0.0, 0.0, false});
+            return false;
+        }
+
+        auto nTime = CurrTime() - nStartTime;
+        if(nTime >= nMinTime || nIteration >= ((uint64_t)(1) << 40)){
+            break;
+        }
+
+        // grow fast but don't overshoot too much
+        // the last run is taken as the warm-up
+        auto fScale = (nTime > 0) ? (1.2 * nMinTime / nTime) : 100.0;
+        nIteration = (uint64_t)(nIteration * std::min<double>(std::max<double>(fScale, 2.0), 100.0));
+    }
+
+    std::vector<double> stTimeV;
+    for(int nRepeat = 0; nRepeat < std::max<int>(m_Repeat, 1); ++nRepeat){
+        auto nStartTime = CurrTime();
+        if(!rstCase.Func(nIteration)){
+            std::fprintf(stderr, "%-48s FAILED\n", rstCase.Name.c_str());
+            m_ResultV.push_back({rstCase.Name, nIteration, rstCase.Bytes, 0.0, 0.0, 0.0, false});
+            return false;
+        }
+        stTimeV.push_back((double)(CurrTime() - nStartTime) / nIteration);
+    }
+
+    std::sort(stTimeV.begin(), stTimeV.end());
+    BenchResult stResult {rstCase.Name, nIteration, rstCase.Bytes, stTimeV.front(), stTimeV[stTimeV.size() / 2], stTimeV.back(), true};
+
+    if(stResult.Bytes){
+        std::fprintf(stderr, "%-48s %12.1f ns/op %10.1f MB/s %14" PRIu64 " iterations\n",
+                stResult.Name.c_str(), stResult.MedianNS, stResult.Bytes * 1000.0 / stResult.MedianNS, stResult.Iteration);
+    }else{
+        std::fprintf(stderr, "%-48s %12.1f ns/op %10s      %14" PRIu64 " iterations\n",
+                stResult.Name.c_str(), stResult.MedianNS, "", stResult.Iteration);
+    }
+
+    m_ResultV.push_back(stResult);
+    return true;
+}
+
+void BenchRunner::WriteJSON(std::FILE *fp) const
+{
+    if(!fp){
+        return;
+    }
+
+    char szDate[64];
+    auto nTime = std::time(nullptr);
+    std::strftime(szDate, sizeof(szDate), "%Y-%m-%dT%H:%M:%S", std::localtime(&nTime));
+
+#if defined(__OPTIMIZE__) && !defined(__SANITIZE_ADDRESS__)
+    const char *szBuild = "release";
+#else
+    const char *szBuild = "debug";
+#endif
+
+    std::fprintf(fp, "{\n");
+    std::fprintf(fp, "    \"context\": {\n");
+    std::fprintf(fp, "        \"date\": \"%s\",\n", szDate);
+    std::fprintf(fp, "        \"compiler\": \"%s\",\n", __VERSION__);
+    std::fprintf(fp, "        \"build\": \"%s\",\n", szBuild);
+    std::fprintf(fp, "        \"cpus\": %u,\n", std::thread::hardware_concurrency());
+    std::fprintf(fp, "        \"min_time_ms\": %" PRIu64 ",\n", m_MinTime);
+    std::fprintf(fp, "        \"repeat\": %d\n", m_Repeat);
+    std::fprintf(fp, "    },\n");
+    std::fprintf(fp, "    \"benchmarks\": [");
+
+    for(size_t nIndex = 0; nIndex < m_ResultV.size(); ++nIndex){
+        auto &rstResult = m_ResultV[nIndex];
+        std::fprintf(fp, "%s\n        {\n", nIndex ? "," : "");
+
+        // case names are made in this program
+        // no quote or backslash in them
+        std::fprintf(fp, "            \"name\": \"%s\",\n", rstResult.Name.c_str());
+        std::fprintf(fp, "            \"ok\": %s,\n", rstResult.OK ? "true" : "false");
+        std::fprintf(fp, "            \"iterations\": %" PRIu64 ",\n", rstResult.Iteration);
+        std::fprintf(fp, "            \"ns_per_op_min\": %.3f,\n", rstResult.MinNS);
+        std::fprintf(fp, "            \"ns_per_op_median\": %.3f,\n", rstResult.MedianNS);
+        std::fprintf(fp, "            \"ns_per_op_max\": %.3f,\n", rstResult.MaxNS);
+        std::fprintf(fp, "            \"ops_per_second\": %.1f,\n", (rstResult.MedianNS > 0.0) ? (1.0e9 / rstResult.MedianNS) : 0.0);
+        std::fprintf(fp, "            \"bytes_per_op\": %" PRIu64 ",\n", rstResult.Bytes);
+        std::fprintf(fp, "            \"bytes_per_second\": %.1f\n", (rstResult.Bytes && rstResult.MedianNS > 0.0) ? (rstResult.Bytes * 1.0e9 / rstResult.MedianNS) : 0.0);
+        std::fprintf(fp, "        }");
+    }
+
+    std::fprintf(fp, "%s]\n", m_ResultV.empty() ? "" : "\n    ");
+    std::fprintf(fp, "}\n");
+}
@@ -0,0 +1,118 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: benchrunner.hpp
+ *        Created: 12/04/2017 10:12:40
+ *  Last Modified: 12/04/2017 21:36:15
+ *
+ *    Description: minimal benchmark runner
+ *
+ *                 each case is a function runs the operation nIteration times, runner
+ *                 calibrates the iteration count to make one run longer than MinTime,
+ *                 then repeats it and takes min / median / max of ns per operation
+ *
+ *                 result is written as JSON, one object per case, then we can diff two
+ *                 builds by the case name
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <functional>
+
+class BenchRunner final
+{
+    public:
+        // run the operation nIteration times
+        // return false if the case found a wrong result
+        using CaseFunc = std::function<bool(uint64_t)>;
+
+    private:
+        struct BenchCase
+        {
+            std::string Name;
+            CaseFunc    Func;
+
+            // bytes processed by each operation
+            // zero if not applicable
+            uint64_t Bytes;
+        };
+
+        struct BenchResult
+        {
+            std::string Name;
+
+            uint64_t Iteration;
+            uint64_t Bytes;
+
+            double MinNS;
+            double MedianNS;
+            double MaxNS;
+
+            bool OK;
+        };
+
+    private:
+        std::vector<BenchCase>   m_CaseV;
+        std::vector<BenchResult> m_ResultV;
+
+    private:
+        uint64_t    m_MinTime;      // in ms
+        int         m_Repeat;
+        std::string m_Filter;
+
+    public:
+        BenchRunner(uint64_t nMinTime, int nRepeat, const char *szFilter)
+            : m_CaseV()
+            , m_ResultV()
+            , m_MinTime(nMinTime)
+            , m_Repeat(nRepeat)
+            , m_Filter(szFilter ? szFilter : "")
+        {}
+
+    public:
+        void Add(const char *, uint64_t, const CaseFunc &);
+
+    public:
+        void List() const;
+
+    public:
+        // return false if any case fails
+        bool Run();
+
+    public:
+        void WriteJSON(std::FILE *) const;
+
+    private:
+        static uint64_t CurrTime();
+
+    private:
+        bool RunCase(const BenchCase &);
+};
+
+namespace Bench
+{
+    // keep the value alive for the compiler
+    // prevents the measured code from being optimized out
+    template<typename T> inline void DoNotOptimize(const T &rstValue)
+    {
+        __asm__ __volatile__("" : : "g"(&rstValue) : "memory");
+    }
+
+    inline void ClobberMemory()
+    {
+        __asm__ __volatile__("" : : : "memory");
+    }
+}
@@ -0,0 +1,179 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: benchscheduler.cpp
+ *        Created: 12/17/2017 20:05:14
+ *  Last Modified: 12/17/2017 22:16:40
+ *
+ *    Description: TickScheduler of the monoserver map, TimerWheel of ActorPod
+ *
+ *                 TickScheduler/Schedule runs the map metronome over 1024 objects with
+ *                 interval of 300 ticks, one call per tick
+ *
+ *                 TickScheduler/ReAdd checks a removed then re-added UID only ticks by
+ *                 its new schedule, node left in the queue by the removed one is skipped
+ *
+ *                 TimerWheel/IdleGap adds a timer to a wheel idle since tick 0, it should
+ *                 fire on time, not at once, and take only a few wake ups
+ *
+ *                 TimerWheel/Wrap runs timers across the 32-bit tick wrap, each fires at
+ *                 exactly its expire tick
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include "benchcase.hpp"
+#include "timerwheel.hpp"
+#include "tickscheduler.hpp"
+
+namespace
+{
+    // timer wheel used as ActorPod does
+    // move an empty wheel to current tick before Add(), only wake up at NextTick()
+    struct WheelPod
+    {
+        TimerWheel Wheel;
+        uint32_t   Tick;
+        size_t     Pass;
+
+        explicit WheelPod(uint32_t nTick)
+            : Wheel(nTick)
+            , Tick(nTick)
+            , Pass(0)
+        {}
+
+        uint32_t AddTimer(uint32_t nDelay, std::function<void()> fnTimer)
+        {
+            Wheel.SetCurrTick(Tick);
+            return Wheel.Add(Tick + nDelay, std::move(fnTimer));
+        }
+
+        // sleep to next wake up and run expired timers
+        // return false if no timer left
+        bool Wakeup()
+        {
+            uint32_t nNextTick = 0;
+            if(!Wheel.NextTick(&nNextTick)){
+                return false;
+            }
+
+            if((int32_t)(nNextTick - Tick) > 0){
+                Tick = nNextTick;
+            }
+
+            Pass++;
+            std::vector<TimerWheel::TimerFunc> stTimerV;
+            Wheel.Expire(Tick, stTimerV);
+
+            for(auto &fnTimer: stTimerV){
+                fnTimer();
+            }
+            return true;
+        }
+    };
+}
+
+void AddSchedulerCase(BenchRunner &rstRunner)
+{
+    rstRunner.Add("TickScheduler/Schedule/1024", 0, [](uint64_t nIteration)
+    {
+        TickScheduler stScheduler;
+        for(uint32_t nUID = 1; nUID <= 1024; ++nUID){
+            stScheduler.Add(nUID, 300, 0);
+        }
+
+        size_t nCount = 0;
+        for(uint64_t nIndex = 0; nIndex < nIteration; ++nIndex){
+            nCount += stScheduler.Schedule((uint32_t)(nIndex), 0, [](uint32_t, bool){});
+        }
+
+        Bench::DoNotOptimize(nCount);
+        return stScheduler.Count() == 1024;
+    });
+
+    rstRunner.Add("TickScheduler/ReAdd", 0, [](uint64_t nIteration)
+    {
+        bool bResult = true;
+        for(uint64_t nIndex = 0; nIndex < nIteration; ++nIndex){
+            TickScheduler stScheduler;
+            size_t nCount = 0;
+            auto fnOnTick = [&nCount](uint32_t, bool)
+            {
+                nCount++;
+            };
+
+            // first schedule is in [0, 100)
+            // re-added one is in [1000, 1100)
+            stScheduler.Add(1, 100, 0);
+            stScheduler.Remove(1);
+            stScheduler.Add(1, 100, 1000);
+
+            stScheduler.Schedule(999, 0, fnOnTick);
+            bResult = (nCount == 0) && bResult;
+
+            stScheduler.Schedule(1099, 0, fnOnTick);
+            bResult = (nCount == 1) && bResult;
+        }
+        return bResult;
+    });
+    rstRunner.Add("TimerWheel/IdleGap", 0, [](uint64_t nIteration)
+    {
+        bool bResult = true;
+        for(uint64_t nIndex = 0; nIndex < nIteration; ++nIndex){
+            // actor created at tick 0 and idle till now
+            WheelPod stPod(0);
+            stPod.Tick = 2200000000;
+
+            uint32_t nFireTick = 0;
+            stPod.AddTimer(3600000, [&stPod, &nFireTick]()
+            {
+                nFireTick = stPod.Tick;
+            });
+
+            while(stPod.Wakeup()){
+                continue;
+            }
+
+            bResult = (nFireTick == 2200000000 + 3600000) && (stPod.Pass <= 8) && bResult;
+        }
+        return bResult;
+    });
+
+    rstRunner.Add("TimerWheel/Wrap", 0, [](uint64_t nIteration)
+    {
+        bool bResult = true;
+        for(uint64_t nIndex = 0; nIndex < nIteration; ++nIndex){
+            WheelPod stPod(0XFFFFFFFF - 1000);
+
+            size_t nFired = 0;
+            const std::vector<uint32_t> stDelayV {1, 100, 999, 1000, 1001, 5000, 70000, 3600000};
+
+            for(auto nDelay: stDelayV){
+                auto nExpire = stPod.Tick + nDelay;
+                stPod.AddTimer(nDelay, [&stPod, &nFired, &bResult, nExpire]()
+                {
+                    nFired++;
+                    bResult = (stPod.Tick == nExpire) && bResult;
+                });
+            }
+
+            while(stPod.Wakeup()){
+                continue;
+            }
+
+            bResult = (nFired == stDelayV.size()) && bResult;
+        }
+        return bResult;
+    });
+}
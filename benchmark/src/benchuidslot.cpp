@@ -0,0 +1,127 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: benchuidslot.cpp
+ *        Created: 12/17/2017 21:10:32
+ *  Last Modified: 12/17/2017 21:10:32
+ *
+ *    Description: slot of the lock-free UID table in MonoServer
+ *
+ *                 UIDSlot/SeqLock reads a slot as MonoServer::GetUIDRecord() does while
+ *                 another thread keeps rewriting it, every copy passing the sequence
+ *                 check should be one whole record
+ *
+ *                 UIDSlot/Generation runs one slot through all its generations, UIDs
+ *                 are all different and the slot is retired at UIDGEN_MAX
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include <unordered_set>
+#include "uidslot.hpp"
+#include "benchcase.hpp"
+
+namespace
+{
+    // all words equal in a whole record
+    struct SlotPayload
+    {
+        uint32_t Word[8];
+    };
+
+    struct SlotRecord
+    {
+        std::atomic<uint32_t>    Sequence;
+        UIDSlotWord<SlotPayload> Payload;
+
+        SlotRecord()
+            : Sequence(0)
+            , Payload()
+        {}
+    };
+}
+
+void AddUIDSlotCase(BenchRunner &rstRunner)
+{
+    rstRunner.Add("UIDSlot/SeqLock", sizeof(SlotPayload), [](uint64_t nIteration)
+    {
+        SlotRecord stRecord;
+        std::atomic<bool> bDone(false);
+
+        std::thread stWriter([&stRecord, &bDone]()
+        {
+            for(uint32_t nValue = 1; !bDone.load(std::memory_order_relaxed); ++nValue){
+                SlotPayload stPayload;
+                for(auto &rnWord: stPayload.Word){
+                    rnWord = nValue;
+                }
+
+                auto nSequence = stRecord.Sequence.load(std::memory_order_relaxed);
+                stRecord.Sequence.store(nSequence + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+
+                stRecord.Payload.Store(stPayload);
+                stRecord.Sequence.store(nSequence + 2, std::memory_order_release);
+            }
+        });
+
+        bool bResult = true;
+        for(uint64_t nIndex = 0; nIndex < nIteration; ++nIndex){
+            while(true){
+                auto nSequence0 = stRecord.Sequence.load(std::memory_order_acquire);
+                if(nSequence0 & 1){
+                    continue;
+                }
+
+                auto stWordV = stRecord.Payload.Load();
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if(stRecord.Sequence.load(std::memory_order_relaxed) != nSequence0){
+                    continue;
+                }
+
+                SlotPayload stPayload;
+                UIDSlotWord<SlotPayload>::Rebuild(stWordV, &stPayload);
+
+                for(auto nWord: stPayload.Word){
+                    bResult = (nWord == stPayload.Word[0]) && bResult;
+                }
+                break;
+            }
+        }
+
+        bDone.store(true, std::memory_order_relaxed);
+        stWriter.join();
+        return bResult;
+    });
+
+    rstRunner.Add("UIDSlot/Generation", 0, [](uint64_t nIteration)
+    {
+        bool bResult = true;
+        for(uint64_t nIndex = 0; nIndex < nIteration; ++nIndex){
+            const uint32_t nSlot = 12345;
+            std::unordered_set<uint32_t> stUIDSet;
+
+            uint32_t nGeneration = 0;
+            do{
+                auto nUID = (nGeneration << UIDSLOT_BITS) | nSlot;
+                bResult = (UIDSlotIndex(nUID) == nSlot) && (UIDGeneration(nUID) == nGeneration) && bResult;
+                bResult = stUIDSet.insert(nUID).second && bResult;
+            }while(UIDNextGeneration(&nGeneration));
+
+            // no wrap back to zero when retired
+            bResult = (nGeneration == UIDGEN_MAX) && (stUIDSet.size() == UIDGEN_MAX + 1) && bResult;
+        }
+        return bResult;
+    });
+}
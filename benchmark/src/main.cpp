@@ -0,0 +1,103 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: main.cpp
+ *        Created: 12/04/2017 10:05:11
+ *  Last Modified: 12/17/2017 21:10:32
+ *
+ *    Description: benchmark of primitives in common/ and the server message pack
+ *
+ *                 human readable lines go to stderr, JSON goes to stdout or the file
+ *                 given by --json, keep JSON of each release to catch regressions
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "benchcase.hpp"
+
+static void PrintUsage()
+{
+    std::printf("Usage: benchmark [options]\n\n");
+    std::printf("    --filter=STR       only run cases with STR in the name\n");
+    std::printf("    --min-time=N       min ms of one run, default 100\n");
+    std::printf("    --repeat=N         runs of each case after calibration, default 5\n");
+    std::printf("    --json=FILE        write JSON to FILE instead of stdout\n");
+    std::printf("    --list             print all case names\n");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *szFilter   = nullptr;
+    const char *szJSONFile = nullptr;
+
+    int  nMinTime = 100;
+    int  nRepeat  = 5;
+    bool bList    = false;
+
+    for(int nIndex = 1; nIndex < argc; ++nIndex){
+        if(!std::strncmp(argv[nIndex], "--filter=", 9)){
+            szFilter = argv[nIndex] + 9;
+        }else if(!std::strncmp(argv[nIndex], "--min-time=", 11)){
+            nMinTime = std::atoi(argv[nIndex] + 11);
+        }else if(!std::strncmp(argv[nIndex], "--repeat=", 9)){
+            nRepeat = std::atoi(argv[nIndex] + 9);
+        }else if(!std::strncmp(argv[nIndex], "--json=", 7)){
+            szJSONFile = argv[nIndex] + 7;
+        }else if(!std::strcmp(argv[nIndex], "--list")){
+            bList = true;
+        }else{
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if(nMinTime <= 0 || nRepeat <= 0){
+        PrintUsage();
+        return 1;
+    }
+
+    BenchRunner stRunner((uint64_t)(nMinTime), nRepeat, szFilter);
+
+    AddMemoryPoolCase (stRunner);
+    AddCacheQueueCase (stRunner);
+    AddInnDBCase      (stRunner);
+    AddCompressCase   (stRunner);
+    AddPathFinderCase (stRunner);
+    AddMessagePackCase(stRunner);
+    AddMapDataCase    (stRunner);
+    AddSchedulerCase  (stRunner);
+    AddUIDSlotCase    (stRunner);
+
+    if(bList){
+        stRunner.List();
+        return 0;
+    }
+
+    auto bAllOK = stRunner.Run();
+    if(szJSONFile){
+        if(auto fp = std::fopen(szJSONFile, "w")){
+            stRunner.WriteJSON(fp);
+            std::fclose(fp);
+        }else{
+            std::fprintf(stderr, "Can't open %s\n", szJSONFile);
+            return 1;
+        }
+    }else{
+        stRunner.WriteJSON(stdout);
+    }
+
+    // failed case means wrong result
+    // not only slow, let scripts see it
+    return bAllOK ? 0 : 1;
+}
@@ -3,7 +3,7 @@
  *
  *       Filename: game.cpp
  *        Created: 08/12/2015 09:59:15
- *  Last Modified: 11/03/2017 17:58:16
+ *  Last Modified: 12/14/2017 20:37:12
  *
  *    Description:
  *
@@ -20,6 +20,8 @@
 
 #include <future>
 #include <thread>
+#include <cstring>
+#include <cinttypes>
 
 #include "log.hpp"
 #include "game.hpp"
@@ -39,6 +41,7 @@
 Game::Game()
     : m_ServerDelay( 0.00)
     , m_NetPackTick(-1.00)
+    , m_ActionDelta()
     , m_CurrentProcess(nullptr)
 {
     InitView(10);
@@ -245,11 +248,35 @@ void Game::OnServerMessage(uint8_t nHC, const uint8_t *pData, size_t nDataLen)
             }
         case SM_ACTION:
             {
+                SMAction stSMA;
+                std::memcpy(&stSMA, pData, sizeof(stSMA));
+
+                m_ActionDelta.Update(stSMA);
                 if(auto pRun = (ProcessRun *)(ProcessValid(PROCESSID_RUN))){
                     pRun->Net_ACTION(pData, nDataLen);
                 }
                 break;
             }
+        case SM_ACTIONDELTA:
+            {
+                SMActionDelta stSMAD;
+                std::memcpy(&stSMAD, pData, sizeof(stSMAD));
+
+                // rebuild the full SMAction
+                // then ProcessRun and creatures don't know there is a delta
+                SMAction stSMA;
+                if(!m_ActionDelta.Patch(stSMAD, &stSMA)){
+                    extern Log *g_Log;
+                    g_Log->AddLog(LOGTYPE_WARNING, "No baseline for action delta: UID = %" PRIu32, stSMAD.UID);
+                    break;
+                }
+
+                m_ActionDelta.Update(stSMA);
+                if(auto pRun = (ProcessRun *)(ProcessValid(PROCESSID_RUN))){
+                    pRun->Net_ACTION((const uint8_t *)(&stSMA), sizeof(stSMA));
+                }
+                break;
+            }
         case SM_OFFLINE:
             {
                 if(auto pRun = (ProcessRun *)(ProcessValid(PROCESSID_RUN))){
@@ -3,7 +3,7 @@
  *
  *       Filename: game.hpp
  *        Created: 08/12/2015 09:59:15
- *  Last Modified: 10/02/2017 18:00:15
+ *  Last Modified: 12/14/2017 20:37:12
  *
  *    Description: public API for class game only
  *
@@ -26,6 +26,7 @@
 #include "netio.hpp"
 #include "process.hpp"
 #include "sdldevice.hpp"
+#include "actiondelta.hpp"
 
 class Game final
 {
@@ -36,6 +37,11 @@ class Game final
     private:
         NetIO m_NetIO;
 
+    private:
+        // SMAction baseline of the connection, mirror of server session
+        // updated for every SM_ACTION / SM_ACTIONDELTA even there is no ProcessRun
+        ActionDelta m_ActionDelta;
+
     private:
         Process *m_CurrentProcess;
 
@@ -3,7 +3,7 @@
  *
  *       Filename: netio.cpp
  *        Created: 06/29/2015 07:18:27 PM
- *  Last Modified: 08/18/2017 15:34:23
+ *  Last Modified: 12/15/2017 21:52:40
  *
  *    Description:
  *
@@ -108,6 +108,8 @@ NetIO::NetIO()
     , m_ReadHC(0)
     , m_ReadLen {0, 0, 0, 0}
     , m_ReadBuf(1024)
+    , m_FrameBuf()
+    , m_DecodeBuf()
     , m_OnReadDone()
     , m_SendQueue()
     , m_MemoryPN()
@@ -294,7 +296,7 @@ bool NetIO::DoReadBody(size_t nMaskLen, size_t nBodyLen)
                     fnReportInvalidArg();
                     return false;
                 }
-                m_ReadBuf.resize(stSMSG.DataLen());
+                m_ReadBuf.resize(nBodyLen);
                 break;
             }
         default:
@@ -346,7 +348,14 @@ bool NetIO::DoReadBody(size_t nMaskLen, size_t nBodyLen)
                 // we should call the completion handler here
 
                 // 1. call completion on decompressed data
-                if(m_OnReadDone){
+                //    frame is unpacked here and completion is called for each message in it
+                if(m_ReadHC == SM_FRAME){
+                    if(!DecodeFrame(&(m_ReadBuf[0]), nBodyLen)){
+                        extern Log *g_Log;
+                        g_Log->AddLog(LOGTYPE_WARNING, "Corrupted frame: FrameLen = %d", (int)(nBodyLen));
+                        fnReportCurrentMessage();
+                    }
+                }else if(m_OnReadDone){
                     m_OnReadDone(m_ReadHC, &(m_ReadBuf[nMaskLen ? ((nMaskLen + nBodyLen + 7) / 8 * 8) : 0]), nMaskLen ? stSMSG.DataLen() : nBodyLen);
                 }
 
@@ -365,6 +374,144 @@ bool NetIO::DoReadBody(size_t nMaskLen, size_t nBodyLen)
     return true;
 }
 
+bool NetIO::DecodeFrame(const uint8_t *pFrame, size_t nFrameLen)
+{
+    // see servermessage.hpp for the frame layout
+    // messages before a corrupted one are already handled, can't take them back
+    if(!(pFrame && nFrameLen)){
+        return false;
+    }
+
+    auto pData    = pFrame + 1;
+    auto nDataLen = nFrameLen - 1;
+
+    switch(pFrame[0]){
+        case FRAMEMODE_RAW:
+            {
+                break;
+            }
+        case FRAMEMODE_COMPRESS:
+            {
+                if(nDataLen < 4){
+                    return false;
+                }
+
+                uint32_t nOrigLenU32 = 0;
+                std::memcpy(&nOrigLenU32, pData, 4);
+
+                // compressed data can't be longer than the original
+                // this also limits the buffer size by the frame length
+                auto nOrigLen = (size_t)(nOrigLenU32);
+                auto nMaskLen = (nOrigLen + 7) / 8;
+                if(4 + nMaskLen > nDataLen){
+                    return false;
+                }
+
+                auto nCompLen = nDataLen - 4 - nMaskLen;
+                if(false
+                        || (nCompLen > nOrigLen)
+                        || (Compress::CountMask(pData + 4, nMaskLen) != (int)(nCompLen))){
+                    return false;
+                }
+
+                m_FrameBuf.resize(nOrigLen + 8);
+                if(Compress::Decode(&(m_FrameBuf[0]), nOrigLen, pData + 4, pData + 4 + nMaskLen) != (int)(nCompLen)){
+                    return false;
+                }
+
+                pData    = &(m_FrameBuf[0]);
+                nDataLen = nOrigLen;
+                break;
+            }
+        default:
+            {
+                return false;
+            }
+    }
+
+    // walk through [HC, Data][HC, Data]...
+    // each message has exactly the same encoding as it goes without frame
+    for(size_t nOffset = 0; nOffset < nDataLen;){
+        auto nHC = pData[nOffset++];
+
+        SMSGParam stSMSG(nHC);
+        if(nHC == SM_FRAME){
+            return false;
+        }
+
+        switch(stSMSG.Type()){
+            case 0:
+                {
+                    if(m_OnReadDone){ m_OnReadDone(nHC, nullptr, 0); }
+                    break;
+                }
+            case 1:
+                {
+                    if(nOffset >= nDataLen){
+                        return false;
+                    }
+
+                    size_t nCompLen = pData[nOffset++];
+                    if(nCompLen == 255){
+                        if(nOffset >= nDataLen){
+                            return false;
+                        }
+                        nCompLen = 255 + (size_t)(pData[nOffset++]);
+                    }
+
+                    if(false
+                            || (nCompLen > stSMSG.DataLen())
+                            || (nOffset + stSMSG.MaskLen() + nCompLen > nDataLen)
+                            || (Compress::CountMask(pData + nOffset, stSMSG.MaskLen()) != (int)(nCompLen))){
+                        return false;
+                    }
+
+                    m_DecodeBuf.resize(stSMSG.DataLen() + 8);
+                    if(Compress::Decode(&(m_DecodeBuf[0]), stSMSG.DataLen(), pData + nOffset, pData + nOffset + stSMSG.MaskLen()) != (int)(nCompLen)){
+                        return false;
+                    }
+
+                    if(m_OnReadDone){ m_OnReadDone(nHC, &(m_DecodeBuf[0]), stSMSG.DataLen()); }
+                    nOffset += (stSMSG.MaskLen() + nCompLen);
+                    break;
+                }
+            case 2:
+                {
+                    if(nOffset + stSMSG.DataLen() > nDataLen){
+                        return false;
+                    }
+
+                    if(m_OnReadDone){ m_OnReadDone(nHC, pData + nOffset, stSMSG.DataLen()); }
+                    nOffset += stSMSG.DataLen();
+                    break;
+                }
+            case 3:
+                {
+                    if(nOffset + 4 > nDataLen){
+                        return false;
+                    }
+
+                    uint32_t nBodyLenU32 = 0;
+                    std::memcpy(&nBodyLenU32, pData + nOffset, 4);
+                    nOffset += 4;
+
+                    if(nOffset + (size_t)(nBodyLenU32) > nDataLen){
+                        return false;
+                    }
+
+                    if(m_OnReadDone){ m_OnReadDone(nHC, nBodyLenU32 ? (pData + nOffset) : nullptr, nBodyLenU32); }
+                    nOffset += nBodyLenU32;
+                    break;
+                }
+            default:
+                {
+                    return false;
+                }
+        }
+    }
+    return true;
+}
+
 void NetIO::DoSendNext()
 {
     condcheck(!m_SendQueue.empty());
@@ -3,7 +3,7 @@
  *
  *       Filename: netio.hpp
  *        Created: 09/03/2015 03:49:00 AM
- *  Last Modified: 04/26/2017 11:55:49
+ *  Last Modified: 12/15/2017 21:52:40
  *
  *    Description: read / write for 1 to 1 map network, for the server part we use class
  *                 session since it's 1 to N map.
@@ -62,6 +62,12 @@ class NetIO final
         uint8_t              m_ReadLen[4];
         std::vector<uint8_t> m_ReadBuf;
 
+    private:
+        // buffers to unpack SM_FRAME
+        // m_FrameBuf for decompressed frame and m_DecodeBuf for each mode-1 message in it
+        std::vector<uint8_t> m_FrameBuf;
+        std::vector<uint8_t> m_DecodeBuf;
+
     private:
         // Game::InitASIO() provide the completion handler for read messages
         // the handler will handle a fully received message instead of (HC, Body) seperately
@@ -140,4 +146,9 @@ class NetIO final
     private:
         void DoReadHC();
         bool DoReadBody(size_t, size_t);
+
+    private:
+        // unpack one SM_FRAME and call m_OnReadDone for each message in it
+        // all data are in memory, no more async_read needed
+        bool DecodeFrame(const uint8_t *, size_t);
 };
@@ -3,7 +3,7 @@
  *
  *       Filename: processlogin.cpp
  *        Created: 08/14/2015 02:47:49
- *  Last Modified: 09/14/2017 21:04:40
+ *  Last Modified: 12/15/2017 21:52:40
  *
  *    Description: 
  *
@@ -167,7 +167,11 @@ void ProcessLogin::DoLogin()
         std::memcpy(stCML.ID, szID.c_str(), szID.size());
         std::memcpy(stCML.Password, szPWD.c_str(), szPWD.size());
 
+        // ask for SM_ACTIONDELTA and SM_FRAME before login
+        // server may ignore them and send messages as they are
         extern Game *g_Game;
+        g_Game->Send(CM_ACTIONDELTA);
+        g_Game->Send(CM_FRAME);
         g_Game->Send(CM_LOGIN, stCML);
     }
 }
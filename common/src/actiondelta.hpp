@@ -0,0 +1,152 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: actiondelta.hpp
+ *        Created: 12/14/2017 20:37:12
+ *  Last Modified: 12/14/2017 20:37:12
+ *
+ *    Description: baseline of SMAction of one connection, used by both server and client
+ *
+ *                 server session and client keep the same table and update it by exactly
+ *                 the same rule for each SM_ACTION / SM_ACTIONDELTA in stream order, TCP
+ *                 makes sure the client has everything the server sent before, then last
+ *                 sent state is the last acknowledged state and no ack message is needed
+ *
+ *                      1. SM_ACTION        : replace the baseline of UID
+ *                      2. SM_ACTIONDELTA   : patch the baseline of UID, server only sends it
+ *                                            if there is one
+ *                      3. ACTION_DIE       : drop the baseline of UID after it, otherwise the
+ *                                            table grows with every monster ever seen
+ *
+ *                 not thread-safe
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include "protocoldef.hpp"
+#include "servermessage.hpp"
+
+class ActionDelta final
+{
+    private:
+        std::unordered_map<uint32_t, SMAction> m_BaselineRecord;
+
+    public:
+        ActionDelta()
+            : m_BaselineRecord()
+        {}
+
+    public:
+        // server side
+        // make delta of rstSMA against the baseline, false if it should be sent as full SMAction
+        bool Diff(const SMAction &rstSMA, SMActionDelta *pDelta) const
+        {
+            auto pBaseline = m_BaselineRecord.find(rstSMA.UID);
+            if(false
+                    || !pDelta
+                    || rstSMA.Action == ACTION_DIE
+                    || pBaseline == m_BaselineRecord.end()
+                    || pBaseline->second.MapID  != rstSMA.MapID
+                    || pBaseline->second.AimUID != rstSMA.AimUID){
+                return false;
+            }
+
+            const auto &rstBase = pBaseline->second;
+
+            int nDX    = (int)(rstSMA.X) - (int)(rstBase.X);
+            int nDY    = (int)(rstSMA.Y) - (int)(rstBase.Y);
+            int nDAimX = ((int)(rstSMA.AimX) - (int)(rstSMA.X)) - ((int)(rstBase.AimX) - (int)(rstBase.X));
+            int nDAimY = ((int)(rstSMA.AimY) - (int)(rstSMA.Y)) - ((int)(rstBase.AimY) - (int)(rstBase.Y));
+
+            if(false
+                    || !InZigzag(nDX)
+                    || !InZigzag(nDY)
+                    || !InZigzag(nDAimX)
+                    || !InZigzag(nDAimY)){
+                return false;
+            }
+
+            pDelta->UID         = rstSMA.UID;
+            pDelta->Action      = rstSMA.Action      ^ rstBase.Action;
+            pDelta->ActionParam = rstSMA.ActionParam ^ rstBase.ActionParam;
+            pDelta->Speed       = rstSMA.Speed       ^ rstBase.Speed;
+            pDelta->Direction   = rstSMA.Direction   ^ rstBase.Direction;
+            pDelta->X           = ZigzagEncode(nDX);
+            pDelta->Y           = ZigzagEncode(nDY);
+            pDelta->AimX        = ZigzagEncode(nDAimX);
+            pDelta->AimY        = ZigzagEncode(nDAimY);
+            return true;
+        }
+
+    public:
+        // client side
+        // rebuild full SMAction from the baseline, false if there is no baseline
+        bool Patch(const SMActionDelta &rstDelta, SMAction *pSMA) const
+        {
+            auto pBaseline = m_BaselineRecord.find(rstDelta.UID);
+            if(false
+                    || !pSMA
+                    || pBaseline == m_BaselineRecord.end()){
+                return false;
+            }
+
+            const auto &rstBase = pBaseline->second;
+
+            pSMA->UID         = rstDelta.UID;
+            pSMA->MapID       = rstBase.MapID;
+            pSMA->Action      = rstDelta.Action      ^ rstBase.Action;
+            pSMA->ActionParam = rstDelta.ActionParam ^ rstBase.ActionParam;
+            pSMA->Speed       = rstDelta.Speed       ^ rstBase.Speed;
+            pSMA->Direction   = rstDelta.Direction   ^ rstBase.Direction;
+            pSMA->X           = (uint16_t)((int)(rstBase.X) + ZigzagDecode(rstDelta.X));
+            pSMA->Y           = (uint16_t)((int)(rstBase.Y) + ZigzagDecode(rstDelta.Y));
+            pSMA->AimX        = (uint16_t)((int)(pSMA->X) + ((int)(rstBase.AimX) - (int)(rstBase.X)) + ZigzagDecode(rstDelta.AimX));
+            pSMA->AimY        = (uint16_t)((int)(pSMA->Y) + ((int)(rstBase.AimY) - (int)(rstBase.Y)) + ZigzagDecode(rstDelta.AimY));
+            pSMA->AimUID      = rstBase.AimUID;
+            return true;
+        }
+
+    public:
+        // both sides
+        // call it for each SMAction sent / received, include the one rebuilt by Patch()
+        void Update(const SMAction &rstSMA)
+        {
+            if(rstSMA.Action == ACTION_DIE){
+                m_BaselineRecord.erase(rstSMA.UID);
+            }else{
+                m_BaselineRecord[rstSMA.UID] = rstSMA;
+            }
+        }
+
+        void Clear()
+        {
+            m_BaselineRecord.clear();
+        }
+
+    private:
+        static bool InZigzag(int nValue)
+        {
+            return nValue >= -128 && nValue <= 127;
+        }
+
+        static uint8_t ZigzagEncode(int nValue)
+        {
+            return (uint8_t)(nValue >= 0 ? (nValue * 2) : (-nValue * 2 - 1));
+        }
+
+        static int ZigzagDecode(uint8_t nValue)
+        {
+            return (nValue % 2) ? -((int)(nValue + 1) / 2) : ((int)(nValue) / 2);
+        }
+};
@@ -0,0 +1,209 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: bitgrid.hpp
+ *        Created: 12/07/2017 09:36:52
+ *  Last Modified: 12/08/2017 23:12:09
+ *
+ *    Description: packed 2D bitmap for map grids
+ *
+ *                 row-major, each row padded to whole 64-bit words, padding bits are
+ *                 always zero, then rectangle / window queries take one word per 64
+ *                 cells of a row instead of testing cells one by one
+ *
+ *                 out-of-range cells read as zero, writes to them are ignored
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+class BitGrid final
+{
+    private:
+        int m_W;
+        int m_H;
+
+    private:
+        size_t m_Stride;
+        std::vector<uint64_t> m_Data;
+
+    public:
+        BitGrid()
+            : BitGrid(0, 0)
+        {}
+
+        BitGrid(int nW, int nH)
+            : m_W(std::max<int>(nW, 0))
+            , m_H(std::max<int>(nH, 0))
+            , m_Stride(((size_t)(m_W) + 63) / 64)
+            , m_Data(m_Stride * (size_t)(m_H), 0)
+        {}
+
+    public:
+        int W() const { return m_W; }
+        int H() const { return m_H; }
+
+    public:
+        bool ValidC(int nX, int nY) const
+        {
+            return nX >= 0 && nX < m_W && nY >= 0 && nY < m_H;
+        }
+
+    public:
+        size_t Stride() const
+        {
+            return m_Stride;
+        }
+
+        const uint64_t *Row(int nY) const
+        {
+            return &(m_Data[(size_t)(nY) * m_Stride]);
+        }
+
+    public:
+        bool Get(int nX, int nY) const
+        {
+            if(ValidC(nX, nY)){
+                return (m_Data[(size_t)(nY) * m_Stride + (nX >> 6)] >> (nX & 63)) & 1;
+            }
+            return false;
+        }
+
+        void Set(int nX, int nY, bool bValue)
+        {
+            if(ValidC(nX, nY)){
+                auto &rstWord = m_Data[(size_t)(nY) * m_Stride + (nX >> 6)];
+                if(bValue){
+                    rstWord |=  ((uint64_t)(1) << (nX & 63));
+                }else{
+                    rstWord &= ~((uint64_t)(1) << (nX & 63));
+                }
+            }
+        }
+
+    public:
+        // nCount bits start from (nX, nY), put at bit 0
+        // requires valid nY, 0 <= nX, 0 < nCount <= 64, bits out of the row are zero
+        uint64_t Bits(int nX, int nY, int nCount) const
+        {
+            auto nWord = (size_t)(nX >> 6);
+            auto nOff  = (nX & 63);
+
+            if(nWord >= m_Stride){
+                return 0;
+            }
+
+            auto pRow  = Row(nY);
+            auto nBits = pRow[nWord] >> nOff;
+
+            if(nOff && (nWord + 1 < m_Stride)){
+                nBits |= pRow[nWord + 1] << (64 - nOff);
+            }
+            return (nCount >= 64) ? nBits : (nBits & (((uint64_t)(1) << nCount) - 1));
+        }
+
+        // 64 bits start from (nX, nY), put at bit 0
+        // no requirement for nX / nY, cells out of the grid are zero
+        uint64_t Word(int nX, int nY) const
+        {
+            if(false
+                    || nY <  0
+                    || nY >= m_H
+                    || nX >= m_W
+                    || nX <= -64){
+                return 0;
+            }
+            return (nX < 0) ? (Bits(0, nY, 64) << (-nX)) : Bits(nX, nY, 64);
+        }
+
+    public:
+        // rectangle is clipped by the grid
+        // empty rectangle has no bit set
+        bool AnyInRect(int nX, int nY, int nW, int nH) const
+        {
+            if(!Clip(nX, nY, nW, nH)){
+                return false;
+            }
+
+            for(int nCurrY = nY; nCurrY < nY + nH; ++nCurrY){
+                for(int nCurrX = nX; nCurrX < nX + nW; nCurrX += 64){
+                    if(Bits(nCurrX, nCurrY, std::min<int>(64, nX + nW - nCurrX))){
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        size_t CountInRect(int nX, int nY, int nW, int nH) const
+        {
+            if(!Clip(nX, nY, nW, nH)){
+                return 0;
+            }
+
+            size_t nCount = 0;
+            for(int nCurrY = nY; nCurrY < nY + nH; ++nCurrY){
+                for(int nCurrX = nX; nCurrX < nX + nW; nCurrX += 64){
+                    nCount += (size_t)(__builtin_popcountll(Bits(nCurrX, nCurrY, std::min<int>(64, nX + nW - nCurrX))));
+                }
+            }
+            return nCount;
+        }
+
+    public:
+        // copy of a clipped rectangle
+        // bit (0, 0) of the result is (nX, nY) of this grid, use -nX / -nY to get back
+        BitGrid Window(int nX, int nY, int nW, int nH) const
+        {
+            if(!Clip(nX, nY, nW, nH)){
+                return BitGrid();
+            }
+
+            BitGrid stWindow(nW, nH);
+            for(int nCurrY = 0; nCurrY < nH; ++nCurrY){
+                for(size_t nWord = 0; nWord < stWindow.m_Stride; ++nWord){
+                    auto nCurrX = (int)(nWord * 64);
+                    stWindow.m_Data[(size_t)(nCurrY) * stWindow.m_Stride + nWord] = Bits(nX + nCurrX, nY + nCurrY, std::min<int>(64, nW - nCurrX));
+                }
+            }
+            return stWindow;
+        }
+
+    public:
+        // merge grids of the same size
+        // ignored if the size doesn't match
+        void Or(const BitGrid &rstOther)
+        {
+            if(m_W == rstOther.m_W && m_H == rstOther.m_H){
+                for(size_t nIndex = 0; nIndex < m_Data.size(); ++nIndex){
+                    m_Data[nIndex] |= rstOther.m_Data[nIndex];
+                }
+            }
+        }
+
+    private:
+        bool Clip(int &nX, int &nY, int &nW, int &nH) const
+        {
+            auto nX1 = std::min<int>(nX + nW, m_W);
+            auto nY1 = std::min<int>(nY + nH, m_H);
+
+            nX = std::max<int>(nX, 0);
+            nY = std::max<int>(nY, 0);
+            nW = nX1 - nX;
+            nH = nY1 - nY;
+            return nW > 0 && nH > 0;
+        }
+};
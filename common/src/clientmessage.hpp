@@ -3,7 +3,7 @@
  *
  *       Filename: clientmessage.hpp
  *        Created: 01/24/2016 19:30:45
- *  Last Modified: 10/14/2017 18:41:45
+ *  Last Modified: 12/15/2017 21:52:40
  *
  *    Description: net message used by client and mono-server
  *
@@ -35,6 +35,14 @@ enum: uint8_t
 
     CM_REQUESTSPACEMOVE,
     CM_PICKUP,
+
+    // client can decode SM_ACTIONDELTA
+    // handled by the server session, never forwarded to actors
+    CM_ACTIONDELTA,
+
+    // client can decode SM_FRAME
+    // handled by the server session, never forwarded to actors
+    CM_FRAME,
 };
 
 #pragma pack(push, 1)
@@ -120,6 +128,8 @@ class CMSGParam: public MessageBase
                 {CM_QUERYCORECORD,    {1, sizeof(CMQueryCORecord),   "CM_QUERYCORECORD"   }},
                 {CM_REQUESTSPACEMOVE, {1, sizeof(CMReqestSpaceMove), "CM_REQUESTSPACEMOVE"}},
                 {CM_PICKUP,           {1, sizeof(CMPickUp),          "CM_PICKUP"          }},
+                {CM_ACTIONDELTA,      {0, 0,                         "CM_ACTIONDELTA"     }},
+                {CM_FRAME,            {0, 0,                         "CM_FRAME"           }},
             };
 
             return s_AttributeTable.at((s_AttributeTable.find(nHC) == s_AttributeTable.end()) ? (uint8_t)(CM_NONE) : nHC);
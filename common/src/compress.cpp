@@ -3,9 +3,24 @@
  *
  *       Filename: compress.cpp
  *        Created: 04/23/2017 21:34:23
- *  Last Modified: 04/25/2017 14:25:47
+ *  Last Modified: 12/16/2017 21:40:02
  *
- *    Description: 
+ *    Description: zero-mask compression
+ *
+ *                 wire format: [mask][data], bit (i % 8) of mask[i / 8] is set if byte i is
+ *                 not zero, and data keeps all non-zero bytes in order
+ *
+ *                 three implementations with the same output, picked once at runtime:
+ *
+ *                      1. scalar   : byte by byte, always available
+ *                      2. SSE2     : mask of 16 bytes by one compare, copy group of 8 bytes
+ *                                    directly if it's all zero or all non-zero
+ *                      3. AVX2     : mask of 32 bytes by one compare, pack / unpack group of
+ *                                    8 bytes by one shuffle
+ *
+ *                 vector versions write / read 8 bytes of packed data at once only when the
+ *                 scalar version would access these bytes also, then caller doesn't need to
+ *                 give any padding
  *
  *        Version: 1.0
  *       Revision: none
@@ -22,68 +37,48 @@
 #include <cstring>
 #include "compress.hpp"
 
-int Compress::CountMask(const uint8_t *pData, size_t nDataLen)
-{
-    if(pData){
-        int  nMaskCount = 0;
-        auto pOrigBegin = pData;
-
-        // need better understanding of std::align()
-        // http://en.cppreference.com/w/cpp/memory/align
-        // document says it does nothing if the given buffer is too small to fit
-
-        // we may have smaller memory chunk at the begin and end of pData
-        // but [pData, pData + nDataLen) is enough to hold at least one unsign long long if not return nullptr
-
-        // nasty casts, std::align only accpet (void * &)
-        auto pCastData = static_cast<void *>(const_cast<uint8_t *>(pData));
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define COMPRESS_X86
+#include <immintrin.h>
+#endif
 
-        // if succeed after this call pData and nDataLen will be adjusted
-        if(std::align(alignof(unsigned long long), sizeof(unsigned long long), pCastData, nDataLen)){
-            for(size_t nIndex = 0; nIndex < nDataLen; nIndex += sizeof(unsigned long long)){
-                // TODO remove the strict-aliasing issue here
-                nMaskCount += __builtin_popcountll(*((unsigned long long *)((const uint8_t *)(pCastData) + nIndex)));
-            }
-        }
+namespace
+{
+    uint64_t Load64(const uint8_t *pData)
+    {
+        uint64_t nData = 0;
+        std::memcpy(&nData, pData, sizeof(nData));
+        return nData;
+    }
 
-        // we always do it no matter align succeed or not
-        pData = (const uint8_t *)(pCastData);
+    // the old std::align() version stepped 8 bytes up to the adjusted length
+    // then over-read and counted the tail twice, this counts each byte once
+    int CountMaskScalar(const uint8_t *pData, size_t nDataLen)
+    {
+        int nMaskCount = 0;
+        size_t nIndex = 0;
 
-        // for (possible) memory chunk at the begin
-        // pData could be adjusted by std::align() if succeed
-        for(const uint8_t *pBegin = pOrigBegin; pBegin < pData; ++pBegin){
-            nMaskCount += __builtin_popcount((unsigned int)(*pBegin));
+        for(; nIndex + sizeof(uint64_t) <= nDataLen; nIndex += sizeof(uint64_t)){
+            nMaskCount += __builtin_popcountll(Load64(pData + nIndex));
         }
 
-        // for (possible) memory chunk at the end
-        // pData and nDataLen could be adjusted by std::align() if succeed
-        if(auto nRest = nDataLen % sizeof(unsigned long long)){
-            for(size_t nIndex = nDataLen - nRest; nIndex < nDataLen; ++nIndex){
-                nMaskCount += __builtin_popcount((unsigned int)(pData[nIndex]));
-            }
+        for(; nIndex < nDataLen; ++nIndex){
+            nMaskCount += __builtin_popcount((unsigned int)(pData[nIndex]));
         }
-
-        // done, return the count
         return nMaskCount;
     }
-    return -1;
-}
 
-int Compress::CountData(const uint8_t *pData, size_t nDataLen)
-{
-    if(pData){
+    int CountDataScalar(const uint8_t *pData, size_t nDataLen)
+    {
         int nCount = 0;
         for(size_t nIndex = 0; nIndex < nDataLen; ++nIndex){
             nCount += (pData[nIndex] ? 1 : 0);
         }
         return nCount;
     }
-    return -1;
-}
 
-int Compress::Encode(uint8_t *pDst, const uint8_t *pData, size_t nDataLen)
-{
-    if(pDst && pData && nDataLen){
+    int EncodeScalar(uint8_t *pDst, const uint8_t *pData, size_t nDataLen)
+    {
         auto nMaskLen = ((nDataLen + 7) / 8);
         auto pMask = pDst;
         auto pComp = pDst + nMaskLen;
@@ -99,17 +94,379 @@ int Compress::Encode(uint8_t *pDst, const uint8_t *pData, size_t nDataLen)
         }
         return nDataCount;
     }
-    return -1;
-}
 
-int Compress::Decode(uint8_t *pOrig, size_t nDataLen, const uint8_t *pMask, const uint8_t *pComp)
-{
-    if(pOrig && nDataLen && pMask && pComp){
+    int DecodeScalar(uint8_t *pOrig, size_t nDataLen, const uint8_t *pMask, const uint8_t *pComp)
+    {
         int nDecodeCount = 0;
         for(size_t nIndex = 0; nIndex < nDataLen; ++nIndex){
             pOrig[nIndex] = (pMask[nIndex / 8] & (0x01 << (nIndex % 8))) ? pComp[nDecodeCount++] : 0;
         }
         return nDecodeCount;
     }
+
+#ifdef COMPRESS_X86
+    // pack non-zero bytes of a group by mask byte: pshufb index of kept bytes, then 0X80
+    // unpack packed bytes to a group by mask byte: pshufb index for set bits, 0X80 for zero
+    struct ShuffleTable
+    {
+        uint8_t Pack  [256][8];
+        uint8_t Unpack[256][8];
+
+        ShuffleTable()
+        {
+            for(int nMask = 0; nMask < 256; ++nMask){
+                int nCount = 0;
+                for(int nBit = 0; nBit < 8; ++nBit){
+                    Pack  [nMask][nBit] = 0X80;
+                    Unpack[nMask][nBit] = 0X80;
+                }
+
+                for(int nBit = 0; nBit < 8; ++nBit){
+                    if(nMask & (1 << nBit)){
+                        Pack  [nMask][nCount] = (uint8_t)(nBit);
+                        Unpack[nMask][nBit  ] = (uint8_t)(nCount);
+                        nCount++;
+                    }
+                }
+            }
+        }
+    };
+
+    const ShuffleTable &GetShuffleTable()
+    {
+        static const ShuffleTable s_ShuffleTable;
+        return s_ShuffleTable;
+    }
+
+    // mask of nonzero bytes for full groups of 16 bytes
+    // return index of the first byte not done, the tail goes to the scalar loop
+    __attribute__((target("sse2"))) size_t BuildMaskSSE2(uint8_t *pMask, const uint8_t *pData, size_t nDataLen, int *pCount)
+    {
+        auto stZero = _mm_setzero_si128();
+
+        int nCount = 0;
+        size_t nIndex = 0;
+
+        for(; nIndex + 16 <= nDataLen; nIndex += 16){
+            auto stData = _mm_loadu_si128((const __m128i *)(pData + nIndex));
+            auto nMask  = (uint32_t)(~_mm_movemask_epi8(_mm_cmpeq_epi8(stData, stZero))) & 0XFFFF;
+
+            pMask[nIndex / 8 + 0] = (uint8_t)(nMask >> 0);
+            pMask[nIndex / 8 + 1] = (uint8_t)(nMask >> 8);
+            nCount += __builtin_popcount(nMask);
+        }
+
+        *pCount = nCount;
+        return nIndex;
+    }
+
+    __attribute__((target("avx2"))) size_t BuildMaskAVX2(uint8_t *pMask, const uint8_t *pData, size_t nDataLen, int *pCount)
+    {
+        auto stZero = _mm256_setzero_si256();
+
+        int nCount = 0;
+        size_t nIndex = 0;
+
+        for(; nIndex + 32 <= nDataLen; nIndex += 32){
+            auto stData = _mm256_loadu_si256((const __m256i *)(pData + nIndex));
+            auto nMask  = ~(uint32_t)(_mm256_movemask_epi8(_mm256_cmpeq_epi8(stData, stZero)));
+
+            std::memcpy(pMask + nIndex / 8, &nMask, sizeof(nMask));
+            nCount += __builtin_popcount(nMask);
+        }
+
+        *pCount = nCount;
+        return nIndex;
+    }
+
+    // finish the mask by the scalar way
+    // return total number of non-zero bytes
+    int BuildMaskTail(uint8_t *pMask, const uint8_t *pData, size_t nDataLen, size_t nIndex, int nCount)
+    {
+        if(nIndex < nDataLen){
+            std::memset(pMask + nIndex / 8, 0, (nDataLen + 7) / 8 - nIndex / 8);
+            for(; nIndex < nDataLen; ++nIndex){
+                if(pData[nIndex]){
+                    pMask[nIndex / 8] |= (0X01 << (nIndex % 8));
+                    nCount++;
+                }
+            }
+        }
+        return nCount;
+    }
+
+    __attribute__((target("sse2"))) int CountDataSSE2(const uint8_t *pData, size_t nDataLen)
+    {
+        auto stZero = _mm_setzero_si128();
+
+        int nCount = 0;
+        size_t nIndex = 0;
+
+        for(; nIndex + 16 <= nDataLen; nIndex += 16){
+            auto stData = _mm_loadu_si128((const __m128i *)(pData + nIndex));
+            nCount += 16 - __builtin_popcount((uint32_t)(_mm_movemask_epi8(_mm_cmpeq_epi8(stData, stZero))));
+        }
+        return nCount + CountDataScalar(pData + nIndex, nDataLen - nIndex);
+    }
+
+    __attribute__((target("avx2"))) int CountDataAVX2(const uint8_t *pData, size_t nDataLen)
+    {
+        auto stZero = _mm256_setzero_si256();
+
+        int nCount = 0;
+        size_t nIndex = 0;
+
+        for(; nIndex + 32 <= nDataLen; nIndex += 32){
+            auto stData = _mm256_loadu_si256((const __m256i *)(pData + nIndex));
+            nCount += 32 - __builtin_popcount((uint32_t)(_mm256_movemask_epi8(_mm256_cmpeq_epi8(stData, stZero))));
+        }
+        return nCount + CountDataScalar(pData + nIndex, nDataLen - nIndex);
+    }
+
+    __attribute__((target("avx2"))) int CountMaskAVX2(const uint8_t *pData, size_t nDataLen)
+    {
+        // popcount by nibble lookup, sum by psadbw
+        // http://0x80.pl/articles/sse-popcount.html
+        auto stLookup = _mm256_setr_epi8(
+                0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        auto stLow4 = _mm256_set1_epi8(0X0F);
+        auto stSum  = _mm256_setzero_si256();
+
+        size_t nIndex = 0;
+        for(; nIndex + 32 <= nDataLen; nIndex += 32){
+            auto stData = _mm256_loadu_si256((const __m256i *)(pData + nIndex));
+            auto stLow  = _mm256_shuffle_epi8(stLookup, _mm256_and_si256(stData, stLow4));
+            auto stHigh = _mm256_shuffle_epi8(stLookup, _mm256_and_si256(_mm256_srli_epi16(stData, 4), stLow4));
+            stSum = _mm256_add_epi64(stSum, _mm256_sad_epu8(_mm256_add_epi8(stLow, stHigh), _mm256_setzero_si256()));
+        }
+
+        uint64_t nSumV[4];
+        _mm256_storeu_si256((__m256i *)(nSumV), stSum);
+        return (int)(nSumV[0] + nSumV[1] + nSumV[2] + nSumV[3]) + CountMaskScalar(pData + nIndex, nDataLen - nIndex);
+    }
+
+    __attribute__((target("sse2"))) int EncodeSSE2(uint8_t *pDst, const uint8_t *pData, size_t nDataLen)
+    {
+        auto pMask = pDst;
+        auto pComp = pDst + (nDataLen + 7) / 8;
+
+        int nTotal = 0;
+        auto nDone = BuildMaskSSE2(pMask, pData, nDataLen, &nTotal);
+        nTotal = BuildMaskTail(pMask, pData, nDataLen, nDone, nTotal);
+
+        // pack group by group
+        // full group copies 8 bytes, sparse group only visits set bits
+        int nCount = 0;
+        size_t nIndex = 0;
+
+        for(; nIndex + 8 <= nDataLen; nIndex += 8){
+            switch(auto nMask = (uint32_t)(pMask[nIndex / 8])){
+                case 0X00:
+                    {
+                        break;
+                    }
+                case 0XFF:
+                    {
+                        std::memcpy(pComp + nCount, pData + nIndex, 8);
+                        nCount += 8;
+                        break;
+                    }
+                default:
+                    {
+                        while(nMask){
+                            pComp[nCount++] = pData[nIndex + __builtin_ctz(nMask)];
+                            nMask &= (nMask - 1);
+                        }
+                        break;
+                    }
+            }
+        }
+
+        for(; nIndex < nDataLen; ++nIndex){
+            if(pData[nIndex]){
+                pComp[nCount++] = pData[nIndex];
+            }
+        }
+        return nTotal;
+    }
+
+    __attribute__((target("avx2"))) int EncodeAVX2(uint8_t *pDst, const uint8_t *pData, size_t nDataLen)
+    {
+        // no full block for the mask
+        // two passes cost more than the byte loop
+        if(nDataLen < 32){
+            return EncodeScalar(pDst, pData, nDataLen);
+        }
+
+        auto pMask = pDst;
+        auto pComp = pDst + (nDataLen + 7) / 8;
+
+        int nTotal = 0;
+        auto nDone = BuildMaskAVX2(pMask, pData, nDataLen, &nTotal);
+        nTotal = BuildMaskTail(pMask, pData, nDataLen, nDone, nTotal);
+
+        // pack one group by one shuffle
+        // store all 8 bytes if they are inside the packed data, extra bytes are overwritten by next group
+        const auto &rstTable = GetShuffleTable();
+
+        int nCount = 0;
+        size_t nIndex = 0;
+
+        for(; nIndex + 8 <= nDataLen; nIndex += 8){
+            auto nMask  = pMask[nIndex / 8];
+            auto stData = _mm_loadl_epi64((const __m128i *)(pData + nIndex));
+            auto stPack = _mm_shuffle_epi8(stData, _mm_loadl_epi64((const __m128i *)(rstTable.Pack[nMask])));
+
+            auto nPackLen = __builtin_popcount((uint32_t)(nMask));
+            if(nCount + 8 <= nTotal){
+                _mm_storel_epi64((__m128i *)(pComp + nCount), stPack);
+            }else{
+                uint8_t nPackBuf[16];
+                _mm_storeu_si128((__m128i *)(nPackBuf), stPack);
+                std::memcpy(pComp + nCount, nPackBuf, nPackLen);
+            }
+            nCount += nPackLen;
+        }
+
+        for(; nIndex < nDataLen; ++nIndex){
+            if(pData[nIndex]){
+                pComp[nCount++] = pData[nIndex];
+            }
+        }
+        return nTotal;
+    }
+
+    __attribute__((target("sse2"))) int DecodeSSE2(uint8_t *pOrig, size_t nDataLen, const uint8_t *pMask, const uint8_t *pComp)
+    {
+        int nCount = 0;
+        size_t nIndex = 0;
+
+        for(; nIndex + 8 <= nDataLen; nIndex += 8){
+            switch(auto nMask = (uint32_t)(pMask[nIndex / 8])){
+                case 0X00:
+                    {
+                        std::memset(pOrig + nIndex, 0, 8);
+                        break;
+                    }
+                case 0XFF:
+                    {
+                        std::memcpy(pOrig + nIndex, pComp + nCount, 8);
+                        nCount += 8;
+                        break;
+                    }
+                default:
+                    {
+                        std::memset(pOrig + nIndex, 0, 8);
+                        while(nMask){
+                            pOrig[nIndex + __builtin_ctz(nMask)] = pComp[nCount++];
+                            nMask &= (nMask - 1);
+                        }
+                        break;
+                    }
+            }
+        }
+        return nCount + DecodeScalar(pOrig + nIndex, nDataLen - nIndex, pMask + nIndex / 8, pComp + nCount);
+    }
+
+    __attribute__((target("avx2"))) int DecodeAVX2(uint8_t *pOrig, size_t nDataLen, const uint8_t *pMask, const uint8_t *pComp)
+    {
+        // packed bytes the scalar version reads for all full groups
+        // loading 8 bytes at once is safe only inside it
+        auto nFullLen  = nDataLen / 8;
+        auto nFullComp = CountMaskAVX2(pMask, nFullLen);
+
+        const auto &rstTable = GetShuffleTable();
+
+        int nCount = 0;
+        size_t nIndex = 0;
+
+        for(; nIndex + 8 <= nDataLen; nIndex += 8){
+            auto nMask = pMask[nIndex / 8];
+            auto nPackLen = __builtin_popcount((uint32_t)(nMask));
+
+            __m128i stPack;
+            if(nCount + 8 <= nFullComp){
+                stPack = _mm_loadl_epi64((const __m128i *)(pComp + nCount));
+            }else{
+                uint8_t nPackBuf[16] = {0};
+                std::memcpy(nPackBuf, pComp + nCount, nPackLen);
+                stPack = _mm_loadu_si128((const __m128i *)(nPackBuf));
+            }
+
+            _mm_storel_epi64((__m128i *)(pOrig + nIndex), _mm_shuffle_epi8(stPack, _mm_loadl_epi64((const __m128i *)(rstTable.Unpack[nMask]))));
+            nCount += nPackLen;
+        }
+        return nCount + DecodeScalar(pOrig + nIndex, nDataLen - nIndex, pMask + nIndex / 8, pComp + nCount);
+    }
+#endif
+
+    struct CompressImpl
+    {
+        const char *Name;
+
+        int (*CountMask)(const uint8_t *, size_t);
+        int (*CountData)(const uint8_t *, size_t);
+        int (*Encode   )(uint8_t *, const uint8_t *, size_t);
+        int (*Decode   )(uint8_t *, size_t, const uint8_t *, const uint8_t *);
+    };
+
+    const CompressImpl &GetCompressImpl()
+    {
+        // pick the implementation once
+        // the shuffle table is built here also, not by the first message
+        static const CompressImpl s_CompressImpl = []() -> CompressImpl
+        {
+#ifdef COMPRESS_X86
+            __builtin_cpu_init();
+            if(__builtin_cpu_supports("avx2")){
+                GetShuffleTable();
+                return {"avx2", CountMaskAVX2, CountDataAVX2, EncodeAVX2, DecodeAVX2};
+            }
+
+            if(__builtin_cpu_supports("sse2")){
+                return {"sse2", CountMaskScalar, CountDataSSE2, EncodeSSE2, DecodeSSE2};
+            }
+#endif
+            return {"scalar", CountMaskScalar, CountDataScalar, EncodeScalar, DecodeScalar};
+        }();
+        return s_CompressImpl;
+    }
+}
+
+const char *Compress::ImplName()
+{
+    return GetCompressImpl().Name;
+}
+
+int Compress::CountMask(const uint8_t *pData, size_t nDataLen)
+{
+    if(pData){
+        return GetCompressImpl().CountMask(pData, nDataLen);
+    }
+    return -1;
+}
+
+int Compress::CountData(const uint8_t *pData, size_t nDataLen)
+{
+    if(pData){
+        return GetCompressImpl().CountData(pData, nDataLen);
+    }
+    return -1;
+}
+
+int Compress::Encode(uint8_t *pDst, const uint8_t *pData, size_t nDataLen)
+{
+    if(pDst && pData && nDataLen){
+        return GetCompressImpl().Encode(pDst, pData, nDataLen);
+    }
+    return -1;
+}
+
+int Compress::Decode(uint8_t *pOrig, size_t nDataLen, const uint8_t *pMask, const uint8_t *pComp)
+{
+    if(pOrig && nDataLen && pMask && pComp){
+        return GetCompressImpl().Decode(pOrig, nDataLen, pMask, pComp);
+    }
     return -1;
 }
@@ -3,9 +3,9 @@
  *
  *       Filename: compress.hpp
  *        Created: 04/23/2017 21:33:02
- *  Last Modified: 04/24/2017 15:33:52
+ *  Last Modified: 12/13/2017 23:41:18
  *
- *    Description: 
+ *    Description: zero-mask compression for type-1 messages
  *
  *        Version: 1.0
  *       Revision: none
@@ -29,4 +29,8 @@ namespace Compress
 
     int Encode(uint8_t *, const uint8_t *, size_t);
     int Decode(uint8_t *, size_t, const uint8_t *, const uint8_t *);
+
+    // implementation picked by cpu at runtime
+    // "avx2", "sse2" or "scalar", all give the same output
+    const char *ImplName();
 }
@@ -0,0 +1,373 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: jpspathfinder.cpp
+ *        Created: 12/08/2017 11:02:17
+ *  Last Modified: 12/08/2017 23:12:09
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <limits>
+#include "jpspathfinder.hpp"
+
+namespace
+{
+    // direction index as AStarPathFinderNode::m_Direction
+    // 0 -> DIR_UP, 1 -> DIR_UPRIGHT, ..., 7 -> DIR_UPLEFT
+    const int g_DX[] = { 0, +1, +1, +1,  0, -1, -1, -1};
+    const int g_DY[] = {-1, -1,  0, +1, +1, +1,  0, -1};
+
+    int DirIndex(int nDX, int nDY)
+    {
+        for(int nIndex = 0; nIndex < 8; ++nIndex){
+            if(g_DX[nIndex] == nDX && g_DY[nIndex] == nDY){
+                return nIndex;
+            }
+        }
+        return -1;
+    }
+
+    struct JPSNode
+    {
+        // search owns the node if Stamp matches
+        // otherwise it's left by an older search
+        uint32_t Stamp;
+
+        int32_t Parent;
+        float   G;
+        int8_t  Direction;
+        bool    Closed;
+    };
+
+    struct JPSOpenNode
+    {
+        float   F;
+        float   G;
+        int32_t Cell;
+
+        bool operator < (const JPSOpenNode &rstOther) const
+        {
+            // std::push_heap() gives max heap
+            return F > rstOther.F;
+        }
+    };
+
+    // grow only, one per worker thread
+    // never shared between searches running at the same time
+    thread_local uint32_t                 t_Stamp = 0;
+    thread_local std::vector<JPSNode>     t_NodeV;
+    thread_local std::vector<JPSOpenNode> t_OpenV;
+}
+
+double JPSPathFinder::RunCost(int nLength, bool bDiagonal, int nMaxStep)
+{
+    // same hops as ServicePathFinder without CheckCO
+    // a run of 4 grids with MaxStep 3 is 3 + 1, or 1 + 3, cost is the same
+    auto fDiagPen = bDiagonal ? 0.10 : 0.00;
+    auto fLongHop = 1.00 + 0.01 * nMaxStep + fDiagPen;
+    auto fUnitHop = 1.00 + 0.01            + fDiagPen;
+
+    if(nMaxStep == 1){
+        return nLength * fUnitHop;
+    }
+    return (nLength / nMaxStep) * fLongHop + (nLength % nMaxStep) * fUnitHop;
+}
+
+bool JPSPathFinder::JumpX(int nX, int nY, int nDX, int *pX) const
+{
+    // grids out of the map read as blocked
+    // scan always stops at the map edge
+    if(nDX > 0){
+        for(int nCurrX = nX + 1;; nCurrX += 64){
+            auto nThrough = Through(nCurrX, nY);
+            auto nStop    = ~nThrough
+                | (~Through(nCurrX, nY - 1) & Through(nCurrX + 1, nY - 1))
+                | (~Through(nCurrX, nY + 1) & Through(nCurrX + 1, nY + 1));
+
+            if(nY == m_Y1 && m_X1 >= nCurrX && m_X1 - nCurrX < 64){
+                nStop |= ((uint64_t)(1) << (m_X1 - nCurrX));
+            }
+
+            if(nStop){
+                auto nBit = __builtin_ctzll(nStop);
+                *pX = nCurrX + nBit;
+                return (nThrough >> nBit) & 1;
+            }
+        }
+    }else{
+        // bit 63 is the grid next to check
+        // then the first stop is the highest bit set
+        for(int nCurrX = nX - 64;; nCurrX -= 64){
+            auto nThrough = Through(nCurrX, nY);
+            auto nStop    = ~nThrough
+                | (~Through(nCurrX, nY - 1) & Through(nCurrX - 1, nY - 1))
+                | (~Through(nCurrX, nY + 1) & Through(nCurrX - 1, nY + 1));
+
+            if(nY == m_Y1 && m_X1 >= nCurrX && m_X1 - nCurrX < 64){
+                nStop |= ((uint64_t)(1) << (m_X1 - nCurrX));
+            }
+
+            if(nStop){
+                auto nBit = 63 - __builtin_clzll(nStop);
+                *pX = nCurrX + nBit;
+                return (nThrough >> nBit) & 1;
+            }
+        }
+    }
+}
+
+bool JPSPathFinder::Jump(int nX, int nY, int nDX, int nDY, int *pX, int *pY) const
+{
+    if(nDY == 0){
+        *pY = nY;
+        return JumpX(nX, nY, nDX, pX);
+    }
+
+    while(true){
+        nX += nDX;
+        nY += nDY;
+
+        if(!CanThrough(nX, nY)){
+            return false;
+        }
+
+        bool bJumpPoint = false;
+        if(nX == m_X1 && nY == m_Y1){
+            bJumpPoint = true;
+        }else if(nDX && nDY){
+            // diagonal stops if any forced neighbor
+            // or a straight run from here reaches a jump point
+            int nJumpX = -1;
+            int nJumpY = -1;
+            bJumpPoint = false
+                || (!CanThrough(nX - nDX, nY) && CanThrough(nX - nDX, nY + nDY))
+                || (!CanThrough(nX, nY - nDY) && CanThrough(nX + nDX, nY - nDY))
+                || Jump(nX, nY, nDX, 0, &nJumpX, &nJumpY)
+                || Jump(nX, nY, 0, nDY, &nJumpX, &nJumpY);
+        }else{
+            bJumpPoint = false
+                || (!CanThrough(nX + 1, nY) && CanThrough(nX + 1, nY + nDY))
+                || (!CanThrough(nX - 1, nY) && CanThrough(nX - 1, nY + nDY));
+        }
+
+        if(bJumpPoint){
+            *pX = nX;
+            *pY = nY;
+            return true;
+        }
+    }
+}
+
+bool JPSPathFinder::Search(int nX0, int nY0, int nX1, int nY1, const std::function<bool()> &fnAbort)
+{
+    m_X0 = nX0;
+    m_Y0 = nY0;
+    m_X1 = nX1;
+    m_Y1 = nY1;
+
+    m_Cost = 0.00;
+    m_Path.clear();
+
+    if(false
+            || !m_Ground.ValidC(nX0, nY0)
+            || !m_Ground.ValidC(nX1, nY1)
+            || !CanThrough(nX1, nY1)){
+        return false;
+    }
+
+    if(nX0 == nX1 && nY0 == nY1){
+        m_Path.emplace_back(nX0, nY0);
+        return true;
+    }
+
+    auto nW = m_Ground.W();
+    auto nCellCount = (size_t)(nW) * (size_t)(m_Ground.H());
+
+    // stamp 0 is never used
+    // reset all records when it wraps
+    if(t_NodeV.size() < nCellCount){
+        t_NodeV.resize(nCellCount, JPSNode{0, -1, 0.00f, -1, false});
+    }
+
+    if(++t_Stamp == 0){
+        for(auto &rstNode: t_NodeV){
+            rstNode.Stamp = 0;
+        }
+        t_Stamp = 1;
+    }
+    t_OpenV.clear();
+
+    auto fnNode = [nW](int nX, int nY) -> JPSNode &
+    {
+        auto &rstNode = t_NodeV[(size_t)(nY) * nW + nX];
+        if(rstNode.Stamp != t_Stamp){
+            rstNode.Stamp     = t_Stamp;
+            rstNode.Parent    = -1;
+            rstNode.G         = std::numeric_limits<float>::max();
+            rstNode.Direction = -1;
+            rstNode.Closed    = false;
+        }
+        return rstNode;
+    };
+
+    auto fnPush = [this, nW](int nX, int nY, float fG)
+    {
+        t_OpenV.push_back({(float)(fG + MinCost(1, nX, nY, m_X1, m_Y1)), fG, (int32_t)(nY * nW + nX)});
+        std::push_heap(t_OpenV.begin(), t_OpenV.end());
+    };
+
+    fnNode(nX0, nY0).G = 0.00f;
+    fnPush(nX0, nY0, 0.00f);
+
+    size_t nStepCount = 0;
+    while(!t_OpenV.empty()){
+        if(fnAbort && ((++nStepCount % 64) == 0) && fnAbort()){
+            return false;
+        }
+
+        std::pop_heap(t_OpenV.begin(), t_OpenV.end());
+        auto stOpenNode = t_OpenV.back();
+        t_OpenV.pop_back();
+
+        int nX = stOpenNode.Cell % nW;
+        int nY = stOpenNode.Cell / nW;
+
+        // lazy removal
+        // a node is pushed again when its G gets smaller
+        auto &rstNode = fnNode(nX, nY);
+        if(rstNode.Closed || stOpenNode.G > rstNode.G){
+            continue;
+        }
+        rstNode.Closed = true;
+
+        if(nX == nX1 && nY == nY1){
+            break;
+        }
+
+        // successor directions, start node takes all 8
+        // others are pruned by the direction reaching it
+        int nDirCount = 0;
+        int nDirV[8];
+
+        if(rstNode.Direction < 0){
+            for(int nDir = 0; nDir < 8; ++nDir){
+                nDirV[nDirCount++] = nDir;
+            }
+        }else{
+            int nDX = g_DX[rstNode.Direction];
+            int nDY = g_DY[rstNode.Direction];
+
+            nDirV[nDirCount++] = rstNode.Direction;
+            if(nDX && nDY){
+                nDirV[nDirCount++] = DirIndex(nDX, 0);
+                nDirV[nDirCount++] = DirIndex(0, nDY);
+
+                if(!CanThrough(nX - nDX, nY)){ nDirV[nDirCount++] = DirIndex(-nDX,  nDY); }
+                if(!CanThrough(nX, nY - nDY)){ nDirV[nDirCount++] = DirIndex( nDX, -nDY); }
+            }else if(nDX){
+                if(!CanThrough(nX, nY + 1)){ nDirV[nDirCount++] = DirIndex(nDX, +1); }
+                if(!CanThrough(nX, nY - 1)){ nDirV[nDirCount++] = DirIndex(nDX, -1); }
+            }else{
+                if(!CanThrough(nX + 1, nY)){ nDirV[nDirCount++] = DirIndex(+1, nDY); }
+                if(!CanThrough(nX - 1, nY)){ nDirV[nDirCount++] = DirIndex(-1, nDY); }
+            }
+        }
+
+        for(int nIndex = 0; nIndex < nDirCount; ++nIndex){
+            auto nDir = nDirV[nIndex];
+
+            int nJumpX = -1;
+            int nJumpY = -1;
+            if(!Jump(nX, nY, g_DX[nDir], g_DY[nDir], &nJumpX, &nJumpY)){
+                continue;
+            }
+
+            auto &rstJumpNode = fnNode(nJumpX, nJumpY);
+            if(rstJumpNode.Closed){
+                continue;
+            }
+
+            // turn cost only when leaving a jump point
+            // grids between two jump points are in the same direction
+            auto fCost = RunCost(std::max<int>(std::abs(nJumpX - nX), std::abs(nJumpY - nY)), g_DX[nDir] && g_DY[nDir], 1);
+            if(rstNode.Direction >= 0){
+                auto nDDir = ((nDir - rstNode.Direction) + 8) % 8;
+                fCost += std::min<int>(nDDir, 8 - nDDir);
+            }
+
+            auto fG = (float)(rstNode.G + fCost);
+            if(fG < rstJumpNode.G){
+                rstJumpNode.G         = fG;
+                rstJumpNode.Parent    = stOpenNode.Cell;
+                rstJumpNode.Direction = (int8_t)(nDir);
+                fnPush(nJumpX, nJumpY, fG);
+            }
+        }
+    }
+
+    auto &rstGoalNode = fnNode(nX1, nY1);
+    if(!rstGoalNode.Closed){
+        return false;
+    }
+
+    // jump points from goal to start
+    // then expand to single hops
+    std::vector<PathFind::PathNode> stJumpPointV;
+    for(int32_t nCell = nY1 * nW + nX1; nCell >= 0; nCell = t_NodeV[nCell].Parent){
+        stJumpPointV.emplace_back(nCell % nW, nCell / nW);
+    }
+
+    m_Path.emplace_back(nX0, nY0);
+    for(auto pJumpPoint = stJumpPointV.rbegin() + 1; pJumpPoint != stJumpPointV.rend(); ++pJumpPoint){
+        auto nCurrX = m_Path.back().X;
+        auto nCurrY = m_Path.back().Y;
+
+        int nDX = (pJumpPoint->X > nCurrX) - (pJumpPoint->X < nCurrX);
+        int nDY = (pJumpPoint->Y > nCurrY) - (pJumpPoint->Y < nCurrY);
+
+        while(nCurrX != pJumpPoint->X || nCurrY != pJumpPoint->Y){
+            nCurrX += nDX;
+            nCurrY += nDY;
+            m_Path.emplace_back(nCurrX, nCurrY);
+        }
+    }
+
+    // cost with MaxStep hops
+    // two jump points in a line make one straight run
+    int nRunDir    = -1;
+    int nRunLength =  0;
+    for(size_t nIndex = 1; nIndex <= m_Path.size(); ++nIndex){
+        int nDir = -1;
+        if(nIndex < m_Path.size()){
+            nDir = DirIndex(m_Path[nIndex].X - m_Path[nIndex - 1].X, m_Path[nIndex].Y - m_Path[nIndex - 1].Y);
+        }
+
+        if(nDir == nRunDir){
+            nRunLength++;
+            continue;
+        }
+
+        if(nRunDir >= 0){
+            m_Cost += RunCost(nRunLength, g_DX[nRunDir] && g_DY[nRunDir], m_MaxStep);
+            if(nDir >= 0){
+                auto nDDir = ((nDir - nRunDir) + 8) % 8;
+                m_Cost += std::min<int>(nDDir, 8 - nDDir);
+            }
+        }
+
+        nRunDir    = nDir;
+        nRunLength = 1;
+    }
+    return true;
+}
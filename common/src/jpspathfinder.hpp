@@ -0,0 +1,170 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: jpspathfinder.hpp
+ *        Created: 12/08/2017 10:25:43
+ *  Last Modified: 12/08/2017 23:12:09
+ *
+ *    Description: jump point search on a BitGrid
+ *
+ *                 AStarPathFinder puts every grid it reaches into the open list and calls
+ *                 std::function for each successor, its node pool holds 1000 nodes only
+ *                 JPS skips straight runs and only stops at jump points, where the path
+ *                 turns or some neighbor is forced by an obstacle
+ *
+ *                 same move semantics as AStarPathFinder used by the server:
+ *                      1. diagonal move can cut corners, only grids on the line are checked
+ *                      2. hop size is MaxStep or 1, straight run of L grids is split into
+ *                         L / MaxStep long hops and L % MaxStep single hops
+ *                      3. hop cost is 1.00 + (0.01 * size) + (0.10 if diagonal)
+ *                      4. turn cost min(d, 8 - d) where d is the direction change
+ *
+ *                 all turns of a JPS path happen at jump points, so 4. is charged when
+ *                 leaving a jump point
+ *
+ *                 search itself takes single hops, pruning needs costs adding up grid by
+ *                 grid, a long hop makes a run cheaper than its parts and breaks it, then
+ *                 MaxStep only cuts the path found into hops, Cost() counts with MaxStep
+ *
+ *                 pruning rules assume uniform grid cost, grids with different cost as CO
+ *                 should be given as blocked, or use AStarPathFinder with a cost function
+ *
+ *                 horizontal runs are scanned 64 grids a time with BitGrid::Word()
+ *                 node records are in a dense per-thread buffer reused by all searches
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+#include <functional>
+
+#include "bitgrid.hpp"
+#include "pathfinder.hpp"
+
+class JPSPathFinder final
+{
+    private:
+        const BitGrid &m_Ground;
+
+    private:
+        // optional extra blocked grids
+        // bit (0, 0) of m_Block is (m_BlockX, m_BlockY) of the ground
+        const BitGrid *m_Block;
+        const int      m_BlockX;
+        const int      m_BlockY;
+
+    private:
+        const int m_MaxStep;
+
+    private:
+        int m_X0;
+        int m_Y0;
+        int m_X1;
+        int m_Y1;
+
+    private:
+        double m_Cost;
+        std::vector<PathFind::PathNode> m_Path;
+
+    public:
+        JPSPathFinder(const BitGrid &rstGround, const BitGrid *pBlock, int nBlockX, int nBlockY, int nMaxStep)
+            : m_Ground(rstGround)
+            , m_Block(pBlock)
+            , m_BlockX(nBlockX)
+            , m_BlockY(nBlockY)
+            , m_MaxStep(nMaxStep)
+            , m_X0(-1)
+            , m_Y0(-1)
+            , m_X1(-1)
+            , m_Y1(-1)
+            , m_Cost(0.00)
+            , m_Path()
+        {
+            condcheck(false
+                    || (m_MaxStep == 1)
+                    || (m_MaxStep == 2)
+                    || (m_MaxStep == 3));
+        }
+
+    public:
+        // start is always taken as passable, it's where the requestor stands
+        // goal is passable if ground is valid, even if it's blocked
+        bool Search(int, int, int, int, const std::function<bool()> & = {});
+
+    public:
+        // path of single hops including start and goal
+        // empty if last search failed
+        const std::vector<PathFind::PathNode> &Path() const
+        {
+            return m_Path;
+        }
+
+        double Cost() const
+        {
+            return m_Cost;
+        }
+
+    public:
+        // cost of any path from (nX0, nY0) to (nX1, nY1) is no less than it
+        // same as AStarPathFinderNode::GoalDistanceEstimate()
+        static double MinCost(int nMaxStep, int nX0, int nY0, int nX1, int nY1)
+        {
+            auto nXDistance = (std::abs(nX1 - nX0) + (nMaxStep - 1)) / nMaxStep;
+            auto nYDistance = (std::abs(nY1 - nY0) + (nMaxStep - 1)) / nMaxStep;
+            return (double)(std::max<int>(nXDistance, nYDistance));
+        }
+
+    private:
+        bool CanThrough(int nX, int nY) const
+        {
+            if(nX == m_X0 && nY == m_Y0){
+                return true;
+            }
+
+            if(!m_Ground.Get(nX, nY)){
+                return false;
+            }
+
+            if(nX == m_X1 && nY == m_Y1){
+                return true;
+            }
+            return !(m_Block && m_Block->Get(nX - m_BlockX, nY - m_BlockY));
+        }
+
+    private:
+        // CanThrough() of 64 grids start from (nX, nY)
+        uint64_t Through(int nX, int nY) const
+        {
+            auto nBits = m_Ground.Word(nX, nY);
+            if(m_Block){
+                nBits &= ~m_Block->Word(nX - m_BlockX, nY - m_BlockY);
+            }
+
+            if(nY == m_Y1 && m_X1 >= nX && m_X1 - nX < 64 && m_Ground.Get(m_X1, m_Y1)){
+                nBits |= ((uint64_t)(1) << (m_X1 - nX));
+            }
+
+            if(nY == m_Y0 && m_X0 >= nX && m_X0 - nX < 64){
+                nBits |= ((uint64_t)(1) << (m_X0 - nX));
+            }
+            return nBits;
+        }
+
+    private:
+        bool Jump (int, int, int, int, int *, int *) const;
+        bool JumpX(int, int, int, int *) const;
+
+    private:
+        static double RunCost(int, bool, int);
+};
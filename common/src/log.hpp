@@ -3,10 +3,26 @@
  *
  *       Filename: log.hpp
  *        Created: 03/16/2016 16:05:17
- *  Last Modified: 04/12/2017 22:38:56
+ *  Last Modified: 11/29/2017 23:40:12
  *
  *    Description: log functionality enabled by g3Log
  *
+ *                 LOGTYPE_XXXX is a call-site descriptor with only literals, no string
+ *                 is built per call, and a log is dropped before formatting if the level
+ *                 is disabled by:
+ *
+ *                      1. MIR2X_LOG_LEVEL  : compile time, -DMIR2X_LOG_LEVEL=0 removes debug
+ *                      2. Log::SetLevel()  : runtime
+ *
+ *                 use MIR2X_ADDLOG() in hot path, then even the arguments are not evaluated
+ *                 if the level is disabled
+ *
+ *                      MIR2X_ADDLOG(g_MonoServer, DEBUG, "UID = %" PRIu32, UID());
+ *
+ *                 formatted log goes to a lock-free ring of the calling thread, a writer
+ *                 thread drains all rings to g3log and the sink, fatal log and log with a
+ *                 full ring are written in place
+ *
  *        Version: 1.0
  *       Revision: none
  *       Compiler: gcc
@@ -19,11 +35,20 @@
  */
 
 #pragma once
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
 #include <thread>
 #include <string>
+#include <vector>
+#include <cstdio>
 #include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <functional>
+#include <condition_variable>
 #include <g3log/g3log.hpp>
 #include <g3log/logworker.hpp>
 
@@ -42,11 +67,25 @@
 #define LOG_ARGV0 "mir2x"
 #endif
 
+// logs with lower level are removed at compile time
+// default keeps all, release build can define it as 0 to remove debug logs
+#ifndef MIR2X_LOG_LEVEL
+#define MIR2X_LOG_LEVEL -1
+#endif
 
-#define LOGTYPE_DEBUG   {std::string("-1"), std::string(__FILE__), std::to_string(__LINE__), std::string(__PRETTY_FUNCTION__)}
-#define LOGTYPE_INFO    {std::string( "0"), std::string(__FILE__), std::to_string(__LINE__), std::string(__PRETTY_FUNCTION__)}
-#define LOGTYPE_WARNING {std::string( "1"), std::string(__FILE__), std::to_string(__LINE__), std::string(__PRETTY_FUNCTION__)}
-#define LOGTYPE_FATAL   {std::string( "2"), std::string(__FILE__), std::to_string(__LINE__), std::string(__PRETTY_FUNCTION__)}
+#define LOGTYPE_DEBUG   (Log::LogSite{Log::LOGTYPEV_DEBUG,   __FILE__, __LINE__, __PRETTY_FUNCTION__})
+#define LOGTYPE_INFO    (Log::LogSite{Log::LOGTYPEV_INFO,    __FILE__, __LINE__, __PRETTY_FUNCTION__})
+#define LOGTYPE_WARNING (Log::LogSite{Log::LOGTYPEV_WARNING, __FILE__, __LINE__, __PRETTY_FUNCTION__})
+#define LOGTYPE_FATAL   (Log::LogSite{Log::LOGTYPEV_FATAL,   __FILE__, __LINE__, __PRETTY_FUNCTION__})
+
+// skip the whole call including arguments if the level is disabled
+// pLogger can be g_Log or g_MonoServer, szLogType is one of DEBUG, INFO, WARNING, FATAL
+#define MIR2X_ADDLOG(pLogger, szLogType, ...) \
+    do{ \
+        if(Log::Enabled(Log::LOGTYPEV_##szLogType)){ \
+            (pLogger)->AddLog(LOGTYPE_##szLogType, __VA_ARGS__); \
+        } \
+    }while(0)
 
 class Log final
 {
@@ -58,13 +97,142 @@ class Log final
             LOGTYPEV_FATAL   =  2,
         };
 
+    public:
+        // all pointers refer to literals
+        // can be kept by the writer after the call returns
+        struct LogSite
+        {
+            int Level;
+
+            const char *File;
+            int         Line;
+            const char *Function;
+        };
+
+        // called by the writer thread for every log
+        // or by the logging thread if the log is written in place
+        using LogSink = std::function<void(int, const char *)>;
+
+    private:
+        struct LogRecord
+        {
+            LogSite Site;
+
+            // keeps its capacity when reused
+            // then a warm slot won't allocate
+            std::string Info;
+        };
+
+        // single producer: the owner thread
+        // single consumer: the writer thread
+        class LogRing final
+        {
+            private:
+                static constexpr size_t RING_SIZE = 512;
+
+            private:
+                std::array<LogRecord, RING_SIZE> m_RecordV;
+
+            private:
+                std::atomic<size_t> m_Head;
+                std::atomic<size_t> m_Tail;
+                std::atomic<bool>   m_Detached;
+
+            public:
+                LogRing()
+                    : m_RecordV()
+                    , m_Head(0)
+                    , m_Tail(0)
+                    , m_Detached(false)
+                {}
+
+            public:
+                bool Push(const LogSite &rstSite, const char *szInfo, size_t nSize)
+                {
+                    auto nTail = m_Tail.load(std::memory_order_relaxed);
+                    if(nTail - m_Head.load(std::memory_order_acquire) >= RING_SIZE){
+                        return false;
+                    }
+
+                    auto &rstRecord = m_RecordV[nTail % RING_SIZE];
+                    rstRecord.Site = rstSite;
+                    rstRecord.Info.assign(szInfo, nSize);
+
+                    m_Tail.store(nTail + 1, std::memory_order_release);
+                    return true;
+                }
+
+                template<typename F> size_t Drain(F &&fnWrite)
+                {
+                    auto nHead = m_Head.load(std::memory_order_relaxed);
+                    auto nTail = m_Tail.load(std::memory_order_acquire);
+
+                    for(auto nIndex = nHead; nIndex != nTail; ++nIndex){
+                        fnWrite(m_RecordV[nIndex % RING_SIZE]);
+                    }
+
+                    m_Head.store(nTail, std::memory_order_release);
+                    return nTail - nHead;
+                }
+
+            public:
+                // owner thread exits
+                // ring is released by the writer after the last drain
+                void Detach()
+                {
+                    m_Detached.store(true, std::memory_order_release);
+                }
+
+                bool Detached() const
+                {
+                    return m_Detached.load(std::memory_order_acquire);
+                }
+        };
+
+        struct LogRingHolder
+        {
+            std::shared_ptr<LogRing> Ring;
+
+            ~LogRingHolder()
+            {
+                if(Ring){
+                    Ring->Detach();
+                }
+            }
+        };
+
     private:
         std::unique_ptr<g3::FileSinkHandle> m_Handler;
         std::unique_ptr<g3::LogWorker>      m_Worker;
         std::string                         m_LogFileName;
 
+    private:
+        std::mutex m_SinkLock;
+        LogSink    m_Sink;
+
+    private:
+        std::mutex                            m_RingLock;
+        std::vector<std::shared_ptr<LogRing>> m_RingV;
+
+    private:
+        bool                    m_Stop;
+        std::mutex              m_StopLock;
+        std::condition_variable m_Condition;
+        std::thread             m_Writer;
+
     public:
         Log(const char *szLogArg0 = LOG_ARGV0, const char *szLogPath = LOG_PATH)
+            : m_Handler()
+            , m_Worker()
+            , m_LogFileName()
+            , m_SinkLock()
+            , m_Sink()
+            , m_RingLock()
+            , m_RingV()
+            , m_Stop(false)
+            , m_StopLock()
+            , m_Condition()
+            , m_Writer()
         {
             extern Log *g_Log;
             if(g_Log){ throw std::runtime_error("only one Log instance please."); }
@@ -83,9 +251,22 @@ class Log final
             std::cout << "* Log file: [" << m_LogFileName << "]"                       << std::endl;
             std::cout << "* Log functionality established!"                            << std::endl;
             std::cout << "* All messges will be redirected to the log after this line" << std::endl;
+
+            m_Writer = std::thread([this](){ WriterLoop(); });
         }
 
-        ~Log() = default;
+       ~Log()
+        {
+            {
+                std::lock_guard<std::mutex> stLockGuard(m_StopLock);
+                m_Stop = true;
+            }
+
+            m_Condition.notify_all();
+            if(m_Writer.joinable()){
+                m_Writer.join();
+            }
+        }
 
     public:
         const char *FileName() const
@@ -93,29 +274,157 @@ class Log final
             return m_LogFileName.c_str();
         }
 
-    private:
-        decltype(INFO) GetLevel(const char *szLevel)
+    public:
+        static std::atomic<int> &RuntimeLevel()
+        {
+            static std::atomic<int> s_Level(LOGTYPEV_DEBUG);
+            return s_Level;
+        }
+
+        static void SetLevel(int nLevel)
+        {
+            RuntimeLevel().store(nLevel, std::memory_order_relaxed);
+        }
+
+        // first part is a constant
+        // compiler removes the whole call if it's false
+        static bool Enabled(int nLevel)
         {
-            if(!std::strcmp(szLevel, "0")){ return INFO;    }
-            if(!std::strcmp(szLevel, "1")){ return WARNING; }
-            if(!std::strcmp(szLevel, "2")){ return FATAL;   }
+            return true
+                && (nLevel >= MIR2X_LOG_LEVEL)
+                && (nLevel >= RuntimeLevel().load(std::memory_order_relaxed));
+        }
 
-            return DEBUG;
+    public:
+        void SetSink(LogSink fnSink)
+        {
+            std::lock_guard<std::mutex> stLockGuard(m_SinkLock);
+            m_Sink = std::move(fnSink);
+        }
+
+    private:
+        decltype(INFO) GetLevel(int nLevel)
+        {
+            switch(nLevel){
+                case LOGTYPEV_INFO   : return INFO;
+                case LOGTYPEV_WARNING: return WARNING;
+                case LOGTYPEV_FATAL  : return FATAL;
+                default              : return DEBUG;
+            }
         }
 
     public:
         // to get rid of ``format-security" warning
-        void AddLog(const std::array<std::string, 4> &stLoc, const char *szInfo)
+        void AddLog(const LogSite &rstSite, const char *szInfo)
         {
-            int nLine = std::atoi(stLoc[2].c_str());
-            auto stLevel = GetLevel(stLoc[0].c_str());
-            LogCapture(stLoc[1].c_str(), nLine, stLoc[3].c_str(), stLevel).capturef("%s", szInfo);
+            if(Enabled(rstSite.Level)){
+                szInfo = szInfo ? szInfo : "";
+                Stage(rstSite, szInfo, std::strlen(szInfo));
+            }
         }
 
-        template<typename... U> void AddLog(const std::array<std::string, 4> &stLoc, const char *szLogFormat, U&&... u)
+        template<typename... U> void AddLog(const LogSite &rstSite, const char *szLogFormat, U&&... u)
         {
-            int nLine = std::atoi(stLoc[2].c_str());
-            auto stLevel = GetLevel(stLoc[0].c_str());
-            LogCapture(stLoc[1].c_str(), nLine, stLoc[3].c_str(), stLevel).capturef(szLogFormat, std::forward<U>(u)...);
+            if(!Enabled(rstSite.Level)){
+                return;
+            }
+
+            auto &rstBuf = FormatBuf();
+            auto nLogSize = std::snprintf(&(rstBuf[0]), rstBuf.size(), szLogFormat, u...);
+
+            if(nLogSize >= 0 && (size_t)(nLogSize) >= rstBuf.size()){
+                rstBuf.resize(nLogSize + 1 + 64);
+                nLogSize = std::snprintf(&(rstBuf[0]), rstBuf.size(), szLogFormat, u...);
+            }
+
+            if(nLogSize < 0){
+                std::string szError = std::string("Parse log info failed: ") + (szLogFormat ? szLogFormat : "");
+                Stage({LOGTYPEV_FATAL, rstSite.File, rstSite.Line, rstSite.Function}, szError.c_str(), szError.size());
+                return;
+            }
+            Stage(rstSite, &(rstBuf[0]), (size_t)(nLogSize));
+        }
+
+    private:
+        static std::vector<char> &FormatBuf()
+        {
+            thread_local std::vector<char> s_FormatBuf(1024);
+            return s_FormatBuf;
+        }
+
+    private:
+        LogRing *ThreadRing()
+        {
+            thread_local LogRingHolder s_Holder;
+            if(!s_Holder.Ring){
+                s_Holder.Ring = std::make_shared<LogRing>();
+                {
+                    std::lock_guard<std::mutex> stLockGuard(m_RingLock);
+                    m_RingV.push_back(s_Holder.Ring);
+                }
+            }
+            return s_Holder.Ring.get();
+        }
+
+        void Stage(const LogSite &rstSite, const char *szInfo, size_t nSize)
+        {
+            // fatal log aborts in g3log
+            // write it in place then the stack is still there
+            if(rstSite.Level >= LOGTYPEV_FATAL || !ThreadRing()->Push(rstSite, szInfo, nSize)){
+                Write(rstSite, szInfo);
+                return;
+            }
+
+            if(rstSite.Level >= LOGTYPEV_WARNING){
+                m_Condition.notify_one();
+            }
+        }
+
+        void Write(const LogSite &rstSite, const char *szInfo)
+        {
+            LogCapture(rstSite.File, rstSite.Line, rstSite.Function, GetLevel(rstSite.Level)).capturef("%s", szInfo);
+            {
+                std::lock_guard<std::mutex> stLockGuard(m_SinkLock);
+                if(m_Sink){
+                    m_Sink(rstSite.Level, szInfo);
+                }
+            }
+        }
+
+    private:
+        void WriterLoop()
+        {
+            while(true){
+                size_t nCount = 0;
+                {
+                    std::lock_guard<std::mutex> stLockGuard(m_RingLock);
+                    for(auto pRing = m_RingV.begin(); pRing != m_RingV.end();){
+                        // check before drain
+                        // a detached ring gets no more logs after this point
+                        bool bDetached = (*pRing)->Detached();
+                        nCount += (*pRing)->Drain([this](const LogRecord &rstRecord)
+                        {
+                            Write(rstRecord.Site, rstRecord.Info.c_str());
+                        });
+
+                        if(bDetached){
+                            pRing = m_RingV.erase(pRing);
+                        }else{
+                            ++pRing;
+                        }
+                    }
+                }
+
+                if(!nCount){
+                    std::unique_lock<std::mutex> stUniqueLock(m_StopLock);
+                    if(m_Stop){
+                        break;
+                    }
+
+                    // no notification for info and debug logs
+                    // they wait at most one period
+                    m_Condition.wait_for(stUniqueLock, std::chrono::milliseconds(10));
+                }
+            }
         }
 };
@@ -3,9 +3,12 @@
  *
  *       Filename: mapbindbn.hpp
  *        Created: 09/05/2017 10:33:14
- *  Last Modified: 09/05/2017 10:47:28
+ *  Last Modified: 12/09/2017 23:35:42
  *
- *    Description: 
+ *    Description: map binary database of the server
+ *
+ *                 loads uncompressed map pack if the file is, otherwise as a zip file,
+ *                 map from the pack is a view over the mapping and is never evicted
  *
  *        Version: 1.0
  *       Revision: none
@@ -20,6 +23,7 @@
 
 #pragma once
 #include "mapbindb.hpp"
+#include "mapbinpack.hpp"
 
 #define MAPBINDBN_LC_DEPTH  0
 #define MAPBINDBN_LC_LENGTH 0
@@ -29,17 +33,31 @@ using MapBinDBType = MapBinDB<MAPBINDBN_LC_DEPTH, MAPBINDBN_LC_LENGTH, MAPBINDBN
 
 class MapBinDBN: public MapBinDBType
 {
+    private:
+        MapBinPack m_Pack;
+
     public:
         MapBinDBN()
             : MapBinDBType()
+            , m_Pack()
         {}
 
     public:
         virtual ~MapBinDBN() = default;
 
     public:
-        Mir2xMapData *Retrieve(uint32_t nKey)
+        bool Load(const char *szMapDBName)
+        {
+            return m_Pack.Load(szMapDBName) || MapBinDBType::Load(szMapDBName);
+        }
+
+    public:
+        const Mir2xMapData *Retrieve(uint32_t nKey)
         {
+            if(m_Pack.Valid()){
+                return m_Pack.Retrieve(nKey);
+            }
+
             const auto &fnLinearCacheKey = [](uint32_t) -> size_t
             {
                 return 0;
@@ -47,4 +65,12 @@ class MapBinDBN: public MapBinDBType
 
             return RetrieveItem(nKey, fnLinearCacheKey).Map;
         }
+
+    public:
+        // only the map pack has navigation graphs
+        // without it the map builds one when loading
+        const NavGraph *RetrieveNavGraph(uint32_t nKey) const
+        {
+            return m_Pack.Valid() ? m_Pack.RetrieveNavGraph(nKey) : nullptr;
+        }
 };
@@ -0,0 +1,281 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: mapbinpack.cpp
+ *        Created: 12/06/2017 11:20:05
+ *  Last Modified: 12/09/2017 23:35:42
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include "mapbinpack.hpp"
+
+bool MapBinPack::Load(const char *szPackName)
+{
+    Unload();
+    if(!(szPackName && std::strlen(szPackName))){
+        return false;
+    }
+
+#ifdef _WIN32
+    if(auto fp = std::fopen(szPackName, "rb")){
+        std::fseek(fp, 0, SEEK_END);
+        auto nDataLen = std::ftell(fp);
+        std::fseek(fp, 0, SEEK_SET);
+
+        if(nDataLen > 0){
+            m_Buf.resize(nDataLen);
+            if(std::fread(&(m_Buf[0]), nDataLen, 1, fp) == 1){
+                m_Data    = &(m_Buf[0]);
+                m_DataLen = m_Buf.size();
+            }
+        }
+        std::fclose(fp);
+    }
+#else
+    auto nFD = open(szPackName, O_RDONLY);
+    if(nFD >= 0){
+        struct stat stFileStat;
+        if(true
+                && !fstat(nFD, &stFileStat)
+                && stFileStat.st_size >= (off_t)(sizeof(MapBinPackHeader))){
+
+            // shared read-only mapping
+            // all processes use the same page cache
+            auto pMapping = mmap(nullptr, stFileStat.st_size, PROT_READ, MAP_SHARED, nFD, 0);
+            if(pMapping != MAP_FAILED){
+                m_Data    = (const uint8_t *)(pMapping);
+                m_DataLen = (size_t)(stFileStat.st_size);
+            }
+        }
+
+        // mapping keeps the file
+        // fd is not needed after mmap
+        close(nFD);
+    }
+#endif
+
+    if(!m_Data){
+        Unload();
+        return false;
+    }
+
+    MapBinPackHeader stHeader;
+    std::memcpy(&stHeader, m_Data, sizeof(stHeader));
+
+    if(false
+            || std::memcmp(stHeader.Magic, MAPBINPACK_MAGIC, sizeof(stHeader.Magic))
+            || stHeader.Version < 1
+            || stHeader.Version > MAPBINPACK_VERSION
+            || stHeader.Count == 0
+            || sizeof(MapBinPackHeader) + (size_t)(stHeader.Count) * sizeof(MapBinPackEntry) > m_DataLen){
+        Unload();
+        return false;
+    }
+
+    for(uint32_t nIndex = 0; nIndex < stHeader.Count; ++nIndex){
+        MapBinPackEntry stEntry;
+        std::memcpy(&stEntry, m_Data + sizeof(MapBinPackHeader) + nIndex * sizeof(MapBinPackEntry), sizeof(stEntry));
+
+        if(false
+                || stEntry.MapID == 0
+                || stEntry.Offset > m_DataLen
+                || stEntry.Length > m_DataLen - stEntry.Offset){
+            Unload();
+            return false;
+        }
+
+        // version 1 has no type
+        // the field was reserved and always zero
+        if(stHeader.Version == 1){
+            stEntry.Type = MAPBINPACK_MAPDATA;
+        }
+
+        switch(stEntry.Type){
+            case MAPBINPACK_MAPDATA:
+                {
+                    // View() only checks the size
+                    // the pages are not touched here
+                    Mir2xMapData stMapData;
+                    if(!stMapData.View(m_Data + stEntry.Offset, (size_t)(stEntry.Length))){
+                        Unload();
+                        return false;
+                    }
+                    m_MapRecord[stEntry.MapID] = stMapData;
+                    break;
+                }
+            case MAPBINPACK_NAVGRAPH:
+                {
+                    // checks all indices of the graph
+                    // graph is much smaller than the map data
+                    if(!m_NavRecord[stEntry.MapID].View(m_Data + stEntry.Offset, (size_t)(stEntry.Length))){
+                        Unload();
+                        return false;
+                    }
+                    break;
+                }
+            default:
+                {
+                    break;
+                }
+        }
+    }
+
+    // graph without map data is useless
+    // and the size should match
+    for(auto pRecord = m_NavRecord.begin(); pRecord != m_NavRecord.end();){
+        auto pMapData = Retrieve(pRecord->first);
+        if(!(true
+                    && pMapData
+                    && pMapData->W() == pRecord->second.W()
+                    && pMapData->H() == pRecord->second.H())){
+            pRecord = m_NavRecord.erase(pRecord);
+        }else{
+            ++pRecord;
+        }
+    }
+
+    return Valid();
+}
+
+void MapBinPack::Unload()
+{
+    m_MapRecord.clear();
+    m_NavRecord.clear();
+
+#ifndef _WIN32
+    if(m_Data && m_Buf.empty()){
+        munmap((void *)(m_Data), m_DataLen);
+    }
+#endif
+
+    m_Buf.clear();
+    m_Data    = nullptr;
+    m_DataLen = 0;
+}
+
+bool MapBinPack::Save(const char *szPackName, const std::map<uint32_t, const Mir2xMapData *> &rstMapList, const std::map<uint32_t, const NavGraph *> &rstNavList)
+{
+    if(!(szPackName && std::strlen(szPackName) && !rstMapList.empty())){
+        return false;
+    }
+
+    for(auto &rstMap: rstMapList){
+        if(!(rstMap.first && rstMap.second && rstMap.second->Valid())){
+            return false;
+        }
+    }
+
+    for(auto &rstNav: rstNavList){
+        if(!(true
+                    && rstNav.second
+                    && rstNav.second->Valid()
+                    && rstMapList.find(rstNav.first) != rstMapList.end())){
+            return false;
+        }
+    }
+
+    MapBinPackHeader stHeader;
+    std::memcpy(stHeader.Magic, MAPBINPACK_MAGIC, sizeof(stHeader.Magic));
+    stHeader.Version = MAPBINPACK_VERSION;
+    stHeader.Count   = (uint32_t)(rstMapList.size() + rstNavList.size());
+
+    auto fnAlign = [](uint64_t nOffset) -> uint64_t
+    {
+        return (nOffset + MAPBINPACK_ALIGN - 1) / MAPBINPACK_ALIGN * MAPBINPACK_ALIGN;
+    };
+
+    // each map starts at a new page
+    // then no two maps share one page
+    std::vector<MapBinPackEntry> stEntryV;
+    uint64_t nOffset = fnAlign(sizeof(MapBinPackHeader) + stHeader.Count * sizeof(MapBinPackEntry));
+
+    for(auto &rstMap: rstMapList){
+        MapBinPackEntry stEntry;
+        stEntry.MapID  = rstMap.first;
+        stEntry.Type   = MAPBINPACK_MAPDATA;
+        stEntry.Offset = nOffset;
+        stEntry.Length = 4 + rstMap.second->DataLen();
+
+        stEntryV.push_back(stEntry);
+        nOffset = fnAlign(stEntry.Offset + stEntry.Length);
+    }
+
+    for(auto &rstNav: rstNavList){
+        MapBinPackEntry stEntry;
+        stEntry.MapID  = rstNav.first;
+        stEntry.Type   = MAPBINPACK_NAVGRAPH;
+        stEntry.Offset = nOffset;
+        stEntry.Length = rstNav.second->DataLen();
+
+        stEntryV.push_back(stEntry);
+        nOffset = fnAlign(stEntry.Offset + stEntry.Length);
+    }
+
+    auto fp = std::fopen(szPackName, "wb");
+    if(!fp){
+        return false;
+    }
+
+    bool bSaveOK = true;
+    auto fnWrite = [fp, &bSaveOK](const void *pData, size_t nDataLen)
+    {
+        if(bSaveOK && nDataLen){
+            bSaveOK = (std::fwrite(pData, nDataLen, 1, fp) == 1);
+        }
+    };
+
+    auto fnPadding = [fp, &fnWrite](uint64_t nOffset)
+    {
+        static const uint8_t s_Zero[MAPBINPACK_ALIGN] {0};
+        auto nCurrOffset = (uint64_t)(std::ftell(fp));
+        if(nCurrOffset < nOffset){
+            fnWrite(s_Zero, (size_t)(nOffset - nCurrOffset));
+        }
+    };
+
+    fnWrite(&stHeader, sizeof(stHeader));
+    fnWrite(&(stEntryV[0]), stEntryV.size() * sizeof(stEntryV[0]));
+
+    size_t nIndex = 0;
+    for(auto &rstMap: rstMapList){
+        auto nW = (uint16_t)(rstMap.second->W());
+        auto nH = (uint16_t)(rstMap.second->H());
+
+        fnPadding(stEntryV[nIndex++].Offset);
+        fnWrite(&nW, 2);
+        fnWrite(&nH, 2);
+        fnWrite(rstMap.second->Data(), rstMap.second->DataLen());
+    }
+
+    for(auto &rstNav: rstNavList){
+        fnPadding(stEntryV[nIndex++].Offset);
+        fnWrite(rstNav.second->Data(), rstNav.second->DataLen());
+    }
+
+    // pad the last map
+    // then the file size is page aligned
+    fnPadding(nOffset);
+
+    bSaveOK = (std::fclose(fp) == 0) && bSaveOK;
+    return bSaveOK;
+}
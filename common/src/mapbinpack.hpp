@@ -0,0 +1,129 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: mapbinpack.hpp
+ *        Created: 12/06/2017 10:42:16
+ *  Last Modified: 12/09/2017 23:35:42
+ *
+ *    Description: uncompressed map pack, mmap-ed read-only and shared by all maps
+ *
+ *                 file layout, all integers in little endian:
+ *
+ *                      MapBinPackHeader
+ *                      MapBinPackEntry[Count]
+ *                      data at 4096-aligned offsets, by MapBinPackEntry::Type:
+ *
+ *                          MAPBINPACK_MAPDATA  : same format as Mir2xMapData::Save()
+ *                          MAPBINPACK_NAVGRAPH : NavGraph of the map, optional
+ *
+ *                 version 1 has no type and all entries are map data, unknown types are
+ *                 skipped for newer packs
+ *
+ *                 Retrieve() returns views of Mir2xMapData over the mapping, no copy and
+ *                 no decompression, static map data is counted once in page cache for all
+ *                 server maps and processes, pages are loaded when first accessed
+ *
+ *                 Retrieve() / RetrieveNavGraph() are read-only after Load(), thread safe
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <map>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include "navgraph.hpp"
+#include "mir2xmapdata.hpp"
+
+#define MAPBINPACK_MAGIC   "MIR2XPAK"
+#define MAPBINPACK_VERSION 2
+#define MAPBINPACK_ALIGN   4096
+
+#define MAPBINPACK_MAPDATA  0
+#define MAPBINPACK_NAVGRAPH 1
+
+#pragma pack(push, 1)
+struct MapBinPackHeader
+{
+    char     Magic[8];
+    uint32_t Version;
+    uint32_t Count;
+};
+
+struct MapBinPackEntry
+{
+    uint32_t MapID;
+    uint32_t Type;
+    uint64_t Offset;
+    uint64_t Length;
+};
+#pragma pack(pop)
+
+class MapBinPack final
+{
+    private:
+        const uint8_t *m_Data;
+        size_t         m_DataLen;
+
+    private:
+        // used when mmap not supported
+        // then map data are views of this buffer
+        std::vector<uint8_t> m_Buf;
+
+    private:
+        std::unordered_map<uint32_t, Mir2xMapData> m_MapRecord;
+        std::unordered_map<uint32_t, NavGraph>     m_NavRecord;
+
+    public:
+        MapBinPack()
+            : m_Data(nullptr)
+            , m_DataLen(0)
+            , m_Buf()
+            , m_MapRecord()
+            , m_NavRecord()
+        {}
+
+        MapBinPack(const MapBinPack &) = delete;
+        MapBinPack &operator = (const MapBinPack &) = delete;
+
+    public:
+        ~MapBinPack()
+        {
+            Unload();
+        }
+
+    public:
+        bool Load(const char *);
+        void Unload();
+
+    public:
+        bool Valid() const
+        {
+            return m_Data && !m_MapRecord.empty();
+        }
+
+    public:
+        const Mir2xMapData *Retrieve(uint32_t nMapID) const
+        {
+            auto pRecord = m_MapRecord.find(nMapID);
+            return (pRecord != m_MapRecord.end()) ? &(pRecord->second) : nullptr;
+        }
+
+        const NavGraph *RetrieveNavGraph(uint32_t nMapID) const
+        {
+            auto pRecord = m_NavRecord.find(nMapID);
+            return (pRecord != m_NavRecord.end()) ? &(pRecord->second) : nullptr;
+        }
+
+    public:
+        static bool Save(const char *, const std::map<uint32_t, const Mir2xMapData *> &, const std::map<uint32_t, const NavGraph *> & = {});
+};
@@ -3,7 +3,7 @@
  *
  *       Filename: memoryblockpn.hpp
  *        Created: 05/12/2016 23:01:23
- *  Last Modified: 06/12/2017 16:27:37
+ *  Last Modified: 12/04/2017 21:36:15
  *
  *    Description: fixed size memory block pool
  *                 simple implementation for performance
@@ -68,6 +68,7 @@
 #include <mutex>
 #include <vector>
 #include <memory>
+#include <cstddef>
 #include <cstdint>
 
 #include "cachequeue.hpp"
@@ -268,7 +269,7 @@ class MemoryBlockPN
 
             // pOff is the constant offset of a memory block to its data field
             // pHead is the starting address of the memory block, w.r.t. the data chunk to free
-            constexpr auto pOff  = (uint8_t *)(&((*((InnMemoryBlock *)(0))).Data[0]));
+            constexpr auto pOff  = (size_t)(offsetof(InnMemoryBlock, Data));
             const     auto pHead = (InnMemoryBlock *)((uint8_t *)pData - pOff);
 
             // 1. get the branch index
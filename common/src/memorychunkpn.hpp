@@ -3,7 +3,7 @@
  *
  *       Filename: memorychunkpn.hpp
  *        Created: 05/12/2016 23:01:23
- *  Last Modified: 04/24/2017 18:45:52
+ *  Last Modified: 12/04/2017 21:36:15
  *
  *    Description: unfixed-size memory chunk pool, thread safe is optional, but self-contained
  *                 this algorithm is based on buddy algorithm
@@ -72,6 +72,7 @@
 #include <array>
 #include <vector>
 #include <memory>
+#include <cstddef>
 #include <cstdint>
 
 #include "mathfunc.hpp"
@@ -435,7 +436,7 @@ class MemoryChunkPN
     public:
         void *Get(size_t nSizeInByte)
         {
-            constexpr auto nOff = (size_t)(uintptr_t)(&((*((InnMemoryChunk *)(0))).Data[0]));
+            constexpr auto nOff = (size_t)(offsetof(InnMemoryChunk, Data));
             size_t nSizeInUnit = (nSizeInByte + nOff + UnitSize - 1) / UnitSize;
 
             // then nSizeInUnit == 0 won't happen
@@ -478,7 +479,7 @@ class MemoryChunkPN
         {
             if(!pBuf){ return; }
 
-            constexpr auto pOff = (uint8_t *)(&((*((InnMemoryChunk *)(0))).Data[0]));
+            constexpr auto pOff = (size_t)(offsetof(InnMemoryChunk, Data));
             auto pHead = (InnMemoryChunk *)((uint8_t *)pBuf - pOff);
 
             if(!pHead->In){
@@ -492,7 +493,7 @@ class MemoryChunkPN
             }
 
             // ok this is in multi-thread environment, we need the lock
-            InnLockGuard(m_MCPBV[pHead->BranchID].Lock);
+            InnLockGuard stLockGuard(m_MCPBV[pHead->BranchID].Lock);
             m_MCPBV[pHead->BranchID].PoolV[pHead->PoolID]->Free(pHead->NodeID);
         }
 };
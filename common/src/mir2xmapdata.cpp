@@ -3,7 +3,7 @@
  *
  *       Filename: mir2xmapdata.cpp
  *        Created: 08/31/2015 18:26:57
- *  Last Modified: 08/31/2017 23:29:08
+ *  Last Modified: 12/06/2017 23:07:51
  *
  *    Description: class to record data for mir2x map
  *                 this class won't define operation over the data
@@ -65,6 +65,7 @@ bool Mir2xMapData::Load(const char *szFullName)
 
 bool Mir2xMapData::Load(const uint8_t *pData, size_t nDataLen)
 {
+    m_View = nullptr;
     if(true
             && pData
             && nDataLen >= 4){
@@ -92,6 +93,37 @@ bool Mir2xMapData::Load(const uint8_t *pData, size_t nDataLen)
     return false;
 }
 
+bool Mir2xMapData::View(const uint8_t *pData, size_t nDataLen)
+{
+    m_Data.clear();
+    m_View = nullptr;
+
+    if(true
+            && pData
+            && nDataLen >= 4){
+
+        std::memcpy(&m_W, pData, 2);
+        std::memcpy(&m_H, pData + 2, 2);
+
+        if(true
+                && (m_W / 2 > 0) && !(m_W % 2)
+                && (m_H / 2 > 0) && !(m_H % 2)){
+
+            // BLOCK is packed, no alignment requirement
+            // only the size needs to be checked
+            auto nBlockSize = (size_t)(m_W / 2) * (size_t)(m_H / 2);
+            if((sizeof(BLOCK) * nBlockSize) + 4 == nDataLen){
+                m_View = (const BLOCK *)(pData + 4);
+                return true;
+            }
+        }
+    }
+
+    m_W = 0;
+    m_H = 0;
+    return false;
+}
+
 bool Mir2xMapData::Save(const char *szFullName)
 {
     if(Valid()){
@@ -112,7 +144,8 @@ bool Mir2xMapData::Save(const char *szFullName)
 bool Mir2xMapData::Allocate(uint16_t nW, uint16_t nH)
 {
     if(nW % 2 || nH % 2){ return false; }
-    if(nW * nH){
+    if(nW && nH){
+        m_View = nullptr;
         m_W = nW;
         m_H = nH;
 
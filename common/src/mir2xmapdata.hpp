@@ -3,7 +3,7 @@
  *
  *       Filename: mir2xmapdata.hpp
  *        Created: 08/31/2015 18:26:57
- *  Last Modified: 09/10/2017 00:53:54
+ *  Last Modified: 12/06/2017 23:07:51
  *
  *    Description: class to record data for mir2x map
  *                 this class won't define operation over the data
@@ -11,6 +11,9 @@
  *                 previously I was using grid compression
  *                 but I decide to disable it since I found I can use zip to compress
  *
+ *                 View() makes a read-only map over external buffer without copy, used
+ *                 for mmap-ed map pack, copy of a view is still a view of the same buffer
+ *
  *        Version: 1.0
  *       Revision: none
  *       Compiler: gcc
@@ -200,11 +203,17 @@ class Mir2xMapData final
     private:
         std::vector<BLOCK> m_Data;
 
+    private:
+        // not owned, read-only
+        // if not null m_Data is empty
+        const BLOCK *m_View;
+
     public:
         Mir2xMapData()
             : m_W(0)
             , m_H(0)
             , m_Data()
+            , m_View(nullptr)
         {}
 
         Mir2xMapData(const char *pName)
@@ -213,15 +222,26 @@ class Mir2xMapData final
             condcheck(Load(pName));
         }
 
+    private:
+        const BLOCK *BlockData() const
+        {
+            return m_View ? m_View : m_Data.data();
+        }
+
     public:
         const uint8_t *Data() const
         {
-            return (uint8_t *)(&m_Data[0]);
+            return (const uint8_t *)(BlockData());
         }
 
         size_t DataLen() const
         {
-            return m_Data.size() * sizeof(m_Data[0]);
+            return Valid() ? ((size_t)(m_W / 2) * (size_t)(m_H / 2) * sizeof(BLOCK)) : 0;
+        }
+
+        bool IsView() const
+        {
+            return m_View != nullptr;
         }
 
     public:
@@ -234,6 +254,7 @@ class Mir2xMapData final
     public:
         auto &Block(int nX, int nY)
         {
+            condcheck(!m_View);
             return m_Data[nX / 2 + (nY / 2) * (m_W / 2)];
         }
 
@@ -250,7 +271,7 @@ class Mir2xMapData final
     public:
         const auto &Block(int nX, int nY) const
         {
-            return m_Data[nX / 2 + (nY / 2) * (m_W / 2)];
+            return BlockData()[nX / 2 + (nY / 2) * (m_W / 2)];
         }
 
         const auto &Tile(int nX, int nY) const
@@ -267,13 +288,18 @@ class Mir2xMapData final
         bool Load(const char *);
         bool Load(const uint8_t *, size_t);
 
+    public:
+        // same format as Load(const uint8_t *, size_t)
+        // buffer should outlive this map and all its copies
+        bool View(const uint8_t *, size_t);
+
     public:
         bool Save(const char *);
 
     public:
         bool Valid() const
         {
-            return !m_Data.empty();
+            return m_View || !m_Data.empty();
         }
 
         bool ValidC(int nX, int nY) const
@@ -0,0 +1,520 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: navgraph.cpp
+ *        Created: 12/09/2017 10:31:06
+ *  Last Modified: 12/09/2017 23:35:42
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <queue>
+#include <limits>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include "navgraph.hpp"
+
+// entrance no shorter than it gets two portal pairs
+// at both ends, otherwise one pair at the middle
+#define NAVGRAPH_LONGENTRANCE 6
+
+namespace
+{
+    const float g_NavInf = std::numeric_limits<float>::max();
+
+    // costs from (nX, nY) to all grids of the rectangle, moving inside it only
+    // same single hops as JPSPathFinder, grids out of reach get g_NavInf
+    void LocalCost(const BitGrid &rstGround, int nRectX, int nRectY, int nRectW, int nRectH, int nX, int nY, std::vector<float> *pCostV)
+    {
+        static const int nDX[] = { 0, +1, +1, +1,  0, -1, -1, -1};
+        static const int nDY[] = {-1, -1,  0, +1, +1, +1,  0, -1};
+
+        using LocalNode = std::pair<float, int>;
+        std::priority_queue<LocalNode, std::vector<LocalNode>, std::greater<LocalNode>> stQ;
+
+        pCostV->assign((size_t)(nRectW) * (size_t)(nRectH), g_NavInf);
+        (*pCostV)[(nY - nRectY) * nRectW + (nX - nRectX)] = 0.00f;
+        stQ.emplace(0.00f, (nY - nRectY) * nRectW + (nX - nRectX));
+
+        while(!stQ.empty()){
+            auto stNode = stQ.top();
+            stQ.pop();
+
+            if(stNode.first > (*pCostV)[stNode.second]){
+                continue;
+            }
+
+            int nCurrX = stNode.second % nRectW;
+            int nCurrY = stNode.second / nRectW;
+
+            for(int nDir = 0; nDir < 8; ++nDir){
+                int nNextX = nCurrX + nDX[nDir];
+                int nNextY = nCurrY + nDY[nDir];
+
+                if(false
+                        || nNextX < 0 || nNextX >= nRectW
+                        || nNextY < 0 || nNextY >= nRectH
+                        || !rstGround.Get(nRectX + nNextX, nRectY + nNextY)){
+                    continue;
+                }
+
+                auto fCost = stNode.first + ((nDX[nDir] && nDY[nDir]) ? 1.11f : 1.01f);
+                auto &rstCost = (*pCostV)[nNextY * nRectW + nNextX];
+                if(fCost < rstCost){
+                    rstCost = fCost;
+                    stQ.emplace(fCost, nNextY * nRectW + nNextX);
+                }
+            }
+        }
+    }
+
+    struct NavSearchNode
+    {
+        uint32_t Stamp;
+        int32_t  Parent;
+        float    G;
+        bool     Closed;
+    };
+
+    struct NavOpenNode
+    {
+        float   F;
+        float   G;
+        int32_t Node;
+
+        bool operator < (const NavOpenNode &rstOther) const
+        {
+            return F > rstOther.F;
+        }
+    };
+
+    // grow only, one per worker thread
+    // same as node records of JPSPathFinder
+    thread_local uint32_t                   t_NavStamp = 0;
+    thread_local std::vector<NavSearchNode> t_NavNodeV;
+    thread_local std::vector<NavOpenNode>   t_NavOpenV;
+    thread_local std::vector<float>         t_StartCostV;
+    thread_local std::vector<float>         t_GoalCostV;
+}
+
+void NavGraph::Clear()
+{
+    m_Buf.clear();
+    m_Data        = nullptr;
+    m_DataLen     = 0;
+    m_Header      = nullptr;
+    m_ClusterNode = nullptr;
+    m_Node        = nullptr;
+    m_Edge        = nullptr;
+}
+
+bool NavGraph::View(const uint8_t *pData, size_t nDataLen)
+{
+    Clear();
+    if(!(pData && nDataLen >= sizeof(NavGraphHeader))){
+        return false;
+    }
+
+    auto pHeader = (const NavGraphHeader *)(pData);
+    if(false
+            || pHeader->Magic != NAVGRAPH_MAGIC
+            || pHeader->W == 0
+            || pHeader->H == 0
+            || pHeader->Cluster < 2){
+        return false;
+    }
+
+    auto nClusterCount = (size_t)((pHeader->W + pHeader->Cluster - 1) / pHeader->Cluster) * (size_t)((pHeader->H + pHeader->Cluster - 1) / pHeader->Cluster);
+    auto nNodeCount    = (size_t)(pHeader->NodeCount);
+    auto nEdgeCount    = (size_t)(pHeader->EdgeCount);
+
+    auto nClusterOff = sizeof(NavGraphHeader);
+    auto nNodeOff    = nClusterOff + (nClusterCount + 1) * sizeof(uint32_t);
+    auto nEdgeOff    = nNodeOff    + (nNodeCount    + 1) * sizeof(NavGraphNode);
+
+    if(nEdgeOff + nEdgeCount * sizeof(NavGraphEdge) != nDataLen){
+        return false;
+    }
+
+    // check all indices once here
+    // then Search() never reads out of the buffer
+    auto pClusterNode = (const uint32_t     *)(pData + nClusterOff);
+    auto pNode        = (const NavGraphNode *)(pData + nNodeOff);
+    auto pEdge        = (const NavGraphEdge *)(pData + nEdgeOff);
+
+    if(pClusterNode[0] != 0 || pClusterNode[nClusterCount] != nNodeCount){
+        return false;
+    }
+
+    for(size_t nIndex = 0; nIndex < nClusterCount; ++nIndex){
+        if(pClusterNode[nIndex] > pClusterNode[nIndex + 1]){
+            return false;
+        }
+    }
+
+    if(pNode[0].Edge != 0 || pNode[nNodeCount].Edge != nEdgeCount){
+        return false;
+    }
+
+    for(size_t nIndex = 0; nIndex < nNodeCount; ++nIndex){
+        if(false
+                || pNode[nIndex].X >= pHeader->W
+                || pNode[nIndex].Y >= pHeader->H
+                || pNode[nIndex].Edge > pNode[nIndex + 1].Edge){
+            return false;
+        }
+    }
+
+    for(size_t nIndex = 0; nIndex < nEdgeCount; ++nIndex){
+        if(pEdge[nIndex].Node >= nNodeCount || !(pEdge[nIndex].Cost >= 0.00f)){
+            return false;
+        }
+    }
+
+    m_Data        = pData;
+    m_DataLen     = nDataLen;
+    m_Header      = pHeader;
+    m_ClusterNode = pClusterNode;
+    m_Node        = pNode;
+    m_Edge        = pEdge;
+    return true;
+}
+
+bool NavGraph::Build(const BitGrid &rstGround, int nCluster)
+{
+    Clear();
+
+    auto nW = rstGround.W();
+    auto nH = rstGround.H();
+
+    if(false
+            || nW <= 0 || nW > 0XFFFF
+            || nH <= 0 || nH > 0XFFFF
+            || nCluster < 2 || nCluster > 0XFFFF){
+        return false;
+    }
+
+    auto nClusterW = (nW + nCluster - 1) / nCluster;
+    auto nClusterH = (nH + nCluster - 1) / nCluster;
+    auto fnCluster = [nCluster, nClusterW](int nX, int nY) -> int
+    {
+        return (nY / nCluster) * nClusterW + (nX / nCluster);
+    };
+
+    // 1. portals of each cluster by grid index
+    //    and pairs crossing the borders
+    std::vector<std::vector<int>> stPortalV((size_t)(nClusterW) * (size_t)(nClusterH));
+    std::vector<std::pair<int, int>> stInterV;
+
+    auto fnAddPair = [nW, &fnCluster, &stPortalV, &stInterV](int nX0, int nY0, int nX1, int nY1)
+    {
+        stPortalV[fnCluster(nX0, nY0)].push_back(nY0 * nW + nX0);
+        stPortalV[fnCluster(nX1, nY1)].push_back(nY1 * nW + nX1);
+        stInterV.emplace_back(nY0 * nW + nX0, nY1 * nW + nX1);
+    };
+
+    // scan one border of a cluster, nBorder is the last row / column before the border
+    // runs stop at cluster corners, then each entrance is between two clusters only
+    auto fnScanBorder = [&rstGround, &fnAddPair](bool bVertical, int nBorder, int nBegin, int nEnd)
+    {
+        int nRunBegin = -1;
+        for(int nPos = nBegin; nPos <= nEnd; ++nPos){
+            bool bOpen = false;
+            if(nPos < nEnd){
+                bOpen = bVertical
+                    ? (rstGround.Get(nBorder, nPos) && rstGround.Get(nBorder + 1, nPos))
+                    : (rstGround.Get(nPos, nBorder) && rstGround.Get(nPos, nBorder + 1));
+            }
+
+            if(bOpen && nRunBegin < 0){
+                nRunBegin = nPos;
+            }else if(!bOpen && nRunBegin >= 0){
+                std::vector<int> stPosV;
+                if(nPos - nRunBegin < NAVGRAPH_LONGENTRANCE){
+                    stPosV.push_back((nRunBegin + nPos - 1) / 2);
+                }else{
+                    stPosV.push_back(nRunBegin);
+                    stPosV.push_back(nPos - 1);
+                }
+
+                for(auto nPortalPos: stPosV){
+                    if(bVertical){
+                        fnAddPair(nBorder, nPortalPos, nBorder + 1, nPortalPos);
+                    }else{
+                        fnAddPair(nPortalPos, nBorder, nPortalPos, nBorder + 1);
+                    }
+                }
+                nRunBegin = -1;
+            }
+        }
+    };
+
+    for(int nX = nCluster - 1; nX + 1 < nW; nX += nCluster){
+        for(int nY = 0; nY < nH; nY += nCluster){
+            fnScanBorder(true, nX, nY, std::min<int>(nY + nCluster, nH));
+        }
+    }
+
+    for(int nY = nCluster - 1; nY + 1 < nH; nY += nCluster){
+        for(int nX = 0; nX < nW; nX += nCluster){
+            fnScanBorder(false, nY, nX, std::min<int>(nX + nCluster, nW));
+        }
+    }
+
+    // 2. node index sorted by cluster
+    //    one grid could be portal of two entrances, keep one node
+    std::vector<uint32_t> stClusterNodeV;
+    std::vector<int> stNodeGridV;
+    std::unordered_map<int, uint32_t> stGridNode;
+
+    for(auto &rstPortalList: stPortalV){
+        std::sort(rstPortalList.begin(), rstPortalList.end());
+        rstPortalList.erase(std::unique(rstPortalList.begin(), rstPortalList.end()), rstPortalList.end());
+
+        stClusterNodeV.push_back((uint32_t)(stNodeGridV.size()));
+        for(auto nGrid: rstPortalList){
+            stGridNode[nGrid] = (uint32_t)(stNodeGridV.size());
+            stNodeGridV.push_back(nGrid);
+        }
+    }
+    stClusterNodeV.push_back((uint32_t)(stNodeGridV.size()));
+
+    // 3. edges
+    //    portal pair is always a straight single hop
+    std::vector<std::vector<NavGraphEdge>> stEdgeV(stNodeGridV.size());
+    for(auto &rstInter: stInterV){
+        auto nNode0 = stGridNode[rstInter.first ];
+        auto nNode1 = stGridNode[rstInter.second];
+
+        stEdgeV[nNode0].push_back({nNode1, 1.01f});
+        stEdgeV[nNode1].push_back({nNode0, 1.01f});
+    }
+
+    std::vector<float> stCostV;
+    for(int nClusterIndex = 0; nClusterIndex < nClusterW * nClusterH; ++nClusterIndex){
+        auto nRectX = (nClusterIndex % nClusterW) * nCluster;
+        auto nRectY = (nClusterIndex / nClusterW) * nCluster;
+        auto nRectW = std::min<int>(nCluster, nW - nRectX);
+        auto nRectH = std::min<int>(nCluster, nH - nRectY);
+
+        for(auto nNode0 = stClusterNodeV[nClusterIndex]; nNode0 < stClusterNodeV[nClusterIndex + 1]; ++nNode0){
+            LocalCost(rstGround, nRectX, nRectY, nRectW, nRectH, stNodeGridV[nNode0] % nW, stNodeGridV[nNode0] / nW, &stCostV);
+            for(auto nNode1 = stClusterNodeV[nClusterIndex]; nNode1 < stClusterNodeV[nClusterIndex + 1]; ++nNode1){
+                auto nX1 = stNodeGridV[nNode1] % nW;
+                auto nY1 = stNodeGridV[nNode1] / nW;
+                auto fCost = stCostV[(nY1 - nRectY) * nRectW + (nX1 - nRectX)];
+
+                if(nNode1 != nNode0 && fCost < g_NavInf){
+                    stEdgeV[nNode0].push_back({nNode1, fCost});
+                }
+            }
+        }
+    }
+
+    // 4. flatten
+    NavGraphHeader stHeader;
+    stHeader.Magic     = NAVGRAPH_MAGIC;
+    stHeader.W         = (uint16_t)(nW);
+    stHeader.H         = (uint16_t)(nH);
+    stHeader.Cluster   = (uint16_t)(nCluster);
+    stHeader.Reserved  = 0;
+    stHeader.NodeCount = (uint32_t)(stNodeGridV.size());
+    stHeader.EdgeCount = 0;
+
+    std::vector<NavGraphNode> stNodeV;
+    for(size_t nNode = 0; nNode < stNodeGridV.size(); ++nNode){
+        stNodeV.push_back({(uint16_t)(stNodeGridV[nNode] % nW), (uint16_t)(stNodeGridV[nNode] / nW), stHeader.EdgeCount});
+        stHeader.EdgeCount += (uint32_t)(stEdgeV[nNode].size());
+    }
+    stNodeV.push_back({0, 0, stHeader.EdgeCount});
+
+    m_Buf.resize(sizeof(stHeader) + stClusterNodeV.size() * sizeof(uint32_t) + stNodeV.size() * sizeof(NavGraphNode) + stHeader.EdgeCount * sizeof(NavGraphEdge));
+
+    auto pDst = m_Buf.data();
+    std::memcpy(pDst, &stHeader, sizeof(stHeader));
+    pDst += sizeof(stHeader);
+
+    std::memcpy(pDst, stClusterNodeV.data(), stClusterNodeV.size() * sizeof(uint32_t));
+    pDst += stClusterNodeV.size() * sizeof(uint32_t);
+
+    std::memcpy(pDst, stNodeV.data(), stNodeV.size() * sizeof(NavGraphNode));
+    pDst += stNodeV.size() * sizeof(NavGraphNode);
+
+    for(auto &rstEdgeList: stEdgeV){
+        if(!rstEdgeList.empty()){
+            std::memcpy(pDst, rstEdgeList.data(), rstEdgeList.size() * sizeof(NavGraphEdge));
+            pDst += rstEdgeList.size() * sizeof(NavGraphEdge);
+        }
+    }
+
+    // parse the buffer as a view
+    // View() calls Clear(), keep the buffer
+    std::vector<uint8_t> stBuf;
+    stBuf.swap(m_Buf);
+
+    if(!View(stBuf.data(), stBuf.size())){
+        return false;
+    }
+
+    m_Buf.swap(stBuf);
+    return true;
+}
+
+bool NavGraph::Search(const BitGrid &rstGround, int nX0, int nY0, int nX1, int nY1, std::vector<PathFind::PathNode> *pWaypointV) const
+{
+    if(!(true
+                && Valid()
+                && pWaypointV
+                && rstGround.W() == W()
+                && rstGround.H() == H()
+                && rstGround.ValidC(nX0, nY0)
+                && rstGround.ValidC(nX1, nY1)
+                && rstGround.Get(nX1, nY1))){
+        return false;
+    }
+
+    pWaypointV->clear();
+
+    auto nCluster  = (int)(m_Header->Cluster);
+    auto fnRect = [this, nCluster](int nClusterIndex, int *pX, int *pY, int *pW, int *pH)
+    {
+        *pX = (nClusterIndex % ClusterW()) * nCluster;
+        *pY = (nClusterIndex / ClusterW()) * nCluster;
+        *pW = std::min<int>(nCluster, W() - *pX);
+        *pH = std::min<int>(nCluster, H() - *pY);
+    };
+
+    // link start and goal to portals of their clusters
+    // only grids of these two clusters are visited
+    int nRectX0, nRectY0, nRectW0, nRectH0;
+    int nRectX1, nRectY1, nRectW1, nRectH1;
+
+    auto nCluster0 = ClusterIndex(nX0, nY0);
+    auto nCluster1 = ClusterIndex(nX1, nY1);
+
+    fnRect(nCluster0, &nRectX0, &nRectY0, &nRectW0, &nRectH0);
+    fnRect(nCluster1, &nRectX1, &nRectY1, &nRectW1, &nRectH1);
+
+    LocalCost(rstGround, nRectX0, nRectY0, nRectW0, nRectH0, nX0, nY0, &t_StartCostV);
+    LocalCost(rstGround, nRectX1, nRectY1, nRectW1, nRectH1, nX1, nY1, &t_GoalCostV);
+
+    if(true
+            && nCluster0 == nCluster1
+            && t_StartCostV[(nY1 - nRectY0) * nRectW0 + (nX1 - nRectX0)] < g_NavInf){
+        pWaypointV->emplace_back(nX0, nY0);
+        pWaypointV->emplace_back(nX1, nY1);
+        return true;
+    }
+
+    // portals are [0, NodeCount)
+    // NodeCount is the goal
+    auto nGoalNode = (int32_t)(NodeCount());
+    if(t_NavNodeV.size() < NodeCount() + 1){
+        t_NavNodeV.resize(NodeCount() + 1, NavSearchNode{0, -1, 0.00f, false});
+    }
+
+    if(++t_NavStamp == 0){
+        for(auto &rstNode: t_NavNodeV){
+            rstNode.Stamp = 0;
+        }
+        t_NavStamp = 1;
+    }
+    t_NavOpenV.clear();
+
+    auto fnNode = [](int32_t nNode) -> NavSearchNode &
+    {
+        auto &rstNode = t_NavNodeV[nNode];
+        if(rstNode.Stamp != t_NavStamp){
+            rstNode.Stamp  = t_NavStamp;
+            rstNode.Parent = -1;
+            rstNode.G      = g_NavInf;
+            rstNode.Closed = false;
+        }
+        return rstNode;
+    };
+
+    auto fnRelax = [this, nGoalNode, nX1, nY1, &fnNode](int32_t nNode, int32_t nParent, float fG)
+    {
+        auto &rstNode = fnNode(nNode);
+        if(rstNode.Closed || fG >= rstNode.G){
+            return;
+        }
+
+        rstNode.G      = fG;
+        rstNode.Parent = nParent;
+
+        float fH = 0.00f;
+        if(nNode != nGoalNode){
+            fH = 1.01f * std::max<int>(std::abs(m_Node[nNode].X - nX1), std::abs(m_Node[nNode].Y - nY1));
+        }
+
+        t_NavOpenV.push_back({fG + fH, fG, nNode});
+        std::push_heap(t_NavOpenV.begin(), t_NavOpenV.end());
+    };
+
+    for(auto nNode = m_ClusterNode[nCluster0]; nNode < m_ClusterNode[nCluster0 + 1]; ++nNode){
+        auto fCost = t_StartCostV[(m_Node[nNode].Y - nRectY0) * nRectW0 + (m_Node[nNode].X - nRectX0)];
+        if(fCost < g_NavInf){
+            fnRelax((int32_t)(nNode), -1, fCost);
+        }
+    }
+
+    while(!t_NavOpenV.empty()){
+        std::pop_heap(t_NavOpenV.begin(), t_NavOpenV.end());
+        auto stOpenNode = t_NavOpenV.back();
+        t_NavOpenV.pop_back();
+
+        auto &rstNode = fnNode(stOpenNode.Node);
+        if(rstNode.Closed || stOpenNode.G > rstNode.G){
+            continue;
+        }
+        rstNode.Closed = true;
+
+        if(stOpenNode.Node == nGoalNode){
+            break;
+        }
+
+        auto nNode = (uint32_t)(stOpenNode.Node);
+        if(nNode >= m_ClusterNode[nCluster1] && nNode < m_ClusterNode[nCluster1 + 1]){
+            auto fCost = t_GoalCostV[(m_Node[nNode].Y - nRectY1) * nRectW1 + (m_Node[nNode].X - nRectX1)];
+            if(fCost < g_NavInf){
+                fnRelax(nGoalNode, stOpenNode.Node, rstNode.G + fCost);
+            }
+        }
+
+        for(auto nEdge = m_Node[nNode].Edge; nEdge < m_Node[nNode + 1].Edge; ++nEdge){
+            fnRelax((int32_t)(m_Edge[nEdge].Node), stOpenNode.Node, rstNode.G + m_Edge[nEdge].Cost);
+        }
+    }
+
+    if(!fnNode(nGoalNode).Closed){
+        return false;
+    }
+
+    pWaypointV->emplace_back(nX1, nY1);
+    for(auto nNode = fnNode(nGoalNode).Parent; nNode >= 0; nNode = fnNode(nNode).Parent){
+        if(m_Node[nNode].X != pWaypointV->back().X || m_Node[nNode].Y != pWaypointV->back().Y){
+            pWaypointV->emplace_back(m_Node[nNode].X, m_Node[nNode].Y);
+        }
+    }
+
+    if(nX0 != pWaypointV->back().X || nY0 != pWaypointV->back().Y){
+        pWaypointV->emplace_back(nX0, nY0);
+    }
+
+    std::reverse(pWaypointV->begin(), pWaypointV->end());
+    return true;
+}
@@ -0,0 +1,175 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: navgraph.hpp
+ *        Created: 12/09/2017 09:47:30
+ *  Last Modified: 12/09/2017 23:35:42
+ *
+ *    Description: hierarchical navigation graph (HPA*) of one map
+ *
+ *                 map is cut into clusters of NAVGRAPH_CLUSTER x NAVGRAPH_CLUSTER grids,
+ *                 walkable runs on two sides of a cluster border are entrances, each
+ *                 entrance gives one pair of portal nodes at the middle, or two pairs at
+ *                 both ends if it's long, nodes are connected by
+ *
+ *                      1. inter edge : two portals of one pair, crossing the border
+ *                      2. intra edge : two portals of one cluster, cost by searching
+ *                                      inside the cluster only
+ *
+ *                 Search() links start / goal to portals of their clusters, runs A* on
+ *                 the graph and gives waypoints, only grids in two clusters are touched,
+ *                 caller refines the route between waypoints on demand
+ *
+ *                 abstract costs use single hops 1.01 / 1.11 as JPSPathFinder, turn cost
+ *                 is not counted, crossing a border only by a diagonal hop is not an
+ *                 entrance, then Search() may fail while a path exists, fall back to a
+ *                 grid search in that case
+ *
+ *                 data layout, all integers in little endian, flat arrays only, then the
+ *                 graph can be a view of the map pack like Mir2xMapData:
+ *
+ *                      NavGraphHeader
+ *                      uint32_t     [ClusterCount + 1] : first node of each cluster
+ *                      NavGraphNode [NodeCount    + 1] : nodes sorted by cluster
+ *                      NavGraphEdge [EdgeCount       ] : edges sorted by source node
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "bitgrid.hpp"
+#include "pathfinder.hpp"
+
+#define NAVGRAPH_MAGIC   0X4756414E // "NAVG"
+#define NAVGRAPH_CLUSTER 16
+
+#pragma pack(push, 1)
+struct NavGraphHeader
+{
+    uint32_t Magic;
+    uint16_t W;
+    uint16_t H;
+    uint16_t Cluster;
+    uint16_t Reserved;
+    uint32_t NodeCount;
+    uint32_t EdgeCount;
+};
+
+struct NavGraphNode
+{
+    uint16_t X;
+    uint16_t Y;
+
+    // edges of this node are [Edge, next node's Edge)
+    // the last node is a sentinel
+    uint32_t Edge;
+};
+
+struct NavGraphEdge
+{
+    uint32_t Node;
+    float    Cost;
+};
+#pragma pack(pop)
+
+class NavGraph final
+{
+    private:
+        // built graph owns the data
+        // a view points to external buffer and m_Buf is empty
+        std::vector<uint8_t> m_Buf;
+
+    private:
+        const uint8_t *m_Data;
+        size_t         m_DataLen;
+
+    private:
+        const NavGraphHeader *m_Header;
+        const uint32_t       *m_ClusterNode;
+        const NavGraphNode   *m_Node;
+        const NavGraphEdge   *m_Edge;
+
+    public:
+        NavGraph()
+            : m_Buf()
+            , m_Data(nullptr)
+            , m_DataLen(0)
+            , m_Header(nullptr)
+            , m_ClusterNode(nullptr)
+            , m_Node(nullptr)
+            , m_Edge(nullptr)
+        {}
+
+        // pointers refer to m_Buf
+        // copy needs to rebind them and is never needed
+        NavGraph(const NavGraph &) = delete;
+        NavGraph &operator = (const NavGraph &) = delete;
+
+    public:
+        ~NavGraph() = default;
+
+    public:
+        bool Build(const BitGrid &, int = NAVGRAPH_CLUSTER);
+        bool View(const uint8_t *, size_t);
+
+    public:
+        bool Valid() const
+        {
+            return m_Header != nullptr;
+        }
+
+    public:
+        const uint8_t *Data() const
+        {
+            return m_Data;
+        }
+
+        size_t DataLen() const
+        {
+            return m_DataLen;
+        }
+
+    public:
+        int W() const { return Valid() ? m_Header->W : 0; }
+        int H() const { return Valid() ? m_Header->H : 0; }
+
+        size_t NodeCount() const { return Valid() ? m_Header->NodeCount : 0; }
+        size_t EdgeCount() const { return Valid() ? m_Header->EdgeCount : 0; }
+
+    public:
+        // waypoints from (nX0, nY0) to (nX1, nY1) including both ends
+        // two waypoints in a row are in one cluster, or a portal pair next to each other
+        // rstGround should be the grid the graph was built from
+        bool Search(const BitGrid &, int, int, int, int, std::vector<PathFind::PathNode> *) const;
+
+    private:
+        void Clear();
+
+    private:
+        int ClusterW() const
+        {
+            return (m_Header->W + m_Header->Cluster - 1) / m_Header->Cluster;
+        }
+
+        int ClusterH() const
+        {
+            return (m_Header->H + m_Header->Cluster - 1) / m_Header->Cluster;
+        }
+
+        int ClusterIndex(int nX, int nY) const
+        {
+            return (nY / m_Header->Cluster) * ClusterW() + (nX / m_Header->Cluster);
+        }
+};
@@ -3,7 +3,7 @@
  *
  *       Filename: pathfinder.cpp
  *        Created: 03/29/2017 00:59:29
- *  Last Modified: 09/26/2017 11:20:40
+ *  Last Modified: 12/04/2017 21:36:15
  *
  *    Description: 
  *
@@ -30,7 +30,32 @@ bool AStarPathFinder::Search(int nX0, int nY0, int nX1, int nY1)
     do{
         nSearchState = SearchStep();
     }while(nSearchState == AStarSearch<AStarPathFinderNode>::SEARCH_STATE_SEARCHING);
-    return nSearchState == AStarSearch<AStarPathFinderNode>::SEARCH_STATE_SUCCEEDED;
+    m_Solved = (nSearchState == AStarSearch<AStarPathFinderNode>::SEARCH_STATE_SUCCEEDED);
+    return m_Solved;
+}
+
+bool AStarPathFinder::Search(int nX0, int nY0, int nX1, int nY1, const std::function<bool()> &fnAbort)
+{
+    if(!fnAbort){
+        return Search(nX0, nY0, nX1, nY1);
+    }
+
+    AStarPathFinderNode stNode0 {nX0, nY0, -1, this};
+    AStarPathFinderNode stNode1 {nX1, nY1, -1, this};
+    SetStartAndGoalStates(stNode0, stNode1);
+
+    size_t nStepCount = 0;
+    unsigned int nSearchState;
+    do{
+        // fnAbort could be expensive
+        // and CancelSearch() takes effect in next SearchStep()
+        if(((++nStepCount % 64) == 0) && fnAbort()){
+            CancelSearch();
+        }
+        nSearchState = SearchStep();
+    }while(nSearchState == AStarSearch<AStarPathFinderNode>::SEARCH_STATE_SEARCHING);
+    m_Solved = (nSearchState == AStarSearch<AStarPathFinderNode>::SEARCH_STATE_SUCCEEDED);
+    return m_Solved;
 }
 
 int PathFind::MaxReachNode(const PathFind::PathNode *pNodeV, size_t nSize, size_t nMaxStepLen)
@@ -62,8 +87,8 @@ int PathFind::MaxReachNode(const PathFind::PathNode *pNodeV, size_t nSize, size_
             case 2  : return  1;
             default : {
                           if(nMaxStepLen < nSize){
-                              int nDX = std::abs<int>(pNodeV[nMaxStepLen].X - pNodeV[0].X);
-                              int nDY = std::abs<int>(pNodeV[nMaxStepLen].Y - pNodeV[0].Y);
+                              int nDX = std::abs(pNodeV[nMaxStepLen].X - pNodeV[0].X);
+                              int nDY = std::abs(pNodeV[nMaxStepLen].Y - pNodeV[0].Y);
                               if(true
                                       && (std::max<size_t>(nDX, nDY) == nMaxStepLen)
                                       && (std::min<size_t>(nDX, nDY) == 0 || nDX == nDY)){
@@ -3,7 +3,7 @@
  *
  *       Filename: pathfinder.hpp
  *        Created: 03/28/2017 17:04:54
- *  Last Modified: 09/26/2017 11:20:07
+ *  Last Modified: 11/26/2017 22:48:05
  *
  *    Description: A-Star algorithm for path finding
  *
@@ -120,6 +120,11 @@ class AStarPathFinder: public AStarSearch<AStarPathFinderNode>
     private:
         int m_MaxStep;
 
+    private:
+        // solution nodes are only there if search succeeded
+        // a failed or cancelled search has freed all nodes already
+        bool m_Solved;
+
     public:
         friend class AStarPathFinderNode;
 
@@ -132,6 +137,7 @@ class AStarPathFinder: public AStarSearch<AStarPathFinderNode>
             , m_MoveChecker(fnMoveChecker)
             , m_MoveCost(fnMoveCost)
             , m_MaxStep(nMaxStepSize)
+            , m_Solved(false)
         {
             condcheck(m_MoveChecker);
             condcheck(m_MoveCost);
@@ -144,7 +150,9 @@ class AStarPathFinder: public AStarSearch<AStarPathFinderNode>
     public:
         ~AStarPathFinder()
         {
-            FreeSolutionNodes();
+            if(m_Solved){
+                FreeSolutionNodes();
+            }
             EnsureMemoryFreed();
         }
 
@@ -156,6 +164,11 @@ class AStarPathFinder: public AStarSearch<AStarPathFinderNode>
 
     public:
         bool Search(int, int, int, int);
+
+    public:
+        // fnAbort is checked every several steps
+        // search fails immediately if it returns true
+        bool Search(int, int, int, int, const std::function<bool()> &);
 };
 
 class AStarPathFinderNode
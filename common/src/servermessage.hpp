@@ -3,7 +3,7 @@
  *
  *       Filename: servermessage.hpp
  *        Created: 01/24/2016 19:30:45
- *  Last Modified: 10/31/2017 14:22:27
+ *  Last Modified: 12/15/2017 21:52:40
  *
  *    Description: net message used by client and mono-server
  *
@@ -39,7 +39,9 @@ enum: uint8_t
     SM_SPACEMOVE,
     SM_OFFLINE,
     SM_REMOVEGROUNDITEM,
-    SM_PICKUPOK
+    SM_PICKUPOK,
+    SM_ACTIONDELTA,
+    SM_FRAME,
 };
 
 #pragma pack(push, 1)
@@ -85,6 +87,42 @@ struct SMAction
     uint32_t AimUID;
 };
 
+// SMAction against the last one sent for the same UID on the connection
+// only sent if client asks by CM_ACTIONDELTA, unchanged field is zero and costs one mask bit after compression
+//
+// byte fields are xor-ed, coordinates are zigzag of the signed difference
+// AimX / AimY are relative to X / Y, then keeping walking straight costs nothing
+//
+// MapID and AimUID are not in it, changing them or any difference out of range sends full SMAction
+// see actiondelta.hpp
+struct SMActionDelta
+{
+    uint32_t UID;
+
+    uint8_t Action;
+    uint8_t ActionParam;
+    uint8_t Speed;
+    uint8_t Direction;
+
+    uint8_t X;
+    uint8_t Y;
+    uint8_t AimX;
+    uint8_t AimY;
+};
+
+// SM_FRAME is not a struct, it's a mode-3 body packing all messages of one send batch
+// only sent if client asks by CM_FRAME, never nested
+//
+//      [0][HC, Data][HC, Data]...              : messages as they are on wire without frame
+//      [1][OrigLen][Mask][Data]                : zero-mask compression of the mode 0 payload
+//
+// OrigLen is uint32_t, compressed only if it makes the frame smaller
+enum: uint8_t
+{
+    FRAMEMODE_RAW      = 0,
+    FRAMEMODE_COMPRESS = 1,
+};
+
 union SMCORecord
 {
     uint8_t Type;
@@ -230,6 +268,8 @@ class SMSGParam: public MessageBase
                 {SM_OFFLINE,          {1, sizeof(SMOffline),               "SM_OFFLINE"         }},
                 {SM_PICKUPOK,         {1, sizeof(SMPickUpOK),              "SM_PICKUPOK"        }},
                 {SM_REMOVEGROUNDITEM, {1, sizeof(SMRemoveGroundItem),      "SM_REMOVEGROUNDITEM"}},
+                {SM_ACTIONDELTA,      {1, sizeof(SMActionDelta),           "SM_ACTIONDELTA"     }},
+                {SM_FRAME,            {3, 0,                               "SM_FRAME"           }},
             };
 
             return s_AttributeTable.at((s_AttributeTable.find(nHC) == s_AttributeTable.end()) ? (uint8_t)(SM_NONE) : nHC);
@@ -0,0 +1,409 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: timerwheel.hpp
+ *        Created: 11/27/2017 09:21:46
+ *  Last Modified: 12/17/2017 22:16:40
+ *
+ *    Description: hierarchical hashed timer wheel
+ *
+ *                 five levels for the whole 32-bit tick range
+ *
+ *                      level 0 : 256 slots, one tick per slot
+ *                      level 1 :  64 slots, 2^8  ticks per slot
+ *                      level 2 :  64 slots, 2^14 ticks per slot
+ *                      level 3 :  64 slots, 2^20 ticks per slot
+ *                      level 4 :  64 slots, 2^26 ticks per slot
+ *
+ *                 a timer goes to the level its distance fits in, when level 0 wraps
+ *                 the slot of next level is cascaded down, Add() and Remove() are O(1)
+ *
+ *                 timers are in a node vector linked by index, timer ID is the node
+ *                 index with a generation count, then a stale ID never removes others
+ *
+ *                 not thread-safe, expired timers are moved out by Expire() and caller
+ *                 runs them, then timer functions can add / remove timers freely
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <functional>
+
+class TimerWheel final
+{
+    public:
+        using TimerFunc = std::function<void()>;
+
+    private:
+        // level 0 uses 8 bits, others use 6 bits
+        // 8 + 6 * 4 == 32
+        static constexpr int    LEVEL_COUNT = 5;
+        static constexpr int    SLOT_COUNT  = 256 + 64 * 4;
+        static constexpr int    SLOT_DUE    = SLOT_COUNT;
+        static constexpr size_t INDEX_BITS  = 20;
+        static constexpr size_t INDEX_MASK  = (1 << INDEX_BITS) - 1;
+
+    private:
+        struct TimerNode
+        {
+            uint32_t Expire;
+            uint32_t Gen;
+
+            // -1 for free node
+            int Slot;
+            int Prev;
+            int Next;
+
+            TimerFunc Func;
+
+            TimerNode()
+                : Expire(0)
+                , Gen(0)
+                , Slot(-1)
+                , Prev(-1)
+                , Next(-1)
+                , Func()
+            {}
+        };
+
+    private:
+        // next tick to process
+        uint32_t m_CurrTick;
+
+    private:
+        std::vector<TimerNode> m_NodeV;
+        int m_FreeHead;
+
+    private:
+        // one more slot for timers added after their expire tick
+        std::array<int,    SLOT_COUNT + 1> m_SlotHeadV;
+        std::array<size_t, LEVEL_COUNT   > m_LevelCountV;
+
+    public:
+        TimerWheel(uint32_t nCurrTick = 0)
+            : m_CurrTick(nCurrTick)
+            , m_NodeV()
+            , m_FreeHead(-1)
+            , m_SlotHeadV()
+            , m_LevelCountV()
+        {
+            m_SlotHeadV.fill(-1);
+            m_LevelCountV.fill(0);
+        }
+
+    public:
+        size_t Count() const
+        {
+            size_t nCount = 0;
+            for(auto nLevelCount: m_LevelCountV){
+                nCount += nLevelCount;
+            }
+            return nCount;
+        }
+
+        bool Empty() const
+        {
+            return Count() == 0;
+        }
+
+        uint32_t CurrTick() const
+        {
+            return m_CurrTick;
+        }
+
+        // move the wheel to nTick, only when it's empty
+        // timers are linked by distance to m_CurrTick, a stale one puts them to wrong slots
+        bool SetCurrTick(uint32_t nTick)
+        {
+            if(Empty()){
+                m_CurrTick = nTick;
+                return true;
+            }
+            return false;
+        }
+
+    public:
+        // timer expired already fires in next Expire()
+        // return 0 if there is no free ID
+        uint32_t Add(uint32_t nExpire, TimerFunc fnTimer)
+        {
+            int nIndex = m_FreeHead;
+            if(nIndex >= 0){
+                m_FreeHead = m_NodeV[nIndex].Next;
+            }else{
+                if(m_NodeV.size() >= INDEX_MASK){
+                    return 0;
+                }
+                nIndex = (int)(m_NodeV.size());
+                m_NodeV.emplace_back();
+            }
+
+            auto &rstNode  = m_NodeV[nIndex];
+            rstNode.Expire = nExpire;
+            rstNode.Gen    = (rstNode.Gen + 1) & (uint32_t)(0XFFFFFFFF >> INDEX_BITS);
+            rstNode.Func   = std::move(fnTimer);
+
+            Link(nIndex);
+            return (rstNode.Gen << INDEX_BITS) | (uint32_t)(nIndex + 1);
+        }
+
+        bool Remove(uint32_t nID)
+        {
+            auto nIndex = NodeIndex(nID);
+            if(nIndex >= 0){
+                Unlink(nIndex);
+                Free(nIndex);
+                return true;
+            }
+            return false;
+        }
+
+    public:
+        // move out all timers expired at or before nTick, in order of expire tick
+        // return number of timers expired
+        size_t Expire(uint32_t nTick, std::vector<TimerFunc> &rstTimerV)
+        {
+            size_t nExpired = 0;
+            while(m_SlotHeadV[SLOT_DUE] >= 0){
+                auto nIndex = m_SlotHeadV[SLOT_DUE];
+                Unlink(nIndex);
+
+                rstTimerV.push_back(std::move(m_NodeV[nIndex].Func));
+                Free(nIndex);
+                nExpired++;
+            }
+
+            while((int32_t)(nTick - m_CurrTick) >= 0){
+                // no timer in level 0
+                // jump to next cascade point of the lowest non-empty level
+                if(!m_LevelCountV[0]){
+                    int nLevel = 1;
+                    while(nLevel < LEVEL_COUNT && !m_LevelCountV[nLevel]){
+                        nLevel++;
+                    }
+
+                    if(nLevel == LEVEL_COUNT){
+                        m_CurrTick = nTick + 1;
+                        break;
+                    }
+
+                    // boundary is where all lower bits of m_CurrTick are zero
+                    auto nMask = (uint32_t)((1 << LevelShift(nLevel)) - 1);
+                    auto nNext = (m_CurrTick | nMask) + 1;
+                    if(m_CurrTick & nMask){
+                        if((int32_t)(nTick - nNext) < 0){
+                            m_CurrTick = nTick + 1;
+                            break;
+                        }
+                        m_CurrTick = nNext;
+                    }
+                }
+
+                if(!(m_CurrTick & 0XFF)){
+                    for(int nLevel = 1; nLevel < LEVEL_COUNT; ++nLevel){
+                        Cascade(nLevel, (m_CurrTick >> LevelShift(nLevel)) & 0X3F);
+                        if((m_CurrTick >> LevelShift(nLevel)) & 0X3F){
+                            break;
+                        }
+                    }
+                }
+
+                auto &rstHead = m_SlotHeadV[m_CurrTick & 0XFF];
+                while(rstHead >= 0){
+                    auto nIndex = rstHead;
+                    Unlink(nIndex);
+
+                    rstTimerV.push_back(std::move(m_NodeV[nIndex].Func));
+                    Free(nIndex);
+                    nExpired++;
+                }
+                m_CurrTick++;
+            }
+            return nExpired;
+        }
+
+    public:
+        // earliest tick Expire() needs to be called to make progress
+        // exact for timers in level 0, otherwise it's the cascade point of the first non-empty slot
+        // return false if there is no timer
+        bool NextTick(uint32_t *pTick) const
+        {
+            if(m_SlotHeadV[SLOT_DUE] >= 0){
+                if(pTick){ *pTick = m_CurrTick - 1; }
+                return true;
+            }
+
+            if(Empty()){
+                return false;
+            }
+
+            // cascade at m_CurrTick is not done yet
+            if(!(m_CurrTick & 0XFF)){
+                if(pTick){ *pTick = m_CurrTick; }
+                return true;
+            }
+
+            if(m_LevelCountV[0]){
+                for(uint32_t nTick = m_CurrTick; nTick != m_CurrTick + 256; ++nTick){
+                    if(!(nTick & 0XFF)){
+                        // cascade may bring timers to level 0
+                        break;
+                    }
+
+                    if(m_SlotHeadV[nTick & 0XFF] >= 0){
+                        if(pTick){ *pTick = nTick; }
+                        return true;
+                    }
+                }
+                if(pTick){ *pTick = (m_CurrTick | 0XFF) + 1; }
+                return true;
+            }
+
+            // cascade point of the first non-empty slot, not every boundary of the level
+            // check all levels, timer linked earlier can be in higher level but cascade first
+            bool     bFound   = false;
+            uint32_t nMinDiff = 0;
+
+            for(int nLevel = 1; nLevel < LEVEL_COUNT; ++nLevel){
+                if(m_LevelCountV[nLevel]){
+                    auto nShift = LevelShift(nLevel);
+                    auto nMask  = (uint32_t)((1 << nShift) - 1);
+                    auto nBase  = (m_CurrTick & nMask) ? ((m_CurrTick | nMask) + 1) : m_CurrTick;
+
+                    for(uint32_t nStep = 0; nStep < 64; ++nStep){
+                        auto nTick = nBase + (nStep << nShift);
+                        if(m_SlotHeadV[LevelSlot(nLevel) + (int)((nTick >> nShift) & 0X3F)] >= 0){
+                            if(!bFound || (nTick - m_CurrTick) < nMinDiff){
+                                bFound   = true;
+                                nMinDiff = nTick - m_CurrTick;
+                            }
+                            break;
+                        }
+                    }
+                }
+            }
+
+            if(bFound && pTick){
+                *pTick = m_CurrTick + nMinDiff;
+            }
+            return bFound;
+        }
+
+    private:
+        static int LevelShift(int nLevel)
+        {
+            return nLevel ? (8 + 6 * (nLevel - 1)) : 0;
+        }
+
+        static int LevelSlot(int nLevel)
+        {
+            return nLevel ? (256 + 64 * (nLevel - 1)) : 0;
+        }
+
+        static int SlotLevel(int nSlot)
+        {
+            return (nSlot < 256 || nSlot == SLOT_DUE) ? 0 : (1 + (nSlot - 256) / 64);
+        }
+
+    private:
+        int NodeIndex(uint32_t nID) const
+        {
+            auto nIndex = (int)(nID & INDEX_MASK) - 1;
+            if(true
+                    && nIndex >= 0
+                    && nIndex < (int)(m_NodeV.size())
+                    && m_NodeV[nIndex].Slot >= 0
+                    && m_NodeV[nIndex].Gen == (nID >> INDEX_BITS)){
+                return nIndex;
+            }
+            return -1;
+        }
+
+    private:
+        void Link(int nIndex)
+        {
+            auto &rstNode = m_NodeV[nIndex];
+            auto nDiff = (int32_t)(rstNode.Expire - m_CurrTick);
+
+            int nSlot = 0;
+            if(nDiff < 0){
+                nSlot = SLOT_DUE;
+            }else if(nDiff < 256){
+                nSlot = (int)(rstNode.Expire & 0XFF);
+            }else{
+                int nLevel = 1;
+                while(nLevel + 1 < LEVEL_COUNT && (uint32_t)(nDiff) >= ((uint32_t)(1) << LevelShift(nLevel + 1))){
+                    nLevel++;
+                }
+                nSlot = LevelSlot(nLevel) + (int)((rstNode.Expire >> LevelShift(nLevel)) & 0X3F);
+            }
+
+            rstNode.Slot = nSlot;
+            rstNode.Prev = -1;
+            rstNode.Next = m_SlotHeadV[nSlot];
+
+            if(rstNode.Next >= 0){
+                m_NodeV[rstNode.Next].Prev = nIndex;
+            }
+
+            m_SlotHeadV[nSlot] = nIndex;
+            m_LevelCountV[SlotLevel(nSlot)]++;
+        }
+
+        void Unlink(int nIndex)
+        {
+            auto &rstNode = m_NodeV[nIndex];
+            if(rstNode.Prev >= 0){
+                m_NodeV[rstNode.Prev].Next = rstNode.Next;
+            }else{
+                m_SlotHeadV[rstNode.Slot] = rstNode.Next;
+            }
+
+            if(rstNode.Next >= 0){
+                m_NodeV[rstNode.Next].Prev = rstNode.Prev;
+            }
+
+            m_LevelCountV[SlotLevel(rstNode.Slot)]--;
+            rstNode.Prev = -1;
+            rstNode.Next = -1;
+        }
+
+        void Free(int nIndex)
+        {
+            auto &rstNode = m_NodeV[nIndex];
+            rstNode.Func = TimerFunc();
+            rstNode.Slot = -1;
+            rstNode.Next = m_FreeHead;
+            m_FreeHead   = nIndex;
+        }
+
+        void Cascade(int nLevel, uint32_t nSlotIndex)
+        {
+            // detach the whole list first
+            // a timer may be linked back to the same slot if it's one round ahead
+            auto nIndex = m_SlotHeadV[LevelSlot(nLevel) + nSlotIndex];
+            m_SlotHeadV[LevelSlot(nLevel) + nSlotIndex] = -1;
+
+            while(nIndex >= 0){
+                auto nNext = m_NodeV[nIndex].Next;
+                m_LevelCountV[nLevel]--;
+
+                Link(nIndex);
+                nIndex = nNext;
+            }
+        }
+};
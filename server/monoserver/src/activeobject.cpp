@@ -3,7 +3,7 @@
  *
  *       Filename: activeobject.cpp
  *        Created: 04/28/2016 20:51:29
- *  Last Modified: 07/04/2017 18:05:51
+ *  Last Modified: 11/28/2017 01:15:32
  *
  *    Description: 
  *
@@ -24,38 +24,18 @@
 #include "monoserver.hpp"
 #include "activeobject.hpp"
 
+constexpr uint32_t ActiveObject::ClassTag;
+
 ActiveObject::ActiveObject()
     : ServerObject()
     , m_StateV()
     , m_StateTimeV()
     , m_ActorPod(nullptr)
     , m_StateHook()
-    , m_DelayCmdCount(0)
-    , m_DelayCmdQ()
 {
     m_StateV.fill(0);
     m_StateTimeV.fill(0);
 
-    auto fnDelayCmdQueue = [this]() -> bool
-    {
-        extern MonoServer *g_MonoServer;
-        if(!m_DelayCmdQ.empty()){
-            if(m_DelayCmdQ.top().Tick() <= g_MonoServer->GetTimeTick()){
-                try{
-                    m_DelayCmdQ.top()();
-                }catch(...){
-                    g_MonoServer->AddLog(LOGTYPE_WARNING, "caught exception for delay cmd");
-                }
-                m_DelayCmdQ.pop();
-            }
-        }
-
-        // it's never done
-        return false;
-    };
-
-    m_StateHook.Install("DelayCmdQueue", fnDelayCmdQueue);
-
     extern ServerEnv *g_ServerEnv;
     if(g_ServerEnv->MIR2X_DEBUG_PRINT_AM_COUNT){
         auto fnPrintAMCount = [this]() -> bool
@@ -111,6 +91,11 @@ Theron::Address ActiveObject::Activate()
         //    between 1 and 2 there could be gap but OK since before exiting current function
         //    no actor message will be passed or forwarded
         m_ActorPod->BindPod(UID(), ClassName());
+
+        // 3. publish the address and class info to the UID record
+        //    ServerObject ctor only links the UID with info of the base class
+        extern MonoServer *g_MonoServer;
+        g_MonoServer->UpdateUID(UID());
         return GetAddress();
     }else{
         extern MonoServer *g_MonoServer;
@@ -126,11 +111,16 @@ void ActiveObject::Deactivate()
     if(m_ActorPod){ m_ActorPod->Detach(); }
 }
 
-void ActiveObject::Delay(uint32_t nDelayTick, const std::function<void()> &fnCmd)
+// delay command is a timer of the actorpod
+// it fires on time even there is no message comes
+uint32_t ActiveObject::Delay(uint32_t nDelayTick, const std::function<void()> &fnCmd)
 {
-    extern MonoServer *g_MonoServer;
-    m_DelayCmdCount = m_DelayCmdQ.empty() ? 0 : (m_DelayCmdCount + 1);
-    m_DelayCmdQ.emplace(nDelayTick + g_MonoServer->GetTimeTick(), m_DelayCmdCount, fnCmd);
+    if(!m_ActorPod){
+        extern MonoServer *g_MonoServer;
+        g_MonoServer->AddLog(LOGTYPE_WARNING, "Delay command before activation: UID = %" PRIu32 ", ClassName = %s", UID(), ClassName());
+        return 0;
+    }
+    return m_ActorPod->AddTimer(nDelayTick, fnCmd);
 }
 
 uint8_t ActiveObject::GetState(uint8_t nState)
@@ -3,7 +3,7 @@
  *
  *       Filename: activeobject.hpp
  *        Created: 04/21/2016 23:02:31
- *  Last Modified: 08/10/2017 23:07:36
+ *  Last Modified: 11/28/2017 01:15:32
  *
  *    Description: server object with active state
  *                      1. it's active via actor pod
@@ -51,7 +51,6 @@
 
 #include "actorpod.hpp"
 #include "statehook.hpp"
-#include "delaycmd.hpp"
 #include "messagepack.hpp"
 #include "serverobject.hpp"
 
@@ -117,6 +116,15 @@ enum ObjectState: uint8_t
 
 class ActiveObject: public ServerObject
 {
+    public:
+        static constexpr uint32_t ClassTag = CLASSTAG_ACTIVEOBJECT | ServerObject::ClassTag;
+
+    public:
+        uint32_t GetClassTag() const
+        {
+            return ActiveObject::ClassTag;
+        }
+
     protected:
         std::array< uint8_t, 255> m_StateV;
         std::array<uint32_t, 255> m_StateTimeV;
@@ -127,11 +135,6 @@ class ActiveObject: public ServerObject
     protected:
         StateHook m_StateHook;
 
-        // keep an incremental counter for DelayCmd
-        // we have to maintain this count to make DelayCmdQ stable for sort
-        uint32_t m_DelayCmdCount;
-        std::priority_queue<DelayCmd> m_DelayCmdQ;
-
     public:
         ActiveObject();
        ~ActiveObject();
@@ -164,5 +167,7 @@ class ActiveObject: public ServerObject
         virtual void OperateAM(const MessagePack &, const Theron::Address &) = 0;
 
     public:
-        void Delay(uint32_t, const std::function<void()> &);
+        // return timer ID of the actorpod
+        // use m_ActorPod->RemoveTimer() to cancel it
+        uint32_t Delay(uint32_t, const std::function<void()> &);
 };
@@ -3,7 +3,7 @@
  *
  *       Filename: actormessage.hpp
  *        Created: 05/03/2016 13:19:07
- *  Last Modified: 10/31/2017 11:59:53
+ *  Last Modified: 12/11/2017 21:14:07
  *
  *    Description: 
  *
@@ -32,6 +32,7 @@ enum MessagePackType: int
     MPK_PING,
     MPK_LOGIN,
     MPK_METRONOME,
+    MPK_WAKEUP,
     MPK_TRYMOVE,
     MPK_TRYSPACEMOVE,
     MPK_MOVEOK,
@@ -72,6 +73,11 @@ enum MessagePackType: int
     MPK_PICKUP,
     MPK_PICKUPOK,
     MPK_REMOVEGROUNDITEM,
+    MPK_AIINTENT,
+
+    // count of types
+    // keep it as the last one
+    MPK_MAX,
 };
 
 struct AMBadActorPod
@@ -230,10 +236,13 @@ struct AMAction
     
     int AimX;
     int AimY;
+
+    uint32_t AimUID;
 };
 
 struct AMPullCOInfo
 {
+    uint32_t UID;
     uint32_t SessionID;
 };
 
@@ -356,6 +365,19 @@ struct AMUpdateHP
     uint32_t HPMax;
 };
 
+struct AMAIIntent
+{
+    uint32_t UID;
+    int      Type;
+
+    uint32_t TargetUID;
+    int      DC;
+
+    int X;
+    int Y;
+    int Direction;
+};
+
 struct AMDeadFadeOut
 {
     uint32_t UID;
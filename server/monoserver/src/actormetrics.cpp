@@ -0,0 +1,235 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: actormetrics.cpp
+ *        Created: 11/30/2017 20:14:09
+ *  Last Modified: 12/01/2017 00:52:37
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <algorithm>
+#include <cinttypes>
+#include "monoserver.hpp"
+#include "messagepack.hpp"
+#include "actormetrics.hpp"
+#include "eventtaskhub.hpp"
+
+uint64_t ActorMetrics::Histogram::Count() const
+{
+    uint64_t nCount = 0;
+    for(auto nBucket: Bucket){
+        nCount += nBucket;
+    }
+    return nCount;
+}
+
+uint64_t ActorMetrics::Histogram::Mean() const
+{
+    auto nCount = Count();
+    return nCount ? (Sum / nCount) : 0;
+}
+
+uint64_t ActorMetrics::Histogram::Percentile(double fPercent) const
+{
+    auto nCount = Count();
+    if(!nCount){
+        return 0;
+    }
+
+    auto nRank = (uint64_t)(std::max<double>(std::min<double>(fPercent, 1.00), 0.00) * nCount);
+    uint64_t nCurrCount = 0;
+    for(int nIndex = 0; nIndex < BUCKET_COUNT; ++nIndex){
+        nCurrCount += Bucket[nIndex];
+        if(nCurrCount >= std::max<uint64_t>(nRank, 1)){
+            return std::min<uint64_t>((uint64_t)(1) << (nIndex + 1), Max);
+        }
+    }
+    return Max;
+}
+
+ActorMetrics::Histogram &ActorMetrics::Histogram::operator -= (const ActorMetrics::Histogram &rstOther)
+{
+    // max can't be subtracted
+    // keep the max since the start
+    Sum -= std::min<uint64_t>(Sum, rstOther.Sum);
+    for(int nIndex = 0; nIndex < BUCKET_COUNT; ++nIndex){
+        Bucket[nIndex] -= std::min<uint64_t>(Bucket[nIndex], rstOther.Bucket[nIndex]);
+    }
+    return *this;
+}
+
+ActorMetrics::TypeMetrics &ActorMetrics::TypeMetrics::operator -= (const ActorMetrics::TypeMetrics &rstOther)
+{
+    Handler   -= rstOther.Handler;
+    Wait      -= rstOther.Wait;
+    RoundTrip -= rstOther.RoundTrip;
+    Timeout   -= std::min<uint64_t>(Timeout, rstOther.Timeout);
+    return *this;
+}
+
+ActorMetrics::ActorMetrics()
+    : m_ShardLock()
+    , m_ShardV()
+    , m_DumpID(0)
+    , m_DumpFunc()
+    , m_DumpLast()
+{}
+
+ActorMetrics::~ActorMetrics()
+{
+    if(m_DumpID){
+        extern EventTaskHub *g_EventTaskHub;
+        g_EventTaskHub->Dismiss(m_DumpID);
+    }
+}
+
+void ActorMetrics::Record(ShardHistogram &rstHistogram, uint64_t nTime)
+{
+    auto nTimeUS = nTime / 1000;
+
+    int nIndex = 0;
+    while(nIndex + 1 < BUCKET_COUNT && (nTimeUS >> (nIndex + 1))){
+        nIndex++;
+    }
+
+    // single writer
+    // plain load and store is enough
+    auto fnAdd = [](std::atomic<uint64_t> &rstValue, uint64_t nValue)
+    {
+        rstValue.store(rstValue.load(std::memory_order_relaxed) + nValue, std::memory_order_relaxed);
+    };
+
+    fnAdd(rstHistogram.Bucket[nIndex], 1);
+    fnAdd(rstHistogram.Sum, nTimeUS);
+
+    if(nTimeUS > rstHistogram.Max.load(std::memory_order_relaxed)){
+        rstHistogram.Max.store(nTimeUS, std::memory_order_relaxed);
+    }
+}
+
+ActorMetrics::Shard *ActorMetrics::ThreadShard()
+{
+    // only one instance in the server
+    // never released before the instance
+    thread_local Shard *s_Shard = nullptr;
+    if(!s_Shard){
+        // value-initialized
+        // all counters are zero
+        std::unique_ptr<Shard> pShard(new Shard());
+        s_Shard = pShard.get();
+        {
+            std::lock_guard<std::mutex> stLockGuard(m_ShardLock);
+            m_ShardV.push_back(std::move(pShard));
+        }
+    }
+    return s_Shard;
+}
+
+std::vector<ActorMetrics::TypeMetrics> ActorMetrics::Snapshot()
+{
+    std::vector<TypeMetrics> stMetricsV;
+    for(int nType = 0; nType < MPK_MAX; ++nType){
+        stMetricsV.emplace_back(nType);
+    }
+
+    auto fnAdd = [](Histogram &rstDst, const ShardHistogram &rstSrc)
+    {
+        rstDst.Sum += rstSrc.Sum.load(std::memory_order_relaxed);
+        rstDst.Max  = std::max<uint64_t>(rstDst.Max, rstSrc.Max.load(std::memory_order_relaxed));
+
+        for(int nIndex = 0; nIndex < BUCKET_COUNT; ++nIndex){
+            rstDst.Bucket[nIndex] += rstSrc.Bucket[nIndex].load(std::memory_order_relaxed);
+        }
+    };
+
+    std::lock_guard<std::mutex> stLockGuard(m_ShardLock);
+    for(auto &pShard: m_ShardV){
+        for(int nType = 0; nType < MPK_MAX; ++nType){
+            auto &rstSrc = pShard->MetricsV[nType];
+            auto &rstDst = stMetricsV[nType];
+
+            fnAdd(rstDst.Handler,   rstSrc.Handler);
+            fnAdd(rstDst.Wait,      rstSrc.Wait);
+            fnAdd(rstDst.RoundTrip, rstSrc.RoundTrip);
+
+            rstDst.Timeout += rstSrc.Timeout.load(std::memory_order_relaxed);
+        }
+    }
+    return stMetricsV;
+}
+
+void ActorMetrics::Launch(uint32_t nInterval)
+{
+    if(!nInterval || m_DumpFunc){
+        return;
+    }
+
+    m_DumpLast = Snapshot();
+    m_DumpFunc = [this, nInterval]()
+    {
+        Dump(nInterval);
+
+        extern EventTaskHub *g_EventTaskHub;
+        m_DumpID = g_EventTaskHub->Add(nInterval, m_DumpFunc);
+    };
+
+    extern EventTaskHub *g_EventTaskHub;
+    m_DumpID = g_EventTaskHub->Add(nInterval, m_DumpFunc);
+}
+
+void ActorMetrics::Dump(uint32_t nInterval)
+{
+    auto stCurrV = Snapshot();
+    auto stDiffV = stCurrV;
+
+    for(size_t nIndex = 0; nIndex < stDiffV.size() && nIndex < m_DumpLast.size(); ++nIndex){
+        stDiffV[nIndex] -= m_DumpLast[nIndex];
+    }
+    m_DumpLast = std::move(stCurrV);
+
+    // busiest types first
+    // by total handler time in this interval
+    std::sort(stDiffV.begin(), stDiffV.end(), [](const TypeMetrics &rstLHS, const TypeMetrics &rstRHS)
+    {
+        return rstLHS.Handler.Sum > rstRHS.Handler.Sum;
+    });
+
+    extern MonoServer *g_MonoServer;
+    g_MonoServer->AddLog(LOGTYPE_INFO, "Actor metrics in last %" PRIu32 " ms: handler sum/mean/p99, wait mean/p99, rtt mean/p99 in us", nInterval);
+
+    int nDumpCount = 0;
+    for(auto &rstMetrics: stDiffV){
+        if(nDumpCount >= 16){
+            break;
+        }
+
+        if(!(rstMetrics.Count() || rstMetrics.RoundTrip.Count() || rstMetrics.Timeout)){
+            continue;
+        }
+
+        g_MonoServer->AddLog(LOGTYPE_INFO,
+                "%-20s count %-8" PRIu64 " handler %" PRIu64 "/%" PRIu64 "/%" PRIu64 ", wait %" PRIu64 "/%" PRIu64 ", rtt %" PRIu64 "/%" PRIu64 ", timeout %" PRIu64,
+                MessagePack(rstMetrics.Type).Name(),
+                rstMetrics.Count(),
+                rstMetrics.Handler.Sum,
+                rstMetrics.Handler.Mean(),
+                rstMetrics.Handler.Percentile(0.99),
+                rstMetrics.Wait.Mean(),
+                rstMetrics.Wait.Percentile(0.99),
+                rstMetrics.RoundTrip.Mean(),
+                rstMetrics.RoundTrip.Percentile(0.99),
+                rstMetrics.Timeout);
+        nDumpCount++;
+    }
+}
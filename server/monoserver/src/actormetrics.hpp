@@ -0,0 +1,198 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: actormetrics.hpp
+ *        Created: 11/30/2017 20:14:09
+ *  Last Modified: 12/01/2017 00:52:37
+ *
+ *    Description: per message type statistics of all actor pods
+ *
+ *                 for each MPK_XXXX records
+ *
+ *                      1. count of handled messages
+ *                      2. handler time     : InnHandler() including timers and trigger
+ *                      3. wait time        : from creation of the message to handling
+ *                      4. round trip time  : from Forward() to the response, by type of
+ *                                            the request, and count of timeout
+ *
+ *                 time goes to log2 buckets in microseconds, recorded by the actor thread
+ *                 to its own shard without lock or atomic read-modify-write, Snapshot()
+ *                 sums all shards and can be called by any thread
+ *
+ *                 Launch(nInterval) dumps the busiest types in each interval to the log,
+ *                 then it's also shown in the gui browser
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+#include "actormessage.hpp"
+
+class ActorMetrics final
+{
+    public:
+        // bucket 0     : [0, 2) us
+        // bucket n     : [2^n, 2^(n + 1)) us
+        // last bucket  : all longer ones
+        static constexpr int BUCKET_COUNT = 24;
+
+    public:
+        struct Histogram
+        {
+            uint64_t Sum;
+            uint64_t Max;
+            std::array<uint64_t, BUCKET_COUNT> Bucket;
+
+            Histogram()
+                : Sum(0)
+                , Max(0)
+                , Bucket()
+            {
+                Bucket.fill(0);
+            }
+
+            uint64_t Count() const;
+            uint64_t Mean() const;
+
+            // upper bound of the bucket, in us
+            // never greater than Max
+            uint64_t Percentile(double) const;
+
+            Histogram &operator -= (const Histogram &);
+        };
+
+        struct TypeMetrics
+        {
+            int Type;
+
+            Histogram Handler;
+            Histogram Wait;
+            Histogram RoundTrip;
+
+            uint64_t Timeout;
+
+            TypeMetrics(int nType = MPK_NONE)
+                : Type(nType)
+                , Handler()
+                , Wait()
+                , RoundTrip()
+                , Timeout(0)
+            {}
+
+            uint64_t Count() const
+            {
+                return Handler.Count();
+            }
+
+            TypeMetrics &operator -= (const TypeMetrics &);
+        };
+
+    private:
+        // only written by the owner thread
+        // use atomic for the reader, but no lock prefix for the writer
+        struct ShardHistogram
+        {
+            std::atomic<uint64_t> Sum;
+            std::atomic<uint64_t> Max;
+            std::array<std::atomic<uint64_t>, BUCKET_COUNT> Bucket;
+        };
+
+        struct ShardMetrics
+        {
+            ShardHistogram Handler;
+            ShardHistogram Wait;
+            ShardHistogram RoundTrip;
+
+            std::atomic<uint64_t> Timeout;
+        };
+
+        struct Shard
+        {
+            std::array<ShardMetrics, MPK_MAX> MetricsV;
+        };
+
+    private:
+        std::mutex                          m_ShardLock;
+        std::vector<std::unique_ptr<Shard>> m_ShardV;
+
+    private:
+        // for the periodic dump
+        // only used in the event task of g_EventTaskHub
+        uint32_t                  m_DumpID;
+        std::function<void()>     m_DumpFunc;
+        std::vector<TypeMetrics>  m_DumpLast;
+
+    public:
+        ActorMetrics();
+       ~ActorMetrics();
+
+    public:
+        // message handled by an actor pod
+        // all time in ns by MessagePack::CurrTime()
+        void OnMessage(int nType, uint64_t nSendTime, uint64_t nStartTime, uint64_t nDoneTime)
+        {
+            if(ValidType(nType)){
+                auto &rstMetrics = ThreadShard()->MetricsV[nType];
+                if(nSendTime && nSendTime <= nStartTime){
+                    Record(rstMetrics.Wait, nStartTime - nSendTime);
+                }
+                Record(rstMetrics.Handler, (nDoneTime >= nStartTime) ? (nDoneTime - nStartTime) : 0);
+            }
+        }
+
+        // response of a request with type nType comes
+        void OnRespond(int nType, uint64_t nRoundTrip)
+        {
+            if(ValidType(nType)){
+                Record(ThreadShard()->MetricsV[nType].RoundTrip, nRoundTrip);
+            }
+        }
+
+        void OnTimeout(int nType)
+        {
+            if(ValidType(nType)){
+                auto &rstTimeout = ThreadShard()->MetricsV[nType].Timeout;
+                rstTimeout.store(rstTimeout.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+        }
+
+    public:
+        // indexed by message type
+        // TypeMetrics::Type is set for each entry
+        std::vector<TypeMetrics> Snapshot();
+
+    public:
+        // start periodic dump in g_EventTaskHub
+        // zero interval disables it
+        void Launch(uint32_t);
+
+    private:
+        void Dump(uint32_t);
+
+    private:
+        static bool ValidType(int nType)
+        {
+            return nType >= 0 && nType < MPK_MAX;
+        }
+
+        static void Record(ShardHistogram &, uint64_t);
+
+    private:
+        Shard *ThreadShard();
+};
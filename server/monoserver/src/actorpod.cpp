@@ -3,7 +3,7 @@
  *
  *       Filename: actorpod.cpp
  *        Created: 05/03/2016 15:00:35
- *  Last Modified: 05/17/2017 12:06:01
+ *  Last Modified: 12/17/2017 22:16:40
  *
  *    Description: 
  *
@@ -19,52 +19,36 @@
  */
 #include <cstdio>
 #include <atomic>
+#include <algorithm>
 #include <cinttypes>
 
 #include "actorpod.hpp"
 #include "serverenv.hpp"
 #include "monoserver.hpp"
+#include "actormetrics.hpp"
+#include "eventtaskhub.hpp"
 
 void ActorPod::InnHandler(const MessagePack &rstMPK, const Theron::Address stFromAddr)
 {
-    extern ServerEnv *g_ServerEnv;
-    if(g_ServerEnv->MIR2X_DEBUG_PRINT_AM_FORWARD){
-        extern MonoServer *g_MonoServer;
-        g_MonoServer->AddLog(LOGTYPE_INFO, "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) <- (Type: %s, ID: %u, Resp: %u)",
-                (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), rstMPK.Name(), rstMPK.ID(), rstMPK.Respond());
-    }
+    auto nStartTime = MessagePack::CurrTime();
+    m_InHandler = true;
 
-    // everytime when message comes check the expire time
-    // remove all expired message handler before any handling
-    if(m_ExpireTime){
-        while(!m_RespondMessageRecord.empty()){
-            extern MonoServer *g_MonoServer;
-            if(m_RespondMessageRecord.begin()->second.ExpireTime < g_MonoServer->GetTimeTick()){
-                // expired, erase current message handler
-                // send MPK_TIMEOUT to registered message handler to indicate erasion
-                try{
-                    m_RespondMessageRecord.begin()->second.RespondOperation(MPK_TIMEOUT, GetAddress());
-                }catch(...){
-                    extern MonoServer *g_MonoServer;
-                    g_MonoServer->AddLog(LOGTYPE_WARNING,
-                            "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) <- (Type: MPK_TIMEOUT, ID: 0, Resp: %u) : Caught exception from current message handler",
-                            (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), m_RespondMessageRecord.begin()->first);
-                }
-                m_RespondMessageRecord.erase(m_RespondMessageRecord.begin());
-                continue;
-            }
+    extern MonoServer *g_MonoServer;
+    MIR2X_ADDLOG(g_MonoServer, DEBUG, "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) <- (Type: %s, ID: %u, Resp: %u)",
+            (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), rstMPK.Name(), rstMPK.ID(), rstMPK.Respond());
 
-            // std::map<ID, Handler> keeps order in ID number
-            // ID number is the Resp() of the responding messages
-            //
-            // and we guarantee ID1 < ID2 ==> ExpireTime1 <= ExpireTime2
-            // so if we get first non-expired handler, means the rest are all not expired
-            // good feature for std::map, reason why use it instead of std::unordered_map here
-            break;
-        }
-    }
+    // run expired timers before the message
+    // includes timeout of registered response handlers
+    RunTimer();
+
+    if(true
+            && rstMPK.Type() == MPK_WAKEUP
+            && rstMPK.Respond() == 0){
 
-    if(rstMPK.Respond()){
+        // wake up by g_EventTaskHub
+        // no handler for it, only need to run the timers and trigger
+        m_WakeID = 0;
+    }else if(rstMPK.Respond()){
         auto pRecord = m_RespondMessageRecord.find(rstMPK.Respond());
         // try to find the response handler for current responding message
         // 1.     find it, good
@@ -80,9 +64,19 @@ void ActorPod::InnHandler(const MessagePack &rstMPK, const Theron::Address stFro
         }else{
             // we do have an record for this message
             // if we still can find it means it's not expired
-            if(pRecord->second.RespondOperation){
+            //
+            // take it out before calling the handler
+            // handler may register new ones and invalidate pRecord
+            auto fnOperation = std::move(pRecord->second.RespondOperation);
+            m_TimerWheel.Remove(pRecord->second.TimerID);
+
+            extern ActorMetrics *g_ActorMetrics;
+            g_ActorMetrics->OnRespond(pRecord->second.Type, nStartTime - std::min<uint64_t>(nStartTime, pRecord->second.SendTime));
+            m_RespondMessageRecord.erase(pRecord);
+
+            if(fnOperation){
                 try{
-                    pRecord->second.RespondOperation(rstMPK, stFromAddr);
+                    fnOperation(rstMPK, stFromAddr);
                 }catch(...){
                     extern MonoServer *g_MonoServer;
                     g_MonoServer->AddLog(LOGTYPE_WARNING,
@@ -95,7 +89,6 @@ void ActorPod::InnHandler(const MessagePack &rstMPK, const Theron::Address stFro
                         "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) <- (Type: %s, ID: %u, Resp: %u) : Current message handler not executable",
                         (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), rstMPK.Name(), rstMPK.ID(), rstMPK.Respond());
             }
-            m_RespondMessageRecord.erase(pRecord);
         }
     }else{
         // informing type message
@@ -134,6 +127,106 @@ void ActorPod::InnHandler(const MessagePack &rstMPK, const Theron::Address stFro
         // TODO
         // it's ok to work without trigger for an actorpod
     }
+
+    // handler or trigger may add timers
+    m_InHandler = false;
+    ScheduleWakeup();
+
+    extern ActorMetrics *g_ActorMetrics;
+    g_ActorMetrics->OnMessage(rstMPK.Type(), rstMPK.SendTime(), nStartTime, MessagePack::CurrTime());
+}
+
+ActorPod::~ActorPod()
+{
+    if(m_WakeID){
+        extern EventTaskHub *g_EventTaskHub;
+        g_EventTaskHub->Dismiss(m_WakeID);
+    }
+}
+
+void ActorPod::RunTimer()
+{
+    if(m_TimerWheel.Empty()){
+        return;
+    }
+
+    extern MonoServer *g_MonoServer;
+    std::vector<TimerWheel::TimerFunc> stTimerV;
+    m_TimerWheel.Expire(g_MonoServer->GetTimeTick(), stTimerV);
+
+    for(auto &fnTimer: stTimerV){
+        try{
+            fnTimer();
+        }catch(...){
+            g_MonoServer->AddLog(LOGTYPE_WARNING, "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) : Caught exception in timer",
+                    (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID());
+        }
+    }
+}
+
+uint32_t ActorPod::CurrTick()
+{
+    extern MonoServer *g_MonoServer;
+    return g_MonoServer->GetTimeTick();
+}
+
+void ActorPod::ScheduleWakeup()
+{
+    uint32_t nNextTick = 0;
+    if(!m_TimerWheel.NextTick(&nNextTick)){
+        return;
+    }
+
+    // a pending wake up earlier than the next timer is good enough
+    // it makes a new schedule by itself when it comes
+    if(m_WakeID && ((int32_t)(m_WakeTick - nNextTick) <= 0)){
+        return;
+    }
+
+    extern MonoServer *g_MonoServer;
+    extern EventTaskHub *g_EventTaskHub;
+
+    if(m_WakeID){
+        g_EventTaskHub->Dismiss(m_WakeID);
+    }
+
+    auto nCurrTick = g_MonoServer->GetTimeTick();
+    auto nDelay    = ((int32_t)(nNextTick - nCurrTick) > 0) ? (nNextTick - nCurrTick) : 0;
+
+    m_WakeTick = nCurrTick + nDelay;
+    m_WakeID   = g_EventTaskHub->Add(nDelay, [stAddress = GetAddress()]()
+    {
+        // send to a dead actor fails
+        // then nothing to do with it
+        extern Theron::Framework *g_Framework;
+        g_Framework->Send(MessagePack(MPK_WAKEUP), Theron::Address::Null(), stAddress);
+    });
+}
+
+uint32_t ActorPod::AddTimer(uint32_t nDelay, std::function<void()> fnTimer)
+{
+    if(!fnTimer){
+        return 0;
+    }
+
+    // base tick of an empty wheel can be far behind after idle
+    // timer linked by distance to it may wrap and be taken as due
+    auto nCurrTick = CurrTick();
+    m_TimerWheel.SetCurrTick(nCurrTick);
+
+    auto nTimerID = m_TimerWheel.Add(nCurrTick + nDelay, std::move(fnTimer));
+
+    // outside of InnHandler() nobody schedules the wake up for it
+    // ScheduleWakeup() only reschedules if it's earlier than the pending one
+    if(nTimerID && !m_InHandler){
+        ScheduleWakeup();
+    }
+    return nTimerID;
+}
+
+bool ActorPod::RemoveTimer(uint32_t nTimerID)
+{
+    return m_TimerWheel.Remove(nTimerID);
 }
 
 uint32_t ActorPod::ValidID()
@@ -166,12 +259,9 @@ uint32_t ActorPod::ValidID()
 
 bool ActorPod::Forward(const MessageBuf &rstMB, const Theron::Address &rstAddr, uint32_t nRespond)
 {
-    extern ServerEnv *g_ServerEnv;
-    if(g_ServerEnv->MIR2X_DEBUG_PRINT_AM_FORWARD){
-        extern MonoServer *g_MonoServer;
-        g_MonoServer->AddLog(LOGTYPE_INFO, "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) -> (Type: %s, ID: %u, Resp: %u)",
-                (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), MessagePack(rstMB.Type()).Name(), 0, nRespond);
-    }
+    extern MonoServer *g_MonoServer;
+    MIR2X_ADDLOG(g_MonoServer, DEBUG, "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) -> (Type: %s, ID: %u, Resp: %u)",
+            (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), MessagePack(rstMB.Type()).Name(), 0, nRespond);
 
     if(!rstAddr){
         extern MonoServer *g_MonoServer;
@@ -204,12 +294,9 @@ bool ActorPod::Forward(const MessageBuf &rstMB,
 {
     uint32_t nID = ValidID();
 
-    extern ServerEnv *g_ServerEnv;
-    if(g_ServerEnv->MIR2X_DEBUG_PRINT_AM_FORWARD){
-        extern MonoServer *g_MonoServer;
-        g_MonoServer->AddLog(LOGTYPE_INFO, "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) -> (Type: %s, ID: %u, Resp: %u)",
-                (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), MessagePack(rstMB.Type()).Name(), nID, nRespond);
-    }
+    extern MonoServer *g_MonoServer;
+    MIR2X_ADDLOG(g_MonoServer, DEBUG, "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) -> (Type: %s, ID: %u, Resp: %u)",
+            (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), MessagePack(rstMB.Type()).Name(), nID, nRespond);
 
     if(!rstAddr){
         extern MonoServer *g_MonoServer;
@@ -225,6 +312,7 @@ bool ActorPod::Forward(const MessageBuf &rstMB,
         return false;
     }
 
+    auto nSendTime = MessagePack::CurrTime();
     if(!Theron::Actor::Send<MessagePack>({rstMB, nID, nRespond}, rstAddr)){
         extern MonoServer *g_MonoServer;
         g_MonoServer->AddLog(LOGTYPE_WARNING, "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) -> (Type: %s, ID: %u, Resp: %u) : Failed to send message to given address",
@@ -232,6 +320,32 @@ bool ActorPod::Forward(const MessageBuf &rstMB,
         return false;
     }
 
-    extern MonoServer *g_MonoServer;
-    return m_RespondMessageRecord.emplace(nID, RespondMessageRecord((g_MonoServer->GetTimeTick() + m_ExpireTime), fnOPR)).second;
+    // expired handler gets MPK_TIMEOUT and is removed
+    // timer is removed if response comes in time
+    uint32_t nTimerID = 0;
+    if(m_ExpireTime){
+        nTimerID = AddTimer(m_ExpireTime, [this, nID]()
+        {
+            auto pRecord = m_RespondMessageRecord.find(nID);
+            if(pRecord != m_RespondMessageRecord.end()){
+                auto fnOperation = std::move(pRecord->second.RespondOperation);
+
+                extern ActorMetrics *g_ActorMetrics;
+                g_ActorMetrics->OnTimeout(pRecord->second.Type);
+                m_RespondMessageRecord.erase(pRecord);
+
+                if(fnOperation){
+                    try{
+                        fnOperation(MPK_TIMEOUT, GetAddress());
+                    }catch(...){
+                        extern MonoServer *g_MonoServer;
+                        g_MonoServer->AddLog(LOGTYPE_WARNING,
+                                "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) <- (Type: MPK_TIMEOUT, ID: 0, Resp: %u) : Caught exception from current message handler",
+                                (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), nID);
+                    }
+                }
+            }
+        });
+    }
+    return m_RespondMessageRecord.emplace(nID, RespondMessageRecord(nTimerID, fnOPR, rstMB.Type(), nSendTime)).second;
 }
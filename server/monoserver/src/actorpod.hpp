@@ -3,7 +3,7 @@
  *
  *       Filename: actorpod.hpp
  *        Created: 04/20/2016 21:49:14
- *  Last Modified: 05/15/2017 13:58:35
+ *  Last Modified: 12/17/2017 22:16:40
  *
  *    Description: why I made actor as a plug, because I want it to be a one to zero/one
  *                 mapping as ServerObject -> Actor
@@ -34,8 +34,8 @@
  *
  *                 ActorPod(Trigger, Operation);
  *
- *                 to provide the trigger, this trigger can handle delay commands, so we
- *                 define class DelayCmd and take the trigger as:
+ *                 to provide the trigger, delay commands are timers of the actorpod now
+ *                 and the trigger is for state hooks only, take it as:
  *
  *                      auto fnTrigger = [this](){ m_StateHook.Execute(); }
  *
@@ -48,6 +48,11 @@
  *                 put the trigger here. Then for Transponder and ReactObject, we
  *                 provide method to install trigger handler:
  *
+ *                 timers of the actor, including response timeout, are in one TimerWheel
+ *                 and run before each message, if the actor has pending timers it asks
+ *                 g_EventTaskHub to send MPK_WAKEUP at the earliest one, then timers and
+ *                 the trigger still run on an idle actor
+ *
  *        Version: 1.0
  *       Revision: none
  *       Compiler: gcc
@@ -60,11 +65,13 @@
  */
 #pragma once
 
-#include <map>
+#include <vector>
 #include <functional>
+#include <unordered_map>
 #include <Theron/Theron.h>
 
 #include "messagebuf.hpp"
+#include "timerwheel.hpp"
 #include "messagepack.hpp"
 
 class ActorPod final: public Theron::Actor
@@ -76,14 +83,20 @@ class ActorPod final: public Theron::Actor
         // so we can put the pack copy in the lambda function capture list instead of here
         struct RespondMessageRecord
         {
-            // we put an expire time here
-            // to support automatically remove the registered response handler
-            uint32_t ExpireTime;
+            // timer to remove the registered response handler when expired
+            // zero if the pod never expires handlers
+            uint32_t TimerID;
             MessagePackOperation RespondOperation;
 
-            RespondMessageRecord(uint32_t nExpireTime, const MessagePackOperation &rstOperation)
-                : ExpireTime(nExpireTime)
+            // for round trip time of the request
+            int      Type;
+            uint64_t SendTime;
+
+            RespondMessageRecord(uint32_t nTimerID, const MessagePackOperation &rstOperation, int nType, uint64_t nSendTime)
+                : TimerID(nTimerID)
                 , RespondOperation(rstOperation)
+                , Type(nType)
+                , SendTime(nSendTime)
             {}
         };
 
@@ -116,17 +129,25 @@ class ActorPod final: public Theron::Actor
         // we can put argument to specify the expire time of each handler but not necessary
         const uint32_t m_ExpireTime;
 
-        // use std::map instead of std::unordered_map
-        //
-        // 1. we have to scan the map every time when new message comes to remove expired ones
-        //    std::unordered_map is slow for scan the entire map
-        //    I can maintain another std::priority_queue based on expire time
-        //    but it's hard to remove those entry which executed before expire from the queue
-        //
-        // 2. std::map keeps entries in order by Resp number
-        //    Resp number gives strict order of expire time, excellent freature by std::map
-        //    then when checking expired ones, we start from std::map::begin() and stop at the fist non-expired one
-        std::map<uint32_t, RespondMessageRecord> m_RespondMessageRecord;
+        // expiration is done by m_TimerWheel
+        // then no scan of this map is needed
+        std::unordered_map<uint32_t, RespondMessageRecord> m_RespondMessageRecord;
+
+    private:
+        // tick by g_MonoServer->GetTimeTick()
+        // only accessed in the actor thread, moved to current tick whenever it's empty
+        TimerWheel m_TimerWheel;
+
+    private:
+        // MPK_WAKEUP scheduled in g_EventTaskHub
+        // zero ID means no wake up pending
+        uint32_t m_WakeID;
+        uint32_t m_WakeTick;
+
+    private:
+        // set while InnHandler() is running
+        // timers added inside get scheduled once at the end of the handler
+        bool m_InHandler;
 
     private:
         // actor information provided by BindPod()
@@ -144,6 +165,10 @@ class ActorPod final: public Theron::Actor
             , m_ValidID(0)
             , m_ExpireTime(nExpireTime)
             , m_RespondMessageRecord()
+            , m_TimerWheel(CurrTick())
+            , m_WakeID(0)
+            , m_WakeTick(0)
+            , m_InHandler(false)
             , m_UID(0)
             , m_Name("ActorPod")
         {
@@ -156,7 +181,7 @@ class ActorPod final: public Theron::Actor
             : ActorPod(pFramework, std::function<void()>(), fnOperate, nExpireTime)
         {}
 
-       ~ActorPod() = default;
+       ~ActorPod();
 
     private:
         // get an ID to a message expcecting a response
@@ -172,6 +197,23 @@ class ActorPod final: public Theron::Actor
         // Theron::Actor accept Theron::Actor::InnHandler only instead of std::function<void(...)>
         void InnHandler(const MessagePack &, const Theron::Address);
 
+    private:
+        // run all expired timers
+        // and schedule MPK_WAKEUP for the earliest pending one
+        void RunTimer();
+        void ScheduleWakeup();
+
+        // g_MonoServer->GetTimeTick()
+        // monoserver.hpp is not included here
+        static uint32_t CurrTick();
+
+    public:
+        // delay in ms, timer runs in the actor thread
+        // it fires on time even if no message comes, also when added outside of a handler
+        // return timer ID, zero means failed
+        uint32_t AddTimer(uint32_t, std::function<void()>);
+        bool RemoveTimer(uint32_t);
+
     public:
         // just send a message, not a response, and won't exptect a reply
         bool Forward(const MessageBuf &rstMB, const Theron::Address &rstAddr)
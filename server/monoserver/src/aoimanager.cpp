@@ -0,0 +1,197 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: aoimanager.cpp
+ *        Created: 11/13/2017 10:40:19
+ *  Last Modified: 11/13/2017 16:48:05
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <algorithm>
+#include "player.hpp"
+#include "mathfunc.hpp"
+#include "serverenv.hpp"
+#include "charobject.hpp"
+#include "aoimanager.hpp"
+#include "monoserver.hpp"
+#include "activeobject.hpp"
+
+AOIManager::AOIManager(int nW, int nH, int nSectorSize)
+    : m_W(std::max<int>(nW, 0))
+    , m_H(std::max<int>(nH, 0))
+    , m_SectorSize(std::max<int>(nSectorSize, 1))
+    , m_SectorW((m_W + m_SectorSize - 1) / m_SectorSize)
+    , m_SectorH((m_H + m_SectorSize - 1) / m_SectorSize)
+    , m_SectorV()
+    , m_EntryMap()
+{
+    m_SectorV.resize(m_SectorW * m_SectorH);
+}
+
+int AOIManager::Radius(int nEventType)
+{
+    // default radius is the same as we used in DoCircle()
+    // can be overwritten by environment setting
+
+    extern ServerEnv *g_ServerEnv;
+    auto fnRadius = [](int nConfig, int nDefault) -> int
+    {
+        return (nConfig > 0) ? nConfig : nDefault;
+    };
+
+    switch(nEventType){
+        case AOIEVENT_ACTION           : return fnRadius(g_ServerEnv->MIR2X_CONFIG_AOI_ACTION     , 10);
+        case AOIEVENT_UPDATEHP         : return fnRadius(g_ServerEnv->MIR2X_CONFIG_AOI_UPDATEHP   , 20);
+        case AOIEVENT_DEADFADEOUT      : return fnRadius(g_ServerEnv->MIR2X_CONFIG_AOI_DEADFADEOUT, 20);
+        case AOIEVENT_OFFLINE          : return fnRadius(g_ServerEnv->MIR2X_CONFIG_AOI_OFFLINE    , 10);
+        case AOIEVENT_SHOWDROPITEM     : return fnRadius(g_ServerEnv->MIR2X_CONFIG_AOI_DROPITEM   , 10);
+        case AOIEVENT_REMOVEGROUNDITEM : return fnRadius(g_ServerEnv->MIR2X_CONFIG_AOI_DROPITEM   , 10);
+        case AOIEVENT_QUERYCORECORD    : return 10;
+        default                        : return 0;
+    }
+}
+
+bool AOIManager::Update(uint32_t nUID, int nX, int nY)
+{
+    if(!(nUID && ValidC(nX, nY))){
+        return false;
+    }
+
+    auto pEntry = m_EntryMap.find(nUID);
+    if(pEntry != m_EntryMap.end()){
+
+        // moving inside current map
+        // only touch sector list when crossing the sector boundary
+
+        auto nOldIndex = SectorIndex(pEntry->second.X, pEntry->second.Y);
+        auto nNewIndex = SectorIndex(nX, nY);
+
+        if(nOldIndex != nNewIndex){
+            SectorRemove(nOldIndex, nUID);
+            SectorAdd(nNewIndex, nUID);
+        }
+
+        pEntry->second.X = nX;
+        pEntry->second.Y = nY;
+        return true;
+    }
+
+    // entering current map
+    // this is the only place we query the UID record
+
+    extern MonoServer *g_MonoServer;
+    if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
+        m_EntryMap[nUID] = AOIEntry(nUID, nX, nY,
+                stUIDRecord.ClassFrom<Player>(),
+                stUIDRecord.ClassFrom<CharObject>(),
+                stUIDRecord.ClassFrom<ActiveObject>(),
+                stUIDRecord.Address);
+
+        SectorAdd(SectorIndex(nX, nY), nUID);
+        return true;
+    }
+    return false;
+}
+
+bool AOIManager::Remove(uint32_t nUID)
+{
+    auto pEntry = m_EntryMap.find(nUID);
+    if(pEntry != m_EntryMap.end()){
+        SectorRemove(SectorIndex(pEntry->second.X, pEntry->second.Y), nUID);
+        m_EntryMap.erase(pEntry);
+        return true;
+    }
+    return false;
+}
+
+bool AOIManager::Remove(uint32_t nUID, int nX, int nY)
+{
+    // when moving we first add the UID to the new location
+    // then a late remove for the old location should be ignored
+
+    auto pEntry = m_EntryMap.find(nUID);
+    if(true
+            && pEntry != m_EntryMap.end()
+            && pEntry->second.X == nX
+            && pEntry->second.Y == nY){
+        return Remove(nUID);
+    }
+    return false;
+}
+
+void AOIManager::ForEach(int nCX, int nCY, int nCR, const std::function<bool(const AOIEntry &)> &fnOP) const
+{
+    int nW = 2 * nCR - 1;
+    int nH = 2 * nCR - 1;
+
+    int nX0 = nCX - nCR + 1;
+    int nY0 = nCY - nCR + 1;
+
+    if(true
+            && fnOP
+            && nW > 0
+            && nH > 0
+            && RectangleOverlapRegion(0, 0, m_W, m_H, &nX0, &nY0, &nW, &nH)){
+
+        int nSX0 = (nX0          ) / m_SectorSize;
+        int nSY0 = (nY0          ) / m_SectorSize;
+        int nSX1 = (nX0 + nW - 1 ) / m_SectorSize;
+        int nSY1 = (nY0 + nH - 1 ) / m_SectorSize;
+
+        for(int nSY = nSY0; nSY <= nSY1; ++nSY){
+            for(int nSX = nSX0; nSX <= nSX1; ++nSX){
+                for(auto nUID: m_SectorV[nSY * m_SectorW + nSX]){
+                    auto pEntry = m_EntryMap.find(nUID);
+                    if(pEntry != m_EntryMap.end()){
+                        if(LDistance2(pEntry->second.X, pEntry->second.Y, nCX, nCY) <= (nCR - 1) * (nCR - 1)){
+                            if(fnOP(pEntry->second)){
+                                return;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void AOIManager::ForAll(const std::function<bool(const AOIEntry &)> &fnOP) const
+{
+    if(fnOP){
+        for(auto &rstEntry: m_EntryMap){
+            if(fnOP(rstEntry.second)){
+                return;
+            }
+        }
+    }
+}
+
+void AOIManager::SectorAdd(int nIndex, uint32_t nUID)
+{
+    auto &rstUIDList = m_SectorV[nIndex];
+    if(std::find(rstUIDList.begin(), rstUIDList.end(), nUID) == rstUIDList.end()){
+        rstUIDList.push_back(nUID);
+    }
+}
+
+void AOIManager::SectorRemove(int nIndex, uint32_t nUID)
+{
+    auto &rstUIDList = m_SectorV[nIndex];
+    auto pUIDRecord  = std::find(rstUIDList.begin(), rstUIDList.end(), nUID);
+
+    if(pUIDRecord != rstUIDList.end()){
+        std::swap(rstUIDList.back(), *pUIDRecord);
+        rstUIDList.pop_back();
+    }
+}
@@ -0,0 +1,160 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: aoimanager.hpp
+ *        Created: 11/13/2017 10:12:37
+ *  Last Modified: 11/13/2017 16:48:05
+ *
+ *    Description: area-of-interest manager for server map broadcasting
+ *
+ *                 originally map broadcasts an event by DoCircle(), which visits every
+ *                 cell in the radius and checks UIDRecord for each UID in it, then a
+ *                 crowded area makes every step cost hundreds of cell visits
+ *
+ *                 AOIManager splits the map into sectors of SectorSize x SectorSize
+ *                 and keeps the UID's in each sector, entry of each UID is updated
+ *                 incrementally when it enters / leaves / moves, then a broadcast only
+ *                 checks sectors overlapping the radius and entries inside it
+ *
+ *                 class info and address of an entry is cached when it enters, so no
+ *                 more GetUIDRecord() needed for the fan-out
+ *
+ *                 this class is not thread-safe, only used inside ServerMap's actor
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <Theron/Address.h>
+
+enum AOIEventType: int
+{
+    AOIEVENT_NONE = 0,
+    AOIEVENT_ACTION,
+    AOIEVENT_UPDATEHP,
+    AOIEVENT_DEADFADEOUT,
+    AOIEVENT_OFFLINE,
+    AOIEVENT_SHOWDROPITEM,
+    AOIEVENT_REMOVEGROUNDITEM,
+    AOIEVENT_QUERYCORECORD,
+    AOIEVENT_MAX,
+};
+
+class AOIManager final
+{
+    public:
+        struct AOIEntry
+        {
+            uint32_t UID;
+
+            int X;
+            int Y;
+
+            // cached class info when entering
+            // class of an object never changes
+            bool Player;
+            bool CharObject;
+            bool ActiveObject;
+
+            Theron::Address Address;
+
+            AOIEntry(uint32_t nUID = 0,
+                    int nX = -1,
+                    int nY = -1,
+                    bool bPlayer       = false,
+                    bool bCharObject   = false,
+                    bool bActiveObject = false,
+                    const Theron::Address &rstAddress = Theron::Address::Null())
+                : UID(nUID)
+                , X(nX)
+                , Y(nY)
+                , Player(bPlayer)
+                , CharObject(bCharObject)
+                , ActiveObject(bActiveObject)
+                , Address(rstAddress)
+            {}
+        };
+
+    private:
+        const int m_W;
+        const int m_H;
+
+    private:
+        const int m_SectorSize;
+        const int m_SectorW;
+        const int m_SectorH;
+
+    private:
+        std::vector<std::vector<uint32_t>> m_SectorV;
+        std::unordered_map<uint32_t, AOIEntry> m_EntryMap;
+
+    public:
+        AOIManager(int, int, int = 8);
+       ~AOIManager() = default;
+
+    public:
+        static int Radius(int);
+
+    public:
+        bool Update(uint32_t, int, int);
+
+    public:
+        // remove by UID
+        // or only remove if it's recorded at (x, y)
+        bool Remove(uint32_t);
+        bool Remove(uint32_t, int, int);
+
+    public:
+        const AOIEntry *Find(uint32_t nUID) const
+        {
+            auto pEntry = m_EntryMap.find(nUID);
+            return (pEntry == m_EntryMap.end()) ? nullptr : &(pEntry->second);
+        }
+
+        size_t Count() const
+        {
+            return m_EntryMap.size();
+        }
+
+    public:
+        // visit all entries inside the circle
+        // circle has same definition as ServerMap::DoCircle()
+        // stop visiting if fnOP returns true
+        void ForEach(int, int, int, const std::function<bool(const AOIEntry &)> &) const;
+
+        // visit entries inside the radius configured for given event type
+        void ForEvent(int nEventType, int nX, int nY, const std::function<bool(const AOIEntry &)> &fnOP) const
+        {
+            ForEach(nX, nY, Radius(nEventType), fnOP);
+        }
+
+        // visit all entries in the map
+        void ForAll(const std::function<bool(const AOIEntry &)> &) const;
+
+    private:
+        int SectorIndex(int nX, int nY) const
+        {
+            return (nY / m_SectorSize) * m_SectorW + (nX / m_SectorSize);
+        }
+
+        bool ValidC(int nX, int nY) const
+        {
+            return nX >= 0 && nX < m_W && nY >= 0 && nY < m_H;
+        }
+
+    private:
+        void SectorAdd(int, uint32_t);
+        void SectorRemove(int, uint32_t);
+};
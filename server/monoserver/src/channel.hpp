@@ -3,7 +3,7 @@
  *
  *       Filename: channel.hpp
  *        Created: 10/04/2017 12:36:13
- *  Last Modified: 10/08/2017 02:08:16
+ *  Last Modified: 12/11/2017 21:14:07
  *
  *    Description: 
  *
@@ -154,7 +154,9 @@ class Channel final
         }
 
     public:
-        template<typename... Args> bool Send(uint8_t nHC, Args&&... args)
+        // forward all arguments to Session::Send()
+        // include the shared message from Session::Encode() for broadcast
+        template<typename... Args> bool Send(Args&&... args)
         {
             while(true){
                 switch(auto nCurrState = m_State.exchange(CHANNSTATE_MODIFY)){
@@ -182,7 +184,7 @@ class Channel final
                             // do the send job
                             // this allows multiple user to send
                             // but the channel won't be released during any sending
-                            auto bSendDone = m_Session->Send(nHC, std::forward<Args>(args)...);
+                            auto bSendDone = m_Session->Send(std::forward<Args>(args)...);
 
                             // need to decrement the user count
                             // we know at least one sender is doning its work
@@ -3,7 +3,7 @@
  *
  *       Filename: charobject.cpp
  *        Created: 04/07/2016 03:48:41 AM
- *  Last Modified: 10/03/2017 10:42:12
+ *  Last Modified: 12/10/2017 22:48:31
  *
  *    Description: 
  *
@@ -29,6 +29,8 @@
 #include "protocoldef.hpp"
 #include "eventtaskhub.hpp"
 
+constexpr uint32_t CharObject::ClassTag;
+
 CharObject::CharObject(ServiceCore *pServiceCore,
         ServerMap                  *pServerMap,
         int                         nMapX,
@@ -125,6 +127,8 @@ void CharObject::DispatchAction(const ActionNode &rstAction)
         stAMA.AimX = rstAction.AimX;
         stAMA.AimY = rstAction.AimY;
 
+        stAMA.AimUID = rstAction.AimUID;
+
         m_ActorPod->Forward({MPK_ACTION, stAMA}, m_Map->GetAddress());
         return;
     }
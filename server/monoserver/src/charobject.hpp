@@ -3,7 +3,7 @@
  *
  *       Filename: charobject.hpp
  *        Created: 04/10/2016 12:05:22
- *  Last Modified: 09/26/2017 00:03:03
+ *  Last Modified: 11/19/2017 02:14:36
  *
  *    Description: 
  *
@@ -127,6 +127,15 @@ struct COLocation
 
 class CharObject: public ActiveObject
 {
+    public:
+        static constexpr uint32_t ClassTag = CLASSTAG_CHAROBJECT | ActiveObject::ClassTag;
+
+    public:
+        uint32_t GetClassTag() const
+        {
+            return CharObject::ClassTag;
+        }
+
     protected:
         enum QueryType: int
         {
@@ -3,7 +3,7 @@
  *
  *       Filename: dbconnection.hpp
  *        Created: 09/03/2015 03:49:00 AM
- *  Last Modified: 03/27/2017 13:18:52
+ *  Last Modified: 11/25/2017 01:06:57
  *
  *    Description: 
  *
@@ -56,4 +56,5 @@ class DBConnection
 
     public:
         friend class DBRecord;
+        friend class DBStatement;
 };
@@ -0,0 +1,135 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: dbpipeline.cpp
+ *        Created: 11/24/2017 16:02:45
+ *  Last Modified: 11/25/2017 01:06:57
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <mariadb/mysql.h>
+#include "dbpipeline.hpp"
+#include "monoserver.hpp"
+
+DBStatement *DBPipeline::DBWorker::Statement(const char *szSQL)
+{
+    auto &rstStatement = m_StatementMap[szSQL ? szSQL : ""];
+    if(!(rstStatement && rstStatement->Valid())){
+        rstStatement.reset(new DBStatement(m_Connection.get(), szSQL));
+    }
+    return rstStatement.get();
+}
+
+DBPipeline::~DBPipeline()
+{
+    {
+        std::lock_guard<std::mutex> stLockGuard(m_QueueLock);
+        m_Stop = true;
+    }
+    m_Condition.notify_all();
+
+    // pending jobs are all done before workers exit
+    for(auto &stWorker: m_WorkThreadV){
+        stWorker.join();
+    }
+}
+
+int DBPipeline::Launch(const char *szHostName, const char *szUserName,
+        const char *szPassword, const char *szDBName, unsigned int nPort, size_t nWorkerCount)
+{
+    if(false
+            || !szHostName
+            || !szUserName
+            || !szPassword
+            || !szDBName
+            || !nWorkerCount){
+        return 1;
+    }
+
+    {
+        std::lock_guard<std::mutex> stLockGuard(m_QueueLock);
+        if(!m_WorkThreadV.empty()){
+            return 1;
+        }
+    }
+
+    // create all connections before starting workers
+    // then a failed launch leaves no thread behind
+    std::vector<std::unique_ptr<DBConnection>> stConnectionV;
+    for(size_t nIndex = 0; nIndex < nWorkerCount; ++nIndex){
+        stConnectionV.emplace_back(new DBConnection(szHostName, szUserName, szPassword, szDBName, nPort));
+        if(!stConnectionV.back()->Valid()){
+            return 2;
+        }
+    }
+
+    std::lock_guard<std::mutex> stLockGuard(m_QueueLock);
+    for(auto &pConnection: stConnectionV){
+        m_WorkThreadV.emplace_back([this, pRawConnection = pConnection.release()]()
+        {
+            // client library needs per-thread init
+            // the connection is only used in this thread from now on
+            mysql_thread_init();
+            {
+                DBWorker stWorker(pRawConnection);
+                while(true){
+                    DBJob fnJob;
+                    {
+                        std::unique_lock<std::mutex> stUniqueLock(m_QueueLock);
+                        m_Condition.wait(stUniqueLock, [this](){ return m_Stop || !m_JobQ.empty(); });
+
+                        if(m_Stop && m_JobQ.empty()){
+                            break;
+                        }
+
+                        fnJob = std::move(m_JobQ.front());
+                        m_JobQ.pop();
+                    }
+
+                    if(fnJob){
+                        try{
+                            fnJob(stWorker);
+                        }catch(...){
+                            extern MonoServer *g_MonoServer;
+                            g_MonoServer->AddLog(LOGTYPE_WARNING, "Caught exception in database job");
+                        }
+                    }
+                }
+            }
+            mysql_thread_end();
+        });
+    }
+    return 0;
+}
+
+bool DBPipeline::Post(DBJob fnJob)
+{
+    if(!fnJob){
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> stLockGuard(m_QueueLock);
+        if(false
+                || m_Stop
+                || m_WorkThreadV.empty()
+                || m_JobQ.size() >= m_QueueSize){
+            return false;
+        }
+        m_JobQ.push(std::move(fnJob));
+    }
+
+    m_Condition.notify_one();
+    return true;
+}
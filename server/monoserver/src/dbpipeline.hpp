@@ -0,0 +1,143 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: dbpipeline.hpp
+ *        Created: 11/24/2017 15:32:11
+ *  Last Modified: 11/25/2017 01:06:57
+ *
+ *    Description: asynchronous database pipeline
+ *
+ *                 DBPodN hands out a connection to any thread asking for it, then the
+ *                 thread pool worker blocks on the round trip and DBRecord formats and
+ *                 parses the query as a string every time
+ *
+ *                 DBPipeline has its own worker threads, each worker owns one connection
+ *                 and caches the prepared statements used on it, actors post jobs to a
+ *                 bounded queue and return immediately, a job runs on one worker and sends
+ *                 the result back as an actor message by the worker's SyncDriver
+ *
+ *                      g_DBPipeline->Post([stAddr](DBPipeline::DBWorker &rstWorker)
+ *                      {
+ *                          auto pStmt = rstWorker.Statement("select ... where fld_id = ?");
+ *                          pStmt->BindInt(0, nID);
+ *                          if(pStmt->Execute() && pStmt->Fetch()){
+ *                              rstWorker.Forward({MPK_XXXX, stAMXXXX}, stAddr);
+ *                          }
+ *                      });
+ *
+ *                 Post() fails if the queue is full, caller should report it as a busy
+ *                 database rather than waiting
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <queue>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <condition_variable>
+
+#include "syncdriver.hpp"
+#include "dbstatement.hpp"
+#include "dbconnection.hpp"
+
+class DBPipeline final
+{
+    public:
+        class DBWorker final
+        {
+            private:
+                std::unique_ptr<DBConnection> m_Connection;
+
+            private:
+                // prepared statements on this connection
+                // key is the SQL string itself
+                std::unordered_map<std::string, std::unique_ptr<DBStatement>> m_StatementMap;
+
+            private:
+                SyncDriver m_SyncDriver;
+
+            public:
+                DBWorker(DBConnection *pConnection)
+                    : m_Connection(pConnection)
+                    , m_StatementMap()
+                    , m_SyncDriver()
+                {}
+
+               ~DBWorker()
+                {
+                    // statements refer to the connection
+                    // need to close them first
+                    m_StatementMap.clear();
+                }
+
+            public:
+                // never returns nullptr
+                // statement failed to prepare is not valid and prepared again in next call
+                DBStatement *Statement(const char *);
+
+            public:
+                bool Forward(const MessageBuf &rstMB, const Theron::Address &rstAddr)
+                {
+                    return m_SyncDriver.Forward(rstMB, rstAddr) == 0;
+                }
+        };
+
+    public:
+        using DBJob = std::function<void(DBWorker &)>;
+
+    private:
+        const size_t m_QueueSize;
+
+    private:
+        bool                     m_Stop;
+        std::mutex               m_QueueLock;
+        std::condition_variable  m_Condition;
+        std::queue<DBJob>        m_JobQ;
+        std::vector<std::thread> m_WorkThreadV;
+
+    public:
+        DBPipeline(size_t nQueueSize = 1024)
+            : m_QueueSize(nQueueSize ? nQueueSize : 1)
+            , m_Stop(false)
+            , m_QueueLock()
+            , m_Condition()
+            , m_JobQ()
+            , m_WorkThreadV()
+        {}
+
+       ~DBPipeline();
+
+    public:
+        // launch the db connection for each worker
+        // return value
+        //      0: OK
+        //      1: invalid argument
+        //      2: failed in connection
+        int Launch(const char *, const char *, const char *, const char *, unsigned int, size_t);
+
+    public:
+        // called by actor threads, never blocks on database
+        // return false if the queue is full or pipeline stopped
+        bool Post(DBJob);
+
+    public:
+        size_t Pending()
+        {
+            std::lock_guard<std::mutex> stLockGuard(m_QueueLock);
+            return m_JobQ.size();
+        }
+};
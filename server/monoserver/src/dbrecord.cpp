@@ -115,15 +115,15 @@ const char *DBRecord::Get(const char *szColumnName)
 {
     if(szColumnName && std::strlen(szColumnName)){
         if(m_CurrentRow){
-            mysql_field_seek(m_SQLRES, 0);
+            // scan the field array directly
+            // for hot queries use DBStatement which resolves column index only once
+            auto nFieldCount = (int)(mysql_num_fields(m_SQLRES));
+            auto pFieldV     = mysql_fetch_fields(m_SQLRES);
 
-            int nIndex = 0;
-            MYSQL_FIELD *pCurrField = nullptr;
-            while((pCurrField = mysql_fetch_field(m_SQLRES)) != nullptr){
-                if((pCurrField->name) && (!std::strcmp(pCurrField->name, szColumnName))){
+            for(int nIndex = 0; nIndex < nFieldCount; ++nIndex){
+                if((pFieldV[nIndex].name) && (!std::strcmp(pFieldV[nIndex].name, szColumnName))){
                     return m_CurrentRow[nIndex];
                 }
-                nIndex++;
             }
         }
     }
@@ -0,0 +1,324 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: dbstatement.cpp
+ *        Created: 11/24/2017 10:44:02
+ *  Last Modified: 11/25/2017 01:06:57
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <cstring>
+#include <algorithm>
+#include <mariadb/mysql.h>
+
+#include "dbstatement.hpp"
+#include "dbconnection.hpp"
+
+DBStatement::DBStatement(DBConnection *pConnection, const char *szSQL)
+    : m_Connection(pConnection)
+    , m_Stmt(nullptr)
+    , m_ParamBindV()
+    , m_ParamIntV()
+    , m_ParamStrV()
+    , m_ParamLenV()
+    , m_ResultBindV()
+    , m_ResultBufV()
+    , m_ResultLenV()
+    , m_ResultNullV()
+    , m_ColumnIndex()
+    , m_Valid(false)
+    , m_Stored(false)
+{
+    if(!(true
+                && m_Connection
+                && m_Connection->m_SQL
+                && m_Connection->Valid()
+                && szSQL
+                && std::strlen(szSQL))){
+        return;
+    }
+
+    if(!(m_Stmt = mysql_stmt_init(m_Connection->m_SQL))){
+        return;
+    }
+
+    if(mysql_stmt_prepare(m_Stmt, szSQL, std::strlen(szSQL))){
+        return;
+    }
+
+    // ask mysql_stmt_store_result() to update max_length
+    // then we know the buffer size for each column before fetching
+    my_bool bUpdateMaxLength = 1;
+    mysql_stmt_attr_set(m_Stmt, STMT_ATTR_UPDATE_MAX_LENGTH, &bUpdateMaxLength);
+
+    auto nParamCount = (size_t)(mysql_stmt_param_count(m_Stmt));
+    m_ParamBindV.resize(nParamCount);
+    m_ParamIntV .resize(nParamCount, 0);
+    m_ParamStrV .resize(nParamCount);
+    m_ParamLenV .resize(nParamCount, 0);
+
+    for(auto &rstBind: m_ParamBindV){
+        std::memset(&rstBind, 0, sizeof(rstBind));
+        rstBind.buffer_type = MYSQL_TYPE_NULL;
+    }
+
+    // statement without result set gives nullptr
+    // resolve column name -> index here only once
+    if(auto pMeta = mysql_stmt_result_metadata(m_Stmt)){
+        auto nColumnCount = (size_t)(mysql_num_fields(pMeta));
+        auto pFieldV      = mysql_fetch_fields(pMeta);
+
+        for(size_t nIndex = 0; nIndex < nColumnCount; ++nIndex){
+            if(pFieldV[nIndex].name){
+                m_ColumnIndex.emplace(pFieldV[nIndex].name, (int)(nIndex));
+            }
+        }
+
+        m_ResultBindV.resize(nColumnCount);
+        m_ResultBufV .resize(nColumnCount);
+        m_ResultLenV .resize(nColumnCount, 0);
+        m_ResultNullV.resize(nColumnCount, 0);
+
+        mysql_free_result(pMeta);
+    }
+
+    m_Valid = true;
+}
+
+DBStatement::~DBStatement()
+{
+    FreeResult();
+    if(m_Stmt){
+        mysql_stmt_close(m_Stmt);
+    }
+}
+
+bool DBStatement::BindInt(int nIndex, int64_t nValue)
+{
+    if(!(true
+                && m_Valid
+                && nIndex >= 0
+                && nIndex < (int)(m_ParamBindV.size()))){
+        return false;
+    }
+
+    m_ParamIntV[nIndex] = (long long)(nValue);
+
+    auto &rstBind = m_ParamBindV[nIndex];
+    std::memset(&rstBind, 0, sizeof(rstBind));
+
+    rstBind.buffer_type = MYSQL_TYPE_LONGLONG;
+    rstBind.buffer      = &(m_ParamIntV[nIndex]);
+    return true;
+}
+
+bool DBStatement::BindStr(int nIndex, const char *szValue)
+{
+    if(!(true
+                && m_Valid
+                && nIndex >= 0
+                && nIndex < (int)(m_ParamBindV.size()))){
+        return false;
+    }
+
+    auto &rstBind = m_ParamBindV[nIndex];
+    std::memset(&rstBind, 0, sizeof(rstBind));
+
+    if(szValue){
+        m_ParamStrV[nIndex] = szValue;
+        m_ParamLenV[nIndex] = (unsigned long)(m_ParamStrV[nIndex].size());
+
+        rstBind.buffer_type   = MYSQL_TYPE_STRING;
+        rstBind.buffer        = (void *)(m_ParamStrV[nIndex].data());
+        rstBind.buffer_length = m_ParamLenV[nIndex];
+        rstBind.length        = &(m_ParamLenV[nIndex]);
+    }else{
+        rstBind.buffer_type = MYSQL_TYPE_NULL;
+    }
+    return true;
+}
+
+bool DBStatement::Execute()
+{
+    if(!m_Valid){
+        return false;
+    }
+
+    FreeResult();
+
+    if(!m_ParamBindV.empty()){
+        if(mysql_stmt_bind_param(m_Stmt, m_ParamBindV.data())){
+            return false;
+        }
+    }
+
+    if(mysql_stmt_execute(m_Stmt)){
+        return false;
+    }
+
+    if(m_ResultBindV.empty()){
+        // not a select
+        return true;
+    }
+
+    if(mysql_stmt_store_result(m_Stmt)){
+        return false;
+    }
+
+    m_Stored = true;
+
+    // size the buffer by this result set
+    // field length is the declared width, take it as a hint for numeric columns
+    if(auto pMeta = mysql_stmt_result_metadata(m_Stmt)){
+        auto pFieldV = mysql_fetch_fields(pMeta);
+        for(size_t nIndex = 0; nIndex < m_ResultBufV.size(); ++nIndex){
+            auto nBufLen = std::max<size_t>({(size_t)(pFieldV[nIndex].max_length), std::min<size_t>((size_t)(pFieldV[nIndex].length), 1024), 64}) + 1;
+            if(m_ResultBufV[nIndex].size() < nBufLen){
+                m_ResultBufV[nIndex].resize(nBufLen);
+            }
+        }
+        mysql_free_result(pMeta);
+    }
+
+    return BindResult();
+}
+
+bool DBStatement::BindResult()
+{
+    for(size_t nIndex = 0; nIndex < m_ResultBindV.size(); ++nIndex){
+        if(m_ResultBufV[nIndex].empty()){
+            m_ResultBufV[nIndex].resize(64 + 1);
+        }
+
+        auto &rstBind = m_ResultBindV[nIndex];
+        std::memset(&rstBind, 0, sizeof(rstBind));
+
+        // reserve one byte for the tailing zero
+        rstBind.buffer_type   = MYSQL_TYPE_STRING;
+        rstBind.buffer        = m_ResultBufV[nIndex].data();
+        rstBind.buffer_length = (unsigned long)(m_ResultBufV[nIndex].size() - 1);
+        rstBind.length        = &(m_ResultLenV[nIndex]);
+        rstBind.is_null       = &(m_ResultNullV[nIndex]);
+    }
+    return !mysql_stmt_bind_result(m_Stmt, m_ResultBindV.data());
+}
+
+bool DBStatement::Fetch()
+{
+    if(!m_Stored){
+        return false;
+    }
+
+    switch(mysql_stmt_fetch(m_Stmt)){
+        case 0:
+            {
+                break;
+            }
+        case MYSQL_DATA_TRUNCATED:
+            {
+                // buffer size is only a guess for some columns
+                // grow the truncated ones and fetch them again
+                for(size_t nIndex = 0; nIndex < m_ResultBindV.size(); ++nIndex){
+                    if(true
+                            && !m_ResultNullV[nIndex]
+                            && m_ResultLenV[nIndex] >= m_ResultBufV[nIndex].size()){
+
+                        m_ResultBufV[nIndex].resize(m_ResultLenV[nIndex] + 1);
+
+                        auto stBind = m_ResultBindV[nIndex];
+                        stBind.buffer        = m_ResultBufV[nIndex].data();
+                        stBind.buffer_length = (unsigned long)(m_ResultBufV[nIndex].size() - 1);
+
+                        if(mysql_stmt_fetch_column(m_Stmt, &stBind, (unsigned int)(nIndex), 0)){
+                            return false;
+                        }
+                    }
+                }
+
+                // buffers may be re-allocated
+                if(!BindResult()){
+                    return false;
+                }
+                break;
+            }
+        default:
+            {
+                // MYSQL_NO_DATA or error
+                return false;
+            }
+    }
+
+    for(size_t nIndex = 0; nIndex < m_ResultBufV.size(); ++nIndex){
+        if(!m_ResultNullV[nIndex]){
+            m_ResultBufV[nIndex][std::min<size_t>(m_ResultLenV[nIndex], m_ResultBufV[nIndex].size() - 1)] = '\0';
+        }
+    }
+    return true;
+}
+
+int DBStatement::RowCount()
+{
+    // only call this function after ``select"
+    if(m_Stored){
+        return (int)(mysql_stmt_num_rows(m_Stmt));
+    }
+    return m_Valid ? 0 : -1;
+}
+
+int DBStatement::Column(const char *szColumnName) const
+{
+    if(szColumnName){
+        auto pColumn = m_ColumnIndex.find(szColumnName);
+        if(pColumn != m_ColumnIndex.end()){
+            return pColumn->second;
+        }
+    }
+    return -1;
+}
+
+const char *DBStatement::Get(int nColumn) const
+{
+    if(true
+            && m_Stored
+            && nColumn >= 0
+            && nColumn < (int)(m_ResultBufV.size())
+            && !m_ResultNullV[nColumn]){
+        return m_ResultBufV[nColumn].data();
+    }
+    return nullptr;
+}
+
+void DBStatement::FreeResult()
+{
+    if(m_Stored){
+        mysql_stmt_free_result(m_Stmt);
+        m_Stored = false;
+    }
+}
+
+int DBStatement::ErrorID()
+{
+    if(m_Stmt){
+        return (int)(mysql_stmt_errno(m_Stmt));
+    }
+    return m_Connection ? m_Connection->ErrorID() : -2;
+}
+
+const char *DBStatement::ErrorInfo()
+{
+    if(m_Stmt){
+        return mysql_stmt_error(m_Stmt);
+    }
+    return m_Connection ? m_Connection->ErrorInfo() : "null connection pointer in current statement";
+}
@@ -0,0 +1,111 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: dbstatement.hpp
+ *        Created: 11/24/2017 10:18:40
+ *  Last Modified: 11/25/2017 01:06:57
+ *
+ *    Description: prepared statement on one DBConnection
+ *
+ *                 DBRecord::Execute() formats the whole query by vsnprintf every time
+ *                 and server parses it again, also arguments are put into the query
+ *                 directly without escaping
+ *
+ *                 DBStatement is prepared only once, arguments are bound by type and
+ *                 sent in binary, column name -> index is resolved when preparing, so
+ *                 Get(column_name) is a hash lookup rather than a strcmp scan
+ *
+ *                 all columns are fetched as null-terminated strings to keep the same
+ *                 interface as DBRecord, NULL value gives nullptr
+ *
+ *                 not thread-safe, used by the thread owning the connection
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <mariadb/mysql.h>
+
+class DBConnection;
+class DBStatement final
+{
+    private:
+        DBConnection *m_Connection;
+        MYSQL_STMT   *m_Stmt;
+
+    private:
+        // parameters, size fixed when preparing
+        // then MYSQL_BIND can refer to the value slot
+        std::vector<MYSQL_BIND>    m_ParamBindV;
+        std::vector<long long>     m_ParamIntV;
+        std::vector<std::string>   m_ParamStrV;
+        std::vector<unsigned long> m_ParamLenV;
+
+    private:
+        // result set, one buffer per column
+        // buffers grow by max_length of each result set
+        std::vector<MYSQL_BIND>        m_ResultBindV;
+        std::vector<std::vector<char>> m_ResultBufV;
+        std::vector<unsigned long>     m_ResultLenV;
+        std::vector<my_bool>           m_ResultNullV;
+
+    private:
+        std::unordered_map<std::string, int> m_ColumnIndex;
+
+    private:
+        bool m_Valid;
+        bool m_Stored;
+
+    public:
+        DBStatement(DBConnection *, const char *);
+       ~DBStatement();
+
+    public:
+        bool Valid() const
+        {
+            return m_Valid;
+        }
+
+    public:
+        // parameter index starts from 0
+        // bound value is kept till next bind at the same index
+        bool BindInt(int, int64_t);
+        bool BindStr(int, const char *);
+
+    public:
+        bool Execute();
+        bool Fetch();
+        int  RowCount();
+
+    public:
+        // column index of given name
+        // resolved once when preparing, -1 if not found
+        int Column(const char *) const;
+
+    public:
+        const char *Get(int) const;
+        const char *Get(const char *szColumnName) const
+        {
+            return Get(Column(szColumnName));
+        }
+
+    public:
+        int ErrorID();
+        const char *ErrorInfo();
+
+    private:
+        void FreeResult();
+        bool BindResult();
+};
@@ -3,7 +3,7 @@
  *
  *       Filename: main.cpp
  *        Created: 08/31/2015 08:52:57 PM
- *  Last Modified: 09/05/2017 13:04:52
+ *  Last Modified: 12/08/2017 23:12:09
  *
  *    Description: 
  *
@@ -18,10 +18,12 @@
  * =====================================================================================
  */
 #include <ctime>
+#include <algorithm>
 #include <asio.hpp>
 
 #include "log.hpp"
 #include "dbpod.hpp"
+#include "dbpipeline.hpp"
 #include "netpod.hpp"
 #include "taskhub.hpp"
 #include "memorypn.hpp"
@@ -31,6 +33,8 @@
 #include "serverenv.hpp"
 #include "mainwindow.hpp"
 #include "eventtaskhub.hpp"
+#include "actormetrics.hpp"
+#include "pathfindservice.hpp"
 #include "scriptwindow.hpp"
 #include "serverconfigurewindow.hpp"
 #include "databaseconfigurewindow.hpp"
@@ -40,11 +44,14 @@ ServerEnv                *g_ServerEnv;
 TaskHub                  *g_TaskHub;
 MemoryPN                 *g_MemoryPN;
 EventTaskHub             *g_EventTaskHub;
+ActorMetrics             *g_ActorMetrics;
 Theron::EndPoint         *g_EndPoint;
 Theron::Framework        *g_Framework;
 ThreadPN                 *g_ThreadPN;
 NetPodN                  *g_NetPodN;
 DBPodN                   *g_DBPodN;
+DBPipeline               *g_DBPipeline;
+PathFindService          *g_PathFindService;
 
 MapBinDBN                *g_MapBinDBN;
 ScriptWindow             *g_ScriptWindow;
@@ -72,12 +79,22 @@ int main()
     g_ServerConfigureWindow   = new ServerConfigureWindow();
     g_DatabaseConfigureWindow = new DatabaseConfigureWindow();
     g_EventTaskHub            = new EventTaskHub();
+    g_ActorMetrics            = new ActorMetrics();
     g_EndPoint                = new Theron::EndPoint("monoserver", "tcp://127.0.0.1:5556");
     g_Framework               = new Theron::Framework(*g_EndPoint);
     g_ThreadPN                = new ThreadPN(4);
     g_DBPodN                  = new DBPodN();
+    g_DBPipeline              = new DBPipeline((size_t)(std::max<int>(g_ServerEnv->MIR2X_CONFIG_DB_QUEUE, 1)));
+    g_PathFindService         = new PathFindService(
+            (size_t)(std::max<int>(g_ServerEnv->MIR2X_CONFIG_PATHFIND_WORKER, 1)),
+            (size_t)(std::max<int>(g_ServerEnv->MIR2X_CONFIG_PATHFIND_QUEUE,  1)),
+            (uint32_t)(std::max<int>(g_ServerEnv->MIR2X_CONFIG_PATHFIND_CACHE, 0)));
     g_NetPodN                 = new NetPodN();
 
+    // set before any actor starts
+    // then hot path debug logs cost nothing by default
+    Log::SetLevel(g_ServerEnv->MIR2X_CONFIG_LOG_LEVEL);
+
     g_MainWindow->ShowAll();
 
     while(Fl::wait() > 0){
@@ -3,7 +3,7 @@
  *
  *       Filename: messagebuf.hpp
  *        Created: 05/03/2016 13:14:40
- *  Last Modified: 06/05/2016 21:48:52
+ *  Last Modified: 11/23/2017 17:41:08
  *
  *    Description: used to shorten the argument list, so keep it simple
  *                 MessageBuf won't maintain the validation of the pointer
@@ -21,6 +21,7 @@
 
 #pragma once
 #include <cstdint>
+#include "messagepayload.hpp"
 
 class MessageBuf
 {
@@ -29,6 +30,11 @@ class MessageBuf
         const uint8_t *m_Data;
         size_t         m_DataLen;
 
+    private:
+        // if not null the message shares this payload
+        // instead of making a copy of [m_Data, m_Data + m_DataLen)
+        const MessagePayload *m_Payload;
+
     public:
         // message descriptor without body
         MessageBuf(int nMessageType)
@@ -41,6 +47,16 @@ class MessageBuf
             : m_Type(nMessageType)
             , m_Data(pData)
             , m_DataLen(nDataLen)
+            , m_Payload(nullptr)
+        {}
+
+        // message descriptor with a shared payload
+        // used to forward one payload to many actors without copy
+        MessageBuf(int nMessageType, const MessagePayload &rstPayload)
+            : m_Type(nMessageType)
+            , m_Data(rstPayload.Data())
+            , m_DataLen(rstPayload.DataLen())
+            , m_Payload(rstPayload ? &rstPayload : nullptr)
         {}
 
         // actually you can put a pointer here
@@ -75,6 +91,11 @@ class MessageBuf
             return DataLen();
         }
 
+        const MessagePayload *Payload() const
+        {
+            return m_Payload;
+        }
+
     public:
         int Type()
         {
@@ -3,7 +3,7 @@
  *
  *       Filename: messagepack.hpp
  *        Created: 04/20/2016 21:57:08
- *  Last Modified: 10/06/2017 00:06:15
+ *  Last Modified: 12/10/2017 22:48:31
  *
  *    Description: message class for actor system
  *
@@ -90,6 +90,7 @@
  */
 
 #pragma once
+#include <chrono>
 #include <cstring>
 #include <cstdint>
 #include <utility>
@@ -97,6 +98,7 @@
 
 #include "messagebuf.hpp"
 #include "actormessage.hpp"
+#include "messagepayload.hpp"
 
 template<size_t SBufSize = 64>
 class InnMessagePack final
@@ -108,13 +110,19 @@ class InnMessagePack final
         uint32_t m_ID;
         uint32_t m_Respond;
 
+    private:
+        // steady clock in nanoseconds when it's created
+        // copies keep it, then receiver gets the queue wait time
+        uint64_t m_SendTime;
+
     private:
         uint8_t  m_SBuf[SBufSize];
         size_t   m_SBufUsedLen;
 
     private:
-        uint8_t *m_DBuf;
-        size_t   m_DBufLen;
+        // for message longer than SBufSize
+        // copy of MessagePack shares this block rather than a deep copy
+        MessagePayload m_Payload;
 
     public:
         // since we make sender to accept only MessageBuf
@@ -127,95 +135,75 @@ class InnMessagePack final
             : m_Type(nType)
             , m_ID(nID)
             , m_Respond(nRespond)
+            , m_SendTime(CurrTime())
+            , m_SBufUsedLen(0)
+            , m_Payload()
         {
             if(pData && nDataLen){
                 if(nDataLen <= SBufSize){
                     m_SBufUsedLen = nDataLen;
                     std::memcpy(m_SBuf, pData, nDataLen);
-
-                    m_DBuf = nullptr;
-                    m_DBufLen = 0;
                 }else{
-                    m_DBuf = new uint8_t[nDataLen];
-                    m_DBufLen = nDataLen;
-                    std::memcpy(m_DBuf, pData, nDataLen);
-
-                    m_SBufUsedLen = 0;
+                    m_Payload = MessagePayload(pData, nDataLen);
                 }
-            }else{
-                m_DBuf = nullptr;
-                m_DBufLen = 0;
-
-                m_SBufUsedLen = 0;
             }
         }
 
         InnMessagePack(const MessageBuf &rstMB, uint32_t nID = 0, uint32_t nRespond = 0)
-            : InnMessagePack(rstMB.Type(), rstMB.Data(), rstMB.DataLen(), nID, nRespond)
-        {}
+            : InnMessagePack(rstMB.Type(),
+                    rstMB.Payload() ? nullptr : rstMB.Data(),
+                    rstMB.Payload() ? 0       : rstMB.DataLen(), nID, nRespond)
+        {
+            // share the payload, no copy
+            if(rstMB.Payload()){
+                m_Payload = *(rstMB.Payload());
+            }
+        }
 
         InnMessagePack(InnMessagePack &&rstMPK)
             : m_Type(rstMPK.Type())
             , m_ID(rstMPK.ID())
             , m_Respond(rstMPK.Respond())
+            , m_SendTime(rstMPK.SendTime())
+            , m_SBufUsedLen(rstMPK.m_SBufUsedLen)
+            , m_Payload(std::move(rstMPK.m_Payload))
         {
-            // case-1: use dynamic buffer, steal the buffer
-            //         after this call rstMPK will be invalid
-            if(rstMPK.m_DBuf && rstMPK.m_DBufLen){
-                m_DBuf = rstMPK.m_DBuf;
-                m_DBufLen = rstMPK.m_DBufLen;
-
-                m_SBufUsedLen = 0;
-
-                rstMPK.m_DBuf = nullptr;
-                rstMPK.m_DBufLen = 0;
-                return;
-            }
-
-            // case-1: use static buffer, copy only
-            //         but after this call I make rstMPK invalid
-            if(rstMPK.m_SBufUsedLen){
-                m_SBufUsedLen = rstMPK.m_SBufUsedLen;
+            // static buffer can only be copied
+            // but after this call I make rstMPK invalid
+            if(m_SBufUsedLen){
                 std::memcpy(m_SBuf, rstMPK.m_SBuf, m_SBufUsedLen);
-
-                m_DBuf = nullptr;
-                m_DBufLen = 0;
-
                 rstMPK.m_SBufUsedLen = 0;
-                return;
-            }
-
-            // case-3: empty message
-            //         shouldn't happen here
-            {
-                m_SBufUsedLen = 0;
-
-                m_DBuf = nullptr;
-                m_DBufLen = 0;
-                return;
             }
         }
 
         InnMessagePack(const InnMessagePack &rstMPK)
-            : InnMessagePack(rstMPK.Type(), rstMPK.Data(), rstMPK.DataLen(), rstMPK.ID(), rstMPK.Respond())
-        {}
-
-    public:
-       ~InnMessagePack()
+            : m_Type(rstMPK.Type())
+            , m_ID(rstMPK.ID())
+            , m_Respond(rstMPK.Respond())
+            , m_SendTime(rstMPK.SendTime())
+            , m_SBufUsedLen(rstMPK.m_SBufUsedLen)
+            , m_Payload(rstMPK.m_Payload)
         {
-            delete [] m_DBuf;
+            // Theron copies the message when sending
+            // for long message it's only a ref-count increment
+            if(m_SBufUsedLen){
+                std::memcpy(m_SBuf, rstMPK.m_SBuf, m_SBufUsedLen);
+            }
         }
 
+    public:
+       ~InnMessagePack() = default;
+
     public:
        InnMessagePack &operator = (InnMessagePack stMPK)
        {
            std::swap(m_Type         , stMPK.m_Type       );
            std::swap(m_ID           , stMPK.m_ID         );
            std::swap(m_Respond      , stMPK.m_Respond    );
+           std::swap(m_SendTime     , stMPK.m_SendTime   );
 
            std::swap(m_SBufUsedLen  , stMPK.m_SBufUsedLen);
-           std::swap(m_DBuf         , stMPK.m_DBuf       );
-           std::swap(m_DBufLen      , stMPK.m_DBufLen    );
+           std::swap(m_Payload      , stMPK.m_Payload    );
 
            if(m_SBufUsedLen){
                std::memcpy(m_SBuf, stMPK.m_SBuf, m_SBufUsedLen);
@@ -232,12 +220,17 @@ class InnMessagePack final
 
         const uint8_t *Data() const
         {
-            return m_SBufUsedLen ? m_SBuf : m_DBuf;
+            return m_SBufUsedLen ? m_SBuf : m_Payload.Data();
         }
 
         size_t DataLen() const
         {
-            return m_SBufUsedLen ? m_SBufUsedLen : m_DBufLen;
+            return m_SBufUsedLen ? m_SBufUsedLen : m_Payload.DataLen();
+        }
+
+        const MessagePayload &Payload() const
+        {
+            return m_Payload;
         }
 
         size_t Size() const
@@ -255,6 +248,17 @@ class InnMessagePack final
             return m_ID;
         }
 
+        uint64_t SendTime() const
+        {
+            return m_SendTime;
+        }
+
+    public:
+        static uint64_t CurrTime()
+        {
+            return (uint64_t)(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
         const char *Name() const
         {
             switch(m_Type){
@@ -268,6 +272,7 @@ class InnMessagePack final
                 case MPK_PING                : return "MPK_PING";
                 case MPK_LOGIN               : return "MPK_LOGIN";
                 case MPK_METRONOME           : return "MPK_METRONOME";
+                case MPK_WAKEUP              : return "MPK_WAKEUP";
                 case MPK_TRYMOVE             : return "MPK_TRYMOVE";
                 case MPK_MOVEOK              : return "MPK_MOVEOK";
                 case MPK_TRYLEAVE            : return "MPK_TRYLEAVE";
@@ -304,6 +309,7 @@ class InnMessagePack final
                 case MPK_SHOWDROPITEM        : return "MPK_SHOWDROPITEM";
                 case MPK_NOTIFYDEAD          : return "MPK_NOTIFYDEAD";
                 case MPK_OFFLINE             : return "MPK_OFFLINE";
+                case MPK_AIINTENT            : return "MPK_AIINTENT";
                 default                      : return "MPK_UNKNOWN";
             }
         }
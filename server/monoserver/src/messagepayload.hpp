@@ -0,0 +1,147 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: messagepayload.hpp
+ *        Created: 11/23/2017 11:05:27
+ *  Last Modified: 12/17/2017 21:48:51
+ *
+ *    Description: immutable payload block for MessagePack, intrusively ref-counted
+ *
+ *                 MessagePack copies its payload in constructor, and Theron makes one
+ *                 more copy of the MessagePack when sending, then a message bigger than
+ *                 the small buffer costs two new[] and memcpy per hop
+ *
+ *                 MessagePayload allocates the block from g_MemoryPN with the counter
+ *                 in its head, copy of it only increases the counter, the block is freed
+ *                 when the last reference is gone, in any thread
+ *
+ *                 to share one payload among many messages, build it once and pass it by
+ *                 MessageBuf(MessageType, MessagePayload), data in the block can't be
+ *                 changed after construction
+ *
+ *                 only do it for message bigger than the small buffer, a small one passed
+ *                 by value is copied into the small buffer without allocation, but passed
+ *                 as MessagePayload it always takes a block from the pool
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <new>
+#include <atomic>
+#include <cstring>
+#include <cstdint>
+#include <utility>
+#include <type_traits>
+#include "memorypn.hpp"
+
+class MessagePayload final
+{
+    private:
+        // data follows the head directly
+        // head is 16 bytes then data is aligned as the memory pool chunk
+        struct PayloadHead
+        {
+            std::atomic<int> RefCount;
+            size_t           DataLen;
+
+            PayloadHead(size_t nDataLen)
+                : RefCount(1)
+                , DataLen(nDataLen)
+            {}
+        };
+
+    private:
+        PayloadHead *m_Head;
+
+    public:
+        MessagePayload()
+            : m_Head(nullptr)
+        {}
+
+        MessagePayload(const uint8_t *pData, size_t nDataLen)
+            : m_Head(nullptr)
+        {
+            if(pData && nDataLen){
+                extern MemoryPN *g_MemoryPN;
+                m_Head = new (g_MemoryPN->Get(sizeof(PayloadHead) + nDataLen)) PayloadHead(nDataLen);
+                std::memcpy((uint8_t *)(m_Head + 1), pData, nDataLen);
+            }
+        }
+
+        template<typename T> explicit MessagePayload(const T &rstPOD)
+            : MessagePayload((const uint8_t *)(&rstPOD), sizeof(rstPOD))
+        {
+            static_assert(std::is_pod<T>::value, "POD data type supported only");
+        }
+
+        MessagePayload(const MessagePayload &rstPayload)
+            : m_Head(rstPayload.m_Head)
+        {
+            if(m_Head){
+                m_Head->RefCount.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        MessagePayload(MessagePayload &&rstPayload)
+            : m_Head(rstPayload.m_Head)
+        {
+            rstPayload.m_Head = nullptr;
+        }
+
+    public:
+        ~MessagePayload()
+        {
+            Release();
+        }
+
+    public:
+        MessagePayload &operator = (MessagePayload stPayload)
+        {
+            std::swap(m_Head, stPayload.m_Head);
+            return *this;
+        }
+
+    public:
+        explicit operator bool () const
+        {
+            return m_Head != nullptr;
+        }
+
+        const uint8_t *Data() const
+        {
+            return m_Head ? (const uint8_t *)(m_Head + 1) : nullptr;
+        }
+
+        size_t DataLen() const
+        {
+            return m_Head ? m_Head->DataLen : 0;
+        }
+
+        int RefCount() const
+        {
+            return m_Head ? m_Head->RefCount.load(std::memory_order_relaxed) : 0;
+        }
+
+    private:
+        void Release()
+        {
+            // the last one frees the block
+            // acq_rel makes all reads by other owners done before free
+            if(m_Head && (m_Head->RefCount.fetch_sub(1, std::memory_order_acq_rel) == 1)){
+                m_Head->~PayloadHead();
+
+                extern MemoryPN *g_MemoryPN;
+                g_MemoryPN->Free(m_Head);
+            }
+            m_Head = nullptr;
+        }
+};
@@ -3,7 +3,7 @@
  *
  *       Filename: monoserver.cpp
  *        Created: 08/31/2015 10:45:48 PM
- *  Last Modified: 09/23/2017 22:57:45
+ *  Last Modified: 12/17/2017 21:10:32
  *
  *    Description: 
  *
@@ -18,6 +18,7 @@
  * =====================================================================================
  */
 #include <thread>
+#include <algorithm>
 #include <chrono>
 #include <vector>
 #include <string>
@@ -29,6 +30,8 @@
 
 #include "log.hpp"
 #include "dbpod.hpp"
+#include "serverenv.hpp"
+#include "dbpipeline.hpp"
 #include "taskhub.hpp"
 #include "message.hpp"
 #include "monster.hpp"
@@ -39,6 +42,7 @@
 #include "mainwindow.hpp"
 #include "monoserver.hpp"
 #include "servicecore.hpp"
+#include "actormetrics.hpp"
 #include "eventtaskhub.hpp"
 #include "commandwindow.hpp"
 #include "databaseconfigurewindow.hpp"
@@ -47,37 +51,59 @@ MonoServer::MonoServer()
     : m_LogLock()
     , m_LogBuf()
     , m_ServiceCore(nullptr)
-    , m_GlobalUID {1}
-    , m_UIDArray()
+    , m_UIDLock()
+    , m_UIDSlotCount(1)
+    , m_UIDFreeQ()
+    , m_UIDChunkV()
     , m_StartTime(std::chrono::system_clock::now())
-{}
+{
+    // slot 0 is reserved
+    // then UID as zero is always invalid
+    for(auto &rstChunk: m_UIDChunkV){
+        rstChunk.store(nullptr);
+    }
 
-void MonoServer::AddLog(const std::array<std::string, 4> &stLogDesc, const char *szLogFormat, ...)
+    // debug logs only go to the log file
+    // others are also shown in the gui browser
+    extern Log *g_Log;
+    g_Log->SetSink([this](int nLogType, const char *szLogInfo)
+    {
+        if(nLogType != Log::LOGTYPEV_DEBUG){
+            {
+                std::lock_guard<std::mutex> stLockGuard(m_LogLock);
+                m_LogBuf.push_back((char)(nLogType));
+                m_LogBuf.insert(m_LogBuf.end(), szLogInfo, szLogInfo + std::strlen(szLogInfo) + 1);
+            }
+            NotifyGUI("FlushBrowser");
+        }
+    });
+}
+
+MonoServer::~MonoServer()
 {
-    int nLogSize = 0;
-    int nLogType = std::atoi(stLogDesc[0].c_str());
+    extern Log *g_Log;
+    g_Log->SetSink(nullptr);
+
+    for(auto &rstChunk: m_UIDChunkV){
+        delete [] rstChunk.exchange(nullptr);
+    }
+}
 
-    auto fnRecordLog = [this, &stLogDesc](int nLogType, const char *szLogInfo)
+void MonoServer::AddLog(const Log::LogSite &rstSite, const char *szLogFormat, ...)
+{
+    // checked before formatting
+    // disabled log costs nothing more than the call
+    if(!Log::Enabled(rstSite.Level)){
+        return;
+    }
+
+    int nLogSize = 0;
+    auto fnRecordLog = [&rstSite](int nLogType, const char *szLogInfo)
     {
+        // gui browser is fed by the log sink
+        // which runs in the writer thread of g_Log
         extern Log *g_Log;
-        switch(nLogType){
-            case Log::LOGTYPEV_DEBUG:
-                {
-                    g_Log->AddLog(stLogDesc, szLogInfo);
-                    break;
-                }
-            default:
-                {
-                    g_Log->AddLog(stLogDesc, szLogInfo);
-                    {
-                        std::lock_guard<std::mutex> stLockGuard(m_LogLock);
-                        m_LogBuf.push_back((char)(nLogType));
-                        m_LogBuf.insert(m_LogBuf.end(), szLogInfo, szLogInfo + std::strlen(szLogInfo) + 1);
-                    }
-                    NotifyGUI("FlushBrowser");
-                    break;
-                }
-        }
+        g_Log->AddLog({nLogType, rstSite.File, rstSite.Line, rstSite.Function}, szLogInfo);
     };
 
     // 1. try static buffer
@@ -92,7 +118,7 @@ void MonoServer::AddLog(const std::array<std::string, 4> &stLogDesc, const char
 
         if(nLogSize >= 0){
             if((size_t)(nLogSize + 1) < (sizeof(szSBuf) / sizeof(szSBuf[0]))){
-                fnRecordLog(nLogType, szSBuf);
+                fnRecordLog(rstSite.Level, szSBuf);
                 return;
             }else{
                 // do nothing
@@ -116,7 +142,7 @@ void MonoServer::AddLog(const std::array<std::string, 4> &stLogDesc, const char
 
         if(nLogSize >= 0){
             if((size_t)(nLogSize + 1) < szDBuf.size()){
-                fnRecordLog(nLogType, &(szDBuf[0]));
+                fnRecordLog(rstSite.Level, &(szDBuf[0]));
                 return;
             }else{
                 szDBuf.resize(nLogSize + 1 + 64);
@@ -223,6 +249,22 @@ void MonoServer::CreateDBConnection()
                 g_DatabaseConfigureWindow->DatabaseIP(),
                 g_DatabaseConfigureWindow->DatabasePort());
     }
+
+    extern ServerEnv *g_ServerEnv;
+    extern DBPipeline *g_DBPipeline;
+
+    if(g_DBPipeline->Launch(
+            g_DatabaseConfigureWindow->DatabaseIP(),
+            g_DatabaseConfigureWindow->UserName(),
+            g_DatabaseConfigureWindow->Password(),
+            g_DatabaseConfigureWindow->DatabaseName(),
+            g_DatabaseConfigureWindow->DatabasePort(),
+            (size_t)(std::max<int>(g_ServerEnv->MIR2X_CONFIG_DB_WORKER, 1)))){
+        AddLog(LOGTYPE_WARNING, "DBPipeline can't connect to Database (%s:%d)", 
+                g_DatabaseConfigureWindow->DatabaseIP(),
+                g_DatabaseConfigureWindow->DatabasePort());
+        Restart();
+    }
 }
 
 void MonoServer::RegisterAMFallbackHandler()
@@ -257,10 +299,21 @@ void MonoServer::LoadMapBinDBN()
     extern ServerConfigureWindow *g_ServerConfigureWindow;
     std::string szMapPath = g_ServerConfigureWindow->GetMapPath();
 
+    // prefer uncompressed pack next to the zip
+    // it's mmap-ed and no decompression when loading map
+    std::vector<std::string> stMapPathV {szMapPath};
+    if(szMapPath.size() > 4 && !szMapPath.compare(szMapPath.size() - 4, 4, ".ZIP")){
+        stMapPathV.insert(stMapPathV.begin(), szMapPath.substr(0, szMapPath.size() - 4) + ".PAK");
+    }
+
     extern MapBinDBN *g_MapBinDBN;
-    if(!g_MapBinDBN->Load(szMapPath.c_str())){
-        AddLog(LOGTYPE_FATAL, "Failed to load mapbindbn");
+    for(auto &szPath: stMapPathV){
+        if(g_MapBinDBN->Load(szPath.c_str())){
+            AddLog(LOGTYPE_INFO, "Load mapbindbn: %s", szPath.c_str());
+            return;
+        }
     }
+    AddLog(LOGTYPE_FATAL, "Failed to load mapbindbn");
 }
 
 void MonoServer::CreateServiceCore()
@@ -295,6 +348,10 @@ void MonoServer::Launch()
 
     extern EventTaskHub *g_EventTaskHub;
     g_EventTaskHub->Launch();
+
+    extern ServerEnv *g_ServerEnv;
+    extern ActorMetrics *g_ActorMetrics;
+    g_ActorMetrics->Launch((uint32_t)(std::max<int>(g_ServerEnv->MIR2X_CONFIG_METRICS_DUMP, 0)));
 }
 
 void MonoServer::Restart()
@@ -695,25 +752,88 @@ void MonoServer::FlushCWBrowser()
     }
 }
 
+MonoServer::UIDSlotRecord *MonoServer::UIDSlot(uint32_t nUID)
+{
+    auto nSlot  = UIDSlotIndex(nUID);
+    auto pChunk = m_UIDChunkV[nSlot >> UIDCHUNK_BITS].load(std::memory_order_acquire);
+
+    return pChunk ? (pChunk + (nSlot & ((1 << UIDCHUNK_BITS) - 1))) : nullptr;
+}
+
+void MonoServer::WriteUIDSlot(UIDSlotRecord *pSlot, uint32_t nUID, const ServerObject *pObject)
+{
+    // only called with m_UIDLock
+    // mark the slot as writing before touching any field
+
+    auto nSequence = pSlot->Sequence.load(std::memory_order_relaxed);
+    pSlot->Sequence.store(nSequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    if(pObject){
+        auto bActive = pObject->ClassFrom<ActiveObject>();
+
+        pSlot->UID       .store(nUID, std::memory_order_relaxed);
+        pSlot->ClassTag  .store(pObject->GetClassTag(), std::memory_order_relaxed);
+        pSlot->Desp      .Store(pObject->GetInvarData());
+        pSlot->Address   .Store(bActive ? ((const ActiveObject *)(pObject))->GetAddress() : Theron::Address::Null());
+        pSlot->ClassEntry.store(&(pObject->ClassEntry()), std::memory_order_relaxed);
+    }else{
+        pSlot->UID       .store(0, std::memory_order_relaxed);
+        pSlot->ClassTag  .store(0, std::memory_order_relaxed);
+        pSlot->Desp      .Store(InvarData());
+        pSlot->Address   .Store(Theron::Address::Null());
+        pSlot->ClassEntry.store(nullptr, std::memory_order_relaxed);
+    }
+
+    pSlot->Sequence.store(nSequence + 2, std::memory_order_release);
+}
+
 uint32_t MonoServer::GetUID()
 {
-    return m_GlobalUID.fetch_add(1);
+    std::lock_guard<std::mutex> stLockGuard(m_UIDLock);
+
+    // reuse a free slot only if there are enough of them
+    // this delays the reuse and makes a slot reach UIDGEN_MAX slower
+
+    uint32_t nSlot = 0;
+    if(true
+            && !m_UIDFreeQ.empty()
+            && (m_UIDFreeQ.size() >= 1024 || m_UIDSlotCount >= (1 << UIDSLOT_BITS))){
+        nSlot = m_UIDFreeQ.front();
+        m_UIDFreeQ.pop_front();
+    }else if(m_UIDSlotCount < (1 << UIDSLOT_BITS)){
+        nSlot = m_UIDSlotCount++;
+        auto &rstChunk = m_UIDChunkV[nSlot >> UIDCHUNK_BITS];
+        if(!rstChunk.load(std::memory_order_relaxed)){
+            rstChunk.store(new UIDSlotRecord[1 << UIDCHUNK_BITS], std::memory_order_release);
+        }
+    }else{
+        AddLog(LOGTYPE_FATAL, "No free slot for UID, object count exceeds: %d", (int)(1 << UIDSLOT_BITS));
+        return 0;
+    }
+
+    auto pSlot = UIDSlot(nSlot);
+    return (pSlot->Generation << UIDSLOT_BITS) | nSlot;
 }
 
 bool MonoServer::LinkUID(uint32_t nUID, ServerObject *pObject)
 {
     if(nUID && pObject){
-        auto &rstRecord = m_UIDArray[nUID % m_UIDArray.size()];
-        {
-            std::lock_guard<std::mutex> stLockGuard(rstRecord.Lock);
-            auto stFind = rstRecord.Record.find(nUID);
-            if(stFind == rstRecord.Record.end()){
-                rstRecord.Record[nUID] = pObject;
-                return true;
-            }else{
-                AddLog(LOGTYPE_WARNING, "UIDArray duplicated UID: (%" PRIu32 ", %p, %p)", nUID, stFind->second, pObject);
+        std::lock_guard<std::mutex> stLockGuard(m_UIDLock);
+        if(auto pSlot = UIDSlot(nUID)){
+            if(pSlot->Object){
+                AddLog(LOGTYPE_WARNING, "UIDArray duplicated UID: (%" PRIu32 ", %p, %p)", nUID, pSlot->Object, pObject);
+                return false;
+            }
+
+            if(pSlot->Generation != UIDGeneration(nUID)){
+                AddLog(LOGTYPE_WARNING, "UIDArray generation mismatch: UID = %" PRIu32, nUID);
                 return false;
             }
+
+            pSlot->Object = pObject;
+            WriteUIDSlot(pSlot, nUID, pObject);
+            return true;
         }
     }
 
@@ -721,74 +841,102 @@ bool MonoServer::LinkUID(uint32_t nUID, ServerObject *pObject)
     return false;
 }
 
+bool MonoServer::UpdateUID(uint32_t nUID)
+{
+    if(nUID){
+        std::lock_guard<std::mutex> stLockGuard(m_UIDLock);
+        if(auto pSlot = UIDSlot(nUID)){
+            if(true
+                    && pSlot->Object
+                    && pSlot->Object->UID() == nUID){
+                WriteUIDSlot(pSlot, nUID, pSlot->Object);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
 void MonoServer::EraseUID(uint32_t nUID)
 {
+    ServerObject *pObject = nullptr;
     if(nUID){
-        auto &rstRecord = m_UIDArray[nUID % m_UIDArray.size()];
-        {
-            std::lock_guard<std::mutex> stLockGuard(rstRecord.Lock);
-            auto stFind = rstRecord.Record.find(nUID);
-            if(stFind != rstRecord.Record.end()){
-                if(stFind->second){
-                    if(stFind->second->UID() != nUID){
-                        AddLog(LOGTYPE_WARNING, "UIDArray mismatch: UID = (%" PRIu32 ", %" PRIu32 ")", nUID, stFind->second->UID());
-                    }
-                    delete stFind->second;
+        std::lock_guard<std::mutex> stLockGuard(m_UIDLock);
+        if(auto pSlot = UIDSlot(nUID)){
+            if(true
+                    && pSlot->Object
+                    && pSlot->UID.load(std::memory_order_relaxed) == nUID){
+
+                if(pSlot->Object->UID() != nUID){
+                    AddLog(LOGTYPE_WARNING, "UIDArray mismatch: UID = (%" PRIu32 ", %" PRIu32 ")", nUID, pSlot->Object->UID());
+                }
+
+                pObject = pSlot->Object;
+                pSlot->Object = nullptr;
+                WriteUIDSlot(pSlot, 0, nullptr);
+
+                // bump the generation
+                // then old UID in other actors' hand won't match the new owner of the slot
+                // slot at UIDGEN_MAX is retired, wrapping to zero makes the oldest UIDs alive again
+                if(UIDNextGeneration(&(pSlot->Generation))){
+                    m_UIDFreeQ.push_back(UIDSlotIndex(nUID));
+                }else{
+                    AddLog(LOGTYPE_INFO, "UID slot retired at max generation: slot = %" PRIu32, UIDSlotIndex(nUID));
                 }
-                rstRecord.Record.erase(stFind);
             }
         }
     }
+
+    // readers never access the object
+    // then deletion can be done outside of the lock
+    delete pObject;
 }
 
 UIDRecord MonoServer::GetUIDRecord(uint32_t nUID)
 {
+    static const std::vector<ServerObject::ClassCodeName> stNullEntry {};
     if(nUID){
-        auto &rstUIDArrayEntry = m_UIDArray[nUID % m_UIDArray.size()];
-        {
-            std::lock_guard<std::mutex> stLockGuard(rstUIDArrayEntry.Lock);
-            auto pRecord = rstUIDArrayEntry.Record.find(nUID);
-            if(pRecord != rstUIDArrayEntry.Record.end()){
-                if(pRecord->second){
-                    if(pRecord->second->UID() == nUID){
-                        // two solutions
-                        // 1. for server object, define a virtual UIDRecord GetUIDRecord()
-                        //    then here directly forward the result
-                        //
-                        // 2. maintain UID() for server object
-                        //    maintain UID() and GetAddress() for classes from ActiveObject
-                        //    then construct a temporary UIDRecord and return
-                        //
-                        // solution-1 : simpler but it introduces concept of address to server object
-                        // solution-2 : means I should make both UID() and GetAddress() atomically accessable
-                        //
-                        // UID()        : OK by default
-                        // GetAddress() : which calls m_ActorPod->GetAddress()
-                        //                m_ActorPod could change when other threads accessing it
-                        //
-                        // solution:
-                        // 1. we constrains that we can only access an UID if the object actively given it
-                        //    means if we try to access object through GetUIDRecord(nUID), then the nUID is reported
-                        //    by the object itself. rather than we do randomly draw an UID and access it
-                        //
-                        //    an UID can be deleted then we get an invalid UIDRecord
-                        //    this behaves like malloc() / free(), any pointer try to free() should be from malloc()
-                        //
-                        //    this means if we trying to access ActiveObject::GetAddress(), its m_ActorPod has
-                        //    already be initialized otherwise we can't get its UID
-                        //
-                        // 2. before deletion of active object we should call Deactivate() which calls m_ActorPod->Detach()
-                        //    this helps to detach *this* from the actor thread of m_ActorPod, then deletion in other thread is OK
-                        //
-                        //    then deletion of m_ActorPod will wait if m_ActorPod is scheduled in actor threads
-                        //
-                        auto bActive = pRecord->second->ClassFrom<ActiveObject>();
-                        auto stAddress = bActive ? ((ActiveObject *)(pRecord->second))->GetAddress() : Theron::Address::Null();
-                        return {nUID, pRecord->second->GetInvarData(), stAddress, pRecord->second->ClassEntry()};
-                    }else{
-                        AddLog(LOGTYPE_WARNING, "UIDArray mismatch: UID = (%" PRIu32 ", %" PRIu32 ")", nUID, pRecord->second->UID());
-                    }
+        if(auto pSlot = UIDSlot(nUID)){
+
+            // the sequence number decides whether the copy is consistent
+            // retry only if a writer is updating the same slot, which is rare
+
+            while(true){
+                auto nSequence0 = pSlot->Sequence.load(std::memory_order_acquire);
+                if(nSequence0 & 1){
+                    // writer holds m_UIDLock and may be preempted
+                    // give up the core instead of spinning on it
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                // fields are copied as raw words
+                // only rebuilt to InvarData / Theron::Address after the sequence check
+                auto nRecordUID    = pSlot->UID.load(std::memory_order_relaxed);
+                auto nClassTag     = pSlot->ClassTag.load(std::memory_order_relaxed);
+                auto stDespWord    = pSlot->Desp.Load();
+                auto stAddressWord = pSlot->Address.Load();
+                auto pClassEntry   = pSlot->ClassEntry.load(std::memory_order_relaxed);
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if(pSlot->Sequence.load(std::memory_order_relaxed) != nSequence0){
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                // slot is taken by another generation
+                // or it's already erased
+                if(nRecordUID != nUID){
+                    break;
                 }
+
+                InvarData stDesp;
+                UIDSlotWord<InvarData>::Rebuild(stDespWord, &stDesp);
+
+                auto stAddress = Theron::Address::Null();
+                UIDSlotWord<Theron::Address>::Rebuild(stAddressWord, &stAddress);
+
+                return {nUID, nClassTag, stDesp, stAddress, pClassEntry ? *pClassEntry : stNullEntry};
             }
         }
     }
@@ -796,10 +944,8 @@ UIDRecord MonoServer::GetUIDRecord(uint32_t nUID)
     // for all other cases, return empty record
     // 1. provided uid as zero
     // 2. record doesn't exist
-    // 3. record contains an empty pointer
-    // 4. record mismatch
-    static const std::vector<ServerObject::ClassCodeName> stNullEntry {};
-    return UIDRecord(0, {}, Theron::Address::Null(), stNullEntry);
+    // 3. record is erased or reused by other generation
+    return UIDRecord(0, 0, {}, Theron::Address::Null(), stNullEntry);
 }
 
 bool MonoServer::RegisterLuaExport(ServerLuaModule *pModule, uint32_t nCWID)
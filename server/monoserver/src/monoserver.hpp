@@ -3,7 +3,7 @@
  *
  *       Filename: monoserver.hpp
  *        Created: 02/27/2016 16:45:49
- *  Last Modified: 09/05/2017 12:04:24
+ *  Last Modified: 12/17/2017 21:10:32
  *
  *    Description: 
  *
@@ -20,8 +20,11 @@
 
 #pragma once
 
+#include <array>
+#include <deque>
 #include <mutex>
 #include <queue>
+#include <atomic>
 #include <vector>
 #include <chrono>
 #include <cstdint>
@@ -33,6 +36,7 @@
 #include "message.hpp"
 #include "taskhub.hpp"
 #include "database.hpp"
+#include "uidslot.hpp"
 #include "uidrecord.hpp"
 #include "eventtaskhub.hpp"
 #include "serverluamodule.hpp"
@@ -41,10 +45,39 @@ class ServiceCore;
 class ServerObject;
 class MonoServer final
 {
-    struct UIDLockRecord
+    // UID = (Generation << UIDSLOT_BITS) | SlotIndex
+    // record of an UID is copied into its slot, reader never touches the object itself
+    // then reading needs no lock, it's protected by the sequence number of the slot:
+    //
+    //      writer: Sequence++ (odd), write the fields, Sequence++ (even)
+    //      reader: read Sequence, copy the fields, check Sequence unchanged and even
+    //
+    // all writers are serialized by m_UIDLock, allocation / link / erase is rare
+    // fields copied by reader are all atomics, see uidslot.hpp
+    struct UIDSlotRecord
     {
-        std::mutex Lock;
-        std::unordered_map<uint32_t, const ServerObject *> Record;
+        std::atomic<uint32_t> Sequence;
+
+        std::atomic<uint32_t>        UID;
+        std::atomic<uint32_t>        ClassTag;
+        UIDSlotWord<InvarData>       Desp;
+        UIDSlotWord<Theron::Address> Address;
+        std::atomic<const std::vector<ServerObject::ClassCodeName> *> ClassEntry;
+
+        // only accessed with m_UIDLock
+        uint32_t      Generation;
+        ServerObject *Object;
+
+        UIDSlotRecord()
+            : Sequence(0)
+            , UID(0)
+            , ClassTag(0)
+            , Desp()
+            , Address()
+            , ClassEntry(nullptr)
+            , Generation(0)
+            , Object(nullptr)
+        {}
     };
 
     private:
@@ -63,10 +96,13 @@ class MonoServer final
         ServiceCore *m_ServiceCore;
 
     private:
-        std::atomic<uint32_t> m_GlobalUID;
+        // slots are allocated by chunk when needed
+        // a chunk is never released until server exits
+        std::mutex m_UIDLock;
+        uint32_t   m_UIDSlotCount;
 
-    private:
-        std::array<UIDLockRecord, 17> m_UIDArray;
+        std::deque<uint32_t> m_UIDFreeQ;
+        std::array<std::atomic<UIDSlotRecord *>, (1 << (UIDSLOT_BITS - UIDCHUNK_BITS))> m_UIDChunkV;
 
     private:
         std::chrono::time_point<std::chrono::system_clock> m_StartTime;
@@ -81,7 +117,7 @@ class MonoServer final
 
     public:
         MonoServer();
-       ~MonoServer() = default;
+       ~MonoServer();
 
     public:
         void ReadHC();
@@ -104,8 +140,8 @@ class MonoServer final
                 const char *,           // prompt
                 const char *, ...);     // variadic argument list support std::vsnprintf()
 
-        void AddLog(const std::array<std::string, 4> &,     // argument list, compatible to Log::AddLog()
-                const char *, ...);                         // variadic argument list supported by std::vsnprintf()
+        void AddLog(const Log::LogSite &,   // call site, compatible to Log::AddLog()
+                const char *, ...);         // variadic argument list supported by std::vsnprintf()
 
     private:
         bool AddPlayer(uint32_t, uint32_t);
@@ -170,7 +206,7 @@ class MonoServer final
         // 4. A -> C : forward TRYMAPSWITCH to C_Address
 
         // allocate an *unique* uid during current server runtime
-        // if an uid is used sometime, it won't be used again anymore
+        // slot of an erased uid can be reused but with a different generation
         // don't call MonoServer::GetUID() explicitly, should be called in ServerObject ctor
         uint32_t GetUID();
 
@@ -179,6 +215,11 @@ class MonoServer final
         // this function is called automatically when constructing the server ojbect
         bool LinkUID(uint32_t, ServerObject *);
 
+        // refresh the record by the linked instance
+        // LinkUID() is called in ServerObject ctor which can't get info of derived class
+        // should be called when class info / address / invariant data of the object is ready
+        bool UpdateUID(uint32_t);
+
         // remove the uid record and its respective instance or do nothing if not exists
         // after this invocation it's guaranteed there shouldn't be an object with given uid
         // 1. it remove the record from the hash table
@@ -190,6 +231,10 @@ class MonoServer final
         // it could be immediately invalid by EraseUID() from other threads
         UIDRecord GetUIDRecord(uint32_t);
 
+    private:
+        UIDSlotRecord *UIDSlot(uint32_t);
+        void WriteUIDSlot(UIDSlotRecord *, uint32_t, const ServerObject *);
+
     public:
         uint32_t GetTimeTick()
         {
@@ -3,7 +3,7 @@
  *
  *       Filename: monster.cpp
  *        Created: 04/07/2016 03:48:41 AM
- *  Last Modified: 10/06/2017 16:41:34
+ *  Last Modified: 12/10/2017 22:48:31
  *
  *    Description: 
  *
@@ -37,6 +37,8 @@
 #include "messagepack.hpp"
 #include "protocoldef.hpp"
 
+constexpr uint32_t Monster::ClassTag;
+
 Monster::Monster(uint32_t   nMonsterID,
         ServiceCore        *pServiceCore,
         ServerMap          *pServerMap,
@@ -424,6 +426,11 @@ void Monster::OperateAM(const MessagePack &rstMPK, const Theron::Address &rstAdd
                 On_MPK_MAPSWITCH(rstMPK, rstAddress);
                 break;
             }
+        case MPK_AIINTENT:
+            {
+                On_MPK_AIINTENT(rstMPK, rstAddress);
+                break;
+            }
         case MPK_QUERYLOCATION:
             {
                 On_MPK_QUERYLOCATION(rstMPK, rstAddress);
@@ -3,7 +3,7 @@
  *
  *       Filename: monster.hpp
  *        Created: 04/10/2016 02:32:45
- *  Last Modified: 10/06/2017 16:41:04
+ *  Last Modified: 12/10/2017 22:48:31
  *
  *    Description: 
  *
@@ -71,6 +71,15 @@ typedef struct stMONSTERRACEINFO
 
 class Monster: public CharObject
 {
+    public:
+        static constexpr uint32_t ClassTag = CLASSTAG_MONSTER | CharObject::ClassTag;
+
+    public:
+        uint32_t GetClassTag() const
+        {
+            return Monster::ClassTag;
+        }
+
     protected:
         enum FPMethodType: int
         {
@@ -151,6 +160,7 @@ class Monster: public CharObject
         void On_MPK_ATTACK(const MessagePack &, const Theron::Address &);
         void On_MPK_ACTION(const MessagePack &, const Theron::Address &);
         void On_MPK_OFFLINE(const MessagePack &, const Theron::Address &);
+        void On_MPK_AIINTENT(const MessagePack &, const Theron::Address &);
         void On_MPK_UPDATEHP(const MessagePack &, const Theron::Address &);
         void On_MPK_METRONOME(const MessagePack &, const Theron::Address &);
         void On_MPK_MAPSWITCH(const MessagePack &, const Theron::Address &);
@@ -0,0 +1,300 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: monsterai.cpp
+ *        Created: 12/10/2017 10:16:27
+ *  Last Modified: 12/10/2017 22:48:31
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include "mathfunc.hpp"
+#include "monsterai.hpp"
+#include "pathfinder.hpp"
+#include "protocoldef.hpp"
+#include "dbcomrecord.hpp"
+
+// same as RANGE_VISIBLE of Monster::InRange()
+// target out of it is dropped
+constexpr int MONSTERAI_VIEWRANGE = 20;
+
+bool MonsterAI::Add(uint32_t nUID, uint32_t nMonsterID, int nDirection)
+{
+    if(nUID){
+        if(auto &rstMR = DBCOM_MONSTERRECORD(nMonsterID)){
+            AIRecord stRecord(nUID, nDirection);
+            stRecord.WalkWait   = (uint32_t)(std::max<int>(rstMR.WalkWait,   0));
+            stRecord.AttackWait = (uint32_t)(std::max<int>(rstMR.AttackWait, 0));
+
+            // only physical attack is done by Monster::AttackUID()
+            // monster without it only tracks its target
+            auto stDCList = rstMR.DCList();
+            stRecord.PhyAttack = std::find(stDCList.begin(), stDCList.end(), DC_PHY_PLAIN) != stDCList.end();
+
+            m_RecordMap[nUID] = stRecord;
+            return true;
+        }
+    }
+    return false;
+}
+
+void MonsterAI::Remove(uint32_t nUID)
+{
+    m_RecordMap.erase(nUID);
+    m_HPRecord.erase(nUID);
+}
+
+void MonsterAI::OnAction(const AMAction &rstAMA)
+{
+    auto pRecord = m_RecordMap.find(rstAMA.UID);
+    switch(rstAMA.Action){
+        case ACTION_DIE:
+            {
+                if(m_AOI.Find(rstAMA.UID)){
+                    m_HPRecord[rstAMA.UID] = 0;
+                }
+
+                if(pRecord != m_RecordMap.end()){
+                    pRecord->second.Dead = true;
+                }
+                return;
+            }
+        case ACTION_UNDERATTACK:
+            {
+                // attacker is in AimUID
+                // Monster::AddTarget() appends it to the queue, so only take it when there is no target
+                if(true
+                        && pRecord != m_RecordMap.end()
+                        && pRecord->second.TargetUID == 0
+                        && rstAMA.AimUID
+                        && rstAMA.AimUID != rstAMA.UID){
+                    pRecord->second.TargetUID = rstAMA.AimUID;
+                }
+                break;
+            }
+        default:
+            {
+                break;
+            }
+    }
+
+    // keep the direction for random move
+    // monster reports it by every action
+    if(true
+            && pRecord != m_RecordMap.end()
+            && rstAMA.Direction > DIR_NONE
+            && rstAMA.Direction < DIR_MAX){
+        pRecord->second.Direction = rstAMA.Direction;
+    }
+}
+
+void MonsterAI::OnUpdateHP(const AMUpdateHP &rstAMUHP)
+{
+    if(m_AOI.Find(rstAMUHP.UID)){
+        m_HPRecord[rstAMUHP.UID] = rstAMUHP.HP;
+    }
+}
+
+uint32_t MonsterAI::CheckTarget(const AIRecord &rstRecord, int nX, int nY) const
+{
+    // 1. keep current target
+    //    if it's still alive and in view
+    if(true
+            && rstRecord.TargetUID
+            && Alive(rstRecord.TargetUID)){
+        if(auto pTarget = m_AOI.Find(rstRecord.TargetUID)){
+            if(LDistance2(nX, nY, pTarget->X, pTarget->Y) < MONSTERAI_VIEWRANGE * MONSTERAI_VIEWRANGE){
+                return rstRecord.TargetUID;
+            }
+        }
+    }
+
+    // 2. take the nearest player in view
+    //    masterless monster is friend of all other monsters, see Monster::CheckFriend()
+    uint32_t nTargetUID = 0;
+    int      nTargetLD2 = MONSTERAI_VIEWRANGE * MONSTERAI_VIEWRANGE;
+
+    m_AOI.ForEach(nX, nY, MONSTERAI_VIEWRANGE, [this, nX, nY, &nTargetUID, &nTargetLD2](const AOIManager::AOIEntry &rstEntry) -> bool
+    {
+        if(true
+                && rstEntry.Player
+                && Alive(rstEntry.UID)){
+            auto nLD2 = LDistance2(nX, nY, rstEntry.X, rstEntry.Y);
+            if(nLD2 < nTargetLD2){
+                nTargetUID = rstEntry.UID;
+                nTargetLD2 = nLD2;
+            }
+        }
+        return false;
+    });
+    return nTargetUID;
+}
+
+size_t MonsterAI::Update(uint32_t nCurrTick, const std::vector<uint32_t> &rstUIDV, const std::function<bool(int, int)> &fnCanStep, const std::function<void(const AMAIIntent &)> &fnOnIntent)
+{
+    m_ReserveSet.clear();
+    auto fnFreeStep = [this, &fnCanStep](int nX, int nY) -> bool
+    {
+        return true
+            && fnCanStep(nX, nY)
+            && m_ReserveSet.find(GridKey(nX, nY)) == m_ReserveSet.end();
+    };
+
+    size_t nCount = 0;
+    for(auto nUID: rstUIDV){
+        auto pRecord = m_RecordMap.find(nUID);
+        if(false
+                || pRecord == m_RecordMap.end()
+                || pRecord->second.Dead){
+            continue;
+        }
+
+        auto pEntry = m_AOI.Find(nUID);
+        if(!pEntry){
+            continue;
+        }
+
+        // copy it out
+        // fnOnIntent may remove the entry
+        auto nX = pEntry->X;
+        auto nY = pEntry->Y;
+        auto &rstRecord = pRecord->second;
+
+        AMAIIntent stAMAII;
+        std::memset(&stAMAII, 0, sizeof(stAMAII));
+
+        stAMAII.UID  = nUID;
+        stAMAII.Type = AIINTENT_NONE;
+
+        rstRecord.TargetUID = CheckTarget(rstRecord, nX, nY);
+        if(rstRecord.TargetUID){
+            auto pTarget = m_AOI.Find(rstRecord.TargetUID);
+            auto nTargetX = pTarget->X;
+            auto nTargetY = pTarget->Y;
+
+            switch(LDistance2(nX, nY, nTargetX, nTargetY)){
+                case 0:
+                    {
+                        break;
+                    }
+                case 1:
+                case 2:
+                    {
+                        if(true
+                                && rstRecord.PhyAttack
+                                && rstRecord.AttackTick <= nCurrTick){
+
+                            stAMAII.Type      = AIINTENT_ATTACK;
+                            stAMAII.TargetUID = rstRecord.TargetUID;
+                            stAMAII.DC        = DC_PHY_PLAIN;
+                            stAMAII.X         = nTargetX;
+                            stAMAII.Y         = nTargetY;
+
+                            rstRecord.AttackTick = nCurrTick + rstRecord.AttackWait;
+                        }
+                        break;
+                    }
+                default:
+                    {
+                        if(rstRecord.MoveTick <= nCurrTick){
+
+                            // same candidates as Monster::MoveOneStepCombine()
+                            // but checked against the map directly, no failed move request
+                            int nDX = ((nTargetX > nX) - (nTargetX < nX));
+                            int nDY = ((nTargetY > nY) - (nTargetY < nY));
+
+                            std::array<PathFind::PathNode, 3> stvPathNode;
+                            if(nDX && nDY){
+                                stvPathNode[0] = {nX + nDX, nY + nDY};
+                                stvPathNode[1] = {nX      , nY + nDY};
+                                stvPathNode[2] = {nX + nDX, nY      };
+                            }else if(nDY){
+                                stvPathNode[0] = {nX + 0, nY + nDY};
+                                stvPathNode[1] = {nX - 1, nY + nDY};
+                                stvPathNode[2] = {nX + 1, nY + nDY};
+                            }else{
+                                stvPathNode[0] = {nX + nDX, nY + 0};
+                                stvPathNode[1] = {nX + nDX, nY - 1};
+                                stvPathNode[2] = {nX + nDX, nY + 1};
+                            }
+
+                            // all blocked
+                            // let the monster ask for a path
+                            stAMAII.Type = AIINTENT_TRACK;
+                            stAMAII.X    = nTargetX;
+                            stAMAII.Y    = nTargetY;
+
+                            for(auto &rstPathNode: stvPathNode){
+                                if(fnFreeStep(rstPathNode.X, rstPathNode.Y)){
+                                    stAMAII.Type = AIINTENT_MOVE;
+                                    stAMAII.X    = rstPathNode.X;
+                                    stAMAII.Y    = rstPathNode.Y;
+                                    break;
+                                }
+                            }
+                            rstRecord.MoveTick = nCurrTick + rstRecord.WalkWait;
+                        }
+                        break;
+                    }
+            }
+        }else if(rstRecord.MoveTick <= nCurrTick){
+
+            // same as Monster::RandomMove()
+            // move ahead, or turn to a random direction which can move next time
+            int nFrontX = -1;
+            int nFrontY = -1;
+
+            if(true
+                    && PathFind::GetFrontLocation(&nFrontX, &nFrontY, nX, nY, rstRecord.Direction)
+                    && fnFreeStep(nFrontX, nFrontY)){
+                stAMAII.Type = AIINTENT_MOVE;
+                stAMAII.X    = nFrontX;
+                stAMAII.Y    = nFrontY;
+            }else{
+                constexpr int nDirCount = DIR_MAX - (DIR_NONE + 1);
+                auto nDirStart = (int)(std::rand() % nDirCount);
+
+                for(int nIndex = 0; nIndex < nDirCount; ++nIndex){
+                    auto nDirection = (DIR_NONE + 1) + (nDirStart + nIndex) % nDirCount;
+                    if(true
+                            && nDirection != rstRecord.Direction
+                            && PathFind::GetFrontLocation(&nFrontX, &nFrontY, nX, nY, nDirection)
+                            && fnFreeStep(nFrontX, nFrontY)){
+                        stAMAII.Type      = AIINTENT_TURN;
+                        stAMAII.Direction = nDirection;
+
+                        rstRecord.Direction = nDirection;
+                        break;
+                    }
+                }
+            }
+            rstRecord.MoveTick = nCurrTick + rstRecord.WalkWait;
+        }
+
+        if(stAMAII.Type != AIINTENT_NONE){
+            if(stAMAII.Type == AIINTENT_MOVE){
+                m_ReserveSet.insert(GridKey(stAMAII.X, stAMAII.Y));
+            }
+
+            // don't refer rstRecord after it
+            // the monster can be removed if it's gone
+            nCount++;
+            fnOnIntent(stAMAII);
+        }
+    }
+    return nCount;
+}
@@ -0,0 +1,170 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: monsterai.hpp
+ *        Created: 12/10/2017 10:16:27
+ *  Last Modified: 12/10/2017 22:48:31
+ *
+ *    Description: batched AI of monsters on one map
+ *
+ *                 originally each monster runs Update() on its own MPK_METRONOME, and
+ *                 gets location of its target by MPK_QUERYLOCATION, besides every map
+ *                 event in range is forwarded to it to collect targets, then a crowded
+ *                 map has a message storm even nothing happens
+ *
+ *                 MonsterAI lives in ServerMap, all due monsters of a tick are decided
+ *                 in one pass against what the map already knows:
+ *
+ *                      1. location     : AOIManager entries
+ *                      2. HP / death   : MPK_UPDATEHP and ACTION_DIE seen by the map
+ *                      3. target       : nearest player in view, or the last attacker
+ *                                        reported by ACTION_UNDERATTACK
+ *
+ *                 only an intent to move / attack / turn is sent to the monster as
+ *                 MPK_AIINTENT, monster without anything to do gets no message
+ *
+ *                 only monster without master is batched, a dead one goes back to the
+ *                 metronome then map can find it's gone as before
+ *
+ *                 this class is not thread-safe, only used inside ServerMap's actor
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "aoimanager.hpp"
+#include "actormessage.hpp"
+
+enum AIIntentType: int
+{
+    AIINTENT_NONE = 0,
+    AIINTENT_MOVE,          // one step to (X, Y)
+    AIINTENT_TRACK,         // greedy steps are blocked, find path to (X, Y)
+    AIINTENT_ATTACK,        // attack TargetUID at (X, Y) by DC
+    AIINTENT_TURN,          // turn to Direction
+};
+
+class MonsterAI final
+{
+    public:
+        struct AIRecord
+        {
+            uint32_t UID;
+            uint32_t TargetUID;
+
+            int  Direction;
+            bool Dead;
+
+            // earliest tick for next intent
+            // monster still checks CanMove() / CanAttack() itself
+            uint32_t MoveTick;
+            uint32_t AttackTick;
+
+            uint32_t WalkWait;
+            uint32_t AttackWait;
+
+            bool PhyAttack;
+
+            AIRecord(uint32_t nUID = 0, int nDirection = 0)
+                : UID(nUID)
+                , TargetUID(0)
+                , Direction(nDirection)
+                , Dead(false)
+                , MoveTick(0)
+                , AttackTick(0)
+                , WalkWait(0)
+                , AttackWait(0)
+                , PhyAttack(false)
+            {}
+        };
+
+    private:
+        const AOIManager &m_AOI;
+
+    private:
+        std::unordered_map<uint32_t, AIRecord> m_RecordMap;
+
+    private:
+        // last HP seen of char objects on the map
+        // object never reported stays out of it and is taken as alive
+        std::unordered_map<uint32_t, uint32_t> m_HPRecord;
+
+    private:
+        // grids taken by move intents of current pass
+        // map locks a grid only when the move request comes
+        std::unordered_set<uint32_t> m_ReserveSet;
+
+    public:
+        MonsterAI(const AOIManager &rstAOI)
+            : m_AOI(rstAOI)
+            , m_RecordMap()
+            , m_HPRecord()
+            , m_ReserveSet()
+        {}
+
+       ~MonsterAI() = default;
+
+    public:
+        bool Add(uint32_t, uint32_t, int);
+        void Remove(uint32_t);
+
+    public:
+        const AIRecord *Find(uint32_t nUID) const
+        {
+            auto pRecord = m_RecordMap.find(nUID);
+            return (pRecord == m_RecordMap.end()) ? nullptr : &(pRecord->second);
+        }
+
+        // batched monster gets MPK_AIINTENT instead of MPK_METRONOME
+        // and doesn't need map events forwarded
+        bool Batched(uint32_t nUID) const
+        {
+            auto pRecord = Find(nUID);
+            return pRecord && !pRecord->Dead;
+        }
+
+        size_t Count() const
+        {
+            return m_RecordMap.size();
+        }
+
+    public:
+        void OnAction(const AMAction &);
+        void OnUpdateHP(const AMUpdateHP &);
+
+    public:
+        // decide all due monsters in one pass and call fnOnIntent for each intent
+        // fnCanStep(nX, nY) tells if a grid can be stepped on now
+        // fnOnIntent can remove the monster from the map
+        size_t Update(uint32_t, const std::vector<uint32_t> &, const std::function<bool(int, int)> &, const std::function<void(const AMAIIntent &)> &);
+
+    private:
+        bool Alive(uint32_t nUID) const
+        {
+            auto pHP = m_HPRecord.find(nUID);
+            return (pHP == m_HPRecord.end()) || (pHP->second > 0);
+        }
+
+    private:
+        uint32_t CheckTarget(const AIRecord &, int, int) const;
+
+    private:
+        static uint32_t GridKey(int nX, int nY)
+        {
+            return ((uint32_t)(nX) << 16) | ((uint32_t)(nY) & 0XFFFF);
+        }
+};
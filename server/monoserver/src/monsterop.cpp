@@ -3,7 +3,7 @@
  *
  *       Filename: monsterop.cpp
  *        Created: 05/03/2016 21:49:38
- *  Last Modified: 10/06/2017 16:40:22
+ *  Last Modified: 12/10/2017 22:48:31
  *
  *    Description: 
  *
@@ -19,6 +19,7 @@
  */
 
 #include <algorithm>
+#include "motion.hpp"
 #include "player.hpp"
 #include "monster.hpp"
 #include "sysconst.hpp"
@@ -137,8 +138,10 @@ void Monster::On_MPK_ATTACK(const MessagePack &rstMPK, const Theron::Address &rs
     switch(GetState(STATE_DEAD)){
         case 0:
             {
+                // attacker goes with the action
+                // map needs it as target of batched monster
                 AddTarget(stAMAK.UID);
-                DispatchAction({ACTION_UNDERATTACK, 0, Direction(), X(), Y(), MapID()});
+                DispatchAction({ACTION_UNDERATTACK, 0, SYS_DEFSPEED, Direction(), X(), Y(), X(), Y(), stAMAK.UID, MapID()});
 
                 AddHitterUID(stAMAK.UID, stAMAK.Damage);
                 StruckDamage({stAMAK.UID, stAMAK.Type, stAMAK.Damage, stAMAK.Element, stAMAK.Effect});
@@ -155,6 +158,74 @@ void Monster::On_MPK_ATTACK(const MessagePack &rstMPK, const Theron::Address &rs
     }
 }
 
+void Monster::On_MPK_AIINTENT(const MessagePack &rstMPK, const Theron::Address &)
+{
+    AMAIIntent stAMAII;
+    std::memcpy(&stAMAII, rstMPK.Data(), sizeof(stAMAII));
+
+    // decided by MonsterAI of the map in batched mode
+    // it's from a snapshot, still check the state and timing here
+    if(HP() <= 0){
+        GoDie();
+        return;
+    }
+
+    switch(stAMAII.Type){
+        case AIINTENT_MOVE:
+            {
+                if(CanMove()){
+                    RequestMove(MOTION_MON_WALK, stAMAII.X, stAMAII.Y, false, [](){}, [](){});
+                }
+                break;
+            }
+        case AIINTENT_TRACK:
+            {
+                if(CanMove()){
+                    MoveOneStepAStar(stAMAII.X, stAMAII.Y);
+                }
+                break;
+            }
+        case AIINTENT_ATTACK:
+            {
+                switch(LDistance2(X(), Y(), stAMAII.X, stAMAII.Y)){
+                    case 1:
+                    case 2:
+                        {
+                            if(true
+                                    && CanAttack()
+                                    && DCValid(stAMAII.DC, true)){
+
+                                m_Direction = PathFind::GetDirection(X(), Y(), stAMAII.X, stAMAII.Y);
+                                DispatchAction({ACTION_ATTACK, stAMAII.DC, Direction(), X(), Y(), MapID()});
+
+                                extern MonoServer *g_MonoServer;
+                                m_LastAttackTime = g_MonoServer->GetTimeTick();
+                                DispatchAttack(stAMAII.TargetUID, stAMAII.DC);
+                            }
+                            break;
+                        }
+                    default:
+                        {
+                            break;
+                        }
+                }
+                break;
+            }
+        case AIINTENT_TURN:
+            {
+                if(Direction() != stAMAII.Direction){
+                    m_Direction = stAMAII.Direction;
+                    DispatchAction({ACTION_STAND, 0, Direction(), X(), Y(), MapID()});
+                }
+                break;
+            }
+        default:
+            {
+                break;
+            }
+    }
+}
+
 void Monster::On_MPK_MAPSWITCH(const MessagePack &, const Theron::Address &)
 {
 }
@@ -3,7 +3,7 @@
  *
  *       Filename: netpod.cpp
  *        Created: 06/25/2017 12:05:00
- *  Last Modified: 10/04/2017 16:46:57
+ *  Last Modified: 12/12/2017 22:06:51
  *
  *    Description: 
  *
@@ -18,18 +18,22 @@
  * =====================================================================================
  */
 
+#include <algorithm>
 #include "netpod.hpp"
 #include "sysconst.hpp"
+#include "serverenv.hpp"
 #include "monoserver.hpp"
 
 NetPodN::NetPodN()
     : SyncDriver()
     , m_Port(0)
-    , m_IO(nullptr)
     , m_EndPoint(nullptr)
     , m_Acceptor(nullptr)
     , m_Socket(nullptr)
-    , m_Thread()
+    , m_IOV()
+    , m_WorkV()
+    , m_ThreadV()
+    , m_NextShard(0)
     , m_SCAddress(Theron::Address::Null())
     , m_ValidQ()
 {}
@@ -38,10 +42,11 @@ NetPodN::~NetPodN()
 {
     Shutdown(0);
 
+    // sockets refer to their io_service
+    // delete them before m_IOV releases the shards
     delete m_Socket;
     delete m_Acceptor;
     delete m_EndPoint;
-    delete m_IO;
 }
 
 bool NetPodN::CheckPort(uint32_t nPort)
@@ -72,16 +77,28 @@ bool NetPodN::InitASIO(uint32_t nPort)
 
     m_Port = nPort;
 
+    // 2. create io shards
+    //    zero means one shard for each core
+    extern ServerEnv *g_ServerEnv;
+    auto nShardCount = (size_t)(std::max<int>(g_ServerEnv->MIR2X_CONFIG_NET_WORKER, 0));
+    if(nShardCount == 0){
+        nShardCount = (size_t)(std::max<unsigned int>(std::thread::hardware_concurrency(), 1));
+    }
+
     try{
-        m_IO       = new asio::io_service();
+        m_IOV.clear();
+        for(size_t nIndex = 0; nIndex < nShardCount; ++nIndex){
+            m_IOV.emplace_back(new asio::io_service(1));
+        }
+
         m_EndPoint = new asio::ip::tcp::endpoint(asio::ip::tcp::v4(), m_Port);
-        m_Acceptor = new asio::ip::tcp::acceptor(*m_IO, *m_EndPoint);
-        m_Socket   = new asio::ip::tcp::socket(*m_IO);
+        m_Acceptor = new asio::ip::tcp::acceptor(*(m_IOV[0]), *m_EndPoint);
+        m_Socket   = nullptr;
     }catch(...){
         delete m_Socket;
         delete m_Acceptor;
         delete m_EndPoint;
-        delete m_IO;
+        m_IOV.clear();
 
         extern MonoServer *g_MonoServer;
         g_MonoServer->AddLog(LOGTYPE_WARNING, "Initialization of ASIO failed");
@@ -91,6 +108,45 @@ bool NetPodN::InitASIO(uint32_t nPort)
     return true;
 }
 
+size_t NetPodN::Broadcast(const uint32_t *pSessionID, size_t nSessionCount, uint8_t nHC, const uint8_t *pData, size_t nDataLen)
+{
+    auto pMessage = Session::Encode(nHC, pData, nDataLen);
+    if(!pMessage){
+        return 0;
+    }
+
+    size_t nCount = 0;
+    if(pSessionID){
+        for(size_t nIndex = 0; nIndex < nSessionCount; ++nIndex){
+            if(true
+                    && pSessionID[nIndex]
+                    && pSessionID[nIndex] < (uint32_t)(std::extent<decltype(m_ChannelList)>::value)){
+                nCount += (m_ChannelList[pSessionID[nIndex]].Send(pMessage) ? 1 : 0);
+            }
+        }
+    }else{
+        for(int nIndex = 1; nIndex < (int)(std::extent<decltype(m_ChannelList)>::value); ++nIndex){
+            nCount += (m_ChannelList[nIndex].Send(pMessage) ? 1 : 0);
+        }
+    }
+    return nCount;
+}
+
+void NetPodN::StopASIO()
+{
+    m_WorkV.clear();
+    for(auto &pIO: m_IOV){
+        pIO->stop();
+    }
+
+    for(auto &rstThread: m_ThreadV){
+        if(rstThread.joinable()){
+            rstThread.join();
+        }
+    }
+    m_ThreadV.clear();
+}
+
 int NetPodN::Launch(uint32_t nPort, const Theron::Address &rstSCAddr)
 {
     // 1. check parameter
@@ -99,10 +155,8 @@ int NetPodN::Launch(uint32_t nPort, const Theron::Address &rstSCAddr)
     // 2. assign the target address
     m_SCAddress = rstSCAddr;
 
-    // 3. make sure the internal thread has ended
-    if(m_Thread.joinable()){
-        m_Thread.join();
-    }
+    // 3. make sure the internal threads have ended
+    StopASIO();
 
     // 4. prepare valid session ID
     m_ValidQ.Clear();
@@ -114,11 +168,15 @@ int NetPodN::Launch(uint32_t nPort, const Theron::Address &rstSCAddr)
     if(!InitASIO(nPort)){ return 2; }
 
     // 6. put one accept handler inside the event loop
-    //    but the asio main loop is not driven by m_Thread yet here
+    //    but the asio main loops are not driven by m_ThreadV yet here
     Accept();
 
-    // 7. start the internal thread to driven the loop
-    m_Thread = std::thread([this](){ m_IO->run(); });
+    // 7. start the internal threads to driven the loops
+    //    one thread for each shard, shard without session is kept by the work
+    for(auto &pIO: m_IOV){
+        m_WorkV.emplace_back(new asio::io_service::work(*pIO));
+        m_ThreadV.emplace_back([pIO = pIO.get()](){ pIO->run(); });
+    }
 
     // 8. all Launch() function will return 0 when succceeds
     return 0;
@@ -199,5 +257,12 @@ void NetPodN::Accept()
         Accept();
     };
 
+    // create socket on the shard to pin the session
+    // a socket left by last accept is closed, it's not moved into a channel
+    auto pIO = m_IOV[(m_NextShard++) % m_IOV.size()].get();
+
+    delete m_Socket;
+    m_Socket = new asio::ip::tcp::socket(*pIO);
+
     m_Acceptor->async_accept(*m_Socket, fnAccept);
 }
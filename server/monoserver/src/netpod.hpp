@@ -3,13 +3,18 @@
  *
  *       Filename: netpod.hpp
  *        Created: 08/14/2015 11:34:33
- *  Last Modified: 10/06/2017 21:36:08
+ *  Last Modified: 12/12/2017 22:06:51
  *
  *    Description: this will serve as a stand-alone plugin for monoserver, it creates
  *                 with general info. and nothing will be done till Launch()
  *
  *                 when Launch(Theron::Address) with the actor address of service core
- *                 this pod will start a new thread and run asio::run() inside
+ *                 this pod will start MIR2X_CONFIG_NET_WORKER threads, each thread runs
+ *                 asio::run() of its own io_service as one shard
+ *
+ *                 a session is pinned to the shard its socket is created on, then all
+ *                 read / decode / write of one session stay in one thread and sessions on
+ *                 different shards run in parallel, acceptor always runs on shard 0
  *
  *                 when a new connection request received, if netpod decide to accept
  *                 it, the pod will:
@@ -57,7 +62,9 @@
 #pragma once
 
 #include <atomic>
+#include <memory>
 #include <thread>
+#include <vector>
 #include <cstdint>
 #include <asio.hpp>
 #include <Theron/Theron.h>
@@ -73,13 +80,21 @@ class NetPodN: public SyncDriver
 {
     private:
         unsigned int                m_Port;
-        asio::io_service           *m_IO;
         asio::ip::tcp::endpoint    *m_EndPoint;
         asio::ip::tcp::acceptor    *m_Acceptor;
         asio::ip::tcp::socket      *m_Socket;
 
     private:
-        std::thread m_Thread;
+        // io shards, one thread for each io_service
+        // work keeps a shard running when it has no session
+        std::vector<std::unique_ptr<asio::io_service>>       m_IOV;
+        std::vector<std::unique_ptr<asio::io_service::work>> m_WorkV;
+        std::vector<std::thread>                             m_ThreadV;
+
+    private:
+        // shard for next accepted connection
+        // only accessed in the acceptor thread
+        size_t m_NextShard;
 
     private:
         Theron::Address m_SCAddress;
@@ -98,6 +113,9 @@ class NetPodN: public SyncDriver
         bool CheckPort(uint32_t);
         bool InitASIO(uint32_t);
 
+    protected:
+        void StopASIO();
+
     public:
         // launch the netpod with (port, service_core_address)
         // before call this function, the service core should be ready
@@ -133,11 +151,7 @@ class NetPodN: public SyncDriver
                             m_ValidQ.PushHead((uint32_t)(nIndex));
                         }
 
-                        m_IO->stop();
-                        if(m_Thread.joinable()){
-                            m_Thread.join();
-                        }
-
+                        StopASIO();
                         break;
                     }
                 default:
@@ -203,6 +217,25 @@ class NetPodN: public SyncDriver
             return true;
         }
 
+    public:
+        // send one message to a list of sessions
+        // message is encoded once and each session only takes a reference of it
+        // then a mass event costs one encoding and no allocation per recipient
+        //
+        // null session list means all sessions
+        // invalid or closed sessions are skipped, return number of sessions posted
+        size_t Broadcast(const uint32_t *, size_t, uint8_t, const uint8_t *, size_t);
+
+        size_t Broadcast(const std::vector<uint32_t> &rstSessionIDV, uint8_t nHC)
+        {
+            return Broadcast(rstSessionIDV.data(), rstSessionIDV.size(), nHC, nullptr, 0);
+        }
+
+        template<typename T> size_t Broadcast(const std::vector<uint32_t> &rstSessionIDV, uint8_t nHC, const T &stMsgT)
+        {
+            return Broadcast(rstSessionIDV.data(), rstSessionIDV.size(), nHC, (const uint8_t *)(&stMsgT), sizeof(stMsgT));
+        }
+
     private:
         void Accept();
 };
@@ -0,0 +1,517 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: pathfindservice.cpp
+ *        Created: 11/26/2017 11:40:19
+ *  Last Modified: 12/09/2017 23:35:42
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include "mathfunc.hpp"
+#include "pathfinder.hpp"
+#include "syncdriver.hpp"
+#include "jpspathfinder.hpp"
+#include "monoserver.hpp"
+#include "actormessage.hpp"
+#include "pathfindservice.hpp"
+
+// region size of the path cache key in grids
+// and max count of regions one path is saved to
+constexpr int PATHCACHE_REGION    = 8;
+constexpr int PATHCACHE_REGIONMAX = 8;
+
+// goal further than it uses the navigation graph
+// closer one takes the grid search directly
+constexpr int PATHFIND_ROUTEDISTANCE = NAVGRAPH_CLUSTER * 2;
+
+// path cache keeps stale records until it's full
+// then drop all stale records, or all records if none is stale
+constexpr size_t PATHCACHE_SIZE = 4096;
+
+// cells passed by one hop including both ends
+// return -1 if it's not a valid hop of step size 1, 2, 3
+static int HopMaxIndex(int nX0, int nY0, int nX1, int nY1)
+{
+    switch(LDistance2(nX0, nY0, nX1, nY1)){
+        case  0: return 0;
+        case  1:
+        case  2: return 1;
+        case  4:
+        case  8: return 2;
+        case  9:
+        case 18: return 3;
+        default: return -1;
+    }
+}
+
+// finder only reads the job
+// the map is never touched in worker threads
+class ServicePathFinder: public AStarPathFinder
+{
+    public:
+        ServicePathFinder(const PathFindService::PathFindJob &rstJob)
+            : AStarPathFinder(
+                    // 1. step check function
+                    //    for server we always check ground
+                    //    no matter CheckCO set or not we allow all grids if the ground is valid
+                    [&rstJob](int nSrcX, int nSrcY, int nDstX, int nDstY) -> bool
+                    {
+                        auto nMaxIndex = HopMaxIndex(nSrcX, nSrcY, nDstX, nDstY);
+                        if(nMaxIndex < 0){
+                            return false;
+                        }
+
+                        int nDX = (nDstX > nSrcX) - (nDstX < nSrcX);
+                        int nDY = (nDstY > nSrcY) - (nDstY < nSrcY);
+
+                        for(int nIndex = 0; nIndex <= nMaxIndex; ++nIndex){
+                            if(!rstJob.Ground->GroundValid(nSrcX + nDX * nIndex, nSrcY + nDY * nIndex)){
+                                return false;
+                            }
+                        }
+                        return true;
+                    },
+
+                    // 2. move cost function
+                    //    directions 1, 3, 5, 7 get higher cost, then G->I is G -> H -> I rather than G -> C -> I
+                    //
+                    //              A B C D E
+                    //              F G H I J
+                    //              K L M N O
+                    //              P Q R S T
+                    //
+                    //    also read comments in mir2x/client/src/clientpathfinder.cpp
+                    [&rstJob](int nSrcX, int nSrcY, int nDstX, int nDstY) -> double
+                    {
+                        double fExtraPen = 0.00;
+                        switch(LDistance2(nSrcX, nSrcY, nDstX, nDstY)){
+                            case  1: fExtraPen = 0.00 + 0.01; break;
+                            case  2: fExtraPen = 0.10 + 0.01; break;
+                            case  4: fExtraPen = 0.00 + 0.02; break;
+                            case  8: fExtraPen = 0.10 + 0.02; break;
+                            case  9: fExtraPen = 0.00 + 0.03; break;
+                            case 18: fExtraPen = 0.10 + 0.03; break;
+                            default:
+                                {
+                                    extern MonoServer *g_MonoServer;
+                                    g_MonoServer->AddLog(LOGTYPE_FATAL, "Invalid step checked: (%d, %d) -> (%d, %d)", nSrcX, nSrcY, nDstX, nDstY);
+                                    return 10000.00;
+                                }
+                        }
+
+                        if(!rstJob.CheckCO){
+                            // won't check creature
+                            // then all walk-able step get cost 1.0 + delta
+                            return 1.00 + fExtraPen;
+                        }
+
+                        // if there is no co on the way we take it
+                        // however if there is, we can still take it but with very high cost
+                        //
+                        // then A bypasses B to go to C and stops as close as possible to C
+                        // even if C is surrendered by a lot of CO's
+                        //
+                        //    +---+---+---+---+---+
+                        //    |   |   |   | C |   |
+                        //    +---+---+---+---+---+
+                        //    |   |   | B |   |   |
+                        //    +---+---+---+---+---+
+                        //    |   | A |   |   |   |
+                        //    +---+---+---+---+---+
+                        //
+                        // lock is only checked at both ends of the hop, as ServerMap::CanMove(1, 1, 1, ...)
+                        auto nMaxIndex = HopMaxIndex(nSrcX, nSrcY, nDstX, nDstY);
+
+                        int nDX = (nDstX > nSrcX) - (nDstX < nSrcX);
+                        int nDY = (nDstY > nSrcY) - (nDstY < nSrcY);
+
+                        double fMoveCost = 0.00;
+                        for(int nIndex = 0; nIndex <= nMaxIndex; ++nIndex){
+                            auto nCurrX = nSrcX + nDX * nIndex;
+                            auto nCurrY = nSrcY + nDY * nIndex;
+
+                            if(!rstJob.Ground->GroundValid(nCurrX, nCurrY)){
+                                return 10000.00;
+                            }
+
+                            auto nOccupy = rstJob.Occupy.Get(nCurrX, nCurrY);
+                            if((nIndex != 0) && (nIndex != nMaxIndex)){
+                                nOccupy &= ~PathFindService::OCCUPY_LOCK;
+                            }
+                            fMoveCost += (nOccupy ? 100.00 : 1.00);
+                        }
+                        return fMoveCost + fExtraPen;
+                    },
+
+                    rstJob.MaxStep)
+        {}
+};
+
+// single hops from start to (nEndX, nEndY), including both ends
+// try JPS first, CO and lock as blocked, then fall back to A* with CO cost
+static bool FindPath(const PathFindService::PathFindJob &rstJob, int nEndX, int nEndY, const std::function<bool()> &fnAbort, std::vector<PathFind::PathNode> *pPathV)
+{
+    BitGrid stBlock;
+    if(rstJob.CheckCO){
+        stBlock = rstJob.Occupy.CO;
+        stBlock.Or(rstJob.Occupy.Lock);
+    }
+
+    JPSPathFinder stJPSFinder(rstJob.Ground->Bits(), rstJob.CheckCO ? &stBlock : nullptr, rstJob.Occupy.X, rstJob.Occupy.Y, rstJob.MaxStep);
+    if(stJPSFinder.Search(rstJob.X, rstJob.Y, nEndX, nEndY, fnAbort)){
+        // passing one CO costs 100.00
+        // take the detour only if it's cheaper than any path through a CO
+        if(false
+                || !rstJob.CheckCO
+                || stJPSFinder.Cost() < JPSPathFinder::MinCost(rstJob.MaxStep, rstJob.X, rstJob.Y, nEndX, nEndY) + 100.00){
+            *pPathV = stJPSFinder.Path();
+            return true;
+        }
+    }
+
+    // without CheckCO grids are all the same
+    // JPS failing means there is no path, or the job is given up
+    if(!rstJob.CheckCO || fnAbort()){
+        return false;
+    }
+
+    // goal is surrounded or the detour is too long
+    // A* with CO cost stops as close as possible
+    ServicePathFinder stPathFinder(rstJob);
+    if(!(true
+                && stPathFinder.Search(rstJob.X, rstJob.Y, nEndX, nEndY, fnAbort)
+                && stPathFinder.GetSolutionStart())){
+        return false;
+    }
+
+    pPathV->clear();
+    pPathV->emplace_back(rstJob.X, rstJob.Y);
+
+    while(auto pNode1 = stPathFinder.GetSolutionNext()){
+        int nCurrX = pPathV->back().X;
+        int nCurrY = pPathV->back().Y;
+        int nHopX  = pNode1->X();
+        int nHopY  = pNode1->Y();
+
+        if(HopMaxIndex(nCurrX, nCurrY, nHopX, nHopY) <= 0){
+            extern MonoServer *g_MonoServer;
+            g_MonoServer->AddLog(LOGTYPE_WARNING, "Invalid path node");
+            return false;
+        }
+
+        int nDX = (nHopX > nCurrX) - (nHopX < nCurrX);
+        int nDY = (nHopY > nCurrY) - (nHopY < nCurrY);
+
+        while(nCurrX != nHopX || nCurrY != nHopY){
+            nCurrX += nDX;
+            nCurrY += nDY;
+            pPathV->emplace_back(nCurrX, nCurrY);
+        }
+    }
+    return true;
+}
+
+// plan on the navigation graph and refine the first part only
+// result is single hops from start to one of the first waypoints, not to the goal
+static bool FindRoute(const PathFindService::PathFindJob &rstJob, const std::function<bool()> &fnAbort, std::vector<PathFind::PathNode> *pPathV)
+{
+    std::vector<PathFind::PathNode> stWaypointV;
+    if(!rstJob.Ground->Nav().Search(rstJob.Ground->Bits(), rstJob.X, rstJob.Y, rstJob.EndX, rstJob.EndY, &stWaypointV)){
+        return false;
+    }
+
+    // refine to the first waypoint out of the response
+    // two waypoints in a row are at most in two clusters, the search is local
+    auto nPointCount = (int)(sizeof(AMPathFindOK::Point) / sizeof(AMPathFindOK::Point[0]));
+    auto pWaypoint   = stWaypointV.begin() + 1;
+
+    while(true
+            && pWaypoint + 1 != stWaypointV.end()
+            && std::max<int>(std::abs(pWaypoint->X - rstJob.X), std::abs(pWaypoint->Y - rstJob.Y)) < nPointCount){
+        ++pWaypoint;
+    }
+    return FindPath(rstJob, pWaypoint->X, pWaypoint->Y, fnAbort, pPathV);
+}
+
+PathFindService::PathFindService(size_t nWorkerCount, size_t nQueueSize, uint32_t nCacheTime)
+    : m_QueueSize(nQueueSize ? nQueueSize : 1)
+    , m_Stop(false)
+    , m_Seq(0)
+    , m_QueueLock()
+    , m_Condition()
+    , m_JobQ()
+    , m_WorkThreadV()
+    , m_LatestSeq()
+    , m_CacheTime(nCacheTime)
+    , m_CacheLock()
+    , m_PathCache()
+{
+    for(size_t nIndex = 0; nIndex < std::max<size_t>(nWorkerCount, 1); ++nIndex){
+        m_WorkThreadV.emplace_back([this]()
+        {
+            SyncDriver stSyncDriver;
+            while(true){
+                PathFindJob stJob;
+                {
+                    std::unique_lock<std::mutex> stUniqueLock(m_QueueLock);
+                    m_Condition.wait(stUniqueLock, [this](){ return m_Stop || !m_JobQ.empty(); });
+
+                    // drop pending jobs when stopping
+                    // requestors are gone with the framework
+                    if(m_Stop){
+                        break;
+                    }
+
+                    stJob = std::move(m_JobQ.front());
+                    m_JobQ.pop();
+                }
+                RunJob(stJob, stSyncDriver);
+            }
+        });
+    }
+}
+
+PathFindService::~PathFindService()
+{
+    {
+        std::lock_guard<std::mutex> stLockGuard(m_QueueLock);
+        m_Stop = true;
+    }
+    m_Condition.notify_all();
+
+    for(auto &stWorker: m_WorkThreadV){
+        stWorker.join();
+    }
+}
+
+bool PathFindService::Post(PathFindJob stJob)
+{
+    if(!(true
+                && stJob.Ground
+                && (stJob.MaxStep >= 1 && stJob.MaxStep <= 3))){
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> stLockGuard(m_QueueLock);
+        if(false
+                || m_Stop
+                || m_JobQ.size() >= m_QueueSize){
+            return false;
+        }
+
+        // 0 is reserved as no job
+        // newer job of the same UID makes the old one stale
+        m_Seq = (m_Seq + 1) ? (m_Seq + 1) : 1;
+        stJob.Seq = m_Seq;
+
+        m_LatestSeq[stJob.UID] = stJob.Seq;
+        m_JobQ.push(std::move(stJob));
+    }
+
+    m_Condition.notify_one();
+    return true;
+}
+
+void PathFindService::Cancel(uint32_t nUID)
+{
+    std::lock_guard<std::mutex> stLockGuard(m_QueueLock);
+    m_LatestSeq.erase(nUID);
+}
+
+bool PathFindService::Latest(uint32_t nUID, uint32_t nSeq)
+{
+    std::lock_guard<std::mutex> stLockGuard(m_QueueLock);
+    auto pRecord = m_LatestSeq.find(nUID);
+    return (pRecord != m_LatestSeq.end()) && (pRecord->second == nSeq);
+}
+
+void PathFindService::Done(uint32_t nUID, uint32_t nSeq)
+{
+    std::lock_guard<std::mutex> stLockGuard(m_QueueLock);
+    auto pRecord = m_LatestSeq.find(nUID);
+    if((pRecord != m_LatestSeq.end()) && (pRecord->second == nSeq)){
+        m_LatestSeq.erase(pRecord);
+    }
+}
+
+bool PathFindService::LoadCache(const PathFindJob &rstJob, uint32_t nNow, std::vector<PathFind::PathNode> *pPathV)
+{
+    if(!m_CacheTime){
+        return false;
+    }
+
+    std::shared_ptr<const std::vector<PathFind::PathNode>> pCachePath;
+    {
+        std::lock_guard<std::mutex> stLockGuard(m_CacheLock);
+        auto pRecord = m_PathCache.find({rstJob.MapID, rstJob.MaxStep, rstJob.CheckCO, rstJob.EndX, rstJob.EndY, rstJob.X / PATHCACHE_REGION, rstJob.Y / PATHCACHE_REGION});
+        if(false
+                || pRecord == m_PathCache.end()
+                || nNow - pRecord->second.Tick >= m_CacheTime){
+            return false;
+        }
+        pCachePath = pRecord->second.Path;
+    }
+
+    // splice at the furthest grid next to start
+    // then a follower never walks back along the path
+    int nSplice = -1;
+    for(int nIndex = (int)(pCachePath->size()) - 1; nIndex >= 0; --nIndex){
+        if(LDistance2(rstJob.X, rstJob.Y, (*pCachePath)[nIndex].X, (*pCachePath)[nIndex].Y) <= 2){
+            nSplice = nIndex;
+            break;
+        }
+    }
+
+    if(nSplice < 0){
+        return false;
+    }
+
+    pPathV->clear();
+    if(false
+            || (*pCachePath)[nSplice].X != rstJob.X
+            || (*pCachePath)[nSplice].Y != rstJob.Y){
+        pPathV->emplace_back(rstJob.X, rstJob.Y);
+    }
+    pPathV->insert(pPathV->end(), pCachePath->begin() + nSplice, pCachePath->end());
+
+    // only check grids in the response
+    // CO on the rest of the path moves before the requestor gets there
+    if(rstJob.CheckCO){
+        auto nPointCount = sizeof(AMPathFindOK::Point) / sizeof(AMPathFindOK::Point[0]);
+        for(size_t nIndex = 1; nIndex < std::min<size_t>(pPathV->size(), nPointCount); ++nIndex){
+            auto nX = (*pPathV)[nIndex].X;
+            auto nY = (*pPathV)[nIndex].Y;
+            if(true
+                    && !(nX == rstJob.EndX && nY == rstJob.EndY)
+                    && rstJob.Occupy.Get(nX, nY)){
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void PathFindService::SaveCache(const PathFindJob &rstJob, uint32_t nNow, const std::vector<PathFind::PathNode> &rstPathV)
+{
+    if(!m_CacheTime || rstPathV.size() < 2){
+        return;
+    }
+
+    auto pCachePath = std::make_shared<const std::vector<PathFind::PathNode>>(rstPathV);
+
+    std::lock_guard<std::mutex> stLockGuard(m_CacheLock);
+    if(m_PathCache.size() >= PATHCACHE_SIZE){
+        for(auto pRecord = m_PathCache.begin(); pRecord != m_PathCache.end();){
+            if(nNow - pRecord->second.Tick >= m_CacheTime){
+                pRecord = m_PathCache.erase(pRecord);
+            }else{
+                ++pRecord;
+            }
+        }
+
+        if(m_PathCache.size() >= PATHCACHE_SIZE){
+            m_PathCache.clear();
+        }
+    }
+
+    // save to the first regions the path passes
+    // followers are most likely behind the requestor
+    int nRegionCount = 0;
+    PathCacheKey stLastKey {rstJob.MapID, rstJob.MaxStep, rstJob.CheckCO, rstJob.EndX, rstJob.EndY, -1, -1};
+
+    for(auto &rstNode: rstPathV){
+        auto stKey = stLastKey;
+        stKey.RegionX = rstNode.X / PATHCACHE_REGION;
+        stKey.RegionY = rstNode.Y / PATHCACHE_REGION;
+
+        if(stKey == stLastKey){
+            continue;
+        }
+
+        m_PathCache[stKey] = {nNow, pCachePath};
+        stLastKey = stKey;
+
+        if(++nRegionCount >= PATHCACHE_REGIONMAX){
+            break;
+        }
+    }
+}
+
+void PathFindService::RunJob(const PathFindJob &rstJob, SyncDriver &rstSyncDriver)
+{
+    AMPathFindOK stAMPFOK;
+    stAMPFOK.UID   = rstJob.UID;
+    stAMPFOK.MapID = rstJob.MapID;
+
+    // we fill all slots with -1 for initialization
+    // won't keep a record of ``how many path nodes are valid"
+    auto nPathCount = (int)(sizeof(stAMPFOK.Point) / sizeof(stAMPFOK.Point[0]));
+    for(int nIndex = 0; nIndex < nPathCount; ++nIndex){
+        stAMPFOK.Point[nIndex].X = -1;
+        stAMPFOK.Point[nIndex].Y = -1;
+    }
+
+    // checked every several search steps
+    // a stale job gives up as early as possible
+    auto fnAbort = [this, &rstJob]() -> bool
+    {
+        extern MonoServer *g_MonoServer;
+        return false
+            || g_MonoServer->GetTimeTick() >= rstJob.Deadline
+            || !Latest(rstJob.UID, rstJob.Seq);
+    };
+
+    extern MonoServer *g_MonoServer;
+    auto nNow = g_MonoServer->GetTimeTick();
+
+    bool bFound = false;
+    std::vector<PathFind::PathNode> stPathV;
+
+    if(LoadCache(rstJob, nNow, &stPathV)){
+        bFound = true;
+    }else if(!fnAbort()){
+        // route of the graph doesn't reach the goal
+        // it's not put into the cache
+        if(true
+                && rstJob.Ground->Nav().Valid()
+                && std::max<int>(std::abs(rstJob.EndX - rstJob.X), std::abs(rstJob.EndY - rstJob.Y)) > PATHFIND_ROUTEDISTANCE){
+            bFound = FindRoute(rstJob, fnAbort, &stPathV);
+        }
+
+        if(!bFound && !fnAbort()){
+            bFound = FindPath(rstJob, rstJob.EndX, rstJob.EndY, fnAbort, &stPathV);
+            if(bFound){
+                SaveCache(rstJob, nNow, stPathV);
+            }
+        }
+    }
+
+    if(bFound){
+        for(int nIndex = 0; nIndex < std::min<int>(nPathCount, (int)(stPathV.size())); ++nIndex){
+            stAMPFOK.Point[nIndex].X = stPathV[nIndex].X;
+            stAMPFOK.Point[nIndex].Y = stPathV[nIndex].Y;
+        }
+    }
+
+    Done(rstJob.UID, rstJob.Seq);
+
+    // requestor always waits for a response
+    // stale or failed job responds MPK_ERROR
+    if(bFound){
+        rstSyncDriver.Forward({MPK_PATHFINDOK, stAMPFOK}, rstJob.Address, rstJob.Respond);
+    }else{
+        rstSyncDriver.Forward(MPK_ERROR, rstJob.Address, rstJob.Respond);
+    }
+}
@@ -0,0 +1,285 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: pathfindservice.hpp
+ *        Created: 11/26/2017 10:12:37
+ *  Last Modified: 12/09/2017 23:35:42
+ *
+ *    Description: path finding out of the map actor
+ *
+ *                 ServerMap used to run the A* search inside On_MPK_PATHFIND, then one
+ *                 long search blocks all other messages of the map
+ *
+ *                 PathFindService has its own worker threads, the map only prepares a
+ *                 job and returns immediately, a job contains:
+ *
+ *                      1. ground grid, built once per map and never changed, shared
+ *                      2. occupancy window, copied by the map actor around the start
+ *                         and end point when CheckCO is set, cells out of the window
+ *                         are taken as free, copied word by word from map bitmaps
+ *
+ *                 then the worker never touches the map, result is sent back to the
+ *                 requestor by the worker's SyncDriver as response to the request
+ *
+ *                 search is JPSPathFinder with CO and lock as blocked, if the goal can't
+ *                 be reached that way, or the detour costs more than passing a CO, it
+ *                 falls back to AStarPathFinder with CO cost as before
+ *
+ *                 long route is planned on NavGraph of the map first, only the part to the
+ *                 first waypoints gets refined by the grid search, the requestor takes a
+ *                 few grids of the route each time, the rest is never refined
+ *
+ *                 monsters chasing one target ask for almost the same path one by one
+ *                 found paths are kept for a short time, keyed by the goal and regions
+ *                 the path passes, a request starting next to a kept path takes the rest
+ *                 of it without searching, only the grids put in the response are checked
+ *                 against the occupancy window, the requestor moves one hop and asks again
+ *
+ *                 a job is dropped with MPK_ERROR if
+ *                      1. it reaches the deadline, checked during search
+ *                      2. a newer job with the same UID is posted
+ *                      3. Cancel(UID) is called, i.e. the object is gone
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <queue>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_map>
+#include <condition_variable>
+#include <Theron/Theron.h>
+#include "bitgrid.hpp"
+#include "navgraph.hpp"
+#include "pathfinder.hpp"
+
+class SyncDriver;
+class PathFindService final
+{
+    public:
+        // walkable ground of one map
+        // built by the map when loading and read by all workers
+        class GroundGrid final
+        {
+            private:
+                BitGrid  m_CanThrough;
+                NavGraph m_NavGraph;
+
+            public:
+                // graph from the map pack is taken as a view
+                // otherwise build it here, takes some ms for a large map
+                template<typename F> GroundGrid(int nW, int nH, F &&fnGroundValid, const NavGraph *pNavGraph = nullptr)
+                    : m_CanThrough(nW, nH)
+                    , m_NavGraph()
+                {
+                    for(int nY = 0; nY < m_CanThrough.H(); ++nY){
+                        for(int nX = 0; nX < m_CanThrough.W(); ++nX){
+                            m_CanThrough.Set(nX, nY, fnGroundValid(nX, nY));
+                        }
+                    }
+
+                    if(!(true
+                                && pNavGraph
+                                && pNavGraph->W() == nW
+                                && pNavGraph->H() == nH
+                                && m_NavGraph.View(pNavGraph->Data(), pNavGraph->DataLen()))){
+                        m_NavGraph.Build(m_CanThrough);
+                    }
+                }
+
+            public:
+                int W() const { return m_CanThrough.W(); }
+                int H() const { return m_CanThrough.H(); }
+
+            public:
+                bool GroundValid(int nX, int nY) const
+                {
+                    return m_CanThrough.Get(nX, nY);
+                }
+
+                const BitGrid &Bits() const
+                {
+                    return m_CanThrough;
+                }
+
+                const NavGraph &Nav() const
+                {
+                    return m_NavGraph;
+                }
+        };
+
+    public:
+        enum OccupyType: uint8_t
+        {
+            OCCUPY_NONE = 0,
+            OCCUPY_CO   = 1,
+            OCCUPY_LOCK = 2,
+        };
+
+        // copy of CO and lock state in a rectangle
+        // taken by the map when posting the job, no lock needed
+        struct OccupyGrid
+        {
+            int X;
+            int Y;
+
+            BitGrid CO;
+            BitGrid Lock;
+
+            OccupyGrid()
+                : X(0)
+                , Y(0)
+                , CO()
+                , Lock()
+            {}
+
+            uint8_t Get(int nX, int nY) const
+            {
+                return 0
+                    | (CO  .Get(nX - X, nY - Y) ? OCCUPY_CO   : OCCUPY_NONE)
+                    | (Lock.Get(nX - X, nY - Y) ? OCCUPY_LOCK : OCCUPY_NONE);
+            }
+        };
+
+    public:
+        struct PathFindJob
+        {
+            uint32_t UID;
+            uint32_t MapID;
+
+            int  MaxStep;
+            bool CheckCO;
+
+            int X;
+            int Y;
+            int EndX;
+            int EndY;
+
+            // by g_MonoServer->GetTimeTick()
+            uint32_t Deadline;
+
+            std::shared_ptr<const GroundGrid> Ground;
+            OccupyGrid Occupy;
+
+            // where to send the result
+            // Respond is ID of the request message
+            Theron::Address Address;
+            uint32_t        Respond;
+
+            // assigned in Post()
+            uint32_t Seq;
+        };
+
+    private:
+        const size_t m_QueueSize;
+
+    private:
+        bool                     m_Stop;
+        uint32_t                 m_Seq;
+        std::mutex               m_QueueLock;
+        std::condition_variable  m_Condition;
+        std::queue<PathFindJob>  m_JobQ;
+        std::vector<std::thread> m_WorkThreadV;
+
+    private:
+        // UID -> Seq of the latest job
+        // removed when the latest job is done or cancelled
+        std::unordered_map<uint32_t, uint32_t> m_LatestSeq;
+
+    private:
+        struct PathCacheKey
+        {
+            uint32_t MapID;
+            int      MaxStep;
+            bool     CheckCO;
+
+            int EndX;
+            int EndY;
+
+            // region of a grid on the path
+            // by PATHCACHE_REGION
+            int RegionX;
+            int RegionY;
+
+            bool operator == (const PathCacheKey &rstKey) const
+            {
+                return true
+                    && MapID   == rstKey.MapID
+                    && MaxStep == rstKey.MaxStep
+                    && CheckCO == rstKey.CheckCO
+                    && EndX    == rstKey.EndX
+                    && EndY    == rstKey.EndY
+                    && RegionX == rstKey.RegionX
+                    && RegionY == rstKey.RegionY;
+            }
+        };
+
+        struct PathCacheKeyHash
+        {
+            size_t operator () (const PathCacheKey &rstKey) const
+            {
+                uint64_t nHash = rstKey.MapID;
+                nHash = nHash * 131 + (uint64_t)(rstKey.MaxStep) * 2 + (rstKey.CheckCO ? 1 : 0);
+                nHash = nHash * 131 + (((uint64_t)(rstKey.EndX)    & 0XFFFF) << 16) + ((uint64_t)(rstKey.EndY)    & 0XFFFF);
+                nHash = nHash * 131 + (((uint64_t)(rstKey.RegionX) & 0XFFFF) << 16) + ((uint64_t)(rstKey.RegionY) & 0XFFFF);
+                return (size_t)(nHash);
+            }
+        };
+
+        struct PathCacheRecord
+        {
+            uint32_t Tick;
+            std::shared_ptr<const std::vector<PathFind::PathNode>> Path;
+        };
+
+    private:
+        // in ms, zero disables the cache
+        // one path is shared by records of all its regions
+        const uint32_t m_CacheTime;
+        std::mutex     m_CacheLock;
+        std::unordered_map<PathCacheKey, PathCacheRecord, PathCacheKeyHash> m_PathCache;
+
+    public:
+        PathFindService(size_t, size_t, uint32_t);
+       ~PathFindService();
+
+    public:
+        // called by map actors, never runs the search
+        // return false if the queue is full, caller should respond MPK_ERROR
+        bool Post(PathFindJob);
+
+    public:
+        // drop all pending or running jobs of this UID
+        void Cancel(uint32_t);
+
+    public:
+        size_t Pending()
+        {
+            std::lock_guard<std::mutex> stLockGuard(m_QueueLock);
+            return m_JobQ.size();
+        }
+
+    private:
+        bool Latest(uint32_t, uint32_t);
+        void Done(uint32_t, uint32_t);
+
+    private:
+        bool LoadCache(const PathFindJob &, uint32_t, std::vector<PathFind::PathNode> *);
+        void SaveCache(const PathFindJob &, uint32_t, const std::vector<PathFind::PathNode> &);
+
+    private:
+        void RunJob(const PathFindJob &, SyncDriver &);
+};
@@ -3,7 +3,7 @@
  *
  *       Filename: player.cpp
  *        Created: 04/07/2016 03:48:41 AM
- *  Last Modified: 11/03/2017 17:50:24
+ *  Last Modified: 11/19/2017 02:14:36
  *
  *    Description: 
  *
@@ -28,6 +28,8 @@
 #include "friendtype.hpp"
 #include "protocoldef.hpp"
 
+constexpr uint32_t Player::ClassTag;
+
 Player::Player(uint32_t nDBID,
         ServiceCore    *pServiceCore,
         ServerMap      *pServerMap,
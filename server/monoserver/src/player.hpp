@@ -3,7 +3,7 @@
  *
  *       Filename: player.hpp
  *        Created: 04/08/2016 22:37:01
- *  Last Modified: 10/31/2017 12:03:40
+ *  Last Modified: 11/19/2017 02:14:36
  *
  *    Description: 
  *
@@ -54,6 +54,15 @@ typedef struct stPLAYERFEATUREEX
 
 class Player: public CharObject
 {
+    public:
+        static constexpr uint32_t ClassTag = CLASSTAG_PLAYER | CharObject::ClassTag;
+
+    public:
+        uint32_t GetClassTag() const
+        {
+            return Player::ClassTag;
+        }
+
     protected:
         const uint32_t m_DBID;
         const uint32_t m_JobID;
@@ -3,7 +3,7 @@
  *
  *       Filename: playerop.cpp
  *        Created: 05/11/2016 17:37:54
- *  Last Modified: 10/31/2017 12:04:31
+ *  Last Modified: 12/11/2017 21:14:07
  *
  *    Description: 
  *
@@ -57,6 +57,7 @@ void Player::On_MPK_BINDSESSION(const MessagePack &rstMPK, const Theron::Address
 
     if(ActorPodValid() && m_Map->ActorPodValid()){
         AMPullCOInfo stAMPCOI;
+        stAMPCOI.UID       = UID();
         stAMPCOI.SessionID = SessionID();
         m_ActorPod->Forward({MPK_PULLCOINFO, stAMPCOI}, m_Map->GetAddress());
     }
@@ -172,6 +173,7 @@ void Player::On_MPK_MAPSWITCH(const MessagePack &rstMPK, const Theron::Address &
 
                                                 // 4. pull all co's on the new map
                                                 AMPullCOInfo stAMPCOI;
+                                                stAMPCOI.UID       = UID();
                                                 stAMPCOI.SessionID = SessionID();
                                                 m_ActorPod->Forward({MPK_PULLCOINFO, stAMPCOI}, m_Map->GetAddress());
 
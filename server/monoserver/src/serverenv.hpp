@@ -3,7 +3,7 @@
  *
  *       Filename: serverenv.hpp
  *        Created: 05/12/2017 16:33:25
- *  Last Modified: 05/17/2017 12:04:29
+ *  Last Modified: 12/15/2017 21:52:40
  *
  *    Description: use environment to setup the runtime message report:
  *
@@ -26,6 +26,7 @@
 #pragma once
 #include <string>
 #include <cstdint>
+#include <cstdlib>
 
 struct ServerEnv
 {
@@ -33,11 +34,108 @@ struct ServerEnv
     bool MIR2X_DEBUG_PRINT_AM_COUNT;
     bool MIR2X_DEBUG_PRINT_AM_FORWARD;
 
+    // runtime log level, -1 for debug, 0 for info
+    // message forwarding is printed as debug log
+    int MIR2X_CONFIG_LOG_LEVEL;
+
+    // interval in ms to dump actor metrics to the log
+    // zero disables the dump but metrics are still recorded
+    int MIR2X_CONFIG_METRICS_DUMP;
+
+    // broadcast radius of map events
+    // zero or invalid setting means use the default
+    int MIR2X_CONFIG_AOI_ACTION;
+    int MIR2X_CONFIG_AOI_UPDATEHP;
+    int MIR2X_CONFIG_AOI_DEADFADEOUT;
+    int MIR2X_CONFIG_AOI_OFFLINE;
+    int MIR2X_CONFIG_AOI_DROPITEM;
+
+    // tick interval in ms of map objects
+    // and how long a monster without player around goes to sleep
+    int MIR2X_CONFIG_TICK_PLAYER;
+    int MIR2X_CONFIG_TICK_MONSTER;
+    int MIR2X_CONFIG_TICK_IDLE;
+    int MIR2X_CONFIG_TICK_BATCH;
+
+    // nonzero to let map decide masterless monsters in one pass
+    // monster gets MPK_AIINTENT instead of MPK_METRONOME, see MonsterAI
+    int MIR2X_CONFIG_TICK_BATCHAI;
+
+    // coalesced send of sessions
+    // max bytes / messages in one write, and how long small messages wait to be batched
+    // zero delay means flush as soon as possible
+    int MIR2X_CONFIG_NET_SENDBYTES;
+    int MIR2X_CONFIG_NET_SENDCOUNT;
+    int MIR2X_CONFIG_NET_SENDDELAY;
+    int MIR2X_CONFIG_NET_SENDMINBYTES;
+
+    // initial size of session inbound buffer
+    int MIR2X_CONFIG_NET_READBUF;
+
+    // io_service shards of NetPodN, each has one thread
+    // zero means one for each core
+    int MIR2X_CONFIG_NET_WORKER;
+
+    // accept CM_ACTIONDELTA from client, then SM_ACTION is sent as delta when possible
+    int MIR2X_CONFIG_NET_ACTIONDELTA;
+
+    // accept CM_FRAME from client, then each send batch of more than one message goes as one SM_FRAME
+    // 0 : ignore CM_FRAME
+    // 1 : pack only
+    // 2 : pack and compress the frame as a whole if it's smaller
+    int MIR2X_CONFIG_NET_FRAME;
+
+    // worker count and max pending jobs of the database pipeline
+    int MIR2X_CONFIG_DB_WORKER;
+    int MIR2X_CONFIG_DB_QUEUE;
+
+    // path finding service
+    // timeout in ms, margin in grids of the occupancy window around start and end
+    // cache in ms as how long a found path can be reused, zero disables it
+    int MIR2X_CONFIG_PATHFIND_WORKER;
+    int MIR2X_CONFIG_PATHFIND_QUEUE;
+    int MIR2X_CONFIG_PATHFIND_TIMEOUT;
+    int MIR2X_CONFIG_PATHFIND_MARGIN;
+    int MIR2X_CONFIG_PATHFIND_CACHE;
+
     ServerEnv()
     {
         MIR2X_DEBUG = std::getenv("MIR2X_DEBUG") ? std::atoi(std::getenv("MIR2X_DEBUG")) : 0;
 
         MIR2X_DEBUG_PRINT_AM_COUNT   = (MIR2X_DEBUG >= 5) ? true : (std::getenv("MIR2X_DEBUG_PRINT_AM_COUNT"  ) ? true : false);
         MIR2X_DEBUG_PRINT_AM_FORWARD = (MIR2X_DEBUG >= 5) ? true : (std::getenv("MIR2X_DEBUG_PRINT_AM_FORWARD") ? true : false);
+
+        MIR2X_CONFIG_LOG_LEVEL       = std::getenv("MIR2X_CONFIG_LOG_LEVEL"      ) ? std::atoi(std::getenv("MIR2X_CONFIG_LOG_LEVEL"      )) : (MIR2X_DEBUG_PRINT_AM_FORWARD ? -1 : 0);
+        MIR2X_CONFIG_METRICS_DUMP    = std::getenv("MIR2X_CONFIG_METRICS_DUMP"   ) ? std::atoi(std::getenv("MIR2X_CONFIG_METRICS_DUMP"   )) : 60000;
+
+        MIR2X_CONFIG_AOI_ACTION      = std::getenv("MIR2X_CONFIG_AOI_ACTION"     ) ? std::atoi(std::getenv("MIR2X_CONFIG_AOI_ACTION"     )) : 0;
+        MIR2X_CONFIG_AOI_UPDATEHP    = std::getenv("MIR2X_CONFIG_AOI_UPDATEHP"   ) ? std::atoi(std::getenv("MIR2X_CONFIG_AOI_UPDATEHP"   )) : 0;
+        MIR2X_CONFIG_AOI_DEADFADEOUT = std::getenv("MIR2X_CONFIG_AOI_DEADFADEOUT") ? std::atoi(std::getenv("MIR2X_CONFIG_AOI_DEADFADEOUT")) : 0;
+        MIR2X_CONFIG_AOI_OFFLINE     = std::getenv("MIR2X_CONFIG_AOI_OFFLINE"    ) ? std::atoi(std::getenv("MIR2X_CONFIG_AOI_OFFLINE"    )) : 0;
+        MIR2X_CONFIG_AOI_DROPITEM    = std::getenv("MIR2X_CONFIG_AOI_DROPITEM"   ) ? std::atoi(std::getenv("MIR2X_CONFIG_AOI_DROPITEM"   )) : 0;
+
+        MIR2X_CONFIG_TICK_PLAYER     = std::getenv("MIR2X_CONFIG_TICK_PLAYER"    ) ? std::atoi(std::getenv("MIR2X_CONFIG_TICK_PLAYER"    )) : 300;
+        MIR2X_CONFIG_TICK_MONSTER    = std::getenv("MIR2X_CONFIG_TICK_MONSTER"   ) ? std::atoi(std::getenv("MIR2X_CONFIG_TICK_MONSTER"   )) : 300;
+        MIR2X_CONFIG_TICK_IDLE       = std::getenv("MIR2X_CONFIG_TICK_IDLE"      ) ? std::atoi(std::getenv("MIR2X_CONFIG_TICK_IDLE"      )) : 10000;
+        MIR2X_CONFIG_TICK_BATCH      = std::getenv("MIR2X_CONFIG_TICK_BATCH"     ) ? std::atoi(std::getenv("MIR2X_CONFIG_TICK_BATCH"     )) : 0;
+        MIR2X_CONFIG_TICK_BATCHAI    = std::getenv("MIR2X_CONFIG_TICK_BATCHAI"   ) ? std::atoi(std::getenv("MIR2X_CONFIG_TICK_BATCHAI"   )) : 0;
+
+        MIR2X_CONFIG_NET_SENDBYTES    = std::getenv("MIR2X_CONFIG_NET_SENDBYTES"   ) ? std::atoi(std::getenv("MIR2X_CONFIG_NET_SENDBYTES"   )) : 65536;
+        MIR2X_CONFIG_NET_SENDCOUNT    = std::getenv("MIR2X_CONFIG_NET_SENDCOUNT"   ) ? std::atoi(std::getenv("MIR2X_CONFIG_NET_SENDCOUNT"   )) : 1024;
+        MIR2X_CONFIG_NET_SENDDELAY    = std::getenv("MIR2X_CONFIG_NET_SENDDELAY"   ) ? std::atoi(std::getenv("MIR2X_CONFIG_NET_SENDDELAY"   )) : 0;
+        MIR2X_CONFIG_NET_SENDMINBYTES = std::getenv("MIR2X_CONFIG_NET_SENDMINBYTES") ? std::atoi(std::getenv("MIR2X_CONFIG_NET_SENDMINBYTES")) : 1400;
+        MIR2X_CONFIG_NET_READBUF      = std::getenv("MIR2X_CONFIG_NET_READBUF"     ) ? std::atoi(std::getenv("MIR2X_CONFIG_NET_READBUF"     )) : 4096;
+        MIR2X_CONFIG_NET_WORKER       = std::getenv("MIR2X_CONFIG_NET_WORKER"      ) ? std::atoi(std::getenv("MIR2X_CONFIG_NET_WORKER"      )) : 0;
+        MIR2X_CONFIG_NET_ACTIONDELTA  = std::getenv("MIR2X_CONFIG_NET_ACTIONDELTA" ) ? std::atoi(std::getenv("MIR2X_CONFIG_NET_ACTIONDELTA" )) : 1;
+        MIR2X_CONFIG_NET_FRAME        = std::getenv("MIR2X_CONFIG_NET_FRAME"       ) ? std::atoi(std::getenv("MIR2X_CONFIG_NET_FRAME"       )) : 2;
+
+        MIR2X_CONFIG_DB_WORKER        = std::getenv("MIR2X_CONFIG_DB_WORKER"       ) ? std::atoi(std::getenv("MIR2X_CONFIG_DB_WORKER"       )) : 4;
+        MIR2X_CONFIG_DB_QUEUE         = std::getenv("MIR2X_CONFIG_DB_QUEUE"        ) ? std::atoi(std::getenv("MIR2X_CONFIG_DB_QUEUE"        )) : 1024;
+
+        MIR2X_CONFIG_PATHFIND_WORKER  = std::getenv("MIR2X_CONFIG_PATHFIND_WORKER" ) ? std::atoi(std::getenv("MIR2X_CONFIG_PATHFIND_WORKER" )) : 2;
+        MIR2X_CONFIG_PATHFIND_QUEUE   = std::getenv("MIR2X_CONFIG_PATHFIND_QUEUE"  ) ? std::atoi(std::getenv("MIR2X_CONFIG_PATHFIND_QUEUE"  )) : 4096;
+        MIR2X_CONFIG_PATHFIND_TIMEOUT = std::getenv("MIR2X_CONFIG_PATHFIND_TIMEOUT") ? std::atoi(std::getenv("MIR2X_CONFIG_PATHFIND_TIMEOUT")) : 200;
+        MIR2X_CONFIG_PATHFIND_MARGIN  = std::getenv("MIR2X_CONFIG_PATHFIND_MARGIN" ) ? std::atoi(std::getenv("MIR2X_CONFIG_PATHFIND_MARGIN" )) : 16;
+        MIR2X_CONFIG_PATHFIND_CACHE   = std::getenv("MIR2X_CONFIG_PATHFIND_CACHE"  ) ? std::atoi(std::getenv("MIR2X_CONFIG_PATHFIND_CACHE"  )) : 500;
     }
 };
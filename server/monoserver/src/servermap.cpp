@@ -3,7 +3,7 @@
  *
  *       Filename: servermap.cpp
  *        Created: 04/06/2016 08:52:57 PM
- *  Last Modified: 10/31/2017 15:45:22
+ *  Last Modified: 12/17/2017 21:48:51
  *
  *    Description: 
  *
@@ -26,226 +26,26 @@
 #include "mathfunc.hpp"
 #include "sysconst.hpp"
 #include "servermap.hpp"
+#include "serverenv.hpp"
 #include "mapbindbn.hpp"
 #include "charobject.hpp"
 #include "monoserver.hpp"
 #include "dbcomrecord.hpp"
 #include "rotatecoord.hpp"
 
-ServerMap::ServerPathFinder::ServerPathFinder(ServerMap *pMap, int nMaxStep, bool bCheckCO)
-    : AStarPathFinder(
-            // 1. step check function
-            //    validate pMap in constructor body
-            [pMap, nMaxStep](int nSrcX, int nSrcY, int nDstX, int nDstY) -> bool
-            {
-                // for server we always check ground
-                // there shouldn't be any motion through invalid grids while client could be
-
-                // skip some parameter checking
-                // but put the code here for completion
-
-                if(0){
-                    if(true
-                            && nMaxStep != 1
-                            && nMaxStep != 2
-                            && nMaxStep != 3){
-
-                        extern MonoServer *g_MonoServer;
-                        g_MonoServer->AddLog(LOGTYPE_FATAL, "Invalid MaxStep provided: %d, should be (1, 2, 3)", nMaxStep);
-                        return false;
-                    }
-
-                    int nDistance2 = LDistance2(nSrcX, nSrcY, nDstX, nDstY);
-                    if(true
-                            && nDistance2 != 1
-                            && nDistance2 != 2
-                            && nDistance2 != nMaxStep * nMaxStep
-                            && nDistance2 != nMaxStep * nMaxStep * 2){
-
-                        extern MonoServer *g_MonoServer;
-                        g_MonoServer->AddLog(LOGTYPE_FATAL, "Invalid step checked: (%d, %d) -> (%d, %d)", nSrcX, nSrcY, nDstX, nDstY);
-                        return false;
-                    }
-                }
-
-                // now we are sure:
-                // 1. nMaxStep is 1, 2, 3
-                // 2. distance of given src -> dst is 1, 2, 3
-
-                // no matter bCheckCO set or not
-                // we allow all grids if the ground is valid, ignoring the creature and lock
-
-                return pMap->CanMove(false, false, false, nSrcX, nSrcY, nDstX, nDstY);
-            },
-
-            // 2. move cost function, for directions as following
-            //    
-            //                  0
-            //               7     1
-            //             6    x    2
-            //               5     3
-            //                  4
-            //    we put directions 1, 3, 5, 7 as higher cost because for following grids:
-            //
-            //              A B C D E
-            //              F G H I J
-            //              K L M N O
-            //              P Q R S T
-            //
-            //    if we make all directions equally cost, then G->I: G -> C -> I
-            //    we want the result as G -> H -> I
-            //    
-            //    also read comments in mir2x/client/src/clientpathfinder.cpp
-            //    there are more additional issues and solutions for the cost assignment
-
-            [pMap, nMaxStep, bCheckCO](int nSrcX, int nSrcY, int nDstX, int nDstY) -> double
-            {
-                // checking parameter here
-                // skipped since it's done in AStarPathFinder
-
-                if(0){
-                    if(true
-                            && nMaxStep != 1
-                            && nMaxStep != 2
-                            && nMaxStep != 3){
-
-                        extern MonoServer *g_MonoServer;
-                        g_MonoServer->AddLog(LOGTYPE_FATAL, "Invalid MaxStep provided: %d, should be (1, 2, 3)", nMaxStep);
-                        return 10000.00;
-                    }
-
-                    int nDistance2 = LDistance2(nSrcX, nSrcY, nDstX, nDstY);
-                    if(true
-                            && nDistance2 != 1
-                            && nDistance2 != 2
-                            && nDistance2 != nMaxStep * nMaxStep
-                            && nDistance2 != nMaxStep * nMaxStep * 2){
-
-                        extern MonoServer *g_MonoServer;
-                        g_MonoServer->AddLog(LOGTYPE_FATAL, "Invalid step checked: (%d, %d) -> (%d, %d)", nSrcX, nSrcY, nDstX, nDstY);
-                        return 10000.00;
-                    }
-                }
-
-                double fExtraPen = 0.00;
-                switch(LDistance2(nSrcX, nSrcY, nDstX, nDstY)){
-                    case  1: fExtraPen = 0.00 + 0.01; break;
-                    case  2: fExtraPen = 0.10 + 0.01; break;
-                    case  4: fExtraPen = 0.00 + 0.02; break;
-                    case  8: fExtraPen = 0.10 + 0.02; break;
-                    case  9: fExtraPen = 0.00 + 0.03; break;
-                    case 18: fExtraPen = 0.10 + 0.03; break;
-                    default:
-                        {
-                            extern MonoServer *g_MonoServer;
-                            g_MonoServer->AddLog(LOGTYPE_FATAL, "Invalid step checked: (%d, %d) -> (%d, %d)", nSrcX, nSrcY, nDstX, nDstY);
-                            return 10000.00;
-                        }
-                }
-
-                // for server any hops provided to this function has passed the ground checking
-                // this is done in the above lambda through ServerMap::CanMove(false, srcLoc, dstLoc)
-
-                // here we need to assign different value for provided hops
-                // since the hops provided to this function doesn't do creature check
-                // we assign higher cost if bCheckCO is set and ServerMap::CanMove(true, true, srcLoc, dstLoc) fails
-
-                if(bCheckCO){
-
-                    // if there is no co on the way we take it
-                    // however if there is, we can still take it but with very high cost
-                    // for example: now A is targeting at C
-                    //    +---+---+---+---+---+
-                    //    |   |   |   | C |   |
-                    //    +---+---+---+---+---+
-                    //    |   |   | B |   |   |
-                    //    +---+---+---+---+---+
-                    //    |   | A |   |   |   |
-                    //    +---+---+---+---+---+
-                    //    |   |   |   |   |   |
-                    //    +---+---+---+---+---+
-                    // then we try to find a path Loc(A) -> Loc(C)
-                    // if 1. we always allow if CanMove(0, 0, LOC) is true : co ignored
-                    //    2. we always allow if CanMove(1, 1, LOC) is true : co affects
-                    //
-                    // for solution-1: A will stop at current position since A try to move to LOC(B) but it's occupied
-                    //     solution-2: LOC(A) -> LOC(C) is invalid since start and end point has been taken by themselves
-                    //
-                    // so my solution: 1. always allow if CanMove(0, 0, LOC) is true
-                    //                 2. if currently there is CO in the cell we give a higher cost
-                    // then A will bypass B to go to C and stop as close as possible to C
-                    //
-                    // this also saves if C is surrendered by a lot of CO's
-                    // in which case solution-1 will make A stop at a far distance between C
-                    //               solution-2 will make C un-reachable
-                    //            my solution   will make A stop at a place as close as possible to C
-
-                    // new issue found for current cost strategy
-                    //
-                    //             O O D O O
-                    //             O O X O O
-                    //             B O A O C
-                    //             O O O O O
-                    //
-                    // if now we want A->D with step size = 2, we can do (A->B->D) or (A->C->D), the
-                    // step (A->B) and (A->C) are expensive since A is occupied by the path-finding
-                    // requestor. But now if between A and C the grid is occupied by another CO, our
-                    // current algorithm can't prefer (A->B->D) instead of (A->C->D) !!!
-
-                    // reason is we only get yes/no anwser for (A->B) and (A->D) but no detailed
-                    // information to estimate a cost. solution: assign cost inside map rather than
-                    // in the path finder, which need me to introduce new function
-                    //
-                    //   doulbe ServerMap::MoveCost(bool, bool, bool, int, int, int, int)
-                    //   
-                    // this function gives cost of single hop
-                    // in future's version fExtraPen should be penalty for turn
-                    // and this function can enable we put dynamical cost for some busy hops
-
-                    return pMap->MoveCost(true, true, true, nSrcX, nSrcY, nDstX, nDstY) + fExtraPen;
-                }else{
-                    // won't check creature
-                    // then all walk-able step get cost 1.0 + delta
-                    return 1.00 + fExtraPen;
-                }
-            },
-
-            // max step length for each hop, valid step size : 1, 2, 3
-            // check value in AStarPathFinder::AStarPathFinder() and ServerPathFinder::ServerPathFinder()
-            nMaxStep
-      )
-{
-    // we do it here to complete the logic
-    // this also will be checked in AStarPathFinder::AStarPathFinder()
-    switch(nMaxStep){
-        case 1:
-        case 2:
-        case 3:
-            {
-                break;
-            }
-        default:
-            {
-                extern MonoServer *g_MonoServer;
-                g_MonoServer->AddLog(LOGTYPE_FATAL, "Invalid MaxStep provided: %d, should be (1, 2, 3)", nMaxStep);
-                break;
-            }
-    }
-
-    if(!pMap){
-        extern MonoServer *g_MonoServer;
-        g_MonoServer->AddLog(LOGTYPE_FATAL, "Invalid argument: ServerMap = %p, CheckCreature = %d", pMap, (int)(bCheckCO));
-    }
-}
+constexpr uint32_t ServerMap::ClassTag;
 
 ServerMap::ServerMap(ServiceCore *pServiceCore, uint32_t nMapID)
     : ActiveObject()
     , m_ID(nMapID)
-    , m_Mir2xMapData(*([nMapID]() -> Mir2xMapData *
+    , m_Mir2xMapData(*([nMapID]() -> const Mir2xMapData *
       {
           // server is multi-thread
           // but creating server map is always in service core
 
+          // map from the pack is a view over the mapping
+          // copy it only copies the pointer, data is shared
+
           extern MapBinDBN *g_MapBinDBN;
           auto pMir2xMapData = g_MapBinDBN->Retrieve(nMapID);
 
@@ -254,9 +54,28 @@ ServerMap::ServerMap(ServiceCore *pServiceCore, uint32_t nMapID)
           condcheck(pMir2xMapData);
           return pMir2xMapData;
       }()))
+    , m_GroundGrid(std::make_shared<const PathFindService::GroundGrid>(W(), H(), [this](int nX, int nY) -> bool
+      {
+          return true
+              && m_Mir2xMapData.Valid()
+              && m_Mir2xMapData.ValidC(nX, nY)
+              && m_Mir2xMapData.Cell(nX, nY).CanThrough();
+      }, [nMapID]() -> const NavGraph *
+      {
+          extern MapBinDBN *g_MapBinDBN;
+          return g_MapBinDBN->RetrieveNavGraph(nMapID);
+      }()))
     , m_Metronome(nullptr)
     , m_ServiceCore(pServiceCore)
     , m_CellRecordV2D()
+    , m_COGrid(W(), H())
+    , m_LockGrid(W(), H())
+    , m_GroundItemRecord()
+    , m_AOI(W(), H())
+    , m_TickScheduler()
+    , m_MonsterAI(m_AOI)
+    , m_SessionRecord()
+    , m_SessionIDV()
 {
     m_CellRecordV2D.clear();
     if(m_Mir2xMapData.Valid()){
@@ -406,34 +225,15 @@ void ServerMap::OperateAM(const MessagePack &rstMPK, const Theron::Address &rstF
 
 bool ServerMap::GroundValid(int nX, int nY) const
 {
-    return true
-        && m_Mir2xMapData.Valid()
-        && m_Mir2xMapData.ValidC(nX, nY)
-        && m_Mir2xMapData.Cell(nX, nY).CanThrough();
+    return m_GroundGrid->GroundValid(nX, nY);
 }
 
 bool ServerMap::CanMove(bool bCheckCO, bool bCheckLock, int nX, int nY)
 {
-    if(GroundValid(nX, nY)){
-        if(bCheckCO){
-            for(auto nUID: m_CellRecordV2D[nX][nY].UIDList){
-                extern MonoServer *g_MonoServer;
-                if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
-                    if(stUIDRecord.ClassFrom<CharObject>()){
-                        return false;
-                    }
-                }
-            }
-        }
-
-        if(bCheckLock){
-            if(m_CellRecordV2D[nX][nY].Lock){
-                return false;
-            }
-        }
-        return true;
-    }
-    return false;
+    return true
+        && ( GroundValid(nX, nY))
+        && (!bCheckCO   || !m_COGrid  .Get(nX, nY))
+        && (!bCheckLock || !m_LockGrid.Get(nX, nY));
 }
 
 bool ServerMap::CanMove(bool bCheckCO, bool bCheckLock, bool bSkipMiddleLock, int nX0, int nY0, int nX1, int nY1)
@@ -494,100 +294,48 @@ bool ServerMap::CanMove(bool bCheckCO, bool bCheckLock, bool bSkipMiddleLock, in
     return true;
 }
 
-double ServerMap::MoveCost(bool bCheckCO, bool bCheckLock, bool bSkipMiddleLock, int nX0, int nY0, int nX1, int nY1)
+bool ServerMap::RandomLocation(int *pX, int *pY)
 {
-    int nMaxIndex = -1;
-    switch(LDistance2(nX0, nY0, nX1, nY1)){
-        case 0:
-            {
-                nMaxIndex = 0;
-                break;
-            }
-        case 1:
-        case 2:
-            {
-                nMaxIndex = 1;
-                break;
-            }
-        case 4:
-        case 8:
-            {
-                nMaxIndex = 2;
-                break;
-            }
-        case  9:
-        case 18:
-            {
-                nMaxIndex = 3;
-                break;
-            }
-        default:
-            {
-                return 10000.00;
-            }
-    }
-
-    int nDX = (nX1 > nX0) - (nX1 < nX0);
-    int nDY = (nY1 > nY0) - (nY1 < nY0);
-
-    double fMoveCost = 0.0;
-    for(int nIndex = 0; nIndex <= nMaxIndex; ++nIndex){
-        auto nCurrX = nX0 + nDX * nIndex;
-        auto nCurrY = nY0 + nDY * nIndex;
-
-        // validate current grid first
-        // for server's side any motion needs to be inside valid grids
-
-        if(GroundValid(nCurrX, nCurrY)){
-
-            // OK current grid is capable to contain co's
-            // check the co's and locks
-
-            bool bCheckCurrLock = false;
-            if(bCheckLock){
-                if(bSkipMiddleLock){
-                    if((nIndex != 0) && (nIndex != nMaxIndex)){
-                        bCheckCurrLock = false;
-                    }else{
-                        bCheckCurrLock = true;
-                    }
-                }else{
-                    bCheckCurrLock = true;
+    // first walkable cell by column then row
+    // take lowest bit of each row, keep the smallest X
+    int nFindX = -1;
+    int nFindY = -1;
+
+    const auto &rstGround = m_GroundGrid->Bits();
+    for(int nY = 0; nY < rstGround.H(); ++nY){
+        auto pRow = rstGround.Row(nY);
+        for(size_t nWord = 0; nWord < rstGround.Stride(); ++nWord){
+            if(pRow[nWord]){
+                auto nX = (int)(nWord * 64) + __builtin_ctzll(pRow[nWord]);
+                if(nFindX < 0 || nX < nFindX){
+                    nFindX = nX;
+                    nFindY = nY;
                 }
+                break;
             }
-
-            fMoveCost += (CanMove(bCheckCO, bCheckCurrLock, nCurrX, nCurrY) ? 1.00 : 100.00);
-
-        }else{
-
-            // current grid is not valid
-            // ignore alculated cost and immediately return infinite
-            return 10000.00;
         }
     }
 
-    return fMoveCost;
-}
-
-bool ServerMap::RandomLocation(int *pX, int *pY)
-{
-    for(int nX = 0; nX < W(); ++nX){
-        for(int nY = 0; nY < H(); ++nY){
-            if(CanMove(false, false, nX, nY)){
-                if(pX){ *pX = nX; }
-                if(pY){ *pY = nY; }
-                return true;
-            }
-        }
+    if(nFindX >= 0){
+        if(pX){ *pX = nFindX; }
+        if(pY){ *pY = nFindY; }
+        return true;
     }
     return false;
 }
 
 bool ServerMap::Empty()
 {
-    for(int nX = 0; nX < W(); ++nX){
-        for(int nY = 0; nY < H(); ++nY){
-            if(CanMove(true, true, nX, nY)){
+    // any cell can move in with CO and lock checked
+    // ground & ~CO & ~lock, 64 cells a time
+    const auto &rstGround = m_GroundGrid->Bits();
+    for(int nY = 0; nY < rstGround.H(); ++nY){
+        auto pGround = rstGround .Row(nY);
+        auto pCO     = m_COGrid  .Row(nY);
+        auto pLock   = m_LockGrid.Row(nY);
+
+        for(size_t nWord = 0; nWord < rstGround.Stride(); ++nWord){
+            if(pGround[nWord] & ~pCO[nWord] & ~pLock[nWord]){
                 return false;
             }
         }
@@ -616,6 +364,31 @@ void ServerMap::AddGridUID(uint32_t nUID, int nX, int nY)
         if(std::find(rstUIDList.begin(), rstUIDList.end(), nUID) == rstUIDList.end()){
             rstUIDList.push_back(nUID);
         }
+        UpdateCOGrid(nX, nY);
+
+        // for a moving UID this moves its AOI entry
+        // for a new UID this creates the entry
+        if(m_AOI.Update(nUID, nX, nY)){
+            if(auto pEntry = m_AOI.Find(nUID)){
+                if(pEntry->ActiveObject){
+                    extern ServerEnv *g_ServerEnv;
+                    extern MonoServer *g_MonoServer;
+
+                    auto nCurrTick = g_MonoServer->GetTimeTick();
+                    auto nInterval = pEntry->Player ? g_ServerEnv->MIR2X_CONFIG_TICK_PLAYER : g_ServerEnv->MIR2X_CONFIG_TICK_MONSTER;
+
+                    // only add if it's new
+                    // won't reset the schedule for a moving one
+                    m_TickScheduler.Add(nUID, (uint32_t)(std::max<int>(nInterval, 1)), nCurrTick);
+
+                    // player comes
+                    // wake all sleeping objects it can see
+                    if(pEntry->Player){
+                        WakeNearby(nX, nY, AOIManager::Radius(AOIEVENT_UPDATEHP));
+                    }
+                }
+            }
+        }
     }
 }
 
@@ -632,9 +405,41 @@ void ServerMap::RemoveGridUID(uint32_t nUID, int nX, int nY)
             std::swap(rstUIDList.back(), *pUIDRecord);
             rstUIDList.pop_back();
         }
+        UpdateCOGrid(nX, nY);
+
+        if(m_AOI.Remove(nUID, nX, nY)){
+            m_TickScheduler.Remove(nUID);
+            m_MonsterAI.Remove(nUID);
+            m_SessionRecord.erase(nUID);
+        }
     }
 }
 
+bool ServerMap::PlayerNearby(int nX, int nY, int nR)
+{
+    bool bFind = false;
+    m_AOI.ForEach(nX, nY, nR, [&bFind](const AOIManager::AOIEntry &rstEntry) -> bool
+    {
+        bFind = rstEntry.Player;
+        return bFind;
+    });
+    return bFind;
+}
+
+void ServerMap::WakeNearby(int nX, int nY, int nR)
+{
+    extern MonoServer *g_MonoServer;
+    auto nCurrTick = g_MonoServer->GetTimeTick();
+
+    m_AOI.ForEach(nX, nY, nR, [this, nCurrTick](const AOIManager::AOIEntry &rstEntry) -> bool
+    {
+        if(!rstEntry.Player){
+            m_TickScheduler.Wake(rstEntry.UID, nCurrTick);
+        }
+        return false;
+    });
+}
+
 void ServerMap::DoCircle(int nCX0, int nCY0, int nCR, const std::function<bool(int, int)> &fnOP)
 {
     int nW = 2 * nCR - 1;
@@ -769,10 +574,12 @@ void ServerMap::DoCenterSquare(int nCX, int nCY, int nW, int nH, bool bPriority,
 int ServerMap::FindGroundItem(int nX, int nY, uint32_t nItemID)
 {
     if(ValidC(nX, nY)){
-        auto &rstGroundItemList = m_CellRecordV2D[nX][nY].GroundItemList;
-        for(size_t nIndex = 0; nIndex < rstGroundItemList.size(); ++nIndex){
-            if(rstGroundItemList[nIndex].ID() == nItemID){
-                return (int)(nIndex);
+        auto pRecord = m_GroundItemRecord.find(GroundItemKey(nX, nY));
+        if(pRecord != m_GroundItemRecord.end()){
+            for(size_t nIndex = 0; nIndex < pRecord->second.Count(); ++nIndex){
+                if(pRecord->second.At(nIndex).ID() == nItemID){
+                    return (int)(nIndex);
+                }
             }
         }
     }
@@ -781,12 +588,22 @@ int ServerMap::FindGroundItem(int nX, int nY, uint32_t nItemID)
 
 void ServerMap::RemoveGroundItem(int nX, int nY, uint32_t nItemID)
 {
-    while(true){
-        auto nIndex = FindGroundItem(nX, nY, nItemID);
-        if(nIndex >= 0){
-            m_CellRecordV2D[nX][nY].GroundItemList[nIndex] = CommonItem(0, 0);
-        }else{
-            return;
+    if(ValidC(nX, nY)){
+        auto pRecord = m_GroundItemRecord.find(GroundItemKey(nX, nY));
+        if(pRecord != m_GroundItemRecord.end()){
+            for(size_t nIndex = 0; nIndex < pRecord->second.Count();){
+                if(pRecord->second.At(nIndex).ID() == nItemID){
+                    pRecord->second.Remove(nIndex);
+                }else{
+                    nIndex++;
+                }
+            }
+
+            // release the grid record if it's empty
+            // we only keep those grids with items
+            if(pRecord->second.Count() == 0){
+                m_GroundItemRecord.erase(pRecord);
+            }
         }
     }
 }
@@ -794,13 +611,8 @@ void ServerMap::RemoveGroundItem(int nX, int nY, uint32_t nItemID)
 int ServerMap::DropItemListCount(int nX, int nY)
 {
     if(GroundValid(nX, nY)){
-        int nCount = 0;
-        for(auto &rstCurrItem: m_CellRecordV2D[nX][nY].GroundItemList){
-            if(rstCurrItem){
-                nCount++;
-            }
-        }
-        return nCount;
+        auto pRecord = m_GroundItemRecord.find(GroundItemKey(nX, nY));
+        return (pRecord == m_GroundItemRecord.end()) ? 0 : (int)(pRecord->second.Count());
     }
     return -1;
 }
@@ -811,12 +623,12 @@ bool ServerMap::AddGroundItem(int nX, int nY, const CommonItem &rstItem)
             && rstItem
             && GroundValid(nX, nY)){
 
-        // search for item id as 0
-        // find a slot to store the new item
+        // only create the grid record when dropping items
+        // the grid can hold at most SYS_MAXDROPITEM items
 
-        auto nEmptyIndex = FindGroundItem(nX, nY, 0);
-        if(nEmptyIndex >= 0){
-            m_CellRecordV2D[nX][nY].GroundItemList[nEmptyIndex] = rstItem;
+        auto &rstRecord = m_GroundItemRecord[GroundItemKey(nX, nY)];
+        if(rstRecord.Count() < SYS_MAXDROPITEM){
+            rstRecord.Add(rstItem);
 
             // report to all charobject around
             // since there are one more drop item for each grid
@@ -830,22 +642,13 @@ bool ServerMap::AddGroundItem(int nX, int nY, const CommonItem &rstItem)
             stAMSDI.X  = nX;
             stAMSDI.Y  = nY;
 
-            auto fnNotifyDropItem = [this, stAMSDI](int nX, int nY) -> bool
+            m_AOI.ForEvent(AOIEVENT_SHOWDROPITEM, nX, nY, [this, stAMSDI](const AOIManager::AOIEntry &rstEntry) -> bool
             {
-                if(true || ValidC(nX, nY)){
-                    for(auto nUID: m_CellRecordV2D[nX][nY].UIDList){
-                        extern MonoServer *g_MonoServer;
-                        if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
-                            if(stUIDRecord.ClassFrom<Player>()){
-                                m_ActorPod->Forward({MPK_SHOWDROPITEM, stAMSDI}, stUIDRecord.Address);
-                            }
-                        }
-                    }
+                if(rstEntry.Player){
+                    m_ActorPod->Forward({MPK_SHOWDROPITEM, stAMSDI}, rstEntry.Address);
                 }
                 return false;
-            };
-
-            DoCircle(nX, nY, 10, fnNotifyDropItem);
+            });
             return true;
         }
     }
@@ -3,7 +3,7 @@
  *
  *       Filename: servermap.hpp
  *        Created: 09/03/2015 03:49:00
- *  Last Modified: 10/31/2017 11:26:45
+ *  Last Modified: 12/11/2017 21:14:07
  *
  *    Description:
  *
@@ -20,40 +20,42 @@
 
 #pragma once
 
+#include <array>
+#include <memory>
 #include <vector>
 #include <cstdint>
+#include <unordered_map>
 
+#include "bitgrid.hpp"
 #include "sysconst.hpp"
 #include "querytype.hpp"
 #include "uidrecord.hpp"
 #include "metronome.hpp"
+#include "monsterai.hpp"
+#include "aoimanager.hpp"
 #include "commonitem.hpp"
 #include "pathfinder.hpp"
 #include "mir2xmapdata.hpp"
 #include "activeobject.hpp"
+#include "tickscheduler.hpp"
+#include "pathfindservice.hpp"
 
 class ServiceCore;
 class ServerObject;
 class ServerMap: public ActiveObject
 {
-    private:
-        // bind to servermap
-        // only for server map internal usage
-        class ServerPathFinder: public AStarPathFinder
-        {
-            public:
-                ServerPathFinder(ServerMap*, int, bool);
-               ~ServerPathFinder() = default;
-        };
+    public:
+        static constexpr uint32_t ClassTag = CLASSTAG_SERVERMAP | ActiveObject::ClassTag;
 
-        // the server pathfinder will call CanMove() etc
-        // which I refuse to set as public since it's dynamically updated
-        friend class ServerPathFinder;
+    public:
+        uint32_t GetClassTag() const
+        {
+            return ServerMap::ClassTag;
+        }
 
     private:
         struct CellRecord
         {
-            bool Lock;
             std::vector<uint32_t> UIDList;
 
             uint32_t UID;
@@ -66,21 +68,79 @@ class ServerMap: public ActiveObject
             // can't use pServiceCore->GetMapUID() since map in service core could load / unload
             int Query;
 
-            // on every grid there could be one item on ground
-            std::array<CommonItem, SYS_MAXDROPITEM> GroundItemList;
-
             CellRecord()
-                : Lock(false)
-                , UIDList()
+                : UIDList()
                 , UID(0)
                 , MapID(0)
                 , SwitchX(-1)
                 , SwitchY(-1)
                 , Query(QUERY_NONE)
-                , GroundItemList()
             {}
         };
 
+        // items on one grid, at most SYS_MAXDROPITEM
+        // most of the grids have no item, and most with items only have one or two
+        // then use inline slots first and spill to the vector when they are full
+        class GroundItemRecord
+        {
+            private:
+                size_t m_Count;
+                std::array<CommonItem, 2> m_InnList;
+                std::vector<CommonItem>   m_ExtList;
+
+            public:
+                GroundItemRecord()
+                    : m_Count(0)
+                    , m_InnList()
+                    , m_ExtList()
+                {}
+
+            public:
+                size_t Count() const
+                {
+                    return m_Count;
+                }
+
+                const CommonItem &At(size_t nIndex) const
+                {
+                    return (nIndex < m_InnList.size()) ? m_InnList[nIndex] : m_ExtList[nIndex - m_InnList.size()];
+                }
+
+                CommonItem &At(size_t nIndex)
+                {
+                    return (nIndex < m_InnList.size()) ? m_InnList[nIndex] : m_ExtList[nIndex - m_InnList.size()];
+                }
+
+            public:
+                void Add(const CommonItem &rstItem)
+                {
+                    if(m_Count < m_InnList.size()){
+                        m_InnList[m_Count] = rstItem;
+                    }else{
+                        m_ExtList.push_back(rstItem);
+                    }
+                    m_Count++;
+                }
+
+                // keep the order of rest items
+                // client shows the items in the order they dropped
+                void Remove(size_t nIndex)
+                {
+                    if(nIndex < m_Count){
+                        for(size_t nCurrIndex = nIndex; nCurrIndex + 1 < m_Count; ++nCurrIndex){
+                            At(nCurrIndex) = At(nCurrIndex + 1);
+                        }
+
+                        if(m_Count > m_InnList.size()){
+                            m_ExtList.pop_back();
+                        }else{
+                            m_InnList[m_Count - 1] = CommonItem(0, 0);
+                        }
+                        m_Count--;
+                    }
+                }
+        };
+
     private:
         template<typename T> using Vec2D = std::vector<std::vector<T>>;
 
@@ -88,6 +148,11 @@ class ServerMap: public ActiveObject
         const uint32_t     m_ID;
         const Mir2xMapData m_Mir2xMapData;
 
+    private:
+        // walkable grids for path finding
+        // built once in constructor and shared with PathFindService jobs
+        std::shared_ptr<const PathFindService::GroundGrid> m_GroundGrid;
+
     private:
         Metronome   *m_Metronome;
         ServiceCore *m_ServiceCore;
@@ -95,6 +160,43 @@ class ServerMap: public ActiveObject
     private:
         Vec2D<CellRecord> m_CellRecordV2D;
 
+    private:
+        // bitmaps for CanMove() checks
+        // ground is in m_GroundGrid, these two change with objects
+        //
+        //      m_COGrid   : set if UIDList of the cell is not empty, only charobjects are in UIDList
+        //      m_LockGrid : cell reserved for a pending move / map switch
+        //
+        // update m_COGrid by UpdateCOGrid() whenever UIDList changes
+        BitGrid m_COGrid;
+        BitGrid m_LockGrid;
+
+    private:
+        // sparse storage of ground items
+        // key is the packed location by GroundItemKey()
+        std::unordered_map<uint32_t, GroundItemRecord> m_GroundItemRecord;
+
+    private:
+        // for broadcasting only
+        // updated with AddGridUID() / RemoveGridUID()
+        AOIManager m_AOI;
+
+    private:
+        // drive MPK_METRONOME of objects on current map
+        // only objects registered by AddGridUID() get ticked
+        TickScheduler m_TickScheduler;
+
+    private:
+        // decide masterless monsters in one pass if MIR2X_CONFIG_TICK_BATCHAI is set
+        // refers to m_AOI, keep it after m_AOI
+        MonsterAI m_MonsterAI;
+
+    private:
+        // session of players on current map, reported by MPK_PULLCOINFO
+        // player with session gets SM_ACTION by NetPodN::Broadcast() directly
+        std::unordered_map<uint32_t, uint32_t> m_SessionRecord;
+        std::vector<uint32_t>                  m_SessionIDV;
+
     private:
         void OperateAM(const MessagePack &, const Theron::Address &);
 
@@ -118,9 +220,6 @@ class ServerMap: public ActiveObject
         bool CanMove(bool, bool, int, int);
         bool CanMove(bool, bool, bool, int, int, int, int);
 
-    protected:
-        double MoveCost(bool, bool, bool, int, int, int, int);
-
     public:
         int W() const { return m_Mir2xMapData.Valid() ? m_Mir2xMapData.W() : 0; }
         int H() const { return m_Mir2xMapData.Valid() ? m_Mir2xMapData.H() : 0; }
@@ -138,10 +237,26 @@ class ServerMap: public ActiveObject
         void AddGridUID(uint32_t, int, int);
         void RemoveGridUID(uint32_t, int, int);
 
+    private:
+        void UpdateCOGrid(int nX, int nY)
+        {
+            m_COGrid.Set(nX, nY, !m_CellRecordV2D[nX][nY].UIDList.empty());
+        }
+
+    private:
+        bool PlayerNearby(int, int, int);
+        void WakeNearby(int, int, int);
+
     private:
         bool Empty();
         bool RandomLocation(int *, int *);
 
+    private:
+        static uint32_t GroundItemKey(int nX, int nY)
+        {
+            return ((uint32_t)(nX) << 16) | ((uint32_t)(nY) & 0XFFFF);
+        }
+
     private:
         int FindGroundItem(int, int, uint32_t);
         int DropItemListCount(int, int);
@@ -3,7 +3,7 @@
  *
  *       Filename: servermapop.cpp
  *        Created: 05/03/2016 20:21:32
- *  Last Modified: 10/31/2017 12:01:31
+ *  Last Modified: 12/17/2017 21:48:51
  *
  *    Description: 
  *
@@ -17,50 +17,115 @@
  *
  * =====================================================================================
  */
+#include <cstdlib>
+#include <algorithm>
 #include <cinttypes>
 #include "dbcomid.hpp"
 #include "player.hpp"
+#include "netpod.hpp"
 #include "monster.hpp"
 #include "mathfunc.hpp"
 #include "sysconst.hpp"
 #include "actorpod.hpp"
 #include "metronome.hpp"
 #include "servermap.hpp"
+#include "serverenv.hpp"
 #include "monoserver.hpp"
 #include "rotatecoord.hpp"
 #include "dbcomrecord.hpp"
 
 void ServerMap::On_MPK_METRONOME(const MessagePack &, const Theron::Address &)
 {
-    for(auto &rstRecordLine: m_CellRecordV2D){
-        for(auto &rstRecordV: rstRecordLine){
+    // only objects registered in the scheduler get ticked
+    // cost depends on how many objects are due, not the map size
 
-            // this part check all recorded UID and remove those invalid ones
-            // do it periodically in 1s, then for all rest logic we can skip the clean job
+    extern ServerEnv *g_ServerEnv;
+    extern MonoServer *g_MonoServer;
 
-            for(size_t nIndex = 0; nIndex < rstRecordV.UIDList.size();){
-                extern MonoServer *g_MonoServer;
-                if(auto stUIDRecord = g_MonoServer->GetUIDRecord(rstRecordV.UIDList[nIndex])){
-                    if(stUIDRecord.ClassFrom<ActiveObject>()){
-                        if(m_ActorPod->Forward(MPK_METRONOME, stUIDRecord.Address)){
-                            nIndex++;
-                            continue;
-                        }else{
-                            std::swap(rstRecordV.UIDList[nIndex], rstRecordV.UIDList.back());
-                            rstRecordV.UIDList.pop_back();
-                            continue;
-                        }
-                    }else{
-                        nIndex++;
-                        continue;
-                    }
-                }else{
-                    std::swap(rstRecordV.UIDList[nIndex], rstRecordV.UIDList.back());
-                    rstRecordV.UIDList.pop_back();
-                    continue;
+    auto nCurrTick = g_MonoServer->GetTimeTick();
+    auto nMaxBatch = (size_t)(std::max<int>(g_ServerEnv->MIR2X_CONFIG_TICK_BATCH, 0));
+
+    std::vector<uint32_t> stBatchUIDV;
+    auto fnOnTick = [this, nCurrTick, &stBatchUIDV](uint32_t nUID, bool bSleep)
+    {
+        auto pEntry = m_AOI.Find(nUID);
+        if(!pEntry){
+            m_TickScheduler.Remove(nUID);
+            m_MonsterAI.Remove(nUID);
+            m_SessionRecord.erase(nUID);
+            return;
+        }
+
+        // copy it out
+        // RemoveGridUID() invalidates pEntry
+        auto nX = pEntry->X;
+        auto nY = pEntry->Y;
+
+        if(bSleep){
+
+            // for sleeping objects we don't send any message
+            // only check if it's still alive and if there is player around
+
+            extern MonoServer *g_MonoServer;
+            if(!g_MonoServer->GetUIDRecord(nUID)){
+                RemoveGridUID(nUID, nX, nY);
+                return;
+            }
+
+            if(PlayerNearby(nX, nY, AOIManager::Radius(AOIEVENT_UPDATEHP))){
+                m_TickScheduler.Wake(nUID, nCurrTick);
+            }
+            return;
+        }
+
+        // batched monster gets no metronome
+        // it's decided with others after the scheduling, invalid one is removed then
+
+        if(m_MonsterAI.Batched(nUID)){
+            stBatchUIDV.push_back(nUID);
+        }else{
+
+            // this part removes those invalid ones
+            // then for all rest logic we can skip the clean job
+
+            if(!m_ActorPod->Forward(MPK_METRONOME, pEntry->Address)){
+                RemoveGridUID(nUID, nX, nY);
+                return;
+            }
+        }
+
+        // player never sleeps
+        // monster without player around for a while goes to sleep
+
+        if(!pEntry->Player){
+            if(PlayerNearby(nX, nY, AOIManager::Radius(AOIEVENT_UPDATEHP))){
+                m_TickScheduler.Active(nUID, nCurrTick);
+            }else if(auto pRecord = m_TickScheduler.Find(nUID)){
+                extern ServerEnv *g_ServerEnv;
+                if(nCurrTick >= pRecord->ActiveTick + (uint32_t)(std::max<int>(g_ServerEnv->MIR2X_CONFIG_TICK_IDLE, 0))){
+                    m_TickScheduler.Sleep(nUID, nCurrTick);
                 }
             }
         }
+    };
+
+    m_TickScheduler.Schedule(nCurrTick, nMaxBatch, fnOnTick);
+
+    if(!stBatchUIDV.empty()){
+        auto fnCanStep = [this](int nX, int nY) -> bool
+        {
+            return CanMove(true, true, nX, nY);
+        };
+
+        auto fnOnIntent = [this](const AMAIIntent &rstAMAII)
+        {
+            if(auto pEntry = m_AOI.Find(rstAMAII.UID)){
+                if(!m_ActorPod->Forward({MPK_AIINTENT, rstAMAII}, pEntry->Address)){
+                    RemoveGridUID(rstAMAII.UID, pEntry->X, pEntry->Y);
+                }
+            }
+        };
+        m_MonsterAI.Update(nCurrTick, stBatchUIDV, fnCanStep, fnOnIntent);
     }
 }
 
@@ -73,24 +138,53 @@ void ServerMap::On_MPK_ACTION(const MessagePack &rstMPK, const Theron::Address &
     AMAction stAMA;
     std::memcpy(&stAMA, rstMPK.Data(), sizeof(stAMA));
 
+    m_MonsterAI.OnAction(stAMA);
     if(ValidC(stAMA.X, stAMA.Y)){
-        auto fnNotifyAction = [this, stAMA](int nX, int nY) -> bool
+        m_SessionIDV.clear();
+        m_AOI.ForEvent(AOIEVENT_ACTION, stAMA.X, stAMA.Y, [this, stAMA](const AOIManager::AOIEntry &rstEntry) -> bool
         {
-            if(true || ValidC(nX, nY)){
-                for(auto nUID: m_CellRecordV2D[nX][nY].UIDList){
-                    if(nUID != stAMA.UID){
-                        extern MonoServer *g_MonoServer;
-                        if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
-                            if(stUIDRecord.ClassFrom<CharObject>()){
-                                m_ActorPod->Forward({MPK_ACTION, stAMA}, stUIDRecord.Address);
-                            }
+            // batched monster takes targets from m_MonsterAI
+            // don't forward actions to it
+            if(true
+                    && rstEntry.CharObject
+                    && rstEntry.UID != stAMA.UID
+                    && !m_MonsterAI.Batched(rstEntry.UID)){
+
+                // player only reports the action to its client
+                // do it here for all players with session in one broadcast, see Player::On_MPK_ACTION()
+                if(rstEntry.Player){
+                    auto pSession = m_SessionRecord.find(rstEntry.UID);
+                    if(pSession != m_SessionRecord.end()){
+                        if(true
+                                && (std::abs(stAMA.X - rstEntry.X) <= SYS_MAPVISIBLEW)
+                                && (std::abs(stAMA.Y - rstEntry.Y) <= SYS_MAPVISIBLEH)){
+                            m_SessionIDV.push_back(pSession->second);
                         }
+                        return false;
                     }
                 }
+                m_ActorPod->Forward({MPK_ACTION, stAMA}, rstEntry.Address);
             }
             return false;
-        };
-        DoCircle(stAMA.X, stAMA.Y, 10, fnNotifyAction);
+        });
+
+        if(!m_SessionIDV.empty()){
+            SMAction stSMA;
+            stSMA.UID         = stAMA.UID;
+            stSMA.MapID       = stAMA.MapID;
+            stSMA.Action      = stAMA.Action;
+            stSMA.ActionParam = stAMA.ActionParam;
+            stSMA.Speed       = stAMA.Speed;
+            stSMA.Direction   = stAMA.Direction;
+            stSMA.X           = stAMA.X;
+            stSMA.Y           = stAMA.Y;
+            stSMA.AimX        = stAMA.AimX;
+            stSMA.AimY        = stAMA.AimY;
+            stSMA.AimUID      = 0;
+
+            extern NetPodN *g_NetPodN;
+            g_NetPodN->Broadcast(m_SessionIDV, SM_ACTION, stSMA);
+        }
     }
 }
 
@@ -158,6 +252,16 @@ void ServerMap::On_MPK_ADDCHAROBJECT(const MessagePack &rstMPK, const Theron::Ad
 
                     pCO->Activate();
                     AddGridUID(nUID, nX, nY);
+
+                    // monster with master follows it across maps
+                    // keep it on its own metronome
+                    extern ServerEnv *g_ServerEnv;
+                    if(true
+                            && g_ServerEnv->MIR2X_CONFIG_TICK_BATCHAI
+                            && stAMACO.Monster.MasterUID == 0){
+                        m_MonsterAI.Add(nUID, stAMACO.Monster.MonsterID, DIR_UP);
+                    }
+
                     m_ActorPod->Forward(MPK_OK, rstFromAddr, rstMPK.ID());
                     return;
                 }
@@ -392,6 +496,7 @@ void ServerMap::On_MPK_TRYMOVE(const MessagePack &rstMPK, const Theron::Address
                                 // 2. remove from the object list
                                 std::swap(nUID, rstRecordV.back());
                                 rstRecordV.pop_back();
+                                UpdateCOGrid(stAMTM.X, stAMTM.Y);
 
                                 break;
                             }
@@ -469,6 +574,13 @@ void ServerMap::On_MPK_TRYMOVE(const MessagePack &rstMPK, const Theron::Address
                                 }
                             }
                         }
+                    }else{
+                        // object is gone during the move
+                        // nobody will clean its AOI entry since it's not in any cell
+                        m_AOI.Remove(stAMTM.UID);
+                        m_TickScheduler.Remove(stAMTM.UID);
+                        m_MonsterAI.Remove(stAMTM.UID);
+                        m_SessionRecord.erase(stAMTM.UID);
                     }
                     break;
                 }
@@ -477,7 +589,7 @@ void ServerMap::On_MPK_TRYMOVE(const MessagePack &rstMPK, const Theron::Address
                     break;
                 }
         }
-        m_CellRecordV2D[nMostX][nMostY].Lock = false;
+        m_LockGrid.Set(nMostX, nMostY, false);
     };
 
     AMMoveOK stAMMOK;
@@ -488,7 +600,7 @@ void ServerMap::On_MPK_TRYMOVE(const MessagePack &rstMPK, const Theron::Address
     stAMMOK.EndX  = nMostX;
     stAMMOK.EndY  = nMostY;
 
-    m_CellRecordV2D[nMostX][nMostY].Lock = true;
+    m_LockGrid.Set(nMostX, nMostY, true);
     m_ActorPod->Forward({MPK_MOVEOK, stAMMOK}, rstFromAddr, rstMPK.ID(), fnOnR);
 }
 
@@ -522,19 +634,20 @@ void ServerMap::On_MPK_PULLCOINFO(const MessagePack &rstMPK, const Theron::Addre
     AMPullCOInfo stAMPCOI;
     std::memcpy(&stAMPCOI, rstMPK.Data(), sizeof(stAMPCOI));
 
-    auto fnPullCOInfo = [this, stAMPCOI](int nX, int nY) -> bool
+    // player pulls after login and map switch
+    // keep its session for broadcast
+    if(true
+            && stAMPCOI.UID
+            && stAMPCOI.SessionID
+            && m_AOI.Find(stAMPCOI.UID)){
+        m_SessionRecord[stAMPCOI.UID] = stAMPCOI.SessionID;
+    }
+
+    m_AOI.ForAll([this, stAMPCOI](const AOIManager::AOIEntry &rstEntry) -> bool
     {
-        if(true || ValidC(nX, nY)){
-            for(auto nUID: m_CellRecordV2D[nX][nY].UIDList){
-                extern MonoServer *g_MonoServer;
-                if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
-                    m_ActorPod->Forward({MPK_PULLCOINFO, stAMPCOI}, stUIDRecord.Address);
-                }
-            }
-        }
+        m_ActorPod->Forward({MPK_PULLCOINFO, stAMPCOI}, rstEntry.Address);
         return false;
-    };
-    DoSquare(0, 0, W(), H(), fnPullCOInfo);
+    });
 }
 
 void ServerMap::On_MPK_TRYMAPSWITCH(const MessagePack &rstMPK, const Theron::Address &rstFromAddr)
@@ -567,9 +680,9 @@ void ServerMap::On_MPK_TRYMAPSWITCH(const MessagePack &rstMPK, const Theron::Add
                         break;
                     }
             }
-            m_CellRecordV2D[stAMMSOK.X][stAMMSOK.Y].Lock = false;
+            m_LockGrid.Set(stAMMSOK.X, stAMMSOK.Y, false);
         };
-        m_CellRecordV2D[nX][nY].Lock = true;
+        m_LockGrid.Set(nX, nY, true);
         m_ActorPod->Forward({MPK_MAPSWITCHOK, stAMMSOK}, rstFromAddr, rstMPK.ID(), fnOnResp);
     }else{
         extern MonoServer *g_MonoServer;
@@ -583,23 +696,6 @@ void ServerMap::On_MPK_PATHFIND(const MessagePack &rstMPK, const Theron::Address
     AMPathFind stAMPF;
     std::memcpy(&stAMPF, rstMPK.Data(), sizeof(stAMPF));
 
-    int nX0 = stAMPF.X;
-    int nY0 = stAMPF.Y;
-    int nX1 = stAMPF.EndX;
-    int nY1 = stAMPF.EndY;
-
-    AMPathFindOK stAMPFOK;
-    stAMPFOK.UID   = stAMPF.UID;
-    stAMPFOK.MapID = ID();
-
-    // we fill all slots with -1 for initialization
-    // won't keep a record of ``how many path nodes are valid"
-    auto nPathCount = (int)(sizeof(stAMPFOK.Point) / sizeof(stAMPFOK.Point[0]));
-    for(int nIndex = 0; nIndex < nPathCount; ++nIndex){
-        stAMPFOK.Point[nIndex].X = -1;
-        stAMPFOK.Point[nIndex].Y = -1;
-    }
-
     // should make sure MaxStep is OK
     if(true
             && stAMPF.MaxStep != 1
@@ -608,55 +704,60 @@ void ServerMap::On_MPK_PATHFIND(const MessagePack &rstMPK, const Theron::Address
 
         // we get a dangerous parameter from actormessage
         // correct here and put an warning in the log system
-        stAMPF.MaxStep = 1;
-
         extern MonoServer *g_MonoServer;
         g_MonoServer->AddLog(LOGTYPE_WARNING, "Invalid MaxStep: %d, should be (1, 2, 3)", stAMPF.MaxStep);
+
+        stAMPF.MaxStep = 1;
     }
 
-    ServerPathFinder stPathFinder(this, stAMPF.MaxStep, stAMPF.CheckCO);
-    if(true
-            && stPathFinder.Search(nX0, nY0, nX1, nY1)
-            && stPathFinder.GetSolutionStart()){
-
-        int nCurrN = 0;
-        int nCurrX = nX0;
-        int nCurrY = nY0;
-
-        while(auto pNode1 = stPathFinder.GetSolutionNext()){
-            if(nCurrN >= nPathCount){ break; }
-            int nEndX = pNode1->X();
-            int nEndY = pNode1->Y();
-            switch(LDistance2(nCurrX, nCurrY, nEndX, nEndY)){
-                case 1:
-                case 2:
-                    {
-                        stAMPFOK.Point[nCurrN].X = nCurrX;
-                        stAMPFOK.Point[nCurrN].Y = nCurrY;
+    extern ServerEnv *g_ServerEnv;
+    extern MonoServer *g_MonoServer;
 
-                        nCurrN++;
+    PathFindService::PathFindJob stJob;
+    stJob.UID      = stAMPF.UID;
+    stJob.MapID    = ID();
+    stJob.MaxStep  = stAMPF.MaxStep;
+    stJob.CheckCO  = stAMPF.CheckCO;
+    stJob.X        = stAMPF.X;
+    stJob.Y        = stAMPF.Y;
+    stJob.EndX     = stAMPF.EndX;
+    stJob.EndY     = stAMPF.EndY;
+    stJob.Deadline = g_MonoServer->GetTimeTick() + (uint32_t)(std::max<int>(g_ServerEnv->MIR2X_CONFIG_PATHFIND_TIMEOUT, 1));
+    stJob.Ground   = m_GroundGrid;
+    stJob.Address  = rstFromAddr;
+    stJob.Respond  = rstMPK.ID();
+    stJob.Seq      = 0;
+
+    // copy CO and lock around start and end point
+    // this is the only part of the search done in map thread
+    if(stAMPF.CheckCO){
+        auto nMargin = std::max<int>(g_ServerEnv->MIR2X_CONFIG_PATHFIND_MARGIN, 0);
+
+        auto nX0 = std::max<int>(std::min<int>(stAMPF.X, stAMPF.EndX) - nMargin, 0);
+        auto nY0 = std::max<int>(std::min<int>(stAMPF.Y, stAMPF.EndY) - nMargin, 0);
+        auto nX1 = std::min<int>(std::max<int>(stAMPF.X, stAMPF.EndX) + nMargin, W() - 1);
+        auto nY1 = std::min<int>(std::max<int>(stAMPF.Y, stAMPF.EndY) + nMargin, H() - 1);
 
-                        nCurrX = nEndX;
-                        nCurrY = nEndY;
-                        break;
-                    }
-                case 0:
-                default:
-                    {
-                        extern MonoServer *g_MonoServer;
-                        g_MonoServer->AddLog(LOGTYPE_WARNING, "Invalid path node");
-                        break;
-                    }
-            }
+        if(true
+                && nX0 <= nX1
+                && nY0 <= nY1){
+
+            // CO and lock are only set on valid ground
+            // copy the bitmaps directly
+            stJob.Occupy.X    = nX0;
+            stJob.Occupy.Y    = nY0;
+            stJob.Occupy.CO   = m_COGrid  .Window(nX0, nY0, nX1 - nX0 + 1, nY1 - nY0 + 1);
+            stJob.Occupy.Lock = m_LockGrid.Window(nX0, nY0, nX1 - nX0 + 1, nY1 - nY0 + 1);
         }
-
-        // we filled all possible nodes to the message
-        m_ActorPod->Forward({MPK_PATHFINDOK, stAMPFOK}, rstFromAddr, rstMPK.ID());
-        return;
     }
 
-    // failed to find a path
-    m_ActorPod->Forward(MPK_ERROR, rstFromAddr, rstMPK.ID());
+    // search runs in PathFindService
+    // the worker responds to rstFromAddr directly
+    extern PathFindService *g_PathFindService;
+    if(!g_PathFindService->Post(std::move(stJob))){
+        g_MonoServer->AddLog(LOGTYPE_WARNING, "PathFindService is busy, drop request: UID = %" PRIu32, stAMPF.UID);
+        m_ActorPod->Forward(MPK_ERROR, rstFromAddr, rstMPK.ID());
+    }
 }
 
 void ServerMap::On_MPK_UPDATEHP(const MessagePack &rstMPK, const Theron::Address &)
@@ -664,24 +765,18 @@ void ServerMap::On_MPK_UPDATEHP(const MessagePack &rstMPK, const Theron::Address
     AMUpdateHP stAMUHP;
     std::memcpy(&stAMUHP, rstMPK.Data(), sizeof(stAMUHP));
 
+    m_MonsterAI.OnUpdateHP(stAMUHP);
     if(ValidC(stAMUHP.X, stAMUHP.Y)){
-        auto fnUpdateHP = [this, stAMUHP](int nX, int nY) -> bool
+        m_AOI.ForEvent(AOIEVENT_UPDATEHP, stAMUHP.X, stAMUHP.Y, [this, stAMUHP](const AOIManager::AOIEntry &rstEntry) -> bool
         {
-            if(true || ValidC(nX, nY)){
-                for(auto nUID: m_CellRecordV2D[nX][nY].UIDList){
-                    if(nUID != stAMUHP.UID){
-                        extern MonoServer *g_MonoServer;
-                        if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
-                            if(stUIDRecord.ClassFrom<CharObject>()){
-                                m_ActorPod->Forward({MPK_UPDATEHP, stAMUHP}, stUIDRecord.Address);
-                            }
-                        }
-                    }
-                }
+            if(true
+                    && rstEntry.CharObject
+                    && rstEntry.UID != stAMUHP.UID
+                    && !m_MonsterAI.Batched(rstEntry.UID)){
+                m_ActorPod->Forward({MPK_UPDATEHP, stAMUHP}, rstEntry.Address);
             }
             return false;
-        };
-        DoCircle(stAMUHP.X, stAMUHP.Y, 20, fnUpdateHP);
+        });
     }
 }
 
@@ -690,24 +785,20 @@ void ServerMap::On_MPK_DEADFADEOUT(const MessagePack &rstMPK, const Theron::Addr
     AMDeadFadeOut stAMDFO;
     std::memcpy(&stAMDFO, rstMPK.Data(), sizeof(stAMDFO));
 
+    // drop its pending path finding
+    extern PathFindService *g_PathFindService;
+    g_PathFindService->Cancel(stAMDFO.UID);
+
     if(ValidC(stAMDFO.X, stAMDFO.Y)){
-        auto fnDeadFadeOut = [this, stAMDFO](int nX, int nY) -> bool
+        m_AOI.ForEvent(AOIEVENT_DEADFADEOUT, stAMDFO.X, stAMDFO.Y, [this, stAMDFO](const AOIManager::AOIEntry &rstEntry) -> bool
         {
-            if(true || ValidC(nX, nY)){
-                for(auto nUID: m_CellRecordV2D[nX][nY].UIDList){
-                    if(nUID != stAMDFO.UID){
-                        extern MonoServer *g_MonoServer;
-                        if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
-                            if(stUIDRecord.ClassFrom<Player>()){
-                                m_ActorPod->Forward({MPK_DEADFADEOUT, stAMDFO}, stUIDRecord.Address);
-                            }
-                        }
-                    }
-                }
+            if(true
+                    && rstEntry.Player
+                    && rstEntry.UID != stAMDFO.UID){
+                m_ActorPod->Forward({MPK_DEADFADEOUT, stAMDFO}, rstEntry.Address);
             }
             return false;
-        };
-        DoCircle(stAMDFO.X, stAMDFO.Y, 20, fnDeadFadeOut);
+        });
     }
 }
 
@@ -721,24 +812,19 @@ void ServerMap::On_MPK_QUERYCORECORD(const MessagePack &rstMPK, const Theron::Ad
             && stAMQCOR.MapID == ID()
             && ValidC(stAMQCOR.X, stAMQCOR.Y)){
 
-        auto fnQueryCORecord = [this, stAMQCOR](int nX, int nY) -> bool
-        {
-            if(true || ValidC(nX, nY)){
-                for(auto nUID: m_CellRecordV2D[nX][nY].UIDList){
-                    if(nUID == stAMQCOR.UID){
-                        extern MonoServer *g_MonoServer;
-                        if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
-                            if(stUIDRecord.ClassFrom<CharObject>()){
-                                m_ActorPod->Forward({MPK_PULLCOINFO, stAMQCOR.SessionID}, stUIDRecord.Address);
-                                return true;
-                            }
-                        }
-                    }
-                }
+        // no need to scan the circle
+        // AOI keeps location of each UID, check it's inside the range
+        if(auto pEntry = m_AOI.Find(stAMQCOR.UID)){
+            auto nR = AOIManager::Radius(AOIEVENT_QUERYCORECORD);
+            if(true
+                    && pEntry->CharObject
+                    && LDistance2(pEntry->X, pEntry->Y, stAMQCOR.X, stAMQCOR.Y) <= (nR - 1) * (nR - 1)){
+                AMPullCOInfo stAMPCOI;
+                stAMPCOI.UID       = 0;
+                stAMPCOI.SessionID = stAMQCOR.SessionID;
+                m_ActorPod->Forward({MPK_PULLCOINFO, stAMPCOI}, pEntry->Address);
             }
-            return false;
-        };
-        DoCircle(stAMQCOR.X, stAMQCOR.Y, 10, fnQueryCORecord);
+        }
     }
 }
 
@@ -751,20 +837,18 @@ void ServerMap::On_MPK_QUERYCOCOUNT(const MessagePack &rstMPK, const Theron::Add
             || (stAMQCOC.MapID == 0)
             || (stAMQCOC.MapID == ID())){
         int nCOCount = 0;
-        for(size_t nX = 0; nX < m_CellRecordV2D.size(); ++nX){
-            for(size_t nY = 0; nY < m_CellRecordV2D[0].size(); ++nY){
-                std::for_each(m_CellRecordV2D[nX][nY].UIDList.begin(), m_CellRecordV2D[nX][nY].UIDList.end(), [stAMQCOC, &nCOCount](uint32_t nUID){
-                    extern MonoServer *g_MonoServer;
-                    if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
-                        if(stUIDRecord.ClassFrom<CharObject>()){
-                            if(stAMQCOC.Check.NPC    ){ nCOCount++; return; }
-                            if(stAMQCOC.Check.Player ){ nCOCount++; return; }
-                            if(stAMQCOC.Check.Monster){ nCOCount++; return; }
-                        }
-                    }
-                });
+        m_AOI.ForAll([stAMQCOC, &nCOCount](const AOIManager::AOIEntry &rstEntry) -> bool
+        {
+            if(rstEntry.CharObject){
+                if(false
+                        || stAMQCOC.Check.NPC
+                        || stAMQCOC.Check.Player
+                        || stAMQCOC.Check.Monster){
+                    nCOCount++;
+                }
             }
-        }
+            return false;
+        });
 
         // done the count and return it
         AMCOCount stAMCOC;
@@ -796,7 +880,9 @@ void ServerMap::On_MPK_QUERYRECTUIDV(const MessagePack &rstMPK, const Theron::Ad
         }
     }
 
-    m_ActorPod->Forward({MPK_UIDV, stAMUIDV}, rstAddress, rstMPK.ID());
+    // AMUIDV is too big for the small buffer of MessagePack
+    // build the pooled block here, Theron's copy of the message shares it
+    m_ActorPod->Forward({MPK_UIDV, MessagePayload(stAMUIDV)}, rstAddress, rstMPK.ID());
 }
 
 void ServerMap::On_MPK_NEWDROPITEM(const MessagePack &rstMPK, const Theron::Address &)
@@ -842,8 +928,11 @@ void ServerMap::On_MPK_NEWDROPITEM(const MessagePack &rstMPK, const Theron::Addr
 
                         // valid grid
                         // check if gird good to hold
+                        // skip full grids, otherwise AddGroundItem() fails
                         auto nCurrCount = DropItemListCount(stRC.X(), stRC.Y());
-                        if(nCurrCount >= 0){
+                        if(true
+                                && nCurrCount >= 0
+                                && nCurrCount < SYS_MAXDROPITEM){
                             if(nCurrCount < nMinCount){
                                 nMinCount = nCurrCount;
                                 nBestX    = stRC.X();
@@ -855,7 +944,7 @@ void ServerMap::On_MPK_NEWDROPITEM(const MessagePack &rstMPK, const Theron::Addr
                             }
                         }
                     }
-                }while(stRC.Forward() && (nCheckGrid <= SYS_MAXDROPITEMGRID));
+                }while(stRC.Forward() && (nCheckGrid++ <= SYS_MAXDROPITEMGRID));
             }
 
             if(GroundValid(nBestX, nBestY)){
@@ -874,23 +963,18 @@ void ServerMap::On_MPK_OFFLINE(const MessagePack &rstMPK, const Theron::Address
 {
     AMOffline stAMO;
     std::memcpy(&stAMO, rstMPK.Data(), sizeof(stAMO));
+
+    // drop its pending path finding
+    extern PathFindService *g_PathFindService;
+    g_PathFindService->Cancel(stAMO.UID);
        
-    auto fnNotifyOffline = [stAMO, this](int nX, int nY) -> bool
+    m_AOI.ForEvent(AOIEVENT_OFFLINE, stAMO.X, stAMO.Y, [this, stAMO](const AOIManager::AOIEntry &rstEntry) -> bool
     {
-        if(true || ValidC(nX, nY)){
-            for(auto nUID: m_CellRecordV2D[nX][nY].UIDList){
-                if(nUID != stAMO.UID){
-                    extern MonoServer *g_MonoServer;
-                    if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
-                        m_ActorPod->Forward({MPK_OFFLINE, stAMO}, stUIDRecord.Address);
-                    }
-                }
-            }
+        if(rstEntry.UID != stAMO.UID){
+            m_ActorPod->Forward({MPK_OFFLINE, stAMO}, rstEntry.Address);
         }
         return false;
-    };
-
-    DoCircle(stAMO.X, stAMO.Y, 10, fnNotifyOffline);
+    });
 }
 
 void ServerMap::On_MPK_PICKUP(const MessagePack &rstMPK, const Theron::Address &)
@@ -904,26 +988,19 @@ void ServerMap::On_MPK_PICKUP(const MessagePack &rstMPK, const Theron::Address &
             auto nIndex = FindGroundItem(stAMPU.X, stAMPU.Y, stAMPU.ItemID);
             if(nIndex >= 0){
                 RemoveGroundItem(stAMPU.X, stAMPU.Y, stAMPU.ItemID);
-                auto fnRemoveGroundItem = [this, stAMPU](int nX, int nY) -> bool
+                AMRemoveGroundItem stAMRGI;
+                stAMRGI.X      = stAMPU.X;
+                stAMRGI.Y      = stAMPU.Y;
+                stAMRGI.DBID   = stAMPU.DBID;
+                stAMRGI.ItemID = stAMPU.ItemID;
+
+                m_AOI.ForEvent(AOIEVENT_REMOVEGROUNDITEM, stAMPU.X, stAMPU.Y, [this, stAMRGI](const AOIManager::AOIEntry &rstEntry) -> bool
                 {
-                    if(true || ValidC(nX, nY)){
-                        for(auto nUID: m_CellRecordV2D[nX][nY].UIDList){
-                            extern MonoServer *g_MonoServer;
-                            if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
-                                if(stUIDRecord.ClassFrom<Player>()){
-                                    AMRemoveGroundItem stAMRGI;
-                                    stAMRGI.X      = nX;
-                                    stAMRGI.Y      = nY;
-                                    stAMRGI.DBID   = stAMPU.DBID;
-                                    stAMRGI.ItemID = stAMPU.ItemID;
-                                    m_ActorPod->Forward({MPK_REMOVEGROUNDITEM, stAMRGI}, stUIDRecord.Address);
-                                }
-                            }
-                        }
+                    if(rstEntry.Player){
+                        m_ActorPod->Forward({MPK_REMOVEGROUNDITEM, stAMRGI}, rstEntry.Address);
                     }
                     return false;
-                };
-                DoCircle(stAMPU.X, stAMPU.Y, 10, fnRemoveGroundItem);
+                });
 
                 // notify the picker
                 AMPickUpOK stAMPUOK;
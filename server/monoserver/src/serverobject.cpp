@@ -3,7 +3,7 @@
  *
  *       Filename: serverobject.cpp
  *        Created: 05/23/2016 18:22:01
- *  Last Modified: 08/18/2017 15:30:04
+ *  Last Modified: 11/19/2017 02:14:36
  *
  *    Description: 
  *
@@ -24,6 +24,11 @@
 #include "serverobject.hpp"
 
 extern MonoServer *g_MonoServer;
+
+// definition of the compile-time class tag
+// needed when it's odr-used, i.e. bound to a const reference
+constexpr uint32_t ServerObject::ClassTag;
+
 ServerObject::ServerObject()
     : m_UID(g_MonoServer->GetUID())
 {
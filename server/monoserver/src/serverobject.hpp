@@ -3,7 +3,7 @@
  *
  *       Filename: serverobject.hpp
  *        Created: 04/13/2016 20:04:39
- *  Last Modified: 09/23/2017 22:44:38
+ *  Last Modified: 11/19/2017 02:14:36
  *
  *    Description: basis of all objects in monoserver, with
  *
@@ -29,8 +29,28 @@
 #include "invardata.hpp"
 #include "uidrecord.hpp"
 
+// integer tag for each class
+// tag of a class is its bit and all bits of its ancestors
+// then ``A is derived from B" is (A::ClassTag & B::ClassTag) == B::ClassTag
+enum ClassTagType: uint32_t
+{
+    CLASSTAG_NONE         = 0,
+    CLASSTAG_SERVEROBJECT = (1 << 0),
+    CLASSTAG_ACTIVEOBJECT = (1 << 1),
+    CLASSTAG_CHAROBJECT   = (1 << 2),
+    CLASSTAG_PLAYER       = (1 << 3),
+    CLASSTAG_MONSTER      = (1 << 4),
+    CLASSTAG_SERVERMAP    = (1 << 5),
+    CLASSTAG_SERVICECORE  = (1 << 6),
+};
+
 class ServerObject
 {
+    public:
+        // every class derived from ServerObject should define its own ClassTag
+        // and override GetClassTag() to return it
+        static constexpr uint32_t ClassTag = CLASSTAG_SERVEROBJECT;
+
     public:
         struct ClassCodeName
         {
@@ -84,6 +104,12 @@ class ServerObject
             return {};
         }
 
+    public:
+        virtual uint32_t GetClassTag() const
+        {
+            return ServerObject::ClassTag;
+        }
+
     public:
         static const std::vector<ClassCodeName> &ClassEntry(size_t);
 
@@ -96,12 +122,7 @@ class ServerObject
     public:
         template<typename T> bool ClassFrom() const
         {
-            for(const auto &rstCodeName: ClassEntry()){
-                if(true
-                        && rstCodeName.Name == typeid(T).name()
-                        && rstCodeName.Code == typeid(T).hash_code()){ return true; }
-            }
-            return false;
+            return (GetClassTag() & T::ClassTag) == T::ClassTag;
         }
 
     protected:
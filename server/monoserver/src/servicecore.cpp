@@ -3,7 +3,7 @@
  *
  *       Filename: servicecore.cpp
  *        Created: 04/22/2016 18:16:53
- *  Last Modified: 10/06/2017 17:17:33
+ *  Last Modified: 11/19/2017 02:14:36
  *
  *    Description: 
  *
@@ -28,6 +28,8 @@
 #include "monoserver.hpp"
 #include "servicecore.hpp"
 
+constexpr uint32_t ServiceCore::ClassTag;
+
 ServiceCore::ServiceCore()
     : ActiveObject()
     , m_MapRecord()
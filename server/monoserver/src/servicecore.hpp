@@ -3,7 +3,7 @@
  *
  *       Filename: servicecore.hpp
  *        Created: 04/22/2016 17:59:06
- *  Last Modified: 10/06/2017 17:17:50
+ *  Last Modified: 11/19/2017 02:14:36
  *
  *    Description: split monoserver into actor-code and non-actor code
  *                 put all actor code in this class
@@ -35,6 +35,15 @@
 class ServerMap;
 class ServiceCore: public ActiveObject
 {
+    public:
+        static constexpr uint32_t ClassTag = CLASSTAG_SERVICECORE | ActiveObject::ClassTag;
+
+    public:
+        uint32_t GetClassTag() const
+        {
+            return ServiceCore::ClassTag;
+        }
+
     protected:
         std::map<uint32_t, ServerMap *> m_MapRecord;
 
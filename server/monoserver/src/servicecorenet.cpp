@@ -3,7 +3,7 @@
  *
  *       Filename: servicecorenet.cpp
  *        Created: 05/20/2016 17:09:13
- *  Last Modified: 10/03/2017 22:10:24
+ *  Last Modified: 11/25/2017 01:06:57
  *
  *    Description: interaction btw NetPod and ServiceCore
  *
@@ -17,9 +17,8 @@
  *
  * =====================================================================================
  */
-#include "dbpod.hpp"
 #include "dbcomid.hpp"
-#include "threadpn.hpp"
+#include "dbpipeline.hpp"
 #include "monoserver.hpp"
 #include "servicecore.hpp"
 
@@ -28,42 +27,45 @@ void ServiceCore::Net_CM_Login(uint32_t nSessionID, uint8_t, const uint8_t *pDat
     CMLogin stCML;
     std::memcpy(&stCML, pData, sizeof(stCML));
 
-    // don't block ServiceCore too much, so we put rest of it 
-    // in the thread pool since it's db query and slow
+    // don't block ServiceCore too much, so we post rest of it
+    // to the database pipeline since it's db query and slow
 
-    auto fnDBOperation = [nSessionID, stSCAddr = GetAddress(), stCML]()
+    auto fnDBOperation = [nSessionID, stSCAddr = GetAddress(), stCML](DBPipeline::DBWorker &rstWorker)
     {
-        extern DBPodN *g_DBPodN;
         extern MonoServer *g_MonoServer;
-
         g_MonoServer->AddLog(LOGTYPE_INFO, "Login requested: (%s:%s)", stCML.ID, stCML.Password);
-        auto pDBHDR = g_DBPodN->CreateDBHDR();
 
-        if(!pDBHDR->Execute("select fld_id from tbl_account where fld_account = '%s' and fld_password = '%s'", stCML.ID, stCML.Password)){
-            g_MonoServer->AddLog(LOGTYPE_WARNING, "SQL ERROR: (%d: %s)", pDBHDR->ErrorID(), pDBHDR->ErrorInfo());
-            SyncDriver().Forward({SM_LOGINFAIL, nSessionID}, stSCAddr);
+        auto pAccount = rstWorker.Statement("select fld_id from tbl_account where fld_account = ? and fld_password = ?");
+        if(false
+                || !pAccount->BindStr(0, stCML.ID)
+                || !pAccount->BindStr(1, stCML.Password)
+                || !pAccount->Execute()){
+            g_MonoServer->AddLog(LOGTYPE_WARNING, "SQL ERROR: (%d: %s)", pAccount->ErrorID(), pAccount->ErrorInfo());
+            rstWorker.Forward({SM_LOGINFAIL, nSessionID}, stSCAddr);
             return;
         }
 
-        if(pDBHDR->RowCount() < 1){
+        if(pAccount->RowCount() < 1){
             g_MonoServer->AddLog(LOGTYPE_INFO, "can't find account: (%s:%s)", stCML.ID, stCML.Password);
-            SyncDriver().Forward({SM_LOGINFAIL, nSessionID}, stSCAddr);
+            rstWorker.Forward({SM_LOGINFAIL, nSessionID}, stSCAddr);
             return;
         }
 
-        pDBHDR->Fetch();
-        // you can put another lambda here and put it in g_TaskHub
-        // but doesn't make sense since this function is already slow
-        int nID = std::atoi(pDBHDR->Get("fld_id"));
-        if(!pDBHDR->Execute("select * from mir2x.tbl_dbid where fld_id = %d", nID)){
-            g_MonoServer->AddLog(LOGTYPE_WARNING, "SQL ERROR: (%d: %s)", pDBHDR->ErrorID(), pDBHDR->ErrorInfo());
-            SyncDriver().Forward({SM_LOGINFAIL, nSessionID}, stSCAddr);
+        pAccount->Fetch();
+        int nID = std::atoi(pAccount->Get("fld_id"));
+
+        auto pDBID = rstWorker.Statement("select * from mir2x.tbl_dbid where fld_id = ?");
+        if(false
+                || !pDBID->BindInt(0, nID)
+                || !pDBID->Execute()){
+            g_MonoServer->AddLog(LOGTYPE_WARNING, "SQL ERROR: (%d: %s)", pDBID->ErrorID(), pDBID->ErrorInfo());
+            rstWorker.Forward({SM_LOGINFAIL, nSessionID}, stSCAddr);
             return;
         }
 
-        if(pDBHDR->RowCount() < 1){
+        if(pDBID->RowCount() < 1){
             g_MonoServer->AddLog(LOGTYPE_INFO, "no dbid created for this account: (%s:%s)", stCML.ID, stCML.Password);
-            SyncDriver().Forward({SM_LOGINFAIL, nSessionID}, stSCAddr);
+            rstWorker.Forward({SM_LOGINFAIL, nSessionID}, stSCAddr);
             return;
         }
 
@@ -78,23 +80,31 @@ void ServiceCore::Net_CM_Login(uint32_t nSessionID, uint8_t, const uint8_t *pDat
         // 1. session
         stAMLQDB.SessionID = nSessionID;
 
-        pDBHDR->Fetch();
+        pDBID->Fetch();
 
         // 2. needed information to create co
-        stAMLQDB.DBID  = std::atoi(pDBHDR->Get("fld_dbid"));
-        stAMLQDB.MapID = DBCOM_MAPID(pDBHDR->Get("fld_mapname"));
+        stAMLQDB.DBID  = std::atoi(pDBID->Get("fld_dbid"));
+        stAMLQDB.MapID = DBCOM_MAPID(pDBID->Get("fld_mapname"));
 
-        stAMLQDB.MapX  = std::atoi(pDBHDR->Get("fld_mapx"));
-        stAMLQDB.MapY  = std::atoi(pDBHDR->Get("fld_mapy"));
+        stAMLQDB.MapX  = std::atoi(pDBID->Get("fld_mapx"));
+        stAMLQDB.MapY  = std::atoi(pDBID->Get("fld_mapy"));
 
         // 3. additional information, we can retrieve it later
-        stAMLQDB.Level     = std::atoi(pDBHDR->Get("fld_level"));
-        stAMLQDB.JobID     = std::atoi(pDBHDR->Get("fld_jobid"));
-        stAMLQDB.Direction = std::atoi(pDBHDR->Get("fld_direction"));
+        stAMLQDB.Level     = std::atoi(pDBID->Get("fld_level"));
+        stAMLQDB.JobID     = std::atoi(pDBID->Get("fld_jobid"));
+        stAMLQDB.Direction = std::atoi(pDBID->Get("fld_direction"));
 
-        SyncDriver().Forward({MPK_LOGINQUERYDB, stAMLQDB}, stSCAddr);
+        rstWorker.Forward({MPK_LOGINQUERYDB, stAMLQDB}, stSCAddr);
     };
 
-    extern ThreadPN *g_ThreadPN;
-    g_ThreadPN->Add(fnDBOperation);
+    extern DBPipeline *g_DBPipeline;
+    if(!g_DBPipeline->Post(fnDBOperation)){
+        // database is too busy
+        // don't queue more, reject this login directly
+        extern MonoServer *g_MonoServer;
+        g_MonoServer->AddLog(LOGTYPE_WARNING, "Database pipeline busy, login rejected for session %d", (int)(nSessionID));
+
+        extern NetPodN *g_NetPodN;
+        g_NetPodN->Send(nSessionID, SM_LOGINFAIL);
+    }
 }
@@ -3,7 +3,7 @@
  *
  *       Filename: session.cpp
  *        Created: 09/03/2015 03:48:41 AM
- *  Last Modified: 10/08/2017 02:20:52
+ *  Last Modified: 12/17/2017 21:32:08
  *
  *    Description: for received messages we won't crash if get invalid ones
  *                 but for messages to send we take zero tolerance
@@ -19,17 +19,23 @@
  * =====================================================================================
  */
 
+#include <chrono>
+#include <cstring>
+#include <algorithm>
 #include "session.hpp"
 #include "memorypn.hpp"
 #include "compress.hpp"
+#include "serverenv.hpp"
 #include "condcheck.hpp"
 #include "monoserver.hpp"
+#include "clientmessage.hpp"
 
 Session::SendTask::SendTask(uint8_t nHC, const uint8_t *pData, size_t nDataLen, std::function<void()> &&fnOnDone)
     : HC(nHC)
     , Data(pData)
     , DataLen(nDataLen)
     , OnDone(std::move(fnOnDone))
+    , Shared()
 {
     auto fnReportAndExit = [this]()
     {
@@ -109,6 +115,14 @@ Session::SendTask::SendTask(uint8_t nHC, const uint8_t *pData, size_t nDataLen,
     }
 }
 
+Session::SendTask::SendTask(std::shared_ptr<const SharedMessage> pMessage)
+    : HC(pMessage->HC)
+    , Data(pMessage->Data.empty() ? nullptr : pMessage->Data.data())
+    , DataLen(pMessage->Data.size())
+    , OnDone()
+    , Shared(std::move(pMessage))
+{}
+
 Session::Session(uint32_t nSessionID, asio::ip::tcp::socket stSocket)
     : m_ID(nSessionID)
     , m_SyncDriver()
@@ -116,15 +130,25 @@ Session::Session(uint32_t nSessionID, asio::ip::tcp::socket stSocket)
     , m_IP(m_Socket.remote_endpoint().address().to_string())
     , m_Port(m_Socket.remote_endpoint().port())
     , m_ReadHC(0)
-    , m_ReadLen {0, 0, 0, 0}
-    , m_Delay(0)
     , m_BindAddress(Theron::Address::Null())
+    , m_ReadBuf()
+    , m_ReadBegin(0)
+    , m_ReadEnd(0)
     , m_FlushFlag(false)
     , m_NextQLock()
+    , m_NextQBytes(0)
     , m_SendQBuf0()
     , m_SendQBuf1()
     , m_CurrSendQ(&(m_SendQBuf0))
     , m_NextSendQ(&(m_SendQBuf1))
+    , m_SendBuf()
+    , m_SendDoneV()
+    , m_FrameMode(0)
+    , m_FrameBuf()
+    , m_FlushTimerFlag(false)
+    , m_FlushTimer(m_Socket.get_io_service())
+    , m_ActionDeltaFlag(false)
+    , m_ActionDelta()
     , m_MemoryPN()
     , m_State(SESSTYPE_NONE)
 {}
@@ -139,7 +163,7 @@ Session::~Session()
     Shutdown(true);
 }
 
-void Session::DoReadHC()
+void Session::DoReadNext()
 {
     switch(auto nCurrState = m_State.load()){
         case SESSTYPE_STOPPED:
@@ -148,16 +172,29 @@ void Session::DoReadHC()
             }
         case SESSTYPE_RUNNING:
             {
-                auto fnReportCurrentMessage = [pThis = shared_from_this()]()
-                {
-                    extern MonoServer *g_MonoServer;
-                    g_MonoServer->AddLog(LOGTYPE_WARNING, "Current CMSGParam::HC      = %s", (CMSGParam(pThis->m_ReadHC).Name().c_str()));
-                    g_MonoServer->AddLog(LOGTYPE_WARNING, "                 ::Type    = %d", (int)(CMSGParam(pThis->m_ReadHC).Type()));
-                    g_MonoServer->AddLog(LOGTYPE_WARNING, "                 ::MaskLen = %d", (int)(CMSGParam(pThis->m_ReadHC).MaskLen()));
-                    g_MonoServer->AddLog(LOGTYPE_WARNING, "                 ::DataLen = %d", (int)(CMSGParam(pThis->m_ReadHC).DataLen()));
-                };
+                extern ServerEnv *g_ServerEnv;
+                auto nInitSize = (size_t)(std::max<int>(g_ServerEnv->MIR2X_CONFIG_NET_READBUF, 64));
+
+                // move the partial frame to the front
+                // it's short in most cases since we parse all complete frames after each read
+                if(m_ReadBegin){
+                    if(m_ReadEnd > m_ReadBegin){
+                        std::memmove(m_ReadBuf.data(), m_ReadBuf.data() + m_ReadBegin, m_ReadEnd - m_ReadBegin);
+                    }
+                    m_ReadEnd  -= m_ReadBegin;
+                    m_ReadBegin = 0;
+                }
 
-                auto fnOnNetError = [pThis = shared_from_this(), fnReportCurrentMessage](std::error_code stEC)
+                if(m_ReadEnd == 0 && m_ReadBuf.size() != nInitSize){
+                    // first read or a big frame is done
+                    // don't keep a big buffer for the rest of the session
+                    std::vector<uint8_t>(nInitSize).swap(m_ReadBuf);
+                }else if(m_ReadEnd == m_ReadBuf.size()){
+                    // one frame can't fit in current buffer
+                    m_ReadBuf.resize(m_ReadBuf.size() * 2);
+                }
+
+                auto fnDoneRead = [pThis = shared_from_this()](std::error_code stEC, size_t nReadLen)
                 {
                     if(stEC){
                         // 1. close the asio socket
@@ -166,333 +203,214 @@ void Session::DoReadHC()
                         // 2. record the error code to log
                         extern MonoServer *g_MonoServer;
                         g_MonoServer->AddLog(LOGTYPE_WARNING, "Network error on session %d: %s", (int)(pThis->ID()), stEC.message().c_str());
-                        fnReportCurrentMessage();
+                        return;
                     }
-                };
 
-                auto fnDoneReadHC = [pThis = shared_from_this(), fnOnNetError, fnReportCurrentMessage](std::error_code stEC, size_t)
-                {
-                    if(stEC){
-                        fnOnNetError(stEC);
-                    }else{
-                        CMSGParam stCMSG(pThis->m_ReadHC);
-                        switch(stCMSG.Type()){
-                            case 0:
-                                {
-                                    pThis->ForwardActorMessage(pThis->m_ReadHC, nullptr, 0);
-                                    pThis->DoReadHC();
-                                    return;
-                                }
-                            case 1:
-                                {
-                                    // not empty, fixed size, compressed
-                                    auto fnDoneReadLen0 = [pThis, stCMSG, fnOnNetError, fnReportCurrentMessage](std::error_code stEC, size_t)
-                                    {
-                                        if(stEC){
-                                            fnOnNetError(stEC);
-                                        }else{
-                                            if(pThis->m_ReadLen[0] != 255){
-                                                if((size_t)(pThis->m_ReadLen[0]) > stCMSG.DataLen()){
-                                                    // 1. close the asio socket
-                                                    pThis->Shutdown(true);
-
-                                                    // 2. record the error code but not exit?
-                                                    extern MonoServer *g_MonoServer;
-                                                    g_MonoServer->AddLog(LOGTYPE_WARNING, "Invalid package: CompLen = %d", (int)(pThis->m_ReadLen[0]));
-                                                    fnReportCurrentMessage();
-
-                                                    // 3. we stop here
-                                                    //    should we have some method to save it?
-                                                    return;
-                                                }else{
-                                                    pThis->DoReadBody(stCMSG.MaskLen(), pThis->m_ReadLen[0]);
-                                                }
-                                            }else{
-                                                // oooops, bytes[0] is 255
-                                                // we got a long message and need to read bytes[1]
-                                                auto fnDoneReadLen1 = [pThis, stCMSG, fnReportCurrentMessage, fnOnNetError](std::error_code stEC, size_t)
-                                                {
-                                                    if(stEC){
-                                                        fnOnNetError(stEC);
-                                                    }else{
-                                                        condcheck(pThis->m_ReadLen[0] == 255);
-                                                        auto nCompLen = (size_t)(pThis->m_ReadLen[1]) + 255;
-
-                                                        if(nCompLen > stCMSG.DataLen()){
-                                                            // 1. close the asio socket
-                                                            pThis->Shutdown(true);
-
-                                                            // 2. record the error code but not exit?
-                                                            extern MonoServer *g_MonoServer;
-                                                            g_MonoServer->AddLog(LOGTYPE_WARNING, "Invalid package: CompLen = %d", (int)(nCompLen));
-                                                            fnReportCurrentMessage();
-
-                                                            // 3. we stop here
-                                                            //    should we have some method to save it?
-                                                            return;
-                                                        }else{
-                                                            pThis->DoReadBody(stCMSG.MaskLen(), nCompLen);
-                                                        }
-                                                    }
-                                                };
-                                                asio::async_read(pThis->m_Socket, asio::buffer(pThis->m_ReadLen + 1, 1), fnDoneReadLen1);
-                                            }
-                                        }
-                                    };
-                                    asio::async_read(pThis->m_Socket, asio::buffer(pThis->m_ReadLen, 1), fnDoneReadLen0);
-                                    return;
-                                }
-                            case 2:
-                                {
-                                    // not empty, fixed size, not compressed
-
-                                    // it has no overhead, fast
-                                    // this mode should be used for small messages
-                                    pThis->DoReadBody(0, stCMSG.DataLen());
-                                    return;
-                                }
-                            case 3:
-                                {
-                                    // not empty, not fixed size, not compressed
-
-                                    // directly read four bytes as length
-                                    // this mode is designed for transfering big chunk
-                                    // for even bigger chunk we should send more than one time
-
-                                    // and if we want to send big chunk of compressed data
-                                    // we should compress it by other method and send it via this channel
-                                    auto fnDoneReadLen = [pThis, fnOnNetError](std::error_code stEC, size_t)
-                                    {
-                                        if(stEC){
-                                            fnOnNetError(stEC);
-                                        }else{
-                                            uint32_t nDataLenU32 = 0;
-                                            std::memcpy(&nDataLenU32, pThis->m_ReadLen, 4);
-                                            pThis->DoReadBody(0, (size_t)(nDataLenU32));
-                                        }
-                                    };
-                                    asio::async_read(pThis->m_Socket, asio::buffer(pThis->m_ReadLen, 4), fnDoneReadLen);
-                                    return;
-                                }
-                            default:
-                                {
-                                    // impossible type
-                                    // should abort at construction of CMSGParam
-                                    pThis->Shutdown(true);
-                                    fnReportCurrentMessage();
-                                    return;
-                                }
-                        }
+                    pThis->m_ReadEnd += nReadLen;
+                    if(pThis->DoReadParse()){
+                        pThis->DoReadNext();
                     }
                 };
-                asio::async_read(m_Socket, asio::buffer(&m_ReadHC, 1), fnDoneReadHC);
+
+                // take whatever available, one read may contain many frames
+                m_Socket.async_read_some(asio::buffer(m_ReadBuf.data() + m_ReadEnd, m_ReadBuf.size() - m_ReadEnd), fnDoneRead);
                 return;
             }
         default:
             {
                 extern MonoServer *g_MonoServer;
-                g_MonoServer->AddLog(LOGTYPE_WARNING, "Calling DoReadHC() with invalid state: %d", nCurrState);
+                g_MonoServer->AddLog(LOGTYPE_WARNING, "Calling DoReadNext() with invalid state: %d", nCurrState);
                 return;
             }
     }
 }
 
-void Session::DoReadBody(size_t nMaskLen, size_t nBodyLen)
+bool Session::DoReadParse()
 {
-    switch(auto nCurrState = m_State.load()){
-        case SESSTYPE_STOPPED:
-            {
-                return;
-            }
-        case SESSTYPE_RUNNING:
-            {
-                auto fnReportCurrentMessage = [pThis = shared_from_this()]()
-                {
-                    extern MonoServer *g_MonoServer;
-                    g_MonoServer->AddLog(LOGTYPE_WARNING, "Current SMSGParam::HC      = %d", (int)(pThis->m_ReadHC));
-                    g_MonoServer->AddLog(LOGTYPE_WARNING, "                 ::Type    = %d", (int)(CMSGParam(pThis->m_ReadHC).Type()));
-                    g_MonoServer->AddLog(LOGTYPE_WARNING, "                 ::MaskLen = %d", (int)(CMSGParam(pThis->m_ReadHC).MaskLen()));
-                    g_MonoServer->AddLog(LOGTYPE_WARNING, "                 ::DataLen = %d", (int)(CMSGParam(pThis->m_ReadHC).DataLen()));
-                };
+    // parse all complete frames in [m_ReadBegin, m_ReadEnd)
+    // return false if stream is invalid and session has been shutdown
 
-                auto fnOnNetError = [pThis = shared_from_this(), fnReportCurrentMessage](std::error_code stEC)
+    auto fnReportCurrentMessage = [this]()
+    {
+        extern MonoServer *g_MonoServer;
+        g_MonoServer->AddLog(LOGTYPE_WARNING, "Current CMSGParam::HC      = %s", (CMSGParam(m_ReadHC).Name().c_str()));
+        g_MonoServer->AddLog(LOGTYPE_WARNING, "                 ::Type    = %d", (int)(CMSGParam(m_ReadHC).Type()));
+        g_MonoServer->AddLog(LOGTYPE_WARNING, "                 ::MaskLen = %d", (int)(CMSGParam(m_ReadHC).MaskLen()));
+        g_MonoServer->AddLog(LOGTYPE_WARNING, "                 ::DataLen = %d", (int)(CMSGParam(m_ReadHC).DataLen()));
+    };
+
+    while(m_ReadBegin < m_ReadEnd){
+        auto pBuf   = m_ReadBuf.data() + m_ReadBegin;
+        auto nAvail = m_ReadEnd - m_ReadBegin;
+
+        m_ReadHC = pBuf[0];
+        CMSGParam stCMSG(m_ReadHC);
+
+        size_t nHeadLen = 1;
+        size_t nMaskLen = 0;
+        size_t nBodyLen = 0;
+
+        switch(stCMSG.Type()){
+            case 0:
                 {
-                    if(stEC){
+                    // empty, only the header code
+                    break;
+                }
+            case 1:
+                {
+                    // not empty, fixed size, compressed
+                    // length encoding: [0 ~ 254] or [255][0 ~ 255] as 255 + (0 ~ 255)
+                    if(nAvail < 2){
+                        return true;
+                    }
+
+                    if(pBuf[1] != 255){
+                        nHeadLen = 2;
+                        nBodyLen = (size_t)(pBuf[1]);
+                    }else{
+                        if(nAvail < 3){
+                            return true;
+                        }
+                        nHeadLen = 3;
+                        nBodyLen = (size_t)(pBuf[2]) + 255;
+                    }
+
+                    if(nBodyLen > stCMSG.DataLen()){
                         // 1. close the asio socket
-                        pThis->Shutdown(true);
+                        Shutdown(true);
 
-                        // 2. record the error code to log
+                        // 2. record the error code but not exit?
                         extern MonoServer *g_MonoServer;
-                        g_MonoServer->AddLog(LOGTYPE_WARNING, "Network error on session %d: %s", (int)(pThis->ID()), stEC.message().c_str());
+                        g_MonoServer->AddLog(LOGTYPE_WARNING, "Invalid package: CompLen = %d", (int)(nBodyLen));
                         fnReportCurrentMessage();
+                        return false;
                     }
-                };
 
-                auto fnReportInvalidArg = [nMaskLen, nBodyLen, fnReportCurrentMessage]()
+                    nMaskLen = stCMSG.MaskLen();
+                    break;
+                }
+            case 2:
                 {
-                    extern MonoServer *g_MonoServer;
-                    g_MonoServer->AddLog(LOGTYPE_WARNING, "Invalid argument to DoReadBody(MaskLen = %d, BodyLen = %d)", (int)(nMaskLen), (int)(nBodyLen));
-                    fnReportCurrentMessage();
-                };
-
-                // argument check
-                // check if (nMaskLen, nBodyLen) is proper based on current m_ReadHC
-                CMSGParam stCMSG(m_ReadHC);
-                switch(stCMSG.Type()){
-                    case 0:
-                        {
-                            fnReportInvalidArg();
-                            return;
-                        }
-                    case 1:
-                        {
-                            if(!((nMaskLen == stCMSG.MaskLen()) && (nBodyLen <= stCMSG.DataLen()))){
-                                fnReportInvalidArg();
-                                return;
-                            }
-                            break;
-                        }
-                    case 2:
-                        {
-                            if(nMaskLen || (nBodyLen != stCMSG.DataLen())){
-                                fnReportInvalidArg();
-                                return;
-                            }
-                            break;
-                        }
-                    case 3:
-                        {
-                            if(nMaskLen || (nBodyLen > 0XFFFFFFFF)){
-                                fnReportInvalidArg();
-                                return;
-                            }
-                            break;
-                        }
-                    default:
-                        {
-                            fnReportInvalidArg();
-                            return;
-                        }
+                    // not empty, fixed size, not compressed
+                    // it has no overhead, fast
+                    nBodyLen = stCMSG.DataLen();
+                    break;
                 }
+            case 3:
+                {
+                    // not empty, not fixed size, not compressed
+                    // four bytes as length
+                    if(nAvail < 5){
+                        return true;
+                    }
 
-                if(auto nDataLen = nMaskLen + nBodyLen){
-                    // we use global memory pool for read
-                    // since the allocated buffer will be passed to actor
-                    // and it's de-allocated by actor message handler, not here
-                    extern MemoryPN *g_MemoryPN;
-                    auto pMem = (uint8_t *)(g_MemoryPN->Get(nDataLen));
+                    uint32_t nDataLenU32 = 0;
+                    std::memcpy(&nDataLenU32, pBuf + 1, 4);
 
-                    auto fnDoneReadData = [pThis = shared_from_this(), nMaskLen, nBodyLen, pMem, stCMSG, fnReportCurrentMessage, fnOnNetError](std::error_code stEC, size_t)
-                    {
-                        if(stEC){
-                            fnOnNetError(stEC);
-                        }else{
-                            uint8_t *pDecodeMem = nullptr;
-                            if(nMaskLen){
-                                auto nMaskCount = Compress::CountMask(pMem, nMaskLen);
-                                if(nMaskCount != (int)(nBodyLen)){
-                                    // we get corrupted data
-                                    // should we ignore current package or kill the process?
-
-                                    // 1. keep a log for the corrupted message
-                                    extern MonoServer *g_MonoServer;
-                                    g_MonoServer->AddLog(LOGTYPE_WARNING, "Corrupted data: MaskCount = %d, CompLen = %d", nMaskCount, (int)(nBodyLen));
-
-                                    // 2. we ignore this message
-                                    //    won't shutdown current session, just return?
-                                    return;
-                                }
-
-                                // we need to decode it
-                                // we do have a compressed version of data
-                                if(nBodyLen <= stCMSG.DataLen()){
-                                    extern MemoryPN *g_MemoryPN;
-                                    pDecodeMem = (uint8_t *)(g_MemoryPN->Get(stCMSG.DataLen()));
-                                    if(Compress::Decode(pDecodeMem, stCMSG.DataLen(), pMem, pMem + nMaskLen) != (int)(nBodyLen)){
-                                        // 1. keep a record for this failure
-                                        extern MonoServer *g_MonoServer;
-                                        g_MonoServer->AddLog(LOGTYPE_WARNING, "Decode failed: MaskCount = %d, CompLen = %d", nMaskCount, (int)(nBodyLen));
-                                        fnReportCurrentMessage();
-
-                                        // 2. free memory
-                                        g_MemoryPN->Free(pMem);
-                                        g_MemoryPN->Free(pDecodeMem);
-
-                                        // 3. do nothing but return directly
-                                        return;
-                                    }else{
-                                        // ok decoding succeed, free pMem
-                                        g_MemoryPN->Free(pMem);
-                                    }
-                                }else{
-                                    extern MonoServer *g_MonoServer;
-                                    g_MonoServer->AddLog(LOGTYPE_WARNING, "Corrupted data: DataLen = %d, CompLen = %d", (int)(stCMSG.DataLen()), (int)(nBodyLen));
-                                    fnReportCurrentMessage();
-                                    return;
-                                }
-                            }
-
-                            // decoding and verification done
-                            // we pass the pointer to actor and it's released inside actor
-                            pThis->ForwardActorMessage(pThis->m_ReadHC, pDecodeMem ? pDecodeMem : pMem, nMaskLen ? stCMSG.DataLen() : nBodyLen);
-                            pThis->DoReadHC();
-                        }
-                    };
-                    asio::async_read(m_Socket, asio::buffer(pMem, nDataLen), fnDoneReadData);
-                    return;
+                    nHeadLen = 5;
+                    nBodyLen = (size_t)(nDataLenU32);
+                    break;
                 }
+            default:
+                {
+                    // impossible type
+                    // should abort at construction of CMSGParam
+                    Shutdown(true);
+                    fnReportCurrentMessage();
+                    return false;
+                }
+        }
 
-                // possibilities to reach here
-                // 1. call DoReadBody() with m_ReadHC as empty message type
-                // 2. read a body with empty body in mode 3
-                ForwardActorMessage(m_ReadHC, nullptr, 0);
-                DoReadHC();
-                return;
-            }
-        default:
-            {
-                extern MonoServer *g_MonoServer;
-                g_MonoServer->AddLog(LOGTYPE_WARNING, "Calling DoReadBody() with invalid state: %d", nCurrState);
-                return;
-            }
+        if(nAvail < nHeadLen + nMaskLen + nBodyLen){
+            // partial frame
+            // wait for next read
+            return true;
+        }
+
+        DoReadFrame(m_ReadHC, pBuf + nHeadLen, nMaskLen, nBodyLen);
+        m_ReadBegin += (nHeadLen + nMaskLen + nBodyLen);
+
+        // frame handling may shutdown current session
+        if(m_State.load() != SESSTYPE_RUNNING){
+            return false;
+        }
     }
+    return true;
 }
 
-void Session::DoSendNext()
+void Session::DoReadFrame(uint8_t nHC, const uint8_t *pFrame, size_t nMaskLen, size_t nBodyLen)
 {
-    switch(auto nCurrState = m_State.load()){
-        case SESSTYPE_STOPPED:
+    // one complete frame in the read buffer
+    // we use global memory pool for the message to forward
+    // since the allocated buffer will be passed to actor
+    // and it's de-allocated by actor message handler, not here
+
+    // protocol options of this connection
+    // actors don't need to know them
+    switch(nHC){
+        case CM_ACTIONDELTA:
             {
+                extern ServerEnv *g_ServerEnv;
+                m_ActionDeltaFlag.store(g_ServerEnv->MIR2X_CONFIG_NET_ACTIONDELTA != 0);
                 return;
             }
-        case SESSTYPE_RUNNING:
+        case CM_FRAME:
             {
-                condcheck(m_FlushFlag);
-                condcheck(!m_CurrSendQ->empty());
-
-                if(m_CurrSendQ->front().OnDone){
-                    m_CurrSendQ->front().OnDone();
-                }
-
-                if(m_CurrSendQ->front().Data && m_CurrSendQ->front().DataLen){
-                    m_MemoryPN.Free(const_cast<uint8_t *>(m_CurrSendQ->front().Data));
-                }
-
-                m_CurrSendQ->pop();
-                DoSendHC();
-
+                // read and send are in the same asio thread
+                // no need to make m_FrameMode atomic
+                extern ServerEnv *g_ServerEnv;
+                m_FrameMode = std::max<int>(g_ServerEnv->MIR2X_CONFIG_NET_FRAME, 0);
                 return;
             }
         default:
             {
-                extern MonoServer *g_MonoServer;
-                g_MonoServer->AddLog(LOGTYPE_WARNING, "Calling DoSendNext() with invalid state: %d", nCurrState);
-                return;
+                break;
             }
     }
+
+    if(!(nMaskLen + nBodyLen)){
+        // possibilities to reach here
+        // 1. empty message type
+        // 2. read a body with empty body in mode 3
+        ForwardActorMessage(nHC, nullptr, 0);
+        return;
+    }
+
+    extern MemoryPN *g_MemoryPN;
+    extern MonoServer *g_MonoServer;
+
+    if(nMaskLen){
+        CMSGParam stCMSG(nHC);
+        auto nMaskCount = Compress::CountMask(pFrame, nMaskLen);
+        if(nMaskCount != (int)(nBodyLen)){
+            // we get corrupted data
+            // frame boundary is still known, only ignore this message
+            g_MonoServer->AddLog(LOGTYPE_WARNING, "Corrupted data: MaskCount = %d, CompLen = %d", nMaskCount, (int)(nBodyLen));
+            return;
+        }
+
+        auto pDecodeMem = (uint8_t *)(g_MemoryPN->Get(stCMSG.DataLen()));
+        if(Compress::Decode(pDecodeMem, stCMSG.DataLen(), pFrame, pFrame + nMaskLen) != (int)(nBodyLen)){
+            // 1. keep a record for this failure
+            g_MonoServer->AddLog(LOGTYPE_WARNING, "Decode failed: MaskCount = %d, CompLen = %d", nMaskCount, (int)(nBodyLen));
+
+            // 2. free memory and ignore this message
+            g_MemoryPN->Free(pDecodeMem);
+            return;
+        }
+
+        // decoding and verification done
+        // we pass the pointer to actor and it's released inside actor
+        ForwardActorMessage(nHC, pDecodeMem, stCMSG.DataLen());
+        return;
+    }
+
+    auto pMem = (uint8_t *)(g_MemoryPN->Get(nBodyLen));
+    std::memcpy(pMem, pFrame, nBodyLen);
+    ForwardActorMessage(nHC, pMem, nBodyLen);
 }
 
-void Session::DoSendBuf()
+void Session::DoSendDone()
 {
     switch(auto nCurrState = m_State.load()){
         case SESSTYPE_STOPPED:
@@ -502,44 +420,40 @@ void Session::DoSendBuf()
         case SESSTYPE_RUNNING:
             {
                 condcheck(m_FlushFlag);
-                condcheck(!m_CurrSendQ->empty());
 
-                if(m_CurrSendQ->front().Data && m_CurrSendQ->front().DataLen){
-                    auto fnDoneSend = [pThis = shared_from_this()](std::error_code stEC, size_t)
-                    {
-                        if(stEC){
-                            // 1. shutdown current connection
-                            pThis->Shutdown(true);
-
-                            // 2. report message and abort current process
-                            extern MonoServer *g_MonoServer;
-                            g_MonoServer->AddLog(LOGTYPE_WARNING, "Network error on session %d: %s", (int)(pThis->ID()), stEC.message().c_str());
-                            return;
-                        }else{
-                            // don't do buffer release and callback invocation here
-                            // we put it in DoSendNext()
-                            pThis->DoSendNext();
-                        }
-                    };
+                // the whole batch is on wire
+                // invoke callbacks in the order of Send()
+                for(auto &fnOnDone: m_SendDoneV){
+                    if(fnOnDone){
+                        fnOnDone();
+                    }
+                }
+                m_SendDoneV.clear();
 
-                    // the Data field should contains all needed size info
-                    // when call Session::Send() it should be compressed if necessary and put it there
-                    asio::async_write(m_Socket, asio::buffer(m_CurrSendQ->front().Data, m_CurrSendQ->front().DataLen), fnDoneSend);
-                }else{
-                    DoSendNext();
+                // one big message may make the batch buffer huge
+                // don't keep it for the rest of the session
+                extern ServerEnv *g_ServerEnv;
+                if(m_SendBuf.capacity() > 4 * (size_t)(std::max<int>(g_ServerEnv->MIR2X_CONFIG_NET_SENDBYTES, 1))){
+                    std::vector<uint8_t>().swap(m_SendBuf);
                 }
+
+                if(m_FrameBuf.capacity() > 4 * (size_t)(std::max<int>(g_ServerEnv->MIR2X_CONFIG_NET_SENDBYTES, 1))){
+                    std::vector<uint8_t>().swap(m_FrameBuf);
+                }
+
+                DoSendNext();
                 return;
             }
         default:
             {
                 extern MonoServer *g_MonoServer;
-                g_MonoServer->AddLog(LOGTYPE_WARNING, "Calling DoSendBuf() with invalid state: %d", nCurrState);
+                g_MonoServer->AddLog(LOGTYPE_WARNING, "Calling DoSendDone() with invalid state: %d", nCurrState);
                 return;
             }
     }
 }
 
-void Session::DoSendHC()
+void Session::DoSendNext()
 {
     // 1. only called in asio main loop thread
     // 2. only called in RUNNING / STOPPED state
@@ -554,23 +468,17 @@ void Session::DoSendHC()
             }
         case SESSTYPE_RUNNING:
             {
-                // will send this header code
-                // session state could switch to STOPPED during sending
-
                 // when we are here
                 // we should already have m_FlushFlag set as true
                 condcheck(m_FlushFlag);
+                condcheck(m_SendDoneV.empty());
 
                 // we check m_CurrSendQ and if it's empty we swap with the pending queue
                 // then for server threads calling Send() we only dealing with m_NextSendQ
 
-                // but in asio main loop thread calling DoSendHC()
-                // when we finished all tasks in m_CurrSendQ (ro swapped into m_CurrSendQ) we just stopped
+                // when we finished all tasks in m_CurrSendQ (or swapped into m_CurrSendQ) we just stopped
                 // all posted tasks after have to wait for next post to call FlushSendQ() to drive then send
 
-                // we may put a self check for each session
-                // for every x ms we automatically call FlushSendQ()
-
                 if(m_CurrSendQ->empty()){
                     std::lock_guard<std::mutex> stLockGuard(m_NextQLock);
                     if(m_NextSendQ->empty()){
@@ -580,18 +488,53 @@ void Session::DoSendHC()
                         return;
                     }else{
                         // else we still need to access m_CurrSendQ 
-                        // keep m_FlushFlag to pervent other thread to call DoSendHC()
+                        // keep m_FlushFlag to pervent other thread to call DoSendNext()
                         std::swap(m_CurrSendQ, m_NextSendQ);
+                        m_NextQBytes = 0;
                     }
                 }
 
-                condcheck(!m_CurrSendQ->empty());
-                auto fnDoSendBuf = [pThis = shared_from_this()](std::error_code stEC, size_t)
-                {
-                    // we always use pThis here
-                    // but actually we know since DoSendHC() is invoked by pThis always
-                    // then here using this or pThis should be both OK
+                // coalesce pending tasks into one batch
+                // a task is always taken as a whole, and the first one is always taken even it's too long
+                // buffer of each task is released after copy, only the callback is kept till write done
+
+                extern ServerEnv *g_ServerEnv;
+                auto nMaxBytes = (size_t)(std::max<int>(g_ServerEnv->MIR2X_CONFIG_NET_SENDBYTES, 1));
+                auto nMaxCount = (size_t)(std::max<int>(g_ServerEnv->MIR2X_CONFIG_NET_SENDCOUNT, 1));
+
+                m_SendBuf.clear();
+                while(true
+                        && !m_CurrSendQ->empty()
+                        && m_SendDoneV.size() < nMaxCount){
+
+                    auto &rstTask = m_CurrSendQ->front();
+                    if(true
+                            && !m_SendBuf.empty()
+                            && (m_SendBuf.size() + 1 + rstTask.DataLen > nMaxBytes)){
+                        break;
+                    }
+
+                    m_SendBuf.push_back(rstTask.HC);
+                    if(rstTask.Data && rstTask.DataLen){
+                        // the Data field should contains all needed size info
+                        // when call Session::Send() it should be compressed if necessary and put it there
+                        m_SendBuf.insert(m_SendBuf.end(), rstTask.Data, rstTask.Data + rstTask.DataLen);
+                        if(!rstTask.Shared){
+                            m_MemoryPN.Free(const_cast<uint8_t *>(rstTask.Data));
+                        }
+                    }
+
+                    m_SendDoneV.push_back(std::move(rstTask.OnDone));
+                    m_CurrSendQ->pop();
+                }
 
+                condcheck(!m_SendBuf.empty());
+                if(m_FrameMode && (m_SendDoneV.size() > 1)){
+                    PackFrame();
+                }
+
+                auto fnDoneSend = [pThis = shared_from_this()](std::error_code stEC, size_t)
+                {
                     if(stEC){
                         // 1. shutdown current connection
                         pThis->Shutdown(true);
@@ -601,22 +544,67 @@ void Session::DoSendHC()
                         g_MonoServer->AddLog(LOGTYPE_WARNING, "Network error on session %d: %s", (int)(pThis->ID()), stEC.message().c_str());
                         return;
                     }else{
-                        pThis->DoSendBuf();
+                        pThis->DoSendDone();
                     }
                 };
 
-                asio::async_write(m_Socket, asio::buffer(&(m_CurrSendQ->front().HC), 1), fnDoSendBuf);
+                asio::async_write(m_Socket, asio::buffer(m_SendBuf), fnDoneSend);
                 return;
             }
         default:
             {
                 extern MonoServer *g_MonoServer;
-                g_MonoServer->AddLog(LOGTYPE_WARNING, "Calling DoSendHC() with invalid state: %d", nCurrState);
+                g_MonoServer->AddLog(LOGTYPE_WARNING, "Calling DoSendNext() with invalid state: %d", nCurrState);
                 return;
             }
     }
 }
 
+void Session::PackFrame()
+{
+    // m_SendBuf : [HC, Data][HC, Data]...
+    // m_FrameBuf: [SM_FRAME][FrameLen][Mode][...]
+    // see servermessage.hpp for the frame layout
+    auto nOrigLen = m_SendBuf.size();
+    auto nMaskLen = (nOrigLen + 7) / 8;
+
+    m_FrameBuf.clear();
+    m_FrameBuf.push_back(SM_FRAME);
+    m_FrameBuf.resize(1 + 4);
+
+    int nCountData = -1;
+    if(m_FrameMode >= 2){
+        nCountData = Compress::CountData(m_SendBuf.data(), nOrigLen);
+    }
+
+    if(true
+            && (nCountData >= 0)
+            && (4 + nMaskLen + (size_t)(nCountData) < nOrigLen)){
+        m_FrameBuf.push_back(FRAMEMODE_COMPRESS);
+        {
+            auto nOrigLenU32 = (uint32_t)(nOrigLen);
+            m_FrameBuf.insert(m_FrameBuf.end(), (const uint8_t *)(&nOrigLenU32), (const uint8_t *)(&nOrigLenU32) + 4);
+        }
+
+        auto nOffset = m_FrameBuf.size();
+        m_FrameBuf.resize(nOffset + nMaskLen + (size_t)(nCountData));
+        if(Compress::Encode(m_FrameBuf.data() + nOffset, m_SendBuf.data(), nOrigLen) != nCountData){
+            // never happens, send the batch as it is
+            // client can decode it without frame
+            extern MonoServer *g_MonoServer;
+            g_MonoServer->AddLog(LOGTYPE_WARNING, "Compress frame failed: OrigLen = %d, CountData = %d", (int)(nOrigLen), nCountData);
+            return;
+        }
+    }else{
+        m_FrameBuf.push_back(FRAMEMODE_RAW);
+        m_FrameBuf.insert(m_FrameBuf.end(), m_SendBuf.begin(), m_SendBuf.end());
+    }
+
+    auto nFrameLenU32 = (uint32_t)(m_FrameBuf.size() - 1 - 4);
+    std::memcpy(m_FrameBuf.data() + 1, &nFrameLenU32, 4);
+    std::swap(m_SendBuf, m_FrameBuf);
+}
+
 bool Session::FlushSendQ()
 {
     auto fnFlushSendQ = [pThis = shared_from_this()]()
@@ -628,19 +616,54 @@ bool Session::FlushSendQ()
         // but we need lock for m_NextSendQ, in child threads, in asio main loop
 
         // but we need to make sure there is only one procedure in asio main loop accessing m_CurrSendQ
-        // because packages in m_CurrSendQ are divided into two parts: HC / Data 
-        // one package only get erased after Data is sent
-        // then multiple procesdure in asio main loop may send HC / Data more than one time
+        // because one batch of packages is sent by one async_write
+        // then multiple procesdure in asio main loop may write interleaved data to the socket
 
         // use shared_ptr<Session>() instead of raw this
         // then outside of asio main loop we use shared_ptr::reset()
 
-        if(!pThis->m_FlushFlag){
-            //  mark as current some one is accessing it
-            //  we don't even need to make m_FlushFlag atomic since it's in one thread
-            pThis->m_FlushFlag = true;
-            pThis->DoSendHC();
+        if(pThis->m_FlushFlag){
+            // someone is sending
+            // it picks up all pending packages when current batch is done
+            return;
+        }
+
+        extern ServerEnv *g_ServerEnv;
+        if(g_ServerEnv->MIR2X_CONFIG_NET_SENDDELAY > 0){
+            size_t nNextQBytes = 0;
+            {
+                std::lock_guard<std::mutex> stLockGuard(pThis->m_NextQLock);
+                nNextQBytes = pThis->m_NextQBytes;
+            }
+
+            if(nNextQBytes == 0){
+                // flushed by previous post
+                return;
+            }
+
+            if(nNextQBytes < (size_t)(g_ServerEnv->MIR2X_CONFIG_NET_SENDMINBYTES)){
+                // not enough to fill a segment
+                // wait for more packages but no longer than the latency cap
+                if(!pThis->m_FlushTimerFlag){
+                    pThis->m_FlushTimerFlag = true;
+                    pThis->m_FlushTimer.expires_from_now(std::chrono::milliseconds(g_ServerEnv->MIR2X_CONFIG_NET_SENDDELAY));
+                    pThis->m_FlushTimer.async_wait([pThis](std::error_code)
+                    {
+                        pThis->m_FlushTimerFlag = false;
+                        if(!pThis->m_FlushFlag){
+                            pThis->m_FlushFlag = true;
+                            pThis->DoSendNext();
+                        }
+                    });
+                }
+                return;
+            }
         }
+
+        //  mark as current some one is accessing it
+        //  we don't even need to make m_FlushFlag atomic since it's in one thread
+        pThis->m_FlushFlag = true;
+        pThis->DoSendNext();
     };
 
     // FlushSendQ() is called by server threads only
@@ -649,29 +672,164 @@ bool Session::FlushSendQ()
     return true;
 }
 
+template<typename F> bool Session::PostTask(F &&fnBuildTask)
+{
+    size_t nLastBytes = 0;
+    size_t nNextBytes = 0;
+
+    // ready to send
+    {
+        std::lock_guard<std::mutex> stLockGuard(m_NextQLock);
+
+        auto stTask = fnBuildTask();
+        if(!stTask){
+            return false;
+        }
+
+        nLastBytes = m_NextQBytes;
+        nNextBytes = m_NextQBytes + 1 + stTask.DataLen;
+
+        m_NextQBytes = nNextBytes;
+        m_NextSendQ->emplace(std::move(stTask));
+    }
+
+    // 3. notify asio main loop
+    //    if pending queue is not empty the previous Send() already posted a flush
+    //    which sends this one also, only need to post again when it crosses the threshold
+    extern ServerEnv *g_ServerEnv;
+    if(false
+            || (nLastBytes == 0)
+            || (true
+                && (g_ServerEnv->MIR2X_CONFIG_NET_SENDDELAY > 0)
+                && (nLastBytes <  (size_t)(g_ServerEnv->MIR2X_CONFIG_NET_SENDMINBYTES))
+                && (nNextBytes >= (size_t)(g_ServerEnv->MIR2X_CONFIG_NET_SENDMINBYTES)))){
+        return FlushSendQ();
+    }
+    return true;
+}
+
 bool Session::Send(uint8_t nHC, const uint8_t *pData, size_t nDataLen, std::function<void()> &&fnDone)
 {
+    if(true
+            && nHC == SM_ACTION
+            && pData
+            && nDataLen == sizeof(SMAction)
+            && m_ActionDeltaFlag.load()){
+        return SendAction(pData, std::move(fnDone));
+    }
+
     // BuildTask should be thread-safe
     // it's using the internal memory pool to build the task block
+    // build it outside of m_NextQLock since compression takes time
 
     if(auto stTask = BuildTask(nHC, pData, nDataLen, std::move(fnDone))){
-        // ready to send
+        return PostTask([&stTask]() -> SendTask
         {
-            std::lock_guard<std::mutex> stLockGuard(m_NextQLock);
-            m_NextSendQ->emplace(std::move(stTask));
+            return std::move(stTask);
+        });
+    }
+    return false;
+}
+
+bool Session::Send(std::shared_ptr<const SharedMessage> pMessage)
+{
+    if(pMessage && pMessage->HC){
+        // action is delta-encoded by each session
+        // it costs one encoding per session but saves much more bytes on wire
+        if(true
+                && pMessage->HC == SM_ACTION
+                && pMessage->Raw.size() == sizeof(SMAction)
+                && m_ActionDeltaFlag.load()){
+            return SendAction(pMessage->Raw.data(), std::function<void()>());
         }
 
-        // 3. notify asio main loop
-        return FlushSendQ();
+        return PostTask([&pMessage]() -> SendTask
+        {
+            return {std::move(pMessage)};
+        });
     }
     return false;
 }
 
+bool Session::SendAction(const uint8_t *pData, std::function<void()> &&fnDone)
+{
+    SMAction stSMA;
+    std::memcpy(&stSMA, pData, sizeof(stSMA));
+
+    // encode and update the baseline inside m_NextQLock
+    // client sees messages in the same order as the baseline changes
+    return PostTask([this, &stSMA, &fnDone]() -> SendTask
+    {
+        SMActionDelta stSMAD;
+        if(m_ActionDelta.Diff(stSMA, &stSMAD)){
+            if(auto stTask = BuildTask(SM_ACTIONDELTA, (const uint8_t *)(&stSMAD), sizeof(stSMAD), std::move(fnDone))){
+                m_ActionDelta.Update(stSMA);
+                return stTask;
+            }
+            return Session::SendTask::Null();
+        }
+
+        if(auto stTask = BuildTask(SM_ACTION, (const uint8_t *)(&stSMA), sizeof(stSMA), std::move(fnDone))){
+            m_ActionDelta.Update(stSMA);
+            return stTask;
+        }
+        return Session::SendTask::Null();
+    });
+}
+
 Session::SendTask Session::BuildTask(uint8_t nHC, const uint8_t *pData, size_t nDataLen, std::function<void()> &&fnDone)
 {
     size_t   nEncodeSize = 0;
     uint8_t *pEncodeData = nullptr;
 
+    if(!EncodeData(nHC, pData, nDataLen, m_MemoryPN, &pEncodeData, &nEncodeSize)){
+        return Session::SendTask::Null();
+    }
+    return {nHC, pEncodeData, nEncodeSize, std::move(fnDone)};
+}
+
+std::shared_ptr<const Session::SharedMessage> Session::Encode(uint8_t nHC, const uint8_t *pData, size_t nDataLen)
+{
+    // pool of one buffer for EncodeData()
+    // the encoded message is built in place in the shared message
+    struct SharedPool
+    {
+        std::vector<uint8_t> &Buf;
+
+        void *Get(size_t nSize)
+        {
+            Buf.resize(nSize);
+            return Buf.data();
+        }
+
+        void Free(void *)
+        {
+            Buf.clear();
+        }
+    };
+
+    auto pMessage = std::make_shared<SharedMessage>();
+    SharedPool stPool {pMessage->Data};
+
+    size_t   nEncodeSize = 0;
+    uint8_t *pEncodeData = nullptr;
+
+    if(!EncodeData(nHC, pData, nDataLen, stPool, &pEncodeData, &nEncodeSize)){
+        return {};
+    }
+
+    pMessage->HC = nHC;
+    if(nHC == SM_ACTION){
+        pMessage->Raw.assign(pData, pData + nDataLen);
+    }
+    return pMessage;
+}
+
+template<typename T> bool Session::EncodeData(uint8_t nHC, const uint8_t *pData, size_t nDataLen, T &rstPool, uint8_t **ppEncodeData, size_t *pEncodeSize)
+{
+    size_t   nEncodeSize = 0;
+    uint8_t *pEncodeData = nullptr;
+
     auto fnReportError = [nHC, pData, nDataLen](const char *pErrorMessage)
     {
         extern MonoServer *g_MonoServer;
@@ -684,7 +842,7 @@ Session::SendTask Session::BuildTask(uint8_t nHC, const uint8_t *pData, size_t n
             {
                 if(pData || nDataLen){
                     fnReportError("Invalid argument");
-                    return Session::SendTask::Null();
+                    return false;
                 }
                 break;
             }
@@ -693,7 +851,7 @@ Session::SendTask Session::BuildTask(uint8_t nHC, const uint8_t *pData, size_t n
                 // not empty, fixed size, comperssed
                 if(!(pData && (nDataLen == stSMSG.DataLen()))){
                     fnReportError("Invalid argument");
-                    return Session::SendTask::Null();
+                    return false;
                 }
 
                 // do compression, two solutions
@@ -712,31 +870,31 @@ Session::SendTask Session::BuildTask(uint8_t nHC, const uint8_t *pData, size_t n
                 auto nCountData = Compress::CountData(pData, nDataLen);
                 if(nCountData < 0){
                     fnReportError("Count data failed");
-                    return Session::SendTask::Null();
+                    return false;
                 }else if(nCountData <= 254){
                     // we need only one byte for length info
-                    pEncodeData = (uint8_t *)(m_MemoryPN.Get(stSMSG.MaskLen() + (size_t)(nCountData) + 1));
+                    pEncodeData = (uint8_t *)(rstPool.Get(stSMSG.MaskLen() + (size_t)(nCountData) + 1));
                     if(Compress::Encode(pEncodeData + 1, pData, nDataLen) != nCountData){
                         // 1. keep a record for the failure
                         fnReportError("Compression failed");
 
                         // 2. free memory allocated and return immediately
-                        m_MemoryPN.Free(pEncodeData);
-                        return Session::SendTask::Null();
+                        rstPool.Free(pEncodeData);
+                        return false;
                     }
 
                     pEncodeData[0] = (uint8_t)(nCountData);
                     nEncodeSize    = 1 + stSMSG.MaskLen() + (size_t)(nCountData);
                 }else if(nCountData <= (255 + 255)){
                     // we need two byte for length info
-                    pEncodeData = (uint8_t *)(m_MemoryPN.Get(stSMSG.MaskLen() + (size_t)(nCountData) + 2));
+                    pEncodeData = (uint8_t *)(rstPool.Get(stSMSG.MaskLen() + (size_t)(nCountData) + 2));
                     if(!Compress::Encode(pEncodeData + 2, pData, nDataLen)){
                         // 1. keep a record for the failure
                         fnReportError("Compression failed");
 
                         // 2. free memory allocated and return immediately
-                        m_MemoryPN.Free(pEncodeData);
-                        return Session::SendTask::Null();
+                        rstPool.Free(pEncodeData);
+                        return false;
                     }
 
                     pEncodeData[0] = 255;
@@ -750,8 +908,8 @@ Session::SendTask Session::BuildTask(uint8_t nHC, const uint8_t *pData, size_t n
                     fnReportError("Compressed data too long");
 
                     // 2. free memory allocated and return immediately
-                    m_MemoryPN.Free(pEncodeData);
-                    return Session::SendTask::Null();
+                    rstPool.Free(pEncodeData);
+                    return false;
                 }
                 break;
             }
@@ -760,10 +918,10 @@ Session::SendTask Session::BuildTask(uint8_t nHC, const uint8_t *pData, size_t n
                 // not empty, fixed size, not compressed
                 if(!(pData && (nDataLen == stSMSG.DataLen()))){
                     fnReportError("Invalid argument");
-                    return Session::SendTask::Null();
+                    return false;
                 }
 
-                pEncodeData = (uint8_t *)(m_MemoryPN.Get(nDataLen));
+                pEncodeData = (uint8_t *)(rstPool.Get(nDataLen));
                 nEncodeSize = stSMSG.DataLen();
 
                 // for fixed size and uncompressed message
@@ -777,16 +935,16 @@ Session::SendTask Session::BuildTask(uint8_t nHC, const uint8_t *pData, size_t n
                 if(pData){
                     if((nDataLen == 0) || (nDataLen > 0XFFFFFFFF)){
                         fnReportError("Invalid argument");
-                        return Session::SendTask::Null();
+                        return false;
                     }
                 }else{
                     if(nDataLen){
                         fnReportError("Invalid argument");
-                        return Session::SendTask::Null();
+                        return false;
                     }
                 }
 
-                pEncodeData = (uint8_t *)(m_MemoryPN.Get(nDataLen + 4));
+                pEncodeData = (uint8_t *)(rstPool.Get(nDataLen + 4));
                 nEncodeSize = nDataLen + 4;
 
                 // 1. setup the message length encoding
@@ -802,11 +960,13 @@ Session::SendTask Session::BuildTask(uint8_t nHC, const uint8_t *pData, size_t n
         default:
             {
                 fnReportError("Invalid argument");
-                return Session::SendTask::Null();
+                return false;
             }
     }
 
-    return {nHC, pEncodeData, nEncodeSize, std::move(fnDone)};
+    *ppEncodeData = pEncodeData;
+    *pEncodeSize  = nEncodeSize;
+    return true;
 }
 
 bool Session::ForwardActorMessage(uint8_t nHC, const uint8_t *pData, size_t nDataLen)
@@ -940,7 +1100,7 @@ bool Session::Launch(const Theron::Address &rstAddr)
                     // make state RUNNING first
                     // otherwise all DoXXXXFunc() will exit directly
 
-                    m_Socket.get_io_service().post([pThis = shared_from_this()](){ pThis->DoReadHC(); });
+                    m_Socket.get_io_service().post([pThis = shared_from_this()](){ pThis->DoReadNext(); });
                     break;
                 }
             default:
@@ -3,7 +3,7 @@
  *
  *       Filename: session.hpp
  *        Created: 09/03/2015 03:48:41
- *  Last Modified: 10/08/2017 12:54:22
+ *  Last Modified: 12/17/2017 21:32:08
  *
  *    Description: basic class from client-server communication
  *
@@ -21,7 +21,8 @@
  *                 1. who is going to access this class?
  *                    the server threads and asio main loop thread will access it. For access from
  *                    server threads, need to make it thread safe. For access from the asio thread
- *                    since currently I only use one thread for asio, it's simpler
+ *                    it's simpler, NetPodN runs many io_service shards but one session is pinned
+ *                    to one shard, which is driven by only one thread
  *
  *                 2. Session::Send(server_message) use internal memory pool to copy server_message
  *                    and post it to the asio main loop
@@ -96,13 +97,16 @@
 #pragma once
 #include <queue>
 #include <mutex>
+#include <atomic>
 #include <memory>
+#include <vector>
 #include <cstdint>
 #include <asio.hpp>
 #include <functional>
 #include <Theron/Theron.h>
 
 #include "syncdriver.hpp"
+#include "actiondelta.hpp"
 #include "memorychunkpn.hpp"
 
 class Session: public std::enable_shared_from_this<Session>
@@ -115,6 +119,19 @@ class Session: public std::enable_shared_from_this<Session>
             SESSTYPE_STOPPED = 2,
         };
 
+    public:
+        // message encoded once by Session::Encode() for broadcast
+        // sessions refer to the same buffer, freed by the last one copying it into its batch
+        struct SharedMessage
+        {
+            uint8_t HC;
+            std::vector<uint8_t> Data;
+
+            // unencoded body for sessions encoding it by their own state
+            // only kept for SM_ACTION, see m_ActionDelta
+            std::vector<uint8_t> Raw;
+        };
+
     private:
         // used by server threads, when server trying to post an send
         // it build a SendTask package by BuildTask() and post to the asio main loop thread
@@ -127,10 +144,18 @@ class Session: public std::enable_shared_from_this<Session>
 
             std::function<void()> OnDone;
 
+            // set if Data refers to a shared message
+            // then Data is not from m_MemoryPN and shouldn't be freed
+            std::shared_ptr<const SharedMessage> Shared;
+
             // there are argument check when constructing SendTask
             // so put the implementation of the constructor in session.cpp
             SendTask(uint8_t, const uint8_t *, size_t, std::function<void()> &&);
 
+            // shared message is checked when encoding
+            // no argument check here since it's done per recipient
+            SendTask(std::shared_ptr<const SharedMessage>);
+
             operator bool () const
             {
                 return HC != 0;
@@ -156,19 +181,28 @@ class Session: public std::enable_shared_from_this<Session>
 
     private:
         uint8_t         m_ReadHC;
-        uint8_t         m_ReadLen[4];
-        uint32_t        m_BodyLen;
-        uint32_t        m_Delay;
         Theron::Address m_BindAddress;
 
+    private:
+        // inbound buffer, only accessed in asio main loop
+        // read whatever available into [m_ReadEnd, end) and parse all complete frames in [m_ReadBegin, m_ReadEnd)
+        // partial frame left is moved to the front before next read, buffer grows if one frame can't fit
+        std::vector<uint8_t> m_ReadBuf;
+        size_t               m_ReadBegin;
+        size_t               m_ReadEnd;
+
     private:
         // 1. m_FlushFlag indicates there is procedure accessing m_CurrSendQ in asio main loop
         //    m_FlushFlag prevents more than one procedure from accessing m_CurrSendQ
         //
-        // 2. m_NextQLock protect the pending queue: m_NextSendQ
+        // 2. m_NextQLock protect the pending queue: m_NextSendQ and m_NextQBytes
         //    m_NextSendQ will be accessed in multi-threading manner
+        //
+        // 3. m_NextQBytes is bytes on wire of all tasks in m_NextSendQ
+        //    used to decide whether we flush immediately or wait for more messages
         bool       m_FlushFlag;
         std::mutex m_NextQLock;
+        size_t     m_NextQBytes;
 
     private:
         std::queue<SendTask>  m_SendQBuf0;
@@ -176,6 +210,33 @@ class Session: public std::enable_shared_from_this<Session>
         std::queue<SendTask> *m_CurrSendQ;
         std::queue<SendTask> *m_NextSendQ;
 
+    private:
+        // coalesced send batch, only accessed in asio main loop
+        // pending tasks are copied into m_SendBuf as [HC, Data][HC, Data]...
+        // and flushed by one async_write, callbacks are invoked after the write is done
+        std::vector<uint8_t>               m_SendBuf;
+        std::vector<std::function<void()>> m_SendDoneV;
+
+    private:
+        // per-batch frame, only accessed in asio main loop
+        // enabled if client sends CM_FRAME and MIR2X_CONFIG_NET_FRAME is set
+        // a batch of more than one message is packed as one SM_FRAME in m_FrameBuf and swapped into m_SendBuf
+        int                  m_FrameMode;
+        std::vector<uint8_t> m_FrameBuf;
+
+    private:
+        // Nagle-like latency cap, only accessed in asio main loop
+        // if configured, small messages wait at most MIR2X_CONFIG_NET_SENDDELAY ms to be batched
+        bool               m_FlushTimerFlag;
+        asio::steady_timer m_FlushTimer;
+
+    private:
+        // SMAction baseline of this connection, protected by m_NextQLock
+        // baseline changes in the same order as tasks go into m_NextSendQ
+        // enabled if client sends CM_ACTIONDELTA and MIR2X_CONFIG_NET_ACTIONDELTA is set
+        std::atomic<bool> m_ActionDeltaFlag;
+        ActionDelta       m_ActionDelta;
+
     private:
         // used for internal pending message storage
         // support multi-thread since external thread call Send which refers to it
@@ -206,11 +267,6 @@ class Session: public std::enable_shared_from_this<Session>
             return m_Port;
         }
 
-        uint32_t Delay() const
-        {
-            return m_Delay;
-        }
-
         const char *IP() const
         {
             return m_IP.c_str();
@@ -229,6 +285,9 @@ class Session: public std::enable_shared_from_this<Session>
         // then Q1 needs to be protected from data race
         // but for Q2 since it's only used in ASIO main loop, we don't need to protect it
         //
+        // packages in Q2 are coalesced and sent by one async_write
+        // then a burst of messages costs one syscall rather than two per message
+        //
         // idea from: https://stackoverflow.com/questions/4029448/thread-safety-for-stl-queue
         bool Send(uint8_t nHC, const uint8_t *pData, size_t nLen, std::function<void()> &&fnDone);
 
@@ -245,6 +304,12 @@ class Session: public std::enable_shared_from_this<Session>
             return Send(nHC, pData, nLen, std::function<void()>());
         }
 
+        // send a message header code without a body and callback
+        bool Send(uint8_t nHC)
+        {
+            return Send(nHC, nullptr, 0, std::function<void()>());
+        }
+
         // send a message header code without a body
         bool Send(uint8_t nHC, std::function<void()> &&fnDone)
         {
@@ -276,20 +341,48 @@ class Session: public std::enable_shared_from_this<Session>
             return Send(nHC, (const uint8_t *)(&stMsgT), sizeof(stMsgT));
         }
 
+    public:
+        // send a message encoded by Session::Encode()
+        // no encoding and no allocation, only takes a reference of the buffer
+        bool Send(std::shared_ptr<const SharedMessage>);
+
+    public:
+        // encode a message for Send(SharedMessage)
+        // thread-safe, returns empty pointer if message is invalid
+        static std::shared_ptr<const SharedMessage> Encode(uint8_t, const uint8_t *, size_t);
+
     private:
         // called by server threads
         // use internal memory pool to create the task
         SendTask BuildTask(uint8_t, const uint8_t *, size_t, std::function<void()> &&);
 
+    private:
+        // push one task to m_NextSendQ and notify asio main loop if needed
+        // fnBuildTask is called inside m_NextQLock
+        template<typename F> bool PostTask(F &&);
+
+    private:
+        // send SM_ACTION as SM_ACTIONDELTA if there is a baseline
+        bool SendAction(const uint8_t *, std::function<void()> &&);
+
+    private:
+        // encode message by header code into buffer allocated by rstPool.Get()
+        // used by BuildTask() with m_MemoryPN, and Encode() with a shared buffer
+        template<typename T> static bool EncodeData(uint8_t, const uint8_t *, size_t, T &, uint8_t **, size_t *);
+
     private:
         // interal functions isolated from server threads
         // following DoXXXFunc should only be invoked in asio main loop thread
-        void DoReadHC();
-        void DoReadBody(size_t, size_t);
+        void DoReadNext();
+        bool DoReadParse();
+        void DoReadFrame(uint8_t, const uint8_t *, size_t, size_t);
 
-        void DoSendHC();
-        void DoSendBuf();
         void DoSendNext();
+        void DoSendDone();
+
+    private:
+        // pack current batch in m_SendBuf as one SM_FRAME
+        void PackFrame();
 
     private:
         // called by server threads
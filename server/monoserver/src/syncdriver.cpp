@@ -3,7 +3,7 @@
  *
  *       Filename: syncdriver.cpp
  *        Created: 06/09/2016 17:32:50
- *  Last Modified: 06/13/2017 22:48:24
+ *  Last Modified: 11/29/2017 23:40:12
  *
  *    Description: 
  *
@@ -19,7 +19,6 @@
  */
 
 #include <cinttypes>
-#include "serverenv.hpp"
 #include "monoserver.hpp"
 #include "syncdriver.hpp"
 
@@ -31,12 +30,9 @@
 //      1. send failed
 int SyncDriver::Forward(const MessageBuf &rstMB, const Theron::Address &rstAddr, uint32_t nRespond)
 {
-    extern ServerEnv *g_ServerEnv;
-    if(g_ServerEnv->MIR2X_DEBUG_PRINT_AM_FORWARD){
-        extern MonoServer *g_MonoServer;
-        g_MonoServer->AddLog(LOGTYPE_INFO, "(Driver: 0X%0*" PRIXPTR ", Name: SyncDriver, UID: NA) -> (Type: %s, ID: 0, Resp: %" PRIu32 ")",
-                (int)(sizeof(this) * 2), (uintptr_t)(this), MessagePack(rstMB.Type()).Name(), nRespond);
-    }
+    extern MonoServer *g_MonoServer;
+    MIR2X_ADDLOG(g_MonoServer, DEBUG, "(Driver: 0X%0*" PRIXPTR ", Name: SyncDriver, UID: NA) -> (Type: %s, ID: 0, Resp: %" PRIu32 ")",
+            (int)(sizeof(this) * 2), (uintptr_t)(this), MessagePack(rstMB.Type()).Name(), nRespond);
     extern Theron::Framework *g_Framework;
     return g_Framework->Send<MessagePack>({rstMB, 0, nRespond}, m_Receiver.GetAddress(), rstAddr) ? 0 : 1;
 }
@@ -79,12 +75,9 @@ int SyncDriver::Forward(const MessageBuf &rstMB, const Theron::Address &rstAddr,
     m_ValidID = (m_ValidID + 1) ? (m_ValidID + 1) : 1;
     auto nCurrID = m_ValidID;
 
-    extern ServerEnv *g_ServerEnv;
-    if(g_ServerEnv->MIR2X_DEBUG_PRINT_AM_FORWARD){
-        extern MonoServer *g_MonoServer;
-        g_MonoServer->AddLog(LOGTYPE_INFO, "(Driver: 0X%0*" PRIXPTR ", Name: SyncDriver, UID: NA) -> (Type: %s, ID: %" PRIu32 ", Resp: %" PRIu32 ")",
-                (int)(sizeof(this) * 2), (uintptr_t)(this), MessagePack(rstMB.Type()).Name(), nCurrID, nRespond);
-    }
+    extern MonoServer *g_MonoServer;
+    MIR2X_ADDLOG(g_MonoServer, DEBUG, "(Driver: 0X%0*" PRIXPTR ", Name: SyncDriver, UID: NA) -> (Type: %s, ID: %" PRIu32 ", Resp: %" PRIu32 ")",
+            (int)(sizeof(this) * 2), (uintptr_t)(this), MessagePack(rstMB.Type()).Name(), nCurrID, nRespond);
 
     // 2. send message
     extern Theron::Framework *g_Framework;
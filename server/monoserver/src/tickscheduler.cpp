@@ -0,0 +1,126 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: tickscheduler.cpp
+ *        Created: 11/16/2017 14:05:32
+ *  Last Modified: 12/17/2017 20:05:14
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <cstdlib>
+#include "tickscheduler.hpp"
+
+void TickScheduler::Push(TickRecord &rstRecord, uint32_t nNextTick)
+{
+    // zero is for record never pushed
+    // skip it when the counter wraps
+    if(++m_Version == 0){
+        m_Version = 1;
+    }
+
+    rstRecord.Version  = m_Version;
+    rstRecord.NextTick = nNextTick;
+    m_TickQ.emplace(rstRecord.UID, rstRecord.Version, rstRecord.NextTick);
+}
+
+bool TickScheduler::Add(uint32_t nUID, uint32_t nInterval, uint32_t nCurrTick)
+{
+    if(true
+            && nUID
+            && nInterval
+            && m_RecordMap.find(nUID) == m_RecordMap.end()){
+
+        auto &rstRecord = m_RecordMap[nUID];
+        rstRecord = TickRecord(nUID, nInterval, nCurrTick);
+
+        // spread the first tick over the interval
+        // then objects added in one batch won't always tick in the same round
+        Push(rstRecord, nCurrTick + (uint32_t)(std::rand()) % nInterval);
+        return true;
+    }
+    return false;
+}
+
+bool TickScheduler::Remove(uint32_t nUID)
+{
+    // node in the queue is left there
+    // it's skipped since no record found
+    return m_RecordMap.erase(nUID) != 0;
+}
+
+bool TickScheduler::Sleep(uint32_t nUID, uint32_t nCurrTick)
+{
+    auto pRecord = m_RecordMap.find(nUID);
+    if(true
+            && pRecord != m_RecordMap.end()
+            && pRecord->second.Sleep == false){
+
+        pRecord->second.Sleep = true;
+        Push(pRecord->second, nCurrTick + m_SleepInterval);
+        return true;
+    }
+    return false;
+}
+
+bool TickScheduler::Wake(uint32_t nUID, uint32_t nCurrTick)
+{
+    auto pRecord = m_RecordMap.find(nUID);
+    if(true
+            && pRecord != m_RecordMap.end()
+            && pRecord->second.Sleep == true){
+
+        // tick it immediately
+        // it may have pending delay commands
+        pRecord->second.Sleep      = false;
+        pRecord->second.ActiveTick = nCurrTick;
+        Push(pRecord->second, nCurrTick);
+        return true;
+    }
+    return false;
+}
+
+size_t TickScheduler::Schedule(uint32_t nCurrTick, size_t nMaxBatch, const std::function<void(uint32_t, bool)> &fnOP)
+{
+    size_t nCount = 0;
+    while(true
+            && !m_TickQ.empty()
+            && (nCount < nMaxBatch || nMaxBatch == 0)){
+
+        auto stNode = m_TickQ.top();
+        if(stNode.NextTick > nCurrTick){
+            break;
+        }
+
+        m_TickQ.pop();
+
+        auto pRecord = m_RecordMap.find(stNode.UID);
+        if(false
+                || pRecord == m_RecordMap.end()
+                || pRecord->second.Version != stNode.Version){
+
+            // outdated node
+            // record removed or re-scheduled
+            continue;
+        }
+
+        auto bSleep = pRecord->second.Sleep;
+        Push(pRecord->second, nCurrTick + (bSleep ? m_SleepInterval : pRecord->second.Interval));
+
+        nCount++;
+        if(fnOP){
+            fnOP(stNode.UID, bSleep);
+        }
+    }
+    return nCount;
+}
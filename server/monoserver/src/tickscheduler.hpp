@@ -0,0 +1,151 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: tickscheduler.hpp
+ *        Created: 11/16/2017 13:27:10
+ *  Last Modified: 12/17/2017 20:05:14
+ *
+ *    Description: schedule MPK_METRONOME for active objects on one map
+ *
+ *                 originally map scans all cells and sends MPK_METRONOME to every
+ *                 active object it finds, then the cost depends on map size and every
+ *                 monster gets a message per tick even it has nothing to do
+ *
+ *                 TickScheduler keeps registered objects in a priority queue by next
+ *                 tick time, each object can have its own interval, and can be put to
+ *                 sleep, then it's only checked every SleepInterval without message
+ *
+ *                 entries in the queue are never erased, a version number is kept for
+ *                 each record and queue entry mismatch with it is skipped, versions are
+ *                 from one counter of the scheduler, then a node left by a removed record
+ *                 never matches the record added back with the same UID
+ *
+ *                 this class is not thread-safe, only used inside ServerMap's actor
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <queue>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+class TickScheduler final
+{
+    public:
+        struct TickRecord
+        {
+            uint32_t UID;
+            uint32_t Version;
+
+            uint32_t Interval;
+            uint32_t NextTick;
+
+            // last time we find it's busy
+            // used to decide whether to put it to sleep
+            uint32_t ActiveTick;
+
+            bool Sleep;
+
+            TickRecord(uint32_t nUID = 0, uint32_t nInterval = 0, uint32_t nCurrTick = 0)
+                : UID(nUID)
+                , Version(0)
+                , Interval(nInterval)
+                , NextTick(nCurrTick)
+                , ActiveTick(nCurrTick)
+                , Sleep(false)
+            {}
+        };
+
+    private:
+        struct TickNode
+        {
+            uint32_t UID;
+            uint32_t Version;
+            uint32_t NextTick;
+
+            TickNode(uint32_t nUID, uint32_t nVersion, uint32_t nNextTick)
+                : UID(nUID)
+                , Version(nVersion)
+                , NextTick(nNextTick)
+            {}
+
+            // std::priority_queue is a max-heap
+            // reverse it to get the earliest tick on the top
+            bool operator < (const TickNode &rstNode) const
+            {
+                return NextTick > rstNode.NextTick;
+            }
+        };
+
+    private:
+        const uint32_t m_SleepInterval;
+
+    private:
+        // last version given by Push()
+        uint32_t m_Version;
+
+    private:
+        std::unordered_map<uint32_t, TickRecord> m_RecordMap;
+        std::priority_queue<TickNode> m_TickQ;
+
+    public:
+        TickScheduler(uint32_t nSleepInterval = 5000)
+            : m_SleepInterval(nSleepInterval)
+            , m_Version(0)
+            , m_RecordMap()
+            , m_TickQ()
+        {}
+
+       ~TickScheduler() = default;
+
+    public:
+        bool Add(uint32_t, uint32_t, uint32_t);
+        bool Remove(uint32_t);
+
+    public:
+        bool Sleep(uint32_t, uint32_t);
+        bool Wake (uint32_t, uint32_t);
+
+    public:
+        bool Active(uint32_t nUID, uint32_t nCurrTick)
+        {
+            auto pRecord = m_RecordMap.find(nUID);
+            if(pRecord != m_RecordMap.end()){
+                pRecord->second.ActiveTick = nCurrTick;
+                return true;
+            }
+            return false;
+        }
+
+    public:
+        const TickRecord *Find(uint32_t nUID) const
+        {
+            auto pRecord = m_RecordMap.find(nUID);
+            return (pRecord == m_RecordMap.end()) ? nullptr : &(pRecord->second);
+        }
+
+        size_t Count() const
+        {
+            return m_RecordMap.size();
+        }
+
+    public:
+        // pop all due records, at most nMaxBatch, and call fnOP(UID, Sleep)
+        // zero nMaxBatch means no limit, otherwise rest due records wait for next call
+        // record is re-scheduled before calling fnOP, so fnOP can remove / sleep / wake it
+        size_t Schedule(uint32_t, size_t, const std::function<void(uint32_t, bool)> &);
+
+    private:
+        void Push(TickRecord &, uint32_t);
+};
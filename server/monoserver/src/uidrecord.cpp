@@ -3,7 +3,7 @@
  *
  *       Filename: uidrecord.cpp
  *        Created: 05/02/2017 16:11:11
- *  Last Modified: 09/23/2017 22:26:48
+ *  Last Modified: 11/19/2017 02:14:36
  *
  *    Description: 
  *
@@ -23,10 +23,12 @@
 #include "monoserver.hpp"
 
 UIDRecord::UIDRecord(uint32_t nUID,
+        uint32_t nClassTag,
         const InvarData &rstDesp,
         const Theron::Address &rstAddress,
         const std::vector<ServerObject::ClassCodeName> &rstClassEntry)
     : UID(nUID)
+    , ClassTag(nClassTag)
     , Desp(rstDesp)
     , Address(rstAddress)
     , ClassEntry(rstClassEntry)
@@ -43,6 +45,7 @@ void UIDRecord::Print() const
 {
     extern MonoServer *g_MonoServer;
     g_MonoServer->AddLog(LOGTYPE_INFO, "UIDRecord::UID                  = %" PRIu32, UID);
+    g_MonoServer->AddLog(LOGTYPE_INFO, "UIDRecord::ClassTag             = 0X%08" PRIX32, ClassTag);
     for(size_t nIndex= 0; nIndex < ClassEntry.size(); ++nIndex){
         g_MonoServer->AddLog(LOGTYPE_INFO, "UIDRecord::ClassEntry[%d]::Code = %llu", (int)(nIndex), (unsigned long long)(ClassEntry[nIndex].Code));
         g_MonoServer->AddLog(LOGTYPE_INFO, "UIDRecord::ClassEntry[%d]::Name = %s",   (int)(nIndex), ClassEntry[nIndex].Name.c_str());
@@ -3,7 +3,7 @@
  *
  *       Filename: uidrecord.hpp
  *        Created: 05/01/2017 11:35:58
- *  Last Modified: 09/23/2017 22:24:43
+ *  Last Modified: 11/19/2017 02:14:36
  *
  *    Description: UID entry won't take care of one specific class
  *                 It's a framework for all classes derived from ServerObject
@@ -30,12 +30,14 @@
 struct UIDRecord
 {
     uint32_t  UID;
+    uint32_t  ClassTag;
     InvarData Desp;
 
     Theron::Address Address;
     const std::vector<ServerObject::ClassCodeName> &ClassEntry;
 
     UIDRecord(uint32_t,
+            uint32_t,
             const InvarData &,
             const Theron::Address &,
             const std::vector<ServerObject::ClassCodeName> &);
@@ -52,15 +54,10 @@ struct UIDRecord
 
     void Print() const;
 
-    template<typename T> bool ClassFrom()
+    // T::ClassTag is a compile-time constant
+    // then the type check is only one compare
+    template<typename T> bool ClassFrom() const
     {
-        if(Valid()){
-            for(const auto &rstCodeName: ClassEntry){
-                if(true
-                        && rstCodeName.Name == typeid(T).name()
-                        && rstCodeName.Code == typeid(T).hash_code()){ return true; }
-            }
-        }
-        return false;
+        return Valid() && ((ClassTag & T::ClassTag) == T::ClassTag);
     }
 };
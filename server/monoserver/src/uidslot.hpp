@@ -0,0 +1,109 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: uidslot.hpp
+ *        Created: 12/17/2017 21:10:32
+ *  Last Modified: 12/17/2017 21:10:32
+ *
+ *    Description: pieces of the lock-free UID table in MonoServer
+ *
+ *                 the table is a seqlock, a reader may copy a slot while the writer is
+ *                 storing it, and drops the copy if the sequence number changed, then
+ *                 the copy itself must not be a data race: UIDSlotWord<T> keeps a field
+ *                 as words accessed by relaxed atomics, reader takes the words first and
+ *                 only turns them back into T after the sequence check passes
+ *
+ *                 UID = (Generation << UIDSLOT_BITS) | SlotIndex, generation has only
+ *                 (32 - UIDSLOT_BITS) bits, a slot reaching the max generation is retired
+ *                 instead of wrapping to zero, otherwise a stale UID kept by any actor
+ *                 would match the object which takes the slot after the wrap
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+enum: uint32_t
+{
+    UIDSLOT_BITS  = 20,
+    UIDCHUNK_BITS = 10,
+    UIDGEN_MAX    = (1 << (32 - UIDSLOT_BITS)) - 1,
+};
+
+inline uint32_t UIDSlotIndex(uint32_t nUID)
+{
+    return nUID & ((1 << UIDSLOT_BITS) - 1);
+}
+
+inline uint32_t UIDGeneration(uint32_t nUID)
+{
+    return nUID >> UIDSLOT_BITS;
+}
+
+// generation of a slot after its UID is erased
+// return false if the slot reaches UIDGEN_MAX and should never be reused
+inline bool UIDNextGeneration(uint32_t *pGeneration)
+{
+    if(*pGeneration < UIDGEN_MAX){
+        (*pGeneration)++;
+        return true;
+    }
+    return false;
+}
+
+template<typename T> class UIDSlotWord
+{
+    public:
+        using WordArray = std::array<uint32_t, (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t)>;
+
+    private:
+        std::array<std::atomic<uint32_t>, std::tuple_size<WordArray>::value> m_WordV;
+
+    public:
+        UIDSlotWord()
+        {
+            for(auto &rstWord: m_WordV){
+                rstWord.store(0, std::memory_order_relaxed);
+            }
+        }
+
+    public:
+        void Store(const T &rstValue)
+        {
+            WordArray stWordV {};
+            std::memcpy(stWordV.data(), (const void *)(&rstValue), sizeof(T));
+
+            for(size_t nIndex = 0; nIndex < m_WordV.size(); ++nIndex){
+                m_WordV[nIndex].store(stWordV[nIndex], std::memory_order_relaxed);
+            }
+        }
+
+        WordArray Load() const
+        {
+            WordArray stWordV;
+            for(size_t nIndex = 0; nIndex < m_WordV.size(); ++nIndex){
+                stWordV[nIndex] = m_WordV[nIndex].load(std::memory_order_relaxed);
+            }
+            return stWordV;
+        }
+
+    public:
+        // only call it with words passed the sequence check
+        // T is a plain value as InvarData, or Theron::Address which is a pooled name pointer and an index
+        static void Rebuild(const WordArray &rstWordV, T *pValue)
+        {
+            std::memcpy((void *)(pValue), rstWordV.data(), sizeof(T));
+        }
+};
@@ -0,0 +1,613 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: botclient.cpp
+ *        Created: 12/02/2017 17:45:03
+ *  Last Modified: 12/03/2017 23:18:44
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+#include "sysconst.hpp"
+#include "botcodec.hpp"
+#include "botclient.hpp"
+#include "protocoldef.hpp"
+#include "clientmessage.hpp"
+#include "servermessage.hpp"
+
+// max distance from the login location
+// bot walks in this box to avoid going out of the map
+static const int WANDER_RADIUS = 12;
+
+static const int DIR_DX[] = { 0, +1, +1, +1,  0, -1, -1, -1};
+static const int DIR_DY[] = {-1, -1,  0, +1, +1, +1,  0, -1};
+
+BotClient::BotClient(int nBotID, const BotConfig &rstConfig, BotStat &rstStat, asio::io_service &rstIO)
+    : m_BotID(nBotID)
+    , m_Config(rstConfig)
+    , m_Stat(rstStat)
+    , m_Socket(rstIO)
+    , m_Timer(rstIO)
+    , m_RandGen((std::minstd_rand::result_type)(nBotID) + 1)
+    , m_State(BOTSTATE_NONE)
+    , m_ReadBuf(4096)
+    , m_ReadLen(0)
+    , m_DecodeBuf()
+    , m_SendBuf()
+    , m_SendingBuf()
+    , m_ExpectQ()
+    , m_UID(0)
+    , m_MapID(0)
+    , m_X(0)
+    , m_Y(0)
+    , m_Direction(DIR_UP)
+    , m_HomeX(0)
+    , m_HomeY(0)
+    , m_ProbeTime(0)
+    , m_GroundItemV()
+{}
+
+uint64_t BotClient::CurrTime()
+{
+    return (uint64_t)(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void BotClient::Launch(const asio::ip::tcp::endpoint &rstEndpoint, uint32_t nDelay)
+{
+    m_Timer.expires_from_now(std::chrono::milliseconds(nDelay));
+    m_Timer.async_wait([this, rstEndpoint](const asio::error_code &stEC)
+    {
+        if(!stEC && m_State == BOTSTATE_NONE){
+            DoConnect(rstEndpoint);
+        }
+    });
+}
+
+void BotClient::Close()
+{
+    if(m_State != BOTSTATE_CLOSED){
+        m_State = BOTSTATE_CLOSED;
+
+        asio::error_code stEC;
+        m_Timer.cancel(stEC);
+        m_Socket.close(stEC);
+    }
+}
+
+void BotClient::OnError()
+{
+    // connection lost or corrupted
+    // count it only for a connected bot
+    if(m_State == BOTSTATE_LOGIN || m_State == BOTSTATE_ONLINE){
+        m_Stat.Disconnect++;
+    }
+    Close();
+}
+
+void BotClient::DoConnect(const asio::ip::tcp::endpoint &rstEndpoint)
+{
+    m_State = BOTSTATE_CONNECT;
+    m_Socket.async_connect(rstEndpoint, [this](const asio::error_code &stEC)
+    {
+        if(m_State != BOTSTATE_CONNECT){
+            return;
+        }
+
+        if(stEC){
+            m_Stat.ConnectFail++;
+            Close();
+            return;
+        }
+
+        // bot sends small messages
+        // don't wait for a full segment
+        asio::error_code stOptionEC;
+        m_Socket.set_option(asio::ip::tcp::no_delay(true), stOptionEC);
+
+        m_Stat.Connect++;
+        DoLogin();
+        DoRead();
+    });
+}
+
+void BotClient::DoLogin()
+{
+    CMLogin stCML;
+    std::memset(&stCML, 0, sizeof(stCML));
+
+    std::snprintf(stCML.ID, sizeof(stCML.ID), m_Config.Account.c_str(), m_Config.AccountBase + m_BotID);
+    std::snprintf(stCML.Password, sizeof(stCML.Password), "%s", m_Config.Password.c_str());
+
+    m_State = BOTSTATE_LOGIN;
+    Send(CM_LOGIN, stCML);
+    Expect(CM_LOGIN);
+
+    // action timer isn't started yet
+    // use it to give up a login without reply
+    m_Timer.expires_from_now(std::chrono::milliseconds(m_Config.ReplyTimeout));
+    m_Timer.async_wait([this](const asio::error_code &stEC)
+    {
+        if(!stEC && m_State == BOTSTATE_LOGIN){
+            m_Stat.Timeout[CM_LOGIN]++;
+            m_ExpectQ.clear();
+            Close();
+        }
+    });
+}
+
+void BotClient::DoRead()
+{
+    // a message is larger than current buffer
+    // extend the buffer, only happens for type-3 messages
+    if(m_ReadLen == m_ReadBuf.size()){
+        m_ReadBuf.resize(m_ReadBuf.size() * 2);
+    }
+
+    m_Socket.async_read_some(asio::buffer(&(m_ReadBuf[m_ReadLen]), m_ReadBuf.size() - m_ReadLen), [this](const asio::error_code &stEC, size_t nLength)
+    {
+        if(m_State == BOTSTATE_CLOSED){
+            return;
+        }
+
+        if(stEC){
+            OnError();
+            return;
+        }
+
+        m_ReadLen += nLength;
+        m_Stat.RecvBytes += nLength;
+
+        auto nDone = BotCodec::DecodeSM(&(m_ReadBuf[0]), m_ReadLen, m_DecodeBuf, [this](uint8_t nHC, const uint8_t *pData, size_t nDataLen)
+        {
+            // skip all left messages
+            // if a message closed the bot
+            if(m_State != BOTSTATE_CLOSED){
+                OnServerMessage(nHC, pData, nDataLen);
+            }
+        });
+
+        if(nDone < 0){
+            m_Stat.Corrupted++;
+            OnError();
+            return;
+        }
+
+        if(m_State == BOTSTATE_CLOSED){
+            return;
+        }
+
+        if(nDone > 0){
+            std::memmove(&(m_ReadBuf[0]), &(m_ReadBuf[nDone]), m_ReadLen - (size_t)(nDone));
+            m_ReadLen -= (size_t)(nDone);
+        }
+        DoRead();
+    });
+}
+
+void BotClient::Send(uint8_t nHC, const uint8_t *pData, size_t nDataLen)
+{
+    if(m_State == BOTSTATE_CLOSED){
+        return;
+    }
+
+    auto nOldSize = m_SendBuf.size();
+    if(!BotCodec::EncodeCM(nHC, pData, nDataLen, m_SendBuf)){
+        std::fprintf(stderr, "bot %d: failed to encode %s\n", m_BotID, CMSGParam(nHC).Name().c_str());
+        return;
+    }
+
+    m_Stat.SendCount[nHC]++;
+    m_Stat.SendBytes += (m_SendBuf.size() - nOldSize);
+
+    // no pending write
+    // otherwise the message goes with next write
+    if(m_SendingBuf.empty()){
+        DoSend();
+    }
+}
+
+void BotClient::DoSend()
+{
+    std::swap(m_SendBuf, m_SendingBuf);
+    asio::async_write(m_Socket, asio::buffer(m_SendingBuf), [this](const asio::error_code &stEC, size_t)
+    {
+        if(m_State == BOTSTATE_CLOSED){
+            return;
+        }
+
+        if(stEC){
+            OnError();
+            return;
+        }
+
+        m_SendingBuf.clear();
+        if(!m_SendBuf.empty()){
+            DoSend();
+        }
+    });
+}
+
+void BotClient::Expect(uint8_t nHC)
+{
+    m_ExpectQ.push_back({nHC, CurrTime()});
+}
+
+void BotClient::OnReply(uint8_t nHC)
+{
+    // reply of the oldest request of this type
+    // timeout requests have been dropped
+    auto pExpect = std::find_if(m_ExpectQ.begin(), m_ExpectQ.end(), [nHC](const ExpectReply &rstExpect)
+    {
+        return rstExpect.HC == nHC;
+    });
+
+    if(pExpect != m_ExpectQ.end()){
+        auto nCurrTime = CurrTime();
+        m_Stat.Latency[nHC].Record((nCurrTime >= pExpect->SendTime) ? (nCurrTime - pExpect->SendTime) : 0);
+        m_ExpectQ.erase(pExpect);
+    }
+}
+
+void BotClient::CheckTimeout()
+{
+    auto nCurrTime = CurrTime();
+    while(!m_ExpectQ.empty() && (m_ExpectQ.front().SendTime + (uint64_t)(m_Config.ReplyTimeout) * 1000 < nCurrTime)){
+        m_Stat.Timeout[m_ExpectQ.front().HC]++;
+        m_ExpectQ.pop_front();
+    }
+}
+
+void BotClient::OnServerMessage(uint8_t nHC, const uint8_t *pData, size_t)
+{
+    m_Stat.RecvCount[nHC]++;
+    switch(nHC){
+        case SM_LOGINOK         : On_SM_LOGINOK         (pData); break;
+        case SM_LOGINFAIL       : On_SM_LOGINFAIL       (pData); break;
+        case SM_ACTION          : On_SM_ACTION          (pData); break;
+        case SM_CORECORD        : On_SM_CORECORD        (pData); break;
+        case SM_SHOWDROPITEM    : On_SM_SHOWDROPITEM    (pData); break;
+        case SM_REMOVEGROUNDITEM: On_SM_REMOVEGROUNDITEM(pData); break;
+        case SM_PICKUPOK        : On_SM_PICKUPOK        (pData); break;
+        default                 :                                break;
+    }
+}
+
+void BotClient::On_SM_LOGINOK(const uint8_t *pData)
+{
+    if(m_State != BOTSTATE_LOGIN){
+        return;
+    }
+
+    SMLoginOK stSMLOK;
+    std::memcpy(&stSMLOK, pData, sizeof(stSMLOK));
+
+    OnReply(CM_LOGIN);
+    m_Stat.LoginOK++;
+
+    m_UID       = stSMLOK.UID;
+    m_MapID     = stSMLOK.MapID;
+    m_X         = stSMLOK.X;
+    m_Y         = stSMLOK.Y;
+    m_HomeX     = stSMLOK.X;
+    m_HomeY     = stSMLOK.Y;
+    m_Direction = (stSMLOK.Direction > DIR_NONE && stSMLOK.Direction < DIR_MAX) ? (int)(stSMLOK.Direction) : (int)(DIR_UP);
+
+    m_State = BOTSTATE_ONLINE;
+    ScheduleAction();
+}
+
+void BotClient::On_SM_LOGINFAIL(const uint8_t *)
+{
+    if(m_State != BOTSTATE_LOGIN){
+        return;
+    }
+
+    OnReply(CM_LOGIN);
+    m_Stat.LoginFail++;
+    Close();
+}
+
+void BotClient::On_SM_ACTION(const uint8_t *pData)
+{
+    SMAction stSMA;
+    std::memcpy(&stSMA, pData, sizeof(stSMA));
+
+    // server only sends my action for pull-back
+    // others are actions of neighbors
+    if(true
+            && Online()
+            && stSMA.UID   == m_UID
+            && stSMA.MapID == m_MapID
+            && stSMA.Action == ACTION_STAND){
+        m_Stat.PullBack++;
+        m_X = stSMA.X;
+        m_Y = stSMA.Y;
+    }
+}
+
+void BotClient::On_SM_CORECORD(const uint8_t *pData)
+{
+    SMCORecord stSMCOR;
+    std::memcpy(&stSMCOR, pData, sizeof(stSMCOR));
+
+    if(Online() && stSMCOR.Common.UID == m_UID){
+        OnReply(CM_QUERYCORECORD);
+    }
+}
+
+void BotClient::On_SM_SHOWDROPITEM(const uint8_t *pData)
+{
+    SMShowDropItem stSMSDI;
+    std::memcpy(&stSMSDI, pData, sizeof(stSMSDI));
+
+    // only keep latest ones
+    // bot can't walk to all of them anyway
+    if(m_GroundItemV.size() >= 16){
+        m_GroundItemV.erase(m_GroundItemV.begin());
+    }
+    m_GroundItemV.push_back({stSMSDI.ID, stSMSDI.X, stSMSDI.Y});
+}
+
+void BotClient::On_SM_REMOVEGROUNDITEM(const uint8_t *pData)
+{
+    SMRemoveGroundItem stSMRGI;
+    std::memcpy(&stSMRGI, pData, sizeof(stSMRGI));
+
+    m_GroundItemV.erase(std::remove_if(m_GroundItemV.begin(), m_GroundItemV.end(), [&stSMRGI](const GroundItem &rstItem)
+    {
+        return rstItem.ID == stSMRGI.ItemID && rstItem.X == stSMRGI.X && rstItem.Y == stSMRGI.Y;
+    }), m_GroundItemV.end());
+}
+
+void BotClient::On_SM_PICKUPOK(const uint8_t *pData)
+{
+    SMPickUpOK stSMPUOK;
+    std::memcpy(&stSMPUOK, pData, sizeof(stSMPUOK));
+
+    OnReply(CM_PICKUP);
+    m_GroundItemV.erase(std::remove_if(m_GroundItemV.begin(), m_GroundItemV.end(), [&stSMPUOK](const GroundItem &rstItem)
+    {
+        return rstItem.ID == stSMPUOK.ItemID && rstItem.X == stSMPUOK.X && rstItem.Y == stSMPUOK.Y;
+    }), m_GroundItemV.end());
+}
+
+void BotClient::ScheduleAction()
+{
+    // +/- 25% jitter
+    // avoid all bots acting in the same tick
+    int nInterval = (m_Config.ActionRate > 0) ? (1000 / m_Config.ActionRate) : std::max<int>(m_Config.ProbeInterval, 100);
+    nInterval = std::max<int>(1, nInterval + RandInt(-nInterval / 4, nInterval / 4));
+
+    m_Timer.expires_from_now(std::chrono::milliseconds(nInterval));
+    m_Timer.async_wait([this](const asio::error_code &stEC)
+    {
+        if(!stEC && Online()){
+            DoAction();
+            ScheduleAction();
+        }
+    });
+}
+
+void BotClient::DoAction()
+{
+    CheckTimeout();
+    if(m_Config.ProbeInterval > 0 && CurrTime() >= m_ProbeTime + (uint64_t)(m_Config.ProbeInterval) * 1000){
+        ActionProbe();
+    }
+
+    if(m_Config.ActionRate <= 0){
+        return;
+    }
+
+    // keep the direction mostly
+    // then bot walks away instead of shaking
+    auto fnWalk = [this]()
+    {
+        ActionWalk(RandInt(0, 3) ? m_Direction : RandInt(DIR_NONE + 1, DIR_MAX - 1));
+    };
+
+    switch(m_Config.Scenario){
+        case SCENARIO_WALK:
+            {
+                fnWalk();
+                break;
+            }
+        case SCENARIO_ATTACK:
+            {
+                if(RandInt(0, 3)){
+                    ActionAttack();
+                }else{
+                    fnWalk();
+                }
+                break;
+            }
+        case SCENARIO_PICKUP:
+            {
+                ActionPickUp();
+                break;
+            }
+        case SCENARIO_MIXED:
+            {
+                auto nRand = RandInt(0, 9);
+                if(nRand < 5){
+                    fnWalk();
+                }else if(nRand < 8){
+                    ActionAttack();
+                }else{
+                    ActionPickUp();
+                }
+                break;
+            }
+        case SCENARIO_IDLE:
+        default:
+            {
+                break;
+            }
+    }
+}
+
+void BotClient::ActionWalk(int nDirection)
+{
+    if(!(nDirection > DIR_NONE && nDirection < DIR_MAX)){
+        return;
+    }
+
+    auto nX1 = m_X + DIR_DX[nDirection - (DIR_NONE + 1)];
+    auto nY1 = m_Y + DIR_DY[nDirection - (DIR_NONE + 1)];
+
+    // turn back at the edge of the box
+    // server ignores actions out of the map without pull-back
+    if(false
+            || nX1 < 0
+            || nY1 < 0
+            || std::abs(nX1 - m_HomeX) > WANDER_RADIUS
+            || std::abs(nY1 - m_HomeY) > WANDER_RADIUS){
+        nDirection = (nDirection + 3) % 8 + 1;
+        nX1 = m_X + DIR_DX[nDirection - (DIR_NONE + 1)];
+        nY1 = m_Y + DIR_DY[nDirection - (DIR_NONE + 1)];
+
+        if(nX1 < 0 || nY1 < 0){
+            return;
+        }
+    }
+
+    CMAction stCMA;
+    std::memset(&stCMA, 0, sizeof(stCMA));
+
+    stCMA.UID         = m_UID;
+    stCMA.MapID       = m_MapID;
+    stCMA.Action      = ACTION_MOVE;
+    stCMA.ActionParam = 0;
+    stCMA.Speed       = SYS_DEFSPEED;
+    stCMA.Direction   = (uint8_t)(nDirection);
+    stCMA.X           = (uint16_t)(m_X);
+    stCMA.Y           = (uint16_t)(m_Y);
+    stCMA.AimX        = (uint16_t)(nX1);
+    stCMA.AimY        = (uint16_t)(nY1);
+    stCMA.AimUID      = 0;
+
+    Send(CM_ACTION, stCMA);
+
+    // no echo for a successful move
+    // take it done and wait for pull-back if failed
+    m_X         = nX1;
+    m_Y         = nY1;
+    m_Direction = nDirection;
+}
+
+void BotClient::ActionAttack()
+{
+    // attack the grid in a random direction
+    // server attacks whatever standing there
+    auto nDirection = RandInt(DIR_NONE + 1, DIR_MAX - 1);
+    auto nAimX      = m_X + DIR_DX[nDirection - (DIR_NONE + 1)];
+    auto nAimY      = m_Y + DIR_DY[nDirection - (DIR_NONE + 1)];
+
+    if(nAimX < 0 || nAimY < 0){
+        return;
+    }
+
+    CMAction stCMA;
+    std::memset(&stCMA, 0, sizeof(stCMA));
+
+    stCMA.UID         = m_UID;
+    stCMA.MapID       = m_MapID;
+    stCMA.Action      = ACTION_ATTACK;
+    stCMA.ActionParam = 0;
+    stCMA.Speed       = SYS_DEFSPEED;
+    stCMA.Direction   = (uint8_t)(nDirection);
+    stCMA.X           = (uint16_t)(m_X);
+    stCMA.Y           = (uint16_t)(m_Y);
+    stCMA.AimX        = (uint16_t)(nAimX);
+    stCMA.AimY        = (uint16_t)(nAimY);
+    stCMA.AimUID      = 0;
+
+    Send(CM_ACTION, stCMA);
+    m_Direction = nDirection;
+}
+
+void BotClient::ActionPickUp()
+{
+    if(m_GroundItemV.empty()){
+        ActionWalk(RandInt(0, 3) ? m_Direction : RandInt(DIR_NONE + 1, DIR_MAX - 1));
+        return;
+    }
+
+    auto fnDistance = [this](const GroundItem &rstItem)
+    {
+        return std::max<int>(std::abs(rstItem.X - m_X), std::abs(rstItem.Y - m_Y));
+    };
+
+    auto pItem = std::min_element(m_GroundItemV.begin(), m_GroundItemV.end(), [&fnDistance](const GroundItem &rstLHS, const GroundItem &rstRHS)
+    {
+        return fnDistance(rstLHS) < fnDistance(rstRHS);
+    });
+
+    // out of the wander box
+    // forget it, bot can't walk there
+    if(std::abs(pItem->X - m_HomeX) > WANDER_RADIUS || std::abs(pItem->Y - m_HomeY) > WANDER_RADIUS){
+        m_GroundItemV.erase(pItem);
+        return;
+    }
+
+    if(fnDistance(*pItem) == 0){
+        CMPickUp stCMPU;
+        std::memset(&stCMPU, 0, sizeof(stCMPU));
+
+        stCMPU.X      = (uint16_t)(m_X);
+        stCMPU.Y      = (uint16_t)(m_Y);
+        stCMPU.UID    = m_UID;
+        stCMPU.MapID  = m_MapID;
+        stCMPU.ItemID = pItem->ID;
+
+        Send(CM_PICKUP, stCMPU);
+        Expect(CM_PICKUP);
+
+        // don't pick it again
+        // SM_PICKUPOK or timeout tells the result
+        m_GroundItemV.erase(pItem);
+        return;
+    }
+
+    auto nDX = (pItem->X > m_X) - (pItem->X < m_X);
+    auto nDY = (pItem->Y > m_Y) - (pItem->Y < m_Y);
+    for(int nDirection = DIR_NONE + 1; nDirection < DIR_MAX; ++nDirection){
+        if(DIR_DX[nDirection - (DIR_NONE + 1)] == nDX && DIR_DY[nDirection - (DIR_NONE + 1)] == nDY){
+            ActionWalk(nDirection);
+            return;
+        }
+    }
+}
+
+void BotClient::ActionProbe()
+{
+    // ask my own record
+    // reply goes through the map actor, a full round trip in the server
+    CMQueryCORecord stCMQCOR;
+    std::memset(&stCMQCOR, 0, sizeof(stCMQCOR));
+
+    stCMQCOR.UID   = m_UID;
+    stCMQCOR.MapID = m_MapID;
+    stCMQCOR.X     = (uint16_t)(m_X);
+    stCMQCOR.Y     = (uint16_t)(m_Y);
+
+    Send(CM_QUERYCORECORD, stCMQCOR);
+    Expect(CM_QUERYCORECORD);
+    m_ProbeTime = CurrTime();
+}
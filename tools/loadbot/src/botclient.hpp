@@ -0,0 +1,186 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: botclient.hpp
+ *        Created: 12/02/2017 17:45:03
+ *  Last Modified: 12/03/2017 23:18:44
+ *
+ *    Description: one scripted player, runs in the io_service of its worker thread
+ *
+ *                      connect -> CM_LOGIN -> SM_LOGINOK -> action timer
+ *
+ *                 the server doesn't echo a successful move to the mover, so bot keeps
+ *                 its own location and only corrects it by SM_ACTION of itself, which
+ *                 is the pull-back from the server
+ *
+ *                 latency is recorded for CM's with a reply:
+ *
+ *                      CM_LOGIN            -> SM_LOGINOK / SM_LOGINFAIL
+ *                      CM_QUERYCORECORD    -> SM_CORECORD of myself
+ *                      CM_PICKUP           -> SM_PICKUPOK
+ *
+ *                 all handlers run in one thread, no lock in this class
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <deque>
+#include <random>
+#include <vector>
+#include <cstdint>
+#include <asio.hpp>
+
+#include "botstat.hpp"
+#include "botconfig.hpp"
+
+class BotClient final
+{
+    private:
+        enum BotState: int
+        {
+            BOTSTATE_NONE = 0,
+            BOTSTATE_CONNECT,
+            BOTSTATE_LOGIN,
+            BOTSTATE_ONLINE,
+            BOTSTATE_CLOSED,
+        };
+
+    private:
+        struct ExpectReply
+        {
+            uint8_t  HC;            // CM sent
+            uint64_t SendTime;      // in us
+        };
+
+        struct GroundItem
+        {
+            uint32_t ID;
+            int      X;
+            int      Y;
+        };
+
+    private:
+        const int        m_BotID;
+        const BotConfig &m_Config;
+        BotStat         &m_Stat;
+
+    private:
+        asio::ip::tcp::socket m_Socket;
+        asio::steady_timer    m_Timer;
+
+    private:
+        std::minstd_rand m_RandGen;
+
+    private:
+        int m_State;
+
+    private:
+        std::vector<uint8_t> m_ReadBuf;
+        size_t               m_ReadLen;
+        std::vector<uint8_t> m_DecodeBuf;
+
+    private:
+        // messages are appended to m_SendBuf
+        // and swapped to m_SendingBuf for async_write
+        std::vector<uint8_t> m_SendBuf;
+        std::vector<uint8_t> m_SendingBuf;
+
+    private:
+        std::deque<ExpectReply> m_ExpectQ;
+
+    private:
+        uint32_t m_UID;
+        uint32_t m_MapID;
+        int      m_X;
+        int      m_Y;
+        int      m_Direction;
+
+    private:
+        // bot only knows the map size by pull-back
+        // wander around the login location to stay in the map
+        int m_HomeX;
+        int m_HomeY;
+
+    private:
+        uint64_t                m_ProbeTime;
+        std::vector<GroundItem> m_GroundItemV;
+
+    public:
+        BotClient(int, const BotConfig &, BotStat &, asio::io_service &);
+
+    public:
+        BotClient(const BotClient &) = delete;
+        BotClient &operator = (const BotClient &) = delete;
+
+    public:
+        // start after nDelay ms
+        // bots are started in ramp to avoid a login storm
+        void Launch(const asio::ip::tcp::endpoint &, uint32_t);
+        void Close();
+
+    public:
+        bool Online() const
+        {
+            return m_State == BOTSTATE_ONLINE;
+        }
+
+    public:
+        static uint64_t CurrTime();
+
+    private:
+        void DoConnect(const asio::ip::tcp::endpoint &);
+        void DoLogin();
+        void DoRead();
+        void DoSend();
+        void OnError();
+
+    private:
+        void Send(uint8_t, const uint8_t *, size_t);
+
+        template<typename T> void Send(uint8_t nHC, const T &stMsg)
+        {
+            Send(nHC, (const uint8_t *)(&stMsg), sizeof(stMsg));
+        }
+
+    private:
+        void Expect(uint8_t);
+        void OnReply(uint8_t);
+        void CheckTimeout();
+
+    private:
+        void OnServerMessage(uint8_t, const uint8_t *, size_t);
+
+    private:
+        void On_SM_LOGINOK         (const uint8_t *);
+        void On_SM_LOGINFAIL       (const uint8_t *);
+        void On_SM_ACTION          (const uint8_t *);
+        void On_SM_CORECORD        (const uint8_t *);
+        void On_SM_SHOWDROPITEM    (const uint8_t *);
+        void On_SM_REMOVEGROUNDITEM(const uint8_t *);
+        void On_SM_PICKUPOK        (const uint8_t *);
+
+    private:
+        void ScheduleAction();
+        void DoAction();
+
+    private:
+        void ActionWalk(int);
+        void ActionAttack();
+        void ActionPickUp();
+        void ActionProbe();
+
+    private:
+        int RandInt(int nMin, int nMax)
+        {
+            return std::uniform_int_distribution<int>(nMin, nMax)(m_RandGen);
+        }
+};
@@ -0,0 +1,204 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: botcodec.cpp
+ *        Created: 12/02/2017 14:05:21
+ *  Last Modified: 12/03/2017 23:18:44
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <string>
+#include <cstring>
+#include "botcodec.hpp"
+#include "compress.hpp"
+#include "clientmessage.hpp"
+#include "servermessage.hpp"
+
+bool BotCodec::EncodeCM(uint8_t nHC, const uint8_t *pData, size_t nDataLen, std::vector<uint8_t> &rstBuf)
+{
+    CMSGParam stCMSG(nHC);
+    switch(stCMSG.Type()){
+        case 0:
+            {
+                if(pData || nDataLen){
+                    return false;
+                }
+
+                rstBuf.push_back(nHC);
+                return true;
+            }
+        case 1:
+            {
+                if(!(pData && (stCMSG.DataLen() == nDataLen))){
+                    return false;
+                }
+
+                auto nCountData = Compress::CountData(pData, nDataLen);
+                if((nCountData < 0) || (nCountData > (int)(stCMSG.DataLen())) || (nCountData > 255 + 255)){
+                    return false;
+                }
+
+                auto nSizeLen = (nCountData <= 254) ? 1 : 2;
+                auto nOffset  = rstBuf.size();
+
+                rstBuf.resize(nOffset + 1 + nSizeLen + stCMSG.MaskLen() + (size_t)(nCountData));
+                rstBuf[nOffset] = nHC;
+
+                if(nSizeLen == 1){
+                    rstBuf[nOffset + 1] = (uint8_t)(nCountData);
+                }else{
+                    rstBuf[nOffset + 1] = 255;
+                    rstBuf[nOffset + 2] = (uint8_t)(nCountData - 255);
+                }
+
+                if(Compress::Encode(&(rstBuf[nOffset + 1 + nSizeLen]), pData, nDataLen) != nCountData){
+                    rstBuf.resize(nOffset);
+                    return false;
+                }
+                return true;
+            }
+        case 2:
+            {
+                if(!(pData && (nDataLen == stCMSG.DataLen()))){
+                    return false;
+                }
+
+                rstBuf.push_back(nHC);
+                rstBuf.insert(rstBuf.end(), pData, pData + nDataLen);
+                return true;
+            }
+        case 3:
+            {
+                if((pData == nullptr) != (nDataLen == 0) || (nDataLen > 0XFFFFFFFF)){
+                    return false;
+                }
+
+                uint8_t szDataLen[4];
+                auto nDataLenU32 = (uint32_t)(nDataLen);
+                std::memcpy(szDataLen, &nDataLenU32, sizeof(nDataLenU32));
+
+                rstBuf.push_back(nHC);
+                rstBuf.insert(rstBuf.end(), szDataLen, szDataLen + 4);
+                if(pData){
+                    rstBuf.insert(rstBuf.end(), pData, pData + nDataLen);
+                }
+                return true;
+            }
+        default:
+            {
+                return false;
+            }
+    }
+}
+
+int BotCodec::DecodeSM(const uint8_t *pBuf, size_t nBufLen, std::vector<uint8_t> &rstDecodeBuf, const OnSMFunc &fnOnSM)
+{
+    size_t nDone = 0;
+    while(nDone < nBufLen){
+        auto pCurr = pBuf    + nDone;
+        auto nRest = nBufLen - nDone;
+
+        auto nHC = pCurr[0];
+        SMSGParam stSMSG(nHC);
+
+        // unknown HC is mapped to SM_NONE
+        // can't get its length, take it as a corrupted stream
+        if(nHC != SM_NONE && stSMSG.Type() == 0){
+            return -1;
+        }
+
+        switch(stSMSG.Type()){
+            case 0:
+                {
+                    fnOnSM(nHC, nullptr, 0);
+                    nDone += 1;
+                    break;
+                }
+            case 1:
+                {
+                    if(nRest < 2){
+                        return (int)(nDone);
+                    }
+
+                    size_t nSizeLen = 1;
+                    size_t nCompLen = pCurr[1];
+
+                    if(nCompLen == 255){
+                        if(nRest < 3){
+                            return (int)(nDone);
+                        }
+                        nSizeLen = 2;
+                        nCompLen = 255 + (size_t)(pCurr[2]);
+                    }
+
+                    if(nCompLen > stSMSG.DataLen()){
+                        return -1;
+                    }
+
+                    auto nMsgLen = 1 + nSizeLen + stSMSG.MaskLen() + nCompLen;
+                    if(nRest < nMsgLen){
+                        return (int)(nDone);
+                    }
+
+                    auto pMask = pCurr + 1 + nSizeLen;
+                    auto pComp = pMask + stSMSG.MaskLen();
+
+                    if(Compress::CountMask(pMask, stSMSG.MaskLen()) != (int)(nCompLen)){
+                        return -1;
+                    }
+
+                    rstDecodeBuf.resize(stSMSG.DataLen());
+                    if(Compress::Decode(&(rstDecodeBuf[0]), stSMSG.DataLen(), pMask, pComp) != (int)(nCompLen)){
+                        return -1;
+                    }
+
+                    fnOnSM(nHC, &(rstDecodeBuf[0]), stSMSG.DataLen());
+                    nDone += nMsgLen;
+                    break;
+                }
+            case 2:
+                {
+                    if(nRest < 1 + stSMSG.DataLen()){
+                        return (int)(nDone);
+                    }
+
+                    fnOnSM(nHC, pCurr + 1, stSMSG.DataLen());
+                    nDone += 1 + stSMSG.DataLen();
+                    break;
+                }
+            case 3:
+                {
+                    if(nRest < 5){
+                        return (int)(nDone);
+                    }
+
+                    uint32_t nDataLenU32 = 0;
+                    std::memcpy(&nDataLenU32, pCurr + 1, 4);
+
+                    if(nRest < 5 + (size_t)(nDataLenU32)){
+                        return (int)(nDone);
+                    }
+
+                    fnOnSM(nHC, nDataLenU32 ? (pCurr + 5) : nullptr, nDataLenU32);
+                    nDone += 5 + (size_t)(nDataLenU32);
+                    break;
+                }
+            default:
+                {
+                    return -1;
+                }
+        }
+    }
+    return (int)(nDone);
+}
@@ -0,0 +1,54 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: botcodec.hpp
+ *        Created: 12/02/2017 14:05:21
+ *  Last Modified: 12/03/2017 23:18:44
+ *
+ *    Description: client side wire format of CM_XXXX / SM_XXXX
+ *
+ *                 same as client/src/netio.cpp but works on a byte stream, then a bot
+ *                 reads the socket into one buffer and parses all complete messages
+ *
+ *                      [HC]                            : type 0
+ *                      [HC][CompLen][Mask][Comp]       : type 1, CompLen is 1 or 2 bytes
+ *                      [HC][Data]                      : type 2
+ *                      [HC][DataLen: 4 bytes][Data]    : type 3
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace BotCodec
+{
+    // append one client message to rstBuf
+    // return false if the message doesn't match its CMSGParam
+    bool EncodeCM(uint8_t, const uint8_t *, size_t, std::vector<uint8_t> &);
+
+    template<typename T> bool EncodeCM(uint8_t nHC, const T &stMsg, std::vector<uint8_t> &rstBuf)
+    {
+        return EncodeCM(nHC, (const uint8_t *)(&stMsg), sizeof(stMsg), rstBuf);
+    }
+
+    // parse all complete server messages in the buffer
+    // decoded data is valid only in the callback
+    //
+    // return value
+    //      >= 0 : bytes consumed, rest is an incomplete message
+    //        -1 : corrupted stream, connection should be closed
+    using OnSMFunc = std::function<void(uint8_t, const uint8_t *, size_t)>;
+    int DecodeSM(const uint8_t *, size_t, std::vector<uint8_t> &, const OnSMFunc &);
+}
@@ -0,0 +1,74 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: botconfig.hpp
+ *        Created: 12/02/2017 16:20:48
+ *  Last Modified: 12/03/2017 23:18:44
+ *
+ *    Description: configuration of a load test, shared by all bots as read-only
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <string>
+#include <cstdint>
+
+enum: int
+{
+    SCENARIO_NONE = 0,
+    SCENARIO_IDLE,          // login and send latency probes only
+    SCENARIO_WALK,          // random one-hop walk
+    SCENARIO_ATTACK,        // attack around, walk sometimes to meet monsters
+    SCENARIO_PICKUP,        // walk to seen drop items and pick them up
+    SCENARIO_MIXED,         // all of above by weight
+};
+
+struct BotConfig
+{
+    std::string Host;
+    int         Port;
+
+    int Bots;
+    int Threads;
+
+    // account of bot n is printf(Account, AccountBase + n)
+    // all bots use the same password
+    std::string Account;
+    int         AccountBase;
+    std::string Password;
+
+    int Scenario;
+
+    int Duration;           // in seconds, 0 means run until killed
+    int LoginRate;          // bots start per second, 0 means all at once
+    int ActionRate;         // actions per second of each bot
+    int ProbeInterval;      // ms between two CM_QUERYCORECORD to myself, 0 disables it
+    int ReplyTimeout;       // ms before an expected reply counts as timeout
+    int ReportInterval;     // in seconds
+
+    BotConfig()
+        : Host("127.0.0.1")
+        , Port(5000)
+        , Bots(100)
+        , Threads(2)
+        , Account("bot%d")
+        , AccountBase(0)
+        , Password("123456")
+        , Scenario(SCENARIO_WALK)
+        , Duration(60)
+        , LoginRate(200)
+        , ActionRate(2)
+        , ProbeInterval(1000)
+        , ReplyTimeout(5000)
+        , ReportInterval(5)
+    {}
+};
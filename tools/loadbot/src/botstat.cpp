@@ -0,0 +1,157 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: botstat.cpp
+ *        Created: 12/02/2017 15:32:10
+ *  Last Modified: 12/03/2017 23:18:44
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <algorithm>
+#include "botstat.hpp"
+
+static int BucketIndex(uint64_t nTime)
+{
+    if(nTime < 8){
+        return (int)(nTime);
+    }
+
+    // nTime in [2^k, 2^(k + 1)) with k >= 3
+    // top 4 bits are 1xxx, use xxx as the sub-bucket
+    int nExp = 3;
+    while((nTime >> (nExp + 1)) && nExp < 63){
+        nExp++;
+    }
+
+    auto nIndex = (nExp - 2) * 8 + (int)((nTime >> (nExp - 3)) & 7);
+    return std::min<int>(nIndex, BotStat::Histogram::BUCKET_COUNT - 1);
+}
+
+static uint64_t BucketUpper(int nIndex)
+{
+    if(nIndex < 8){
+        return (uint64_t)(nIndex + 1);
+    }
+
+    auto nExp = nIndex / 8 + 2;
+    auto nSub = nIndex % 8;
+    return (uint64_t)(9 + nSub) << (nExp - 3);
+}
+
+void BotStat::Histogram::Record(uint64_t nTime)
+{
+    Bucket[BucketIndex(nTime)]++;
+    Sum += nTime;
+    Max  = std::max<uint64_t>(Max, nTime);
+}
+
+uint64_t BotStat::Histogram::Count() const
+{
+    uint64_t nCount = 0;
+    for(auto nBucket: Bucket){
+        nCount += nBucket;
+    }
+    return nCount;
+}
+
+uint64_t BotStat::Histogram::Mean() const
+{
+    auto nCount = Count();
+    return nCount ? (Sum / nCount) : 0;
+}
+
+uint64_t BotStat::Histogram::Percentile(double fPercent) const
+{
+    auto nCount = Count();
+    if(!nCount){
+        return 0;
+    }
+
+    auto nRank = (uint64_t)(std::max<double>(std::min<double>(fPercent, 1.00), 0.00) * nCount);
+    uint64_t nCurrCount = 0;
+    for(int nIndex = 0; nIndex < BUCKET_COUNT; ++nIndex){
+        nCurrCount += Bucket[nIndex];
+        if(nCurrCount >= std::max<uint64_t>(nRank, 1)){
+            return std::min<uint64_t>(BucketUpper(nIndex), Max);
+        }
+    }
+    return Max;
+}
+
+BotStat::Histogram &BotStat::Histogram::operator += (const BotStat::Histogram &rstOther)
+{
+    Sum += rstOther.Sum;
+    Max  = std::max<uint64_t>(Max, rstOther.Max);
+    for(int nIndex = 0; nIndex < BUCKET_COUNT; ++nIndex){
+        Bucket[nIndex] += rstOther.Bucket[nIndex];
+    }
+    return *this;
+}
+
+BotStat::Histogram &BotStat::Histogram::operator -= (const BotStat::Histogram &rstOther)
+{
+    // max can't be subtracted
+    // keep the max since the start
+    Sum -= std::min<uint64_t>(Sum, rstOther.Sum);
+    for(int nIndex = 0; nIndex < BUCKET_COUNT; ++nIndex){
+        Bucket[nIndex] -= std::min<uint64_t>(Bucket[nIndex], rstOther.Bucket[nIndex]);
+    }
+    return *this;
+}
+
+BotStat &BotStat::operator += (const BotStat &rstOther)
+{
+    for(size_t nHC = 0; nHC < 256; ++nHC){
+        SendCount[nHC] += rstOther.SendCount[nHC];
+        RecvCount[nHC] += rstOther.RecvCount[nHC];
+        Latency  [nHC] += rstOther.Latency  [nHC];
+        Timeout  [nHC] += rstOther.Timeout  [nHC];
+    }
+
+    SendBytes   += rstOther.SendBytes;
+    RecvBytes   += rstOther.RecvBytes;
+
+    Connect     += rstOther.Connect;
+    ConnectFail += rstOther.ConnectFail;
+    LoginOK     += rstOther.LoginOK;
+    LoginFail   += rstOther.LoginFail;
+    Disconnect  += rstOther.Disconnect;
+    Corrupted   += rstOther.Corrupted;
+    PullBack    += rstOther.PullBack;
+    return *this;
+}
+
+BotStat &BotStat::operator -= (const BotStat &rstOther)
+{
+    // only used for the diff of two snapshots
+    // all counters are non-decreasing
+    for(size_t nHC = 0; nHC < 256; ++nHC){
+        SendCount[nHC] -= rstOther.SendCount[nHC];
+        RecvCount[nHC] -= rstOther.RecvCount[nHC];
+        Latency  [nHC] -= rstOther.Latency  [nHC];
+        Timeout  [nHC] -= rstOther.Timeout  [nHC];
+    }
+
+    SendBytes   -= rstOther.SendBytes;
+    RecvBytes   -= rstOther.RecvBytes;
+
+    Connect     -= rstOther.Connect;
+    ConnectFail -= rstOther.ConnectFail;
+    LoginOK     -= rstOther.LoginOK;
+    LoginFail   -= rstOther.LoginFail;
+    Disconnect  -= rstOther.Disconnect;
+    Corrupted   -= rstOther.Corrupted;
+    PullBack    -= rstOther.PullBack;
+    return *this;
+}
@@ -0,0 +1,106 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: botstat.hpp
+ *        Created: 12/02/2017 15:32:10
+ *  Last Modified: 12/03/2017 23:18:44
+ *
+ *    Description: statistics of bots in one worker thread
+ *
+ *                 only touched by the worker thread, report thread gets a copy by
+ *                 posting a handler to the worker io_service, then no lock needed
+ *
+ *                 latency goes to log-linear buckets in microseconds, 8 buckets for
+ *                 each power of two, then percentiles are within 12.5%
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <array>
+#include <cstdint>
+
+struct BotStat
+{
+    struct Histogram
+    {
+        // bucket [0, 8)    : [n, n + 1) us
+        // bucket n >= 8    : 8 sub-buckets in [2^k, 2^(k + 1)) us
+        // last bucket      : all longer ones
+        static constexpr int BUCKET_COUNT = 8 * 32;
+
+        uint64_t Sum;
+        uint64_t Max;
+        std::array<uint64_t, BUCKET_COUNT> Bucket;
+
+        Histogram()
+            : Sum(0)
+            , Max(0)
+            , Bucket()
+        {
+            Bucket.fill(0);
+        }
+
+        void Record(uint64_t);
+
+        uint64_t Count() const;
+        uint64_t Mean() const;
+
+        // upper bound of the bucket, in us
+        // never greater than Max
+        uint64_t Percentile(double) const;
+
+        Histogram &operator += (const Histogram &);
+        Histogram &operator -= (const Histogram &);
+    };
+
+    // indexed by HC
+    // latency is recorded by the CM which asked for the reply
+    std::array<uint64_t,  256> SendCount;
+    std::array<uint64_t,  256> RecvCount;
+    std::array<Histogram, 256> Latency;
+    std::array<uint64_t,  256> Timeout;
+
+    // bytes on wire
+    uint64_t SendBytes;
+    uint64_t RecvBytes;
+
+    uint64_t Connect;
+    uint64_t ConnectFail;
+    uint64_t LoginOK;
+    uint64_t LoginFail;
+    uint64_t Disconnect;
+    uint64_t Corrupted;
+    uint64_t PullBack;
+
+    BotStat()
+        : SendCount()
+        , RecvCount()
+        , Latency()
+        , Timeout()
+        , SendBytes(0)
+        , RecvBytes(0)
+        , Connect(0)
+        , ConnectFail(0)
+        , LoginOK(0)
+        , LoginFail(0)
+        , Disconnect(0)
+        , Corrupted(0)
+        , PullBack(0)
+    {
+        SendCount.fill(0);
+        RecvCount.fill(0);
+        Timeout.fill(0);
+    }
+
+    BotStat &operator += (const BotStat &);
+    BotStat &operator -= (const BotStat &);
+};
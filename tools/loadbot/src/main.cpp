@@ -0,0 +1,357 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: main.cpp
+ *        Created: 12/02/2017 14:01:37
+ *  Last Modified: 12/03/2017 23:18:44
+ *
+ *    Description: headless load test for monoserver
+ *
+ *                 bots are split to worker threads, each thread has its own io_service
+ *                 and BotStat, main thread collects all stats periodically and prints
+ *                 throughput and latency percentiles, no GUI or GPU needed
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <memory>
+#include <thread>
+#include <future>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cinttypes>
+#include <asio.hpp>
+
+#include "botstat.hpp"
+#include "botconfig.hpp"
+#include "botclient.hpp"
+#include "clientmessage.hpp"
+#include "servermessage.hpp"
+
+static volatile std::sig_atomic_t s_Stop = 0;
+
+static void OnSignal(int)
+{
+    s_Stop = 1;
+}
+
+static void PrintUsage()
+{
+    std::printf("Usage: loadbot [options]\n\n");
+    std::printf("    --host=IP              server address, default 127.0.0.1\n");
+    std::printf("    --port=N               server port, default 5000\n");
+    std::printf("    --bots=N               number of bots, default 100\n");
+    std::printf("    --threads=N            number of worker threads, default 2\n");
+    std::printf("    --account=FMT          printf format of account with bot index, default bot%%d\n");
+    std::printf("    --account-base=N       index of the first bot, default 0\n");
+    std::printf("    --password=STR         password of all bots, default 123456\n");
+    std::printf("    --scenario=NAME        idle | walk | attack | pickup | mixed, default walk\n");
+    std::printf("    --duration=N           seconds to run, 0 to run until Ctrl-C, default 60\n");
+    std::printf("    --login-rate=N         bots start per second, 0 for all at once, default 200\n");
+    std::printf("    --action-rate=N        actions per second of each bot, default 2\n");
+    std::printf("    --probe=N              ms between latency probes of each bot, 0 to disable, default 1000\n");
+    std::printf("    --timeout=N            ms to wait for a reply, default 5000\n");
+    std::printf("    --report=N             seconds between two reports, default 5\n");
+    std::printf("\n");
+    std::printf("Accounts should exist in the server database.\n");
+}
+
+static bool ParseArg(int argc, char *argv[], BotConfig &rstConfig)
+{
+    auto fnMatch = [](const char *szArg, const char *szName, const char **pValue) -> bool
+    {
+        auto nLen = std::strlen(szName);
+        if(std::strncmp(szArg, szName, nLen) == 0 && szArg[nLen] == '='){
+            *pValue = szArg + nLen + 1;
+            return true;
+        }
+        return false;
+    };
+
+    for(int nIndex = 1; nIndex < argc; ++nIndex){
+        const char *szValue = nullptr;
+        if(fnMatch(argv[nIndex], "--host", &szValue)){
+            rstConfig.Host = szValue;
+        }else if(fnMatch(argv[nIndex], "--port", &szValue)){
+            rstConfig.Port = std::atoi(szValue);
+        }else if(fnMatch(argv[nIndex], "--bots", &szValue)){
+            rstConfig.Bots = std::atoi(szValue);
+        }else if(fnMatch(argv[nIndex], "--threads", &szValue)){
+            rstConfig.Threads = std::atoi(szValue);
+        }else if(fnMatch(argv[nIndex], "--account", &szValue)){
+            rstConfig.Account = szValue;
+        }else if(fnMatch(argv[nIndex], "--account-base", &szValue)){
+            rstConfig.AccountBase = std::atoi(szValue);
+        }else if(fnMatch(argv[nIndex], "--password", &szValue)){
+            rstConfig.Password = szValue;
+        }else if(fnMatch(argv[nIndex], "--scenario", &szValue)){
+            if(!std::strcmp(szValue, "idle")){
+                rstConfig.Scenario = SCENARIO_IDLE;
+            }else if(!std::strcmp(szValue, "walk")){
+                rstConfig.Scenario = SCENARIO_WALK;
+            }else if(!std::strcmp(szValue, "attack")){
+                rstConfig.Scenario = SCENARIO_ATTACK;
+            }else if(!std::strcmp(szValue, "pickup")){
+                rstConfig.Scenario = SCENARIO_PICKUP;
+            }else if(!std::strcmp(szValue, "mixed")){
+                rstConfig.Scenario = SCENARIO_MIXED;
+            }else{
+                std::printf("Invalid scenario: %s\n", szValue);
+                return false;
+            }
+        }else if(fnMatch(argv[nIndex], "--duration", &szValue)){
+            rstConfig.Duration = std::atoi(szValue);
+        }else if(fnMatch(argv[nIndex], "--login-rate", &szValue)){
+            rstConfig.LoginRate = std::atoi(szValue);
+        }else if(fnMatch(argv[nIndex], "--action-rate", &szValue)){
+            rstConfig.ActionRate = std::atoi(szValue);
+        }else if(fnMatch(argv[nIndex], "--probe", &szValue)){
+            rstConfig.ProbeInterval = std::atoi(szValue);
+        }else if(fnMatch(argv[nIndex], "--timeout", &szValue)){
+            rstConfig.ReplyTimeout = std::atoi(szValue);
+        }else if(fnMatch(argv[nIndex], "--report", &szValue)){
+            rstConfig.ReportInterval = std::atoi(szValue);
+        }else{
+            std::printf("Invalid argument: %s\n", argv[nIndex]);
+            return false;
+        }
+    }
+
+    if(false
+            || rstConfig.Port           <= 0
+            || rstConfig.Bots           <= 0
+            || rstConfig.Threads        <= 0
+            || rstConfig.Duration       <  0
+            || rstConfig.LoginRate      <  0
+            || rstConfig.ActionRate     <  0
+            || rstConfig.ProbeInterval  <  0
+            || rstConfig.ReplyTimeout   <= 0
+            || rstConfig.ReportInterval <= 0){
+        std::printf("Invalid argument value\n");
+        return false;
+    }
+    return true;
+}
+
+struct BotWorker
+{
+    asio::io_service                        IO;
+    std::unique_ptr<asio::io_service::work> Work;
+    BotStat                                 Stat;
+    std::vector<std::unique_ptr<BotClient>> BotV;
+    std::thread                             Thread;
+
+    BotWorker()
+        : IO()
+        , Work(new asio::io_service::work(IO))
+        , Stat()
+        , BotV()
+        , Thread()
+    {}
+};
+
+struct BotSnapshot
+{
+    BotStat Stat;
+    int     Online;
+
+    BotSnapshot()
+        : Stat()
+        , Online(0)
+    {}
+};
+
+static BotSnapshot Collect(std::vector<std::unique_ptr<BotWorker>> &rstWorkerV)
+{
+    // BotStat is only touched in the worker thread
+    // take the copy in the worker thread
+    BotSnapshot stSnapshot;
+    for(auto &pWorker: rstWorkerV){
+        std::promise<void> stPromise;
+        auto pWorkerPtr = pWorker.get();
+        pWorker->IO.post([&stSnapshot, &stPromise, pWorkerPtr]()
+        {
+            stSnapshot.Stat += pWorkerPtr->Stat;
+            for(auto &pBot: pWorkerPtr->BotV){
+                stSnapshot.Online += (pBot->Online() ? 1 : 0);
+            }
+            stPromise.set_value();
+        });
+        stPromise.get_future().wait();
+    }
+    return stSnapshot;
+}
+
+static void Report(const BotSnapshot &rstCurr, const BotSnapshot &rstLast, double fSeconds, bool bFinal)
+{
+    auto stDiff = rstCurr.Stat;
+    stDiff -= rstLast.Stat;
+
+    // final report uses all records
+    // otherwise use records in this interval
+    const auto &rstStat = bFinal ? rstCurr.Stat : stDiff;
+    fSeconds = (fSeconds > 0.0) ? fSeconds : 1.0;
+
+    uint64_t nSendCount = 0;
+    uint64_t nRecvCount = 0;
+    for(size_t nHC = 0; nHC < 256; ++nHC){
+        nSendCount += rstStat.SendCount[nHC];
+        nRecvCount += rstStat.RecvCount[nHC];
+    }
+
+    std::printf("==== %s %.1fs: online %d, connect %" PRIu64 ", connect fail %" PRIu64 ", login ok %" PRIu64 ", login fail %" PRIu64 ", disconnect %" PRIu64 ", corrupted %" PRIu64 ", pull-back %" PRIu64 "\n",
+            bFinal ? "total" : "last",
+            fSeconds,
+            rstCurr.Online,
+            rstStat.Connect,
+            rstStat.ConnectFail,
+            rstStat.LoginOK,
+            rstStat.LoginFail,
+            rstStat.Disconnect,
+            rstStat.Corrupted,
+            rstStat.PullBack);
+
+    std::printf("     send %.1f msg/s, %.1f KB/s, recv %.1f msg/s, %.1f KB/s\n",
+            nSendCount / fSeconds,
+            rstStat.SendBytes / fSeconds / 1024.0,
+            nRecvCount / fSeconds,
+            rstStat.RecvBytes / fSeconds / 1024.0);
+
+    for(size_t nHC = 0; nHC < 256; ++nHC){
+        if(rstStat.SendCount[nHC]){
+            std::printf("     %-20s send %-10" PRIu64 " %.1f/s\n", CMSGParam((uint8_t)(nHC)).Name().c_str(), rstStat.SendCount[nHC], rstStat.SendCount[nHC] / fSeconds);
+        }
+    }
+
+    for(size_t nHC = 0; nHC < 256; ++nHC){
+        if(rstStat.RecvCount[nHC]){
+            std::printf("     %-20s recv %-10" PRIu64 " %.1f/s\n", SMSGParam((uint8_t)(nHC)).Name().c_str(), rstStat.RecvCount[nHC], rstStat.RecvCount[nHC] / fSeconds);
+        }
+    }
+
+    for(size_t nHC = 0; nHC < 256; ++nHC){
+        auto &rstLatency = rstStat.Latency[nHC];
+        if(rstLatency.Count() || rstStat.Timeout[nHC]){
+            std::printf("     %-20s latency us: count %" PRIu64 ", mean %" PRIu64 ", p50 %" PRIu64 ", p90 %" PRIu64 ", p99 %" PRIu64 ", p999 %" PRIu64 ", max %" PRIu64 ", timeout %" PRIu64 "\n",
+                    CMSGParam((uint8_t)(nHC)).Name().c_str(),
+                    rstLatency.Count(),
+                    rstLatency.Mean(),
+                    rstLatency.Percentile(0.50),
+                    rstLatency.Percentile(0.90),
+                    rstLatency.Percentile(0.99),
+                    rstLatency.Percentile(0.999),
+                    rstLatency.Max,
+                    rstStat.Timeout[nHC]);
+        }
+    }
+    std::fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    BotConfig stConfig;
+    if(!ParseArg(argc, argv, stConfig)){
+        PrintUsage();
+        return 1;
+    }
+
+    asio::ip::tcp::endpoint stEndpoint;
+    {
+        asio::error_code stEC;
+        asio::io_service stIO;
+        asio::ip::tcp::resolver stResolver(stIO);
+
+        auto stIter = stResolver.resolve({stConfig.Host, std::to_string(stConfig.Port)}, stEC);
+        if(stEC || stIter == asio::ip::tcp::resolver::iterator()){
+            std::printf("Can't resolve %s:%d\n", stConfig.Host.c_str(), stConfig.Port);
+            return 1;
+        }
+        stEndpoint = *stIter;
+    }
+
+    std::signal(SIGINT,  OnSignal);
+    std::signal(SIGTERM, OnSignal);
+
+    std::vector<std::unique_ptr<BotWorker>> stWorkerV;
+    for(int nIndex = 0; nIndex < stConfig.Threads; ++nIndex){
+        stWorkerV.emplace_back(new BotWorker());
+    }
+
+    // io_service doesn't run yet
+    // safe to setup bots in main thread
+    for(int nBotID = 0; nBotID < stConfig.Bots; ++nBotID){
+        auto &pWorker = stWorkerV[nBotID % stConfig.Threads];
+        pWorker->BotV.emplace_back(new BotClient(nBotID, stConfig, pWorker->Stat, pWorker->IO));
+
+        auto nDelay = stConfig.LoginRate ? (uint32_t)((uint64_t)(nBotID) * 1000 / stConfig.LoginRate) : 0;
+        pWorker->BotV.back()->Launch(stEndpoint, nDelay);
+    }
+
+    for(auto &pWorker: stWorkerV){
+        auto pWorkerPtr = pWorker.get();
+        pWorker->Thread = std::thread([pWorkerPtr]()
+        {
+            pWorkerPtr->IO.run();
+        });
+    }
+
+    std::printf("loadbot: %d bots, %d threads, %s:%d\n", stConfig.Bots, stConfig.Threads, stConfig.Host.c_str(), stConfig.Port);
+    std::fflush(stdout);
+
+    auto fnSeconds = [](std::chrono::steady_clock::time_point stStart)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - stStart).count();
+    };
+
+    auto stStartTime  = std::chrono::steady_clock::now();
+    auto stReportTime = stStartTime;
+
+    BotSnapshot stLastSnapshot;
+    while(!s_Stop){
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if(stConfig.Duration > 0 && fnSeconds(stStartTime) >= stConfig.Duration){
+            break;
+        }
+
+        if(fnSeconds(stReportTime) >= stConfig.ReportInterval){
+            auto stCurrSnapshot = Collect(stWorkerV);
+            Report(stCurrSnapshot, stLastSnapshot, fnSeconds(stReportTime), false);
+
+            stLastSnapshot = std::move(stCurrSnapshot);
+            stReportTime   = std::chrono::steady_clock::now();
+        }
+    }
+
+    Report(Collect(stWorkerV), stLastSnapshot, fnSeconds(stStartTime), true);
+
+    // close bots in their own thread
+    // then let io_service exit after all handlers done
+    for(auto &pWorker: stWorkerV){
+        auto pWorkerPtr = pWorker.get();
+        pWorker->IO.post([pWorkerPtr]()
+        {
+            for(auto &pBot: pWorkerPtr->BotV){
+                pBot->Close();
+            }
+        });
+        pWorker->Work.reset();
+    }
+
+    for(auto &pWorker: stWorkerV){
+        pWorker->Thread.join();
+    }
+    return 0;
+}
@@ -3,9 +3,14 @@
  *
  *       Filename: main.cpp
  *        Created: 08/31/2017 16:12:32
- *  Last Modified: 08/31/2017 16:16:49
+ *  Last Modified: 12/09/2017 23:35:42
  *
  *    Description: convert a file name to its code
+ *                 or create the uncompressed map pack from .MAP files
+ *                 pack includes the navigation graph of each map
+ *
+ *                      mapdbmaker NAME
+ *                      mapdbmaker --pack MapBinDBN.PAK 00000001.MAP 00000002.MAP ...
  *
  *        Version: 1.0
  *       Revision: none
@@ -18,12 +23,76 @@
  * =====================================================================================
  */
 
+#include <map>
+#include <memory>
+#include <vector>
 #include <cstdio>
 #include <cstring>
 #include "dbcomid.hpp"
+#include "bitgrid.hpp"
+#include "navgraph.hpp"
+#include "hexstring.hpp"
+#include "mapbinpack.hpp"
+#include "mir2xmapdata.hpp"
+
+static int CreatePack(int argc, char *argv[])
+{
+    std::vector<std::unique_ptr<Mir2xMapData>> stMapDataV;
+    std::map<uint32_t, const Mir2xMapData *> stMapList;
+
+    for(int nIndex = 3; nIndex < argc; ++nIndex){
+        // same key as MapBinDB
+        // file name is the map id in hex
+        auto szBaseName = std::strrchr(argv[nIndex], '/') ? (std::strrchr(argv[nIndex], '/') + 1) : argv[nIndex];
+        auto nMapID     = HexString::ToHex<uint32_t, 4>(szBaseName);
+
+        stMapDataV.emplace_back(std::make_unique<Mir2xMapData>());
+        if(!(nMapID && stMapDataV.back()->Load(argv[nIndex]))){
+            std::fprintf(stderr, "Invalid map file: %s\n", argv[nIndex]);
+            return 1;
+        }
+
+        if(stMapList.find(nMapID) != stMapList.end()){
+            std::fprintf(stderr, "Duplicated map id: %08X, %s\n", nMapID, argv[nIndex]);
+            return 1;
+        }
+        stMapList[nMapID] = stMapDataV.back().get();
+    }
+
+    // same walkable grids as ServerMap
+    // then the map can take the graph without building
+    std::vector<std::unique_ptr<NavGraph>> stNavGraphV;
+    std::map<uint32_t, const NavGraph *> stNavList;
+
+    for(auto &rstMap: stMapList){
+        BitGrid stGround(rstMap.second->W(), rstMap.second->H());
+        for(int nY = 0; nY < stGround.H(); ++nY){
+            for(int nX = 0; nX < stGround.W(); ++nX){
+                stGround.Set(nX, nY, rstMap.second->Cell(nX, nY).CanThrough());
+            }
+        }
+
+        stNavGraphV.emplace_back(std::make_unique<NavGraph>());
+        if(!stNavGraphV.back()->Build(stGround)){
+            std::fprintf(stderr, "Failed to build navigation graph: %08X\n", rstMap.first);
+            return 1;
+        }
+        stNavList[rstMap.first] = stNavGraphV.back().get();
+    }
+
+    if(!MapBinPack::Save(argv[2], stMapList, stNavList)){
+        std::fprintf(stderr, "Failed to create map pack: %s\n", argv[2]);
+        return 1;
+    }
+    return 0;
+}
 
 int main(int argc, char *argv[])
 {
+    if(argc >= 4 && !std::strcmp(argv[1], "--pack")){
+        return CreatePack(argc, argv);
+    }
+
     if(argc == 2){
         if(auto nMapID = DBCOM_MAPID(argv[1])){
             std::printf("%08X", nMapID);
@@ -1,7 +1,7 @@
 #!/bin/bash
 
 # use a provided string -> id converter
-# then convert all map to the id and store in a zip file
+# then convert all map to the id and store in a zip file and an uncompressed pack
 # usage:
 #        main.sh path/to/mir2xmap  path/to/converter
 
@@ -11,7 +11,8 @@ function printUsage()
     echo "      main.sh path/to/mir2xmap path/to/converter"
     echo "# 1. exam all needed map package in mir2xmap: DESC.BIN and IMG"
     echo "# 2. converter accepts basename only and covert to mapID as %08X"
-    echo "# 3. create two dbs: MapDBN.ZIP and MapBinDBN.ZIP"
+    echo "# 3. create three dbs: MapDBN.ZIP, MapBinDBN.ZIP and MapBinDBN.PAK"
+    echo "# 4. MapBinDBN.PAK is mmap-ed by server, preferred over MapBinDBN.ZIP"
 }
 
 if [[ $# != 2 ]]
@@ -22,6 +23,10 @@ fi
 
 rm -f MapDBN.ZIP
 rm -f MapBinDBN.ZIP
+rm -f MapBinDBN.PAK
+
+# keep all .MAP files for the pack
+packDir=$(mktemp -d)
 
 for mapModuleName in `ls $1`
 do
@@ -61,5 +66,12 @@ do
     echo $mapModuleName : update MapBinDBN.ZIP
     cp -f $1/$mapModuleName/DESC.BIN $mapModuleCode.MAP
     printf "INFO: $mapModuleName -> $mapModuleCode" && zip -j MapBinDBN.ZIP $mapModuleCode.MAP
-    rm -f $mapModuleCode.MAP
+    mv -f $mapModuleCode.MAP $packDir/
 done
+
+if ls $packDir/*.MAP > /dev/null 2>&1
+then
+    echo "INFO: create MapBinDBN.PAK"
+    $2 --pack MapBinDBN.PAK $packDir/*.MAP || echo "WARNING: failed to create MapBinDBN.PAK"
+fi
+rm -rf $packDir